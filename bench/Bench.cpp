@@ -0,0 +1,1259 @@
+/**
+ *  \file
+ *  \brief  Headless benchmarks of the result parsing and filtering core
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <direct.h>
+#define popen   _popen
+#define pclose  _pclose
+#else
+#include <ftw.h>
+#endif
+#include <new>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Common.h"
+#include "PathTable.h"
+#include "Config.h"
+#include "DbManager.h"
+#include "Cmd.h"
+#include "LineParser.h"
+#include "TabParser.h"
+#include "TabStore.h"
+#include "OutputBuffer.h"
+#include "GrepEngine.h"
+#include "GrepIndex.h"
+#include "SymbolResolver.h"
+#include "StrUniquenessChecker.h"
+#include "ResultGen.h"
+
+
+using namespace GTags;
+
+
+namespace
+{
+
+// Heap allocations made so far - the alloc.* benchmarks report their count as items
+volatile LONG AllocCount = 0;
+
+} // anonymous namespace
+
+
+/**
+ *  \brief
+ */
+void* operator new(size_t size)
+{
+    InterlockedIncrement(&AllocCount);
+
+    void* ptr = malloc(size ? size : 1);
+    if (ptr == NULL)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+
+/**
+ *  \brief
+ */
+void operator delete(void* ptr) throw()
+{
+    free(ptr);
+}
+
+
+namespace
+{
+
+const char cUsage[] =
+    "Usage: gtags_bench [options]\n"
+    "  --files=N        number of files in the generated project (2000)\n"
+    "  --hits=N         search hits per file (10)\n"
+    "  --symbols=N      number of symbols for completion (20000)\n"
+    "  --depth=N        max directory depth of the generated paths (3)\n"
+    "  --line-len=N     length of the generated source lines (60)\n"
+    "  --file-lines=N   lines per file in the generated source tree (200)\n"
+    "  --seed=N         generator seed (1)\n"
+    "  --iterations=N   measured iterations per benchmark (10)\n"
+    "  --filter=STR     run only the benchmarks whose name contains STR\n"
+    "  --format=FMT     json (one object per line), csv or text (text)\n"
+    "  --output=FILE    write the results to FILE instead of stdout\n"
+    "  --global=DIR     also time DIR/global -g on the generated source tree\n";
+
+
+/**
+ *  \struct  Options
+ *  \brief
+ */
+struct Options
+{
+    Options() : _iterations(10), _format("text") {}
+
+    ResultGen::Params   _gen;
+    unsigned            _iterations;
+    std::string         _filter;
+    std::string         _format;
+    std::string         _output;
+    std::string         _global;
+};
+
+
+/**
+ *  \class  Reporter
+ *  \brief  Prints the results in machine-readable (json, csv) or human-readable form
+ */
+class Reporter
+{
+public:
+    Reporter(const Options& opts, FILE* fp) : _opts(opts), _fp(fp) {}
+
+    void Header();
+    void Add(const char* name, std::vector<double>& timesUs, unsigned items, size_t bytes);
+
+private:
+    const Options&  _opts;
+    FILE*           _fp;
+};
+
+
+/**
+ *  \brief
+ */
+void Reporter::Header()
+{
+    const ResultGen::Params& gen = _opts._gen;
+
+    if (_opts._format == "json")
+    {
+        fprintf(_fp, "{\"params\":{\"files\":%u,\"hits\":%u,\"symbols\":%u,\"depth\":%u,\"lineLen\":%u,"
+                "\"fileLines\":%u,\"seed\":%u,\"iterations\":%u}}\n",
+                gen._files, gen._hitsPerFile, gen._symbols, gen._pathDepth, gen._lineLen, gen._fileLines,
+                gen._seed, _opts._iterations);
+    }
+    else if (_opts._format == "csv")
+    {
+        fprintf(_fp, "name,iterations,items,bytes,min_us,median_us,mean_us,max_us,items_per_s,mb_per_s\n");
+    }
+    else
+    {
+        fprintf(_fp, "# files %u, hits/file %u, symbols %u, depth %u, line len %u, file lines %u, seed %u, "
+                "iterations %u\n", gen._files, gen._hitsPerFile, gen._symbols, gen._pathDepth, gen._lineLen,
+                gen._fileLines, gen._seed, _opts._iterations);
+        fprintf(_fp, "%-32s %10s %12s %12s %12s %12s %14s %10s\n", "# Benchmark", "Items", "Bytes",
+                "Min us", "Median us", "Mean us", "Items/s", "MB/s");
+    }
+}
+
+
+/**
+ *  \brief
+ */
+void Reporter::Add(const char* name, std::vector<double>& timesUs, unsigned items, size_t bytes)
+{
+    std::sort(timesUs.begin(), timesUs.end());
+
+    double sum = 0;
+    for (double t : timesUs)
+        sum += t;
+
+    const size_t count = timesUs.size();
+    const double minUs = timesUs.front();
+    const double maxUs = timesUs.back();
+    const double medianUs = (count % 2) ? timesUs[count / 2] : (timesUs[count / 2 - 1] + timesUs[count / 2]) / 2;
+    const double meanUs = sum / count;
+    const double itemsPerSec = medianUs > 0 ? items * 1e6 / medianUs : 0;
+    const double mbPerSec = medianUs > 0 ? bytes / medianUs : 0;
+
+    if (_opts._format == "json")
+    {
+        fprintf(_fp, "{\"name\":\"%s\",\"iterations\":%u,\"items\":%u,\"bytes\":%zu,\"min_us\":%.2f,"
+                "\"median_us\":%.2f,\"mean_us\":%.2f,\"max_us\":%.2f,\"items_per_s\":%.0f,\"mb_per_s\":%.2f}\n",
+                name, (unsigned)count, items, bytes, minUs, medianUs, meanUs, maxUs, itemsPerSec, mbPerSec);
+    }
+    else if (_opts._format == "csv")
+    {
+        fprintf(_fp, "%s,%u,%u,%zu,%.2f,%.2f,%.2f,%.2f,%.0f,%.2f\n",
+                name, (unsigned)count, items, bytes, minUs, medianUs, meanUs, maxUs, itemsPerSec, mbPerSec);
+    }
+    else
+    {
+        fprintf(_fp, "%-32s %10u %12zu %12.1f %12.1f %12.1f %14.0f %10.1f\n",
+                name, items, bytes, minUs, medianUs, meanUs, itemsPerSec, mbPerSec);
+    }
+
+    fflush(_fp);
+}
+
+
+/**
+ *  \class  Bench
+ *  \brief  Runs the benchmarks - prepare() is not measured, run() returns the
+ *          number of processed items
+ */
+class Bench
+{
+public:
+    Bench(const Options& opts, Reporter& reporter) : _opts(opts), _reporter(reporter), _failedChecks(0) {}
+
+    bool Enabled(const char* name) const
+    {
+        return (_opts._filter.empty() || strstr(name, _opts._filter.c_str()));
+    }
+
+    void Run(const char* name, size_t bytes, std::function<void()> prepare, std::function<unsigned()> run)
+    {
+        if (!Enabled(name))
+            return;
+
+        // warm-up
+        prepare();
+        unsigned items = run();
+
+        std::vector<double> timesUs;
+        timesUs.reserve(_opts._iterations);
+
+        for (unsigned i = 0; i < _opts._iterations; ++i)
+        {
+            prepare();
+
+            const auto start = std::chrono::steady_clock::now();
+            items = run();
+            const auto end = std::chrono::steady_clock::now();
+
+            timesUs.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        }
+
+        _reporter.Add(name, timesUs, items, bytes);
+    }
+
+    // Behaviour the benchmarks rely on - a failed check makes the bench exit with 2
+    void Check(const char* name, bool passed)
+    {
+        if (passed)
+            return;
+
+        fprintf(stderr, "Check failed: %s\n", name);
+        ++_failedChecks;
+    }
+
+    inline unsigned FailedChecks() const { return _failedChecks; }
+
+private:
+    const Options&  _opts;
+    Reporter&       _reporter;
+    unsigned        _failedChecks;
+};
+
+
+/**
+ *  \brief
+ */
+bool parseOptions(int argc, char* argv[], Options& opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* val = strchr(arg, '=');
+
+        if (strncmp(arg, "--", 2) || !val)
+            return false;
+
+        const std::string key(arg + 2, val - arg - 2);
+        ++val;
+
+        if (key == "files")
+            opts._gen._files = strtoul(val, NULL, 10);
+        else if (key == "hits")
+            opts._gen._hitsPerFile = strtoul(val, NULL, 10);
+        else if (key == "symbols")
+            opts._gen._symbols = strtoul(val, NULL, 10);
+        else if (key == "depth")
+            opts._gen._pathDepth = strtoul(val, NULL, 10);
+        else if (key == "line-len")
+            opts._gen._lineLen = strtoul(val, NULL, 10);
+        else if (key == "file-lines")
+            opts._gen._fileLines = strtoul(val, NULL, 10);
+        else if (key == "seed")
+            opts._gen._seed = strtoul(val, NULL, 10);
+        else if (key == "iterations")
+            opts._iterations = strtoul(val, NULL, 10);
+        else if (key == "filter")
+            opts._filter = val;
+        else if (key == "format")
+            opts._format = val;
+        else if (key == "output")
+            opts._output = val;
+        else if (key == "global")
+            opts._global = val;
+        else
+            return false;
+    }
+
+    if (opts._format != "json" && opts._format != "csv" && opts._format != "text")
+        return false;
+
+    if (!opts._gen._files || !opts._gen._symbols || !opts._iterations)
+        return false;
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+void runParserBenchmarks(Bench& bench, ResultGen& gen, const DbHandle& db)
+{
+    const DbConfig defaultCfg = *db->GetConfig();
+
+    DbConfig libCfg = defaultCfg;
+    libCfg._useLibDb = true;
+    libCfg._libDbPaths.push_back(CPath(_T("C:\\bench\\")));
+    libCfg.InternPaths();
+
+    DbConfig filterCfg = defaultCfg;
+    filterCfg._usePathFilter = true;
+    filterCfg._pathFilters.push_back(CPath(_T("test/")));
+    filterCfg._pathFilters.push_back(CPath(_T("third_party/")));
+    filterCfg._pathFilters.push_back(CPath(_T("src/test/")));
+    filterCfg._pathFilters.push_back(CPath(_T("lib/third_party/")));
+    filterCfg.InternPaths();
+
+    const CText tag(gen.Tag().c_str());
+
+    std::vector<char> grep;
+    std::vector<char> grepLib;
+    std::vector<char> files;
+    std::vector<char> symbols;
+    std::vector<char> symbolsLib;
+
+    gen.Grep(grep);
+    gen.Grep(grepLib, true);
+    gen.FileList(files);
+    gen.Completion(symbols);
+    gen.Completion(symbolsLib, true);
+
+    CmdPtr_t cmd;
+
+    // Result window tab parsing
+    {
+        TabParser parser;
+
+        bench.Run("tab_parser.find_reference", grep.size(),
+            [&]() {
+                db->SetConfig(defaultCfg);
+                cmd.reset(new Cmd(FIND_REFERENCE, _T("Find Reference"), db, NULL, tag.C_str()));
+                cmd->SetResult(grep);
+            },
+            [&]() { return (unsigned)parser.Parse(cmd); });
+
+        bench.Run("tab_parser.find_definition_libdb", grepLib.size(),
+            [&]() {
+                db->SetConfig(libCfg);
+                cmd.reset(new Cmd(FIND_DEFINITION, _T("Find Definition"), db, NULL, tag.C_str()));
+                cmd->SetResult(grepLib);
+            },
+            [&]() { return (unsigned)parser.Parse(cmd); });
+
+        bench.Run("tab_parser.path_filter", grep.size(),
+            [&]() {
+                db->SetConfig(filterCfg);
+                cmd.reset(new Cmd(FIND_REFERENCE, _T("Find Reference"), db, NULL, tag.C_str()));
+                cmd->SetResult(grep);
+            },
+            [&]() { return (unsigned)parser.Parse(cmd); });
+
+        bench.Run("tab_parser.find_file", files.size(),
+            [&]() {
+                db->SetConfig(defaultCfg);
+                cmd.reset(new Cmd(FIND_FILE, _T("Find File"), db, NULL, _T("src")));
+                cmd->SetResult(files);
+            },
+            [&]() { return (unsigned)parser.Parse(cmd); });
+
+        // Tab document formatting - all result lines vs. the file lines only (none loaded)
+        db->SetConfig(defaultCfg);
+        cmd.reset(new Cmd(FIND_REFERENCE, _T("Find Reference"), db, NULL, tag.C_str()));
+        cmd->SetResult(grep);
+        parser.Parse(cmd);
+
+        CTextA text;
+
+        bench.Run("tab_parser.format_all", grep.size(),
+            []() {},
+            [&]() {
+                unsigned lines = 0;
+                text = parser.GetText();
+                for (unsigned i = 0; i < parser.FilesCount(); ++i)
+                {
+                    parser.AppendFile(text, i);
+                    parser.AppendResults(text, i);
+                    lines += 1 + parser.ResultsCount(i);
+                }
+                return lines;
+            });
+
+        bench.Run("tab_parser.format_files", grep.size(),
+            []() {},
+            [&]() {
+                text = parser.GetText();
+                for (unsigned i = 0; i < parser.FilesCount(); ++i)
+                    parser.AppendFile(text, i);
+                return parser.FilesCount();
+            });
+
+        // Inactive tab compression and the spill to disk when over the memory budget
+        auto parseReferences = [&]() {
+                cmd.reset(new Cmd(FIND_REFERENCE, _T("Find Reference"), db, NULL, tag.C_str()));
+                cmd->SetResult(grep);
+                parser.Parse(cmd);
+            };
+
+        std::vector<char> packed;
+
+        bench.Run("tab_parser.pack", grep.size(),
+            parseReferences,
+            [&]() { parser.Pack(packed); return 1u; });
+
+        bench.Run("tab_parser.unpack", grep.size(),
+            []() {},
+            [&]() { return (unsigned)parser.Unpack(packed.data(), packed.size()); });
+
+        TabStore& store = TabStore::Get();
+        store.SetBudget(0);
+
+        bench.Run("tab_store.spill_restore", grep.size(),
+            parseReferences,
+            [&]() {
+                store.Pack(&parser);
+                return (unsigned)store.Restore(&parser);
+            });
+
+        // Search in results over the parsed model
+        parseReferences();
+
+        const CTextA search(tag.C_str());
+        std::vector<TabParser::Match> matches;
+
+        bench.Run("tab_parser.find_all", grep.size(),
+            []() {},
+            [&]() {
+                parser.FindAll(search.C_str(), false, true, false, matches);
+                return (unsigned)matches.size();
+            });
+
+        bench.Run("tab_parser.find_all_ignore_case", grep.size(),
+            []() {},
+            [&]() {
+                parser.FindAll(search.C_str(), true, false, false, matches);
+                return (unsigned)matches.size();
+            });
+
+        bench.Run("tab_parser.find_all_regexp", grep.size(),
+            []() {},
+            [&]() {
+                parser.FindAll(search.C_str(), false, true, true, matches);
+                return (unsigned)matches.size();
+            });
+    }
+
+    // Find in results matches stay within the file path or the result preview they start in
+    if (bench.Enabled("tab_parser.find_all_spans"))
+    {
+        static const char cResults[] = "src/ab.c:1:cd ab cd\nsrc/ab.c:2:abcd\nlib/x.c:3:ab\n";
+
+        TabParser parser;
+        CmdPtr_t cmd(new Cmd(FIND_REFERENCE, _T("Find Reference"), db, NULL, _T("ab")));
+        cmd->SetResult(CTextA(cResults));
+        parser.Parse(cmd);
+
+        std::vector<TabParser::Match> literal, regExp;
+
+        auto findAll = [&](const char* pattern, bool ignoreCase) -> unsigned
+            {
+                parser.FindAll(pattern, ignoreCase, false, false, literal);
+                parser.FindAll(pattern, ignoreCase, false, true, regExp);
+
+                bool same = (literal.size() == regExp.size());
+                for (size_t i = 0; same && i < literal.size(); ++i)
+                    same = (literal[i]._file == regExp[i]._file && literal[i]._result == regExp[i]._result &&
+                            literal[i]._col == regExp[i]._col && literal[i]._len == regExp[i]._len);
+
+                return same ? (unsigned)literal.size() : (unsigned)-1;
+            };
+
+        // Path "src/ab.c", previews "cd ab cd", "abcd", path "lib/x.c", preview "ab"
+        bench.Check("tab_parser.find_all_spans path-preview", findAll("ccd", false) == 0);
+        bench.Check("tab_parser.find_all_spans preview-preview", findAll("cdab", false) == 0);
+        bench.Check("tab_parser.find_all_spans preview-path", findAll("dlib", true) == 0);
+        bench.Check("tab_parser.find_all_spans within", findAll("ab", false) == 4 && findAll("AB", true) == 4);
+
+        // The results window selects the match at its tab line column and maps the caret back to the match
+        bool selected = !literal.empty();
+
+        for (const auto& match : literal)
+        {
+            CTextA tab;
+            if (match._result < 0)
+                parser.AppendFile(tab, match._file);
+            else
+                parser.AppendResults(tab, match._file);
+
+            // Each tab line starts with '\n'
+            const char* line = tab.C_str();
+            for (int i = 0; line && i < match._result; ++i)
+                line = strchr(line + 1, '\n');
+
+            const unsigned lineCol = TabParser::LineCol(match._result, match._col);
+
+            selected = selected && line && strlen(line + 1) >= lineCol + match._len &&
+                    !strncmp(line + 1 + lineCol, "ab", match._len) &&
+                    TabParser::SpanCol(match._result, lineCol) == match._col &&
+                    TabParser::SpanCol(match._result, lineCol - match._col) == 0;
+        }
+
+        bench.Check("tab_parser.find_all_spans tab columns", selected);
+    }
+
+    // Path filtering alone
+    bench.Run("tab_parser.filter_entry", files.size(),
+        []() {},
+        [&]() {
+            unsigned filtered = 0;
+            for (const auto& file : gen.Files())
+                if (TabParser::FilterEntry(filterCfg, file.c_str(), file.size()))
+                    ++filtered;
+            return (unsigned)gen.Files().size();
+        });
+
+    // Config snapshot taken by each command - GTAGSLIBPATH is composed once when the config is set
+    {
+        static const unsigned cSnapshots = 10000;
+
+        db->SetConfig(libCfg);
+
+        bench.Run("db_config.snapshot", cSnapshots,
+            []() {},
+            [&]() {
+                unsigned len = 0;
+                for (unsigned i = 0; i < cSnapshots; ++i)
+                {
+                    const DbConfigPtr cfg = db->GetConfig();
+                    len += cfg->_libPathEnv.Len();
+                }
+                return len ? cSnapshots : 0;
+            });
+    }
+
+    // Completion list parsing
+    {
+        LineParser parser;
+
+        bench.Run("line_parser.completion", symbols.size(),
+            [&]() {
+                db->SetConfig(defaultCfg);
+                cmd.reset(new Cmd(AUTOCOMPLETE, _T("AutoComplete"), db, NULL, _T("get")));
+                cmd->SetResult(symbols);
+            },
+            [&]() { return (unsigned)parser.Parse(cmd); });
+
+        bench.Run("line_parser.completion_libdb", symbolsLib.size(),
+            [&]() {
+                db->SetConfig(libCfg);
+                cmd.reset(new Cmd(AUTOCOMPLETE, _T("AutoComplete"), db, NULL, _T("get")));
+                cmd->SetResult(symbolsLib);
+            },
+            [&]() { return (unsigned)parser.Parse(cmd); });
+
+        bench.Run("line_parser.find_file", files.size(),
+            [&]() {
+                db->SetConfig(defaultCfg);
+                cmd.reset(new Cmd(AUTOCOMPLETE_FILE, _T("AutoComplete File"), db, NULL, _T("src")));
+                cmd->SetResult(files);
+            },
+            [&]() { return (unsigned)parser.Parse(cmd); });
+    }
+
+    db->SetConfig(defaultCfg);
+}
+
+
+/**
+ *  \brief  Filtering as done on each key press in the search and autocomplete windows
+ */
+void runFilterBenchmarks(Bench& bench, ResultGen& gen, const DbHandle& db)
+{
+    std::vector<char> symbols;
+    gen.Completion(symbols);
+
+    CmdPtr_t cmd(new Cmd(AUTOCOMPLETE, _T("AutoComplete"), db, NULL, _T("get")));
+    cmd->SetResult(symbols);
+
+    LineParser parser;
+    parser.Parse(cmd);
+
+    const CText tag(gen.Tag().c_str());
+    std::vector<TCHAR*> filtered;
+
+    bench.Run("completion_filter.prefix", symbols.size(),
+        []() {},
+        [&]() {
+            unsigned entries = 0;
+            for (unsigned len = 1; len <= tag.Len(); ++len)
+            {
+                parser.FilterList(tag.C_str(), len, false, filtered);
+                entries += parser.GetList().size();
+            }
+            return entries;
+        });
+
+    bench.Run("completion_filter.prefix_ic", symbols.size(),
+        []() {},
+        [&]() {
+            unsigned entries = 0;
+            for (unsigned len = 1; len <= tag.Len(); ++len)
+            {
+                parser.FilterList(tag.C_str(), len, true, filtered);
+                entries += parser.GetList().size();
+            }
+            return entries;
+        });
+}
+
+
+/**
+ *  \brief  Symbol table load and resolution of the identifiers in a screen of source
+ */
+void runSymbolBenchmarks(Bench& bench, ResultGen& gen, const DbHandle& db)
+{
+    // First half of the names are listed as defined, the rest as referenced only
+    std::vector<char> names;
+    gen.Completion(names);
+
+    unsigned definitionsLen = (names.size() - 1) / 2;
+    while (definitionsLen && names[definitionsLen - 1] != '\n')
+        --definitionsLen;
+
+    std::vector<char> source;
+    gen.Source(source);
+
+    std::vector<std::string> words;
+    for (size_t i = 0; i < source.size();)
+    {
+        if (!isalnum((unsigned char)source[i]) && source[i] != '_')
+        {
+            ++i;
+            continue;
+        }
+
+        const size_t wordStart = i;
+        while (i < source.size() && (isalnum((unsigned char)source[i]) || source[i] == '_'))
+            ++i;
+
+        if (!isdigit((unsigned char)source[wordStart]))
+            words.push_back(std::string(source.data() + wordStart, i - wordStart));
+    }
+
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    CmdPtr_t cmd(new Cmd(LIST_SYMBOLS, _T("List Symbols"), db));
+    cmd->SetResult(names);
+
+    std::unique_ptr<SymbolTable> table;
+
+    bench.Run("symbol_table.load", names.size(),
+        [&]() { table.reset(new SymbolTable(definitionsLen)); },
+        [&]() { return (unsigned)table->Parse(cmd); });
+
+    std::vector<SymbolTable::Kind_t> kinds;
+
+    bench.Run("symbol_table.resolve_batch", source.size(),
+        []() {},
+        [&]() {
+            table->Resolve(words, kinds);
+            return (unsigned)std::count(kinds.begin(), kinds.end(), SymbolTable::DEFINITION);
+        });
+
+    bench.Run("symbol_table.find_each", source.size(),
+        []() {},
+        [&]() {
+            unsigned definitions = 0;
+            for (const auto& word : words)
+                if (table->Find(word.c_str(), word.size()) == SymbolTable::DEFINITION)
+                    ++definitions;
+            return definitions;
+        });
+}
+
+
+/**
+ *  \brief
+ */
+void runStringBenchmarks(Bench& bench, ResultGen& gen)
+{
+    std::vector<char> grep;
+    gen.Grep(grep, true);
+
+    std::vector<char> lines;
+
+    bench.Run("str_uniqueness.grep_lines", grep.size(),
+        [&]() {
+            lines = grep;
+            for (auto& ch : lines)
+                if (ch == '\n')
+                    ch = 0;
+        },
+        [&]() {
+            StrUniquenessChecker<char> checker;
+            unsigned unique = 0;
+
+            for (size_t pos = 0; pos + 1 < lines.size(); pos += strlen(&lines[pos]) + 1)
+                if (checker.IsUnique(&lines[pos]))
+                    ++unique;
+
+            return unique;
+        });
+
+    bench.Run("ctext.widen_result", grep.size(),
+        []() {},
+        [&]() {
+            CText wide(grep.data());
+            return wide.Len();
+        });
+
+    const CText wideResult(grep.data());
+
+    bench.Run("ctext.narrow_result", grep.size(),
+        []() {},
+        [&]() {
+            CTextA narrow(wideResult.C_str());
+            return narrow.Len();
+        });
+
+    size_t filesBytes = 0;
+    for (const auto& file : gen.Files())
+        filesBytes += file.size();
+
+    bench.Run("ctext.append_paths", filesBytes,
+        []() {},
+        [&]() {
+            CTextA buf;
+            for (const auto& file : gen.Files())
+            {
+                buf += "\n\t";
+                buf.Append(file.c_str(), file.size());
+            }
+            return (unsigned)gen.Files().size();
+        });
+
+    std::vector<CPath> paths;
+    for (const auto& file : gen.Files())
+    {
+        CPath path(_T("C:\\bench\\project\\"));
+        path += CText(file.c_str());
+        paths.push_back(path);
+    }
+
+    std::vector<CPath> dirs;
+    dirs.push_back(CPath(_T("C:\\bench\\project\\src\\")));
+    dirs.push_back(CPath(_T("C:\\bench\\project\\lib\\core\\")));
+    dirs.push_back(CPath(_T("C:\\bench\\project\\include/util/")));
+    dirs.push_back(CPath(_T("C:\\bench\\other\\")));
+
+    bench.Run("cpath.is_parent_of", filesBytes,
+        []() {},
+        [&]() {
+            unsigned matches = 0;
+            for (const auto& path : paths)
+                for (const auto& dir : dirs)
+                    if (dir.IsParentOf(path))
+                        ++matches;
+            return (unsigned)(paths.size() * dirs.size());
+        });
+
+    bench.Run("cpath.strip_filename", filesBytes,
+        []() {},
+        [&]() {
+            for (const auto& path : paths)
+            {
+                CPath dir(path);
+                dir.StripFilename();
+            }
+            return (unsigned)paths.size();
+        });
+
+    // The same checks on the interned paths - interning is a lookup once the paths are in the table
+    PathTable& pathTable = PathTable::Get();
+
+    std::vector<PathId> pathIds;
+    for (const auto& path : paths)
+        pathIds.push_back(pathTable.Intern(path));
+
+    std::vector<PathId> dirIds;
+    for (const auto& dir : dirs)
+        dirIds.push_back(pathTable.Intern(dir));
+
+    bench.Run("path_table.intern", filesBytes,
+        []() {},
+        [&]() {
+            unsigned found = 0;
+            for (const auto& path : paths)
+                if (pathTable.Intern(path) != PathTable::cInvalidId)
+                    ++found;
+            return found;
+        });
+
+    bench.Run("path_table.is_parent_of", filesBytes,
+        []() {},
+        [&]() {
+            unsigned matches = 0;
+            for (PathId pathId : pathIds)
+                for (PathId dirId : dirIds)
+                    if (pathTable.IsParentOf(dirId, pathId))
+                        ++matches;
+            return (unsigned)(pathIds.size() * dirIds.size());
+        });
+}
+
+
+/**
+ *  \brief  Heap allocations (items) of a typical search -> show -> open flow:
+ *          the tag under the caret is widened into the command, the result
+ *          is parsed and formatted into a tab, then a few results are opened
+ *          and pushed to the location history. The paths and the tag are
+ *          short enough to be kept inline by CText/CPath.
+ */
+void runAllocBenchmarks(Bench& bench, ResultGen& gen, const DbHandle& db)
+{
+    std::vector<char> grep;
+    gen.Grep(grep);
+
+    const unsigned cOpened = 10;
+
+    bench.Run("alloc.search", 0,
+        []() {},
+        [&]() {
+            const LONG start = AllocCount;
+            {
+                const CTextA selection(gen.Tag().c_str());
+                CText tag(selection.C_str());
+
+                CmdPtr_t cmd(new Cmd(FIND_REFERENCE, _T("Find Reference"), db, NULL));
+                cmd->Tag(std::move(tag));
+                CText name(cmd->Name());
+                name += _T(" \"");
+                name += cmd->Tag();
+                name += _T("\"");
+            }
+            return (unsigned)(AllocCount - start);
+        });
+
+    bench.Run("alloc.search_show_open", grep.size(),
+        []() {},
+        [&]() {
+            const LONG start = AllocCount;
+            {
+                const CTextA selection(gen.Tag().c_str());
+                CText tag(selection.C_str());
+
+                CmdPtr_t cmd(new Cmd(FIND_REFERENCE, _T("Find Reference"), db, NULL));
+                cmd->Tag(std::move(tag));
+                cmd->SetResult(grep);
+
+                TabParser parser;
+                parser.Parse(cmd);
+
+                const CTextA projectPath(db->GetPath().C_str());
+                const CTextA search(cmd->Tag().C_str());
+
+                CTextA text = parser.GetText();
+                for (unsigned i = 0; i < parser.FilesCount(); ++i)
+                    parser.AppendFile(text, i);
+
+                std::vector<CPath> history;
+                history.reserve(cOpened);
+
+                for (unsigned i = 0; i < cOpened && i < gen.Files().size(); ++i)
+                {
+                    CPath file(projectPath.C_str());
+                    file += gen.Files()[i].c_str();
+                    history.push_back(std::move(file));
+                }
+            }
+            return (unsigned)(AllocCount - start);
+        });
+
+    bench.Run("alloc.open_paths", 0,
+        []() {},
+        [&]() {
+            const LONG start = AllocCount;
+            {
+                const CTextA projectPath(db->GetPath().C_str());
+
+                for (const auto& name : gen.Files())
+                {
+                    CPath file(projectPath.C_str());
+                    file += name.c_str();
+                    CPath folder(file);
+                    folder.StripFilename();
+                }
+            }
+            return (unsigned)(AllocCount - start);
+        });
+}
+
+
+#ifndef _WIN32
+/**
+ *  \brief
+ */
+int removeEntry(const char* path, const struct stat*, int, struct FTW*)
+{
+    return remove(path);
+}
+#endif
+
+
+/**
+ *  \brief
+ */
+std::string makeTempDir()
+{
+#ifdef _WIN32
+    char dir[] = "gtags_bench_XXXXXX";
+    if (_mktemp_s(dir, sizeof(dir)) || _mkdir(dir))
+        return std::string();
+#else
+    char dir[] = "/tmp/gtags_bench.XXXXXX";
+    if (!mkdtemp(dir))
+        return std::string();
+#endif
+
+    return dir;
+}
+
+
+/**
+ *  \brief
+ */
+void removeTree(const std::string& dir)
+{
+#ifdef _WIN32
+    system(("rmdir /s /q \"" + dir + "\"").c_str());
+#else
+    nftw(dir.c_str(), removeEntry, 8, FTW_DEPTH | FTW_PHYS);
+#endif
+}
+
+
+/**
+ *  \brief  Runs global -g in the generated source tree and returns the number of output lines
+ */
+unsigned runGlobalGrep(const std::string& cmdLine)
+{
+    FILE* pipe = popen(cmdLine.c_str(), "r");
+    if (pipe == NULL)
+        return 0;
+
+    unsigned lines = 0;
+    char buf[65536];
+
+    for (size_t len; (len = fread(buf, 1, sizeof(buf), pipe)) > 0;)
+        for (size_t i = 0; i < len; ++i)
+            if (buf[i] == '\n')
+                ++lines;
+
+    pclose(pipe);
+
+    return lines;
+}
+
+
+/**
+ *  \brief  Command output collection the way ReadPipe does it - in memory
+ *          below the spill size and in a mapped temporary file above it
+ */
+void runOutputBenchmarks(Bench& bench, ResultGen& gen)
+{
+    std::vector<char> grep;
+    gen.Grep(grep);
+
+    OutputBuffer output;
+
+    auto fill = [&](size_t size) {
+            output.Clear();
+            for (size_t pos = 0; output.Size() < size; pos = (pos + 4096) % grep.size())
+            {
+                size_t len = std::min((size_t)4096, grep.size() - pos);
+                char* buf = output.Reserve(len);
+                if (!buf)
+                    break;
+                memcpy(buf, &grep[pos], len);
+                output.Commit(len);
+            }
+            output.Terminate();
+            return (unsigned)output.IsSpilled();
+        };
+
+    bench.Run("output_buffer.memory", 8 * 1024 * 1024,
+        []() {},
+        [&]() { return fill(8 * 1024 * 1024); });
+
+    bench.Run("output_buffer.spill", 64 * 1024 * 1024,
+        []() {},
+        [&]() { return fill(64 * 1024 * 1024); });
+
+    output.Clear();
+}
+
+
+/**
+ *  \brief  Trigram index build and query on the generated source tree. The
+ *          index size is reported as the bytes of grep_index.open, the number
+ *          of candidate files as the items of the queries. The rare symbol is
+ *          in a few percent of the files while the tag is in all of them.
+ */
+void runGrepIndexBenchmarks(Bench& bench, ResultGen& gen, const CPath& rootPath, const std::vector<char>& fileList,
+        size_t treeBytes)
+{
+    const std::string& rare = gen.Symbols()[1];
+    const std::string rareRegExp = "^ +" + rare + "\\(";
+
+    bench.Run("grep_index.build", treeBytes,
+        []() {},
+        [&]() { return GrepIndex::Build(rootPath, fileList.data()) ? gen.Files().size() : 0; });
+
+    if (!GrepIndex::Build(rootPath, fileList.data()))
+    {
+        fputs("Cannot build the grep index\n", stderr);
+        return;
+    }
+
+    GrepIndex index;
+    index.Open(rootPath);
+    const size_t indexSize = index.Size();
+    index.Close();
+
+    bench.Run("grep_index.open", indexSize,
+        [&]() { index.Close(); },
+        [&]() { return index.Open(rootPath) ? index.TrigramsCount() : 0; });
+
+    bench.Run("grep_index.query_literal", indexSize,
+        [&]() { index.Close(); },
+        [&]() { index.Open(rootPath); index.Narrow(rare.c_str(), false); return index.CandidatesCount(); });
+
+    bench.Run("grep_index.query_regexp", indexSize,
+        [&]() { index.Close(); },
+        [&]() { index.Open(rootPath); index.Narrow(rareRegExp.c_str(), true); return index.CandidatesCount(); });
+
+    OutputBuffer output;
+
+    GrepEngine rareGrep(rare.c_str(), false, false);
+    GrepEngine rareIndexed(rare.c_str(), false, false);
+    GrepEngine literalIndexed(gen.Tag().c_str(), false, false);
+
+    GrepIndex rareIndex;
+    rareIndex.Open(rootPath);
+    rareIndex.Narrow(rare.c_str(), false);
+    rareIndexed.UseIndex(&rareIndex);
+
+    GrepIndex tagIndex;
+    tagIndex.Open(rootPath);
+    tagIndex.Narrow(gen.Tag().c_str(), false);
+    literalIndexed.UseIndex(&tagIndex);
+
+    bench.Run("grep.rare", treeBytes,
+        []() {},
+        [&]() { return rareGrep.Search(rootPath, fileList.data(), output); });
+
+    bench.Run("grep.rare_indexed", treeBytes,
+        []() {},
+        [&]() { return rareIndexed.Search(rootPath, fileList.data(), output); });
+
+    bench.Run("grep.literal_indexed", treeBytes,
+        []() {},
+        [&]() { return literalIndexed.Search(rootPath, fileList.data(), output); });
+}
+
+
+/**
+ *  \brief  In-process search of a generated source tree on disk. With --global
+ *          the same searches are timed with global -g for comparison.
+ */
+void runGrepBenchmarks(Bench& bench, const Options& opts)
+{
+    static const char* const cNames[] =
+    {
+        "grep.literal", "grep.literal_1thread", "grep.literal_ic", "grep.regexp", "grep.regexp_capped",
+        "grep.global_literal", "grep.global_literal_ic", "grep.global_regexp",
+        "grep.rare", "grep.rare_indexed", "grep.literal_indexed",
+        "grep_index.build", "grep_index.open", "grep_index.query_literal", "grep_index.query_regexp"
+    };
+
+    // Writing the tree takes a while - skip it if no grep benchmark is selected
+    bool enabled = false;
+    for (auto name : cNames)
+        if (bench.Enabled(name))
+            enabled = true;
+    if (!enabled)
+        return;
+
+    // Separate generator so the tree content doesn't depend on the other benchmarks
+    ResultGen gen(opts._gen);
+
+    const std::string root = makeTempDir();
+    if (root.empty())
+    {
+        fputs("Cannot create the source tree directory\n", stderr);
+        return;
+    }
+
+    const size_t treeBytes = gen.WriteTree(root);
+
+    std::vector<char> fileList;
+    gen.FileList(fileList);
+
+    const CPath rootPath(CText((root + "/").c_str()).C_str());
+    const std::string& tag = gen.Tag();
+    const std::string regExp = "^ +" + tag + "\\(";
+
+    OutputBuffer output;
+
+    GrepEngine literal(tag.c_str(), false, false);
+    GrepEngine literal1(tag.c_str(), false, false, 1);
+    GrepEngine literalIC(tag.c_str(), true, false);
+    GrepEngine re(regExp.c_str(), false, true);
+
+    bench.Run("grep.literal", treeBytes,
+        []() {},
+        [&]() { return literal.Search(rootPath, fileList.data(), output); });
+
+    bench.Run("grep.literal_1thread", treeBytes,
+        []() {},
+        [&]() { return literal1.Search(rootPath, fileList.data(), output); });
+
+    bench.Run("grep.literal_ic", treeBytes,
+        []() {},
+        [&]() { return literalIC.Search(rootPath, fileList.data(), output); });
+
+    bench.Run("grep.regexp", treeBytes,
+        []() {},
+        [&]() { return re.Search(rootPath, fileList.data(), output); });
+
+    // Every line matches - the search stops once the output max size is exceeded
+    GrepEngine any(".", false, true);
+    OutputBuffer capped(treeBytes / 8);
+
+    bench.Run("grep.regexp_capped", treeBytes,
+        []() {},
+        [&]() { return any.Search(rootPath, fileList.data(), capped); });
+
+    if (!opts._global.empty())
+    {
+        const std::string cd = "cd \"" + root + "\" && \"" + opts._global;
+
+        if (system((cd + "/gtags\"").c_str()) == 0)
+        {
+            bench.Run("grep.global_literal", treeBytes,
+                []() {},
+                [&]() { return runGlobalGrep(cd + "/global\" -g --result=grep -M --literal " + tag); });
+
+            bench.Run("grep.global_literal_ic", treeBytes,
+                []() {},
+                [&]() { return runGlobalGrep(cd + "/global\" -g --result=grep -i --literal " + tag); });
+
+            bench.Run("grep.global_regexp", treeBytes,
+                []() {},
+                [&]() { return runGlobalGrep(cd + "/global\" -g --result=grep -M \"" + regExp + "\""); });
+        }
+        else
+        {
+            fprintf(stderr, "Cannot run %s/gtags\n", opts._global.c_str());
+        }
+    }
+
+    runGrepIndexBenchmarks(bench, gen, rootPath, fileList, treeBytes);
+
+    removeTree(root);
+}
+
+} // anonymous namespace
+
+
+/**
+ *  \brief
+ */
+int main(int argc, char* argv[])
+{
+    Options opts;
+
+    if (!parseOptions(argc, argv, opts))
+    {
+        fputs(cUsage, stderr);
+        return 1;
+    }
+
+    FILE* fp = stdout;
+
+    if (!opts._output.empty())
+    {
+        fp = fopen(opts._output.c_str(), "w");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "Cannot open %s\n", opts._output.c_str());
+            return 1;
+        }
+    }
+
+    ResultGen gen(opts._gen);
+    const DbHandle& db = DbManager::Get().RegisterDb(CPath(_T("C:\\bench\\project\\")));
+
+    Reporter reporter(opts, fp);
+    Bench bench(opts, reporter);
+
+    reporter.Header();
+
+    runParserBenchmarks(bench, gen, db);
+    runFilterBenchmarks(bench, gen, db);
+    runSymbolBenchmarks(bench, gen, db);
+    runStringBenchmarks(bench, gen);
+    runAllocBenchmarks(bench, gen, db);
+    runOutputBenchmarks(bench, gen);
+    runGrepBenchmarks(bench, opts);
+
+    if (fp != stdout)
+        fclose(fp);
+
+    return bench.FailedChecks() ? 2 : 0;
+}
@@ -0,0 +1,312 @@
+/**
+ *  \file
+ *  \brief  Stub global, gtags and ctags executables for the latency benchmarks
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include "ResultGen.h"
+
+
+using namespace GTags;
+
+
+namespace
+{
+
+/**
+ *  \struct  Config
+ *  \brief  Read from the environment (inherited through CmdEngine) so the
+ *          harness can change the output profile between scenarios:
+ *          FAKE_GLOBAL_FILES, FAKE_GLOBAL_HITS, FAKE_GLOBAL_SYMBOLS - output volume,
+ *          FAKE_GLOBAL_DELAY_MS - time before the first output,
+ *          FAKE_GLOBAL_BYTES_PER_SEC - output rate (0 - unlimited),
+ *          FAKE_GLOBAL_FAIL - if set only error message is written.
+ *          global -f tags the given file itself (ctags -x format) - calls at
+ *          the line start are definitions, the indented ones references.
+ */
+struct Config
+{
+    Config() : _delayMs(0), _bytesPerSec(0), _fail(false) {}
+
+    ResultGen::Params   _gen;
+    unsigned            _delayMs;
+    unsigned            _bytesPerSec;
+    bool                _fail;
+};
+
+
+/**
+ *  \brief
+ */
+unsigned envValue(const char* name, unsigned defaultVal)
+{
+    const char* val = getenv(name);
+
+    return (val && *val) ? (unsigned)strtoul(val, NULL, 10) : defaultVal;
+}
+
+
+/**
+ *  \brief
+ */
+void readConfig(Config& cfg)
+{
+    cfg._gen._files         = envValue("FAKE_GLOBAL_FILES", 200);
+    cfg._gen._hitsPerFile   = envValue("FAKE_GLOBAL_HITS", 5);
+    cfg._gen._symbols       = envValue("FAKE_GLOBAL_SYMBOLS", 2000);
+    cfg._delayMs            = envValue("FAKE_GLOBAL_DELAY_MS", 0);
+    cfg._bytesPerSec        = envValue("FAKE_GLOBAL_BYTES_PER_SEC", 0);
+    cfg._fail               = (getenv("FAKE_GLOBAL_FAIL") != NULL);
+
+    if (!cfg._gen._files)
+        cfg._gen._files = 1;
+    if (!cfg._gen._symbols)
+        cfg._gen._symbols = 1;
+}
+
+
+/**
+ *  \brief  Writes the data in chunks keeping the configured rate
+ */
+void writeThrottled(FILE* fp, const char* data, size_t size, unsigned bytesPerSec)
+{
+    static const size_t cChunkSize = 4096;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (size_t written = 0; written < size;)
+    {
+        const size_t chunk = (size - written < cChunkSize) ? size - written : cChunkSize;
+
+        fwrite(data + written, 1, chunk, fp);
+        fflush(fp);
+        written += chunk;
+
+        if (bytesPerSec && written < size)
+            std::this_thread::sleep_until(start +
+                    std::chrono::microseconds((unsigned long long)written * 1000000 / bytesPerSec));
+    }
+}
+
+
+/**
+ *  \brief
+ */
+bool hasArg(int argc, char* argv[], const char* arg)
+{
+    for (int i = 1; i < argc; ++i)
+        if (!strcmp(argv[i], arg))
+            return true;
+
+    return false;
+}
+
+
+/**
+ *  \brief  Short options are combined (-cT, -gO) so look for the letter
+ */
+bool hasOpt(int argc, char* argv[], char opt)
+{
+    for (int i = 1; i < argc; ++i)
+        if (argv[i][0] == '-' && argv[i][1] != '-' && strchr(argv[i] + 1, opt))
+            return true;
+
+    return false;
+}
+
+
+/**
+ *  \brief
+ */
+const char* exeName(const char* path)
+{
+    const char* name = path;
+
+    for (const char* p = path; *p; ++p)
+        if (*p == '/' || *p == '\\')
+            name = p + 1;
+
+    return name;
+}
+
+
+/**
+ *  \brief  The last argument is the file relative to the current folder
+ */
+int tagFile(int argc, char* argv[], const Config& cfg)
+{
+    const char* file = argv[argc - 1];
+    const bool references = hasOpt(argc, argv, 'r');
+
+    FILE* fp = fopen(file, "rb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "global: cannot open '%s'.\n", file);
+        return 1;
+    }
+
+    std::string out;
+    char line[1024];
+
+    for (unsigned lineNum = 1; fgets(line, sizeof(line), fp); ++lineNum)
+    {
+        line[strcspn(line, "\r\n")] = 0;
+
+        const char* name = line;
+        while (*name == ' ' || *name == '\t')
+            ++name;
+
+        if ((name != line) != references)
+            continue;
+
+        const char* nameEnd = name;
+        while (*nameEnd == '_' || isalnum((unsigned char)*nameEnd))
+            ++nameEnd;
+
+        if (nameEnd == name || *nameEnd != '(')
+            continue;
+
+        char buf[1200];
+        snprintf(buf, sizeof(buf), "%-16.*s %4u %-16s %s\n", (int)(nameEnd - name), name, lineNum, file, line);
+        out += buf;
+    }
+
+    fclose(fp);
+
+    writeThrottled(stdout, out.data(), out.size(), cfg._bytesPerSec);
+
+    return 0;
+}
+
+
+/**
+ *  \brief  gtags -v writes its progress on stderr
+ */
+int runGtags(int argc, char* argv[], const Config& cfg)
+{
+    if (hasArg(argc, argv, "--version"))
+    {
+        puts("gtags (GNU GLOBAL) 6.6.3 (stub)");
+        return 0;
+    }
+
+    if (cfg._fail)
+    {
+        fputs("gtags: stub failure requested.\n", stderr);
+        return 1;
+    }
+
+    if (!hasOpt(argc, argv, 'v'))
+        return 0;
+
+    ResultGen gen(cfg._gen);
+
+    std::string progress("[Mon Jan 01 00:00:00 UTC 2019] Gathering tags...\n");
+    for (unsigned i = 0; i < gen.Files().size(); ++i)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), " [%u] extracting tags of ", i + 1);
+        progress += buf;
+        progress += gen.Files()[i];
+        progress += '\n';
+    }
+    progress += "[Mon Jan 01 00:00:00 UTC 2019] Done.\n";
+
+    writeThrottled(stderr, progress.data(), progress.size(), cfg._bytesPerSec);
+
+    return 0;
+}
+
+
+/**
+ *  \brief
+ */
+int runGlobal(int argc, char* argv[], const Config& cfg)
+{
+    if (hasArg(argc, argv, "--version"))
+    {
+        puts("global (GNU GLOBAL) 6.6.3 (stub)");
+        return 0;
+    }
+
+    if (cfg._fail)
+    {
+        fputs("global: stub failure requested.\n", stderr);
+        return 1;
+    }
+
+    if (hasOpt(argc, argv, 'f'))
+        return tagFile(argc, argv, cfg);
+
+    ResultGen gen(cfg._gen);
+    std::vector<char> out;
+
+    if (hasOpt(argc, argv, 'c'))
+        gen.Completion(out);
+    else if (hasOpt(argc, argv, 'P'))
+        gen.FileList(out);
+    else
+        gen.Grep(out);
+
+    // Drop the NUL terminator
+    if (!out.empty())
+        out.pop_back();
+
+    writeThrottled(stdout, out.data(), out.size(), cfg._bytesPerSec);
+
+    return 0;
+}
+
+} // anonymous namespace
+
+
+/**
+ *  \brief  Acts as global, gtags or ctags depending on the executable name
+ */
+int main(int argc, char* argv[])
+{
+    Config cfg;
+    readConfig(cfg);
+
+    if (cfg._delayMs)
+        std::this_thread::sleep_for(std::chrono::milliseconds(cfg._delayMs));
+
+    const std::string name(exeName(argv[0]));
+
+    if (!name.compare(0, 5, "gtags"))
+        return runGtags(argc, argv, cfg);
+
+    if (!name.compare(0, 5, "ctags"))
+    {
+        puts("Universal Ctags 0.0.0 (stub)");
+        return 0;
+    }
+
+    return runGlobal(argc, argv, cfg);
+}
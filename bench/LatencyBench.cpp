@@ -0,0 +1,1804 @@
+/**
+ *  \file
+ *  \brief  End-to-end command latency benchmarks - CmdEngine, ReadPipe and the parsers run against the stub global
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Common.h"
+#include "INpp.h"
+#include "Config.h"
+#include "DbManager.h"
+#include "GTags.h"
+#include "Cmd.h"
+#include "CmdEngine.h"
+#include "LineParser.h"
+#include "TabParser.h"
+#include "OverlayIndex.h"
+#include "ResultCache.h"
+#include "QueryCache.h"
+#include "SymbolResolver.h"
+#include "DbWarmup.h"
+#include "Startup.h"
+#include "ResultGen.h"
+
+
+using namespace GTags;
+
+
+namespace
+{
+
+const char cUsage[] =
+    "Usage: gtags_latency [options]\n"
+    "  --runs=N           runs per command in each scenario (10)\n"
+    "  --concurrency=N    commands run at once in the concurrent scenario (4)\n"
+    "  --cancel-after=MS  cancel delay after the activity window is shown (100)\n"
+    "  --files=N          files in the stub global output (200)\n"
+    "  --hits=N           search hits per file in the stub global output (5)\n"
+    "  --symbols=N        symbols in the stub global completion output (2000)\n"
+    "  --delay-ms=N       stub global delay before the first output (0)\n"
+    "  --rate=N           stub global output rate in bytes/s, 0 - unlimited (0)\n"
+    "  --filter=STR       run only the benchmarks whose name contains STR\n"
+    "  --format=FMT       json (one object per line), csv or text (text)\n"
+    "  --output=FILE      write the results to FILE instead of stdout\n"
+    "  --backend-dir=DIR  directory containing NppGTags/global.exe (the executable's one)\n"
+    "Exits with 2 if a check fails - symbol cache behaviour, plugin startup time budget\n";
+
+
+/**
+ *  \struct  Options
+ *  \brief
+ */
+struct Options
+{
+    Options() : _runs(10), _concurrency(4), _cancelAfterMs(100), _files(200), _hits(5), _symbols(2000),
+            _delayMs(0), _rate(0), _format("text") {}
+
+    unsigned    _runs;
+    unsigned    _concurrency;
+    unsigned    _cancelAfterMs;
+    unsigned    _files;
+    unsigned    _hits;
+    unsigned    _symbols;
+    unsigned    _delayMs;
+    unsigned    _rate;
+    std::string _filter;
+    std::string _format;
+    std::string _output;
+    std::string _backendDir;
+};
+
+
+/**
+ *  \struct  CmdDesc
+ *  \brief  How GTags.cpp sets up each command
+ */
+struct CmdDesc
+{
+    CmdId_t         _id;
+    const char*     _name;
+    const TCHAR*    _tag;
+    bool            _useDb;
+    int             _parser; // 0 - none, 1 - LineParser, 2 - TabParser
+};
+
+
+const CmdDesc cCmds[] =
+{
+    { CREATE_DATABASE,      "CreateDatabase",       NULL,               true,   0 },
+    { UPDATE_SINGLE,        "UpdateSingle",         _T("src/main.c"),   true,   0 },
+    { AUTOCOMPLETE,         "AutoComplete",         _T("get"),          true,   1 },
+    { AUTOCOMPLETE_SYMBOL,  "AutoCompleteSymbol",   _T("get"),          true,   1 },
+    { AUTOCOMPLETE_FILE,    "AutoCompleteFile",     _T("/src"),         true,   1 },
+    { FIND_FILE,            "FindFile",             _T("src"),          true,   2 },
+    { FIND_DEFINITION,      "FindDefinition",       _T("getNode"),      true,   2 },
+    { FIND_REFERENCE,       "FindReference",        _T("getNode"),      true,   2 },
+    { FIND_SYMBOL,          "FindSymbol",           _T("getNode"),      true,   2 },
+    { GREP,                 "Grep",                 NULL,               true,   2 },
+    { GREP_TEXT,            "GrepText",             NULL,               true,   2 },
+    { VERSION,              "Version",              NULL,               false,  0 },
+    { CTAGS_VERSION,        "CtagsVersion",         NULL,               false,  0 }
+};
+
+
+/**
+ *  \struct  Run
+ *  \brief  Single command run - times in CmdTiming ticks
+ */
+struct Run
+{
+    Run(const CmdDesc& desc, const CmdPtr_t& cmd) : _desc(&desc), _cmd(cmd), _done(false),
+            _doneTime(0), _cancelTime(0), _status(RUN_ERROR) {}
+
+    const CmdDesc*  _desc;
+    CmdPtr_t        _cmd;
+    bool            _done;
+    LONGLONG        _doneTime;
+    LONGLONG        _cancelTime;
+    CmdStatus_t     _status;
+    CmdTiming       _timing;
+};
+
+
+/**
+ *  \struct  Stats
+ *  \brief
+ */
+struct Stats
+{
+    Stats() : _runs(0), _ok(0), _cancelled(0), _failed(0), _bytes(0) {}
+
+    unsigned            _runs;
+    unsigned            _ok;
+    unsigned            _cancelled;
+    unsigned            _failed;
+    unsigned long long  _bytes;
+    std::vector<double> _firstResultMs;
+    std::vector<double> _completeMs;
+    std::vector<double> _cancelMs;
+};
+
+
+/**
+ *  \brief  Nearest-rank percentile, -1 if there are no samples
+ */
+double percentile(std::vector<double>& samples, unsigned pct)
+{
+    if (samples.empty())
+        return -1.0;
+
+    std::sort(samples.begin(), samples.end());
+
+    size_t rank = (samples.size() * pct + 99) / 100;
+    if (rank)
+        --rank;
+
+    return samples[rank];
+}
+
+
+/**
+ *  \class  Reporter
+ *  \brief  Prints the results in machine-readable (json, csv) or human-readable form
+ */
+class Reporter
+{
+public:
+    Reporter(const Options& opts, FILE* fp) : _opts(opts), _fp(fp) {}
+
+    void Header();
+    void Add(const std::string& name, Stats& stats);
+    void Comment(const std::string& text);
+
+private:
+    const Options&  _opts;
+    FILE*           _fp;
+};
+
+
+/**
+ *  \brief
+ */
+void Reporter::Header()
+{
+    if (_opts._format == "json")
+    {
+        fprintf(_fp, "{\"params\":{\"runs\":%u,\"concurrency\":%u,\"cancelAfterMs\":%u,\"files\":%u,\"hits\":%u,"
+                "\"symbols\":%u,\"delayMs\":%u,\"rate\":%u}}\n",
+                _opts._runs, _opts._concurrency, _opts._cancelAfterMs, _opts._files, _opts._hits,
+                _opts._symbols, _opts._delayMs, _opts._rate);
+    }
+    else if (_opts._format == "csv")
+    {
+        fprintf(_fp, "name,runs,ok,cancelled,failed,bytes,first_result_p50_ms,first_result_p99_ms,"
+                "complete_min_ms,complete_p50_ms,complete_p99_ms,complete_max_ms,cancel_p50_ms,cancel_p99_ms\n");
+    }
+    else
+    {
+        fprintf(_fp, "# runs %u, concurrency %u, cancel after %u ms, files %u, hits/file %u, symbols %u, "
+                "delay %u ms, rate %u B/s\n", _opts._runs, _opts._concurrency, _opts._cancelAfterMs,
+                _opts._files, _opts._hits, _opts._symbols, _opts._delayMs, _opts._rate);
+        fprintf(_fp, "# times in ms, -1 if not measured\n");
+        fprintf(_fp, "%-36s %5s %5s %5s %10s %10s %10s %10s %10s %10s %10s\n", "# Benchmark", "Runs", "OK",
+                "Canc", "Bytes", "1st p50", "1st p99", "Done p50", "Done p99", "Canc p50", "Canc p99");
+    }
+}
+
+
+/**
+ *  \brief
+ */
+void Reporter::Add(const std::string& name, Stats& stats)
+{
+    const unsigned long long bytes = stats._runs ? stats._bytes / stats._runs : 0;
+
+    std::sort(stats._completeMs.begin(), stats._completeMs.end());
+
+    const double firstP50       = percentile(stats._firstResultMs, 50);
+    const double firstP99       = percentile(stats._firstResultMs, 99);
+    const double completeMin    = stats._completeMs.empty() ? -1.0 : stats._completeMs.front();
+    const double completeP50    = percentile(stats._completeMs, 50);
+    const double completeP99    = percentile(stats._completeMs, 99);
+    const double completeMax    = stats._completeMs.empty() ? -1.0 : stats._completeMs.back();
+    const double cancelP50      = percentile(stats._cancelMs, 50);
+    const double cancelP99      = percentile(stats._cancelMs, 99);
+
+    if (_opts._format == "json")
+    {
+        fprintf(_fp, "{\"name\":\"%s\",\"runs\":%u,\"ok\":%u,\"cancelled\":%u,\"failed\":%u,\"bytes\":%llu,"
+                "\"first_result_p50_ms\":%.2f,\"first_result_p99_ms\":%.2f,\"complete_min_ms\":%.2f,"
+                "\"complete_p50_ms\":%.2f,\"complete_p99_ms\":%.2f,\"complete_max_ms\":%.2f,"
+                "\"cancel_p50_ms\":%.2f,\"cancel_p99_ms\":%.2f}\n",
+                name.c_str(), stats._runs, stats._ok, stats._cancelled, stats._failed, bytes,
+                firstP50, firstP99, completeMin, completeP50, completeP99, completeMax, cancelP50, cancelP99);
+    }
+    else if (_opts._format == "csv")
+    {
+        fprintf(_fp, "%s,%u,%u,%u,%u,%llu,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+                name.c_str(), stats._runs, stats._ok, stats._cancelled, stats._failed, bytes,
+                firstP50, firstP99, completeMin, completeP50, completeP99, completeMax, cancelP50, cancelP99);
+    }
+    else
+    {
+        fprintf(_fp, "%-36s %5u %5u %5u %10llu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+                name.c_str(), stats._runs, stats._ok, stats._cancelled, bytes,
+                firstP50, firstP99, completeP50, completeP99, cancelP50, cancelP99);
+    }
+
+    fflush(_fp);
+}
+
+
+/**
+ *  \brief  Extra information in the human-readable output only
+ */
+void Reporter::Comment(const std::string& text)
+{
+    if (_opts._format == "text")
+    {
+        fprintf(_fp, "# %s\n", text.c_str());
+        fflush(_fp);
+    }
+}
+
+
+/**
+ *  \class  Harness
+ *  \brief  Plays the role of the plugin main window - runs the commands
+ *          through CmdEngine and pumps the messages it sends
+ */
+class Harness
+{
+public:
+    Harness(const Options& opts, Reporter& reporter, const DbHandle& db, const char* grepTag);
+    ~Harness();
+
+    void Sequential();
+    void Concurrent();
+    void Cancel();
+    void Truncate();
+    void Overlay(const char* dbDir, const std::string& file);
+    void Delta(const char* dbDir, const std::vector<std::string>& files);
+    void Prefetch();
+    void Supersede();
+    void BusyUi();
+    bool LostWakeUp();
+    void Persistent(const char* dbDir);
+    void Warmup(const char* dbDir, const std::vector<std::string>& files);
+    bool SymbolCache(const char* dbDir, const std::string& file, const std::string& symbol);
+    bool StartupTime(const char* dbDir, const std::vector<std::string>& files);
+
+private:
+    static Harness* Instance;
+
+    static LRESULT CALLBACK wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
+    static void onComplete(const CmdPtr_t& cmd);
+
+    bool enabled(const std::string& name) const
+    {
+        return (_opts._filter.empty() || name.find(_opts._filter) != std::string::npos);
+    }
+
+    void setBackendEnv(unsigned delayMs) const;
+    bool start(const CmdDesc& desc, bool useCache = false);
+    void waitAll(unsigned cancelAfterMs = 0);
+    void collect(Stats& stats, const CmdDesc* desc = NULL);
+
+    const Options&      _opts;
+    Reporter&           _reporter;
+    const DbHandle&     _db;
+    const CText         _grepTag;
+    std::vector<Run>    _runs;
+    unsigned            _pending;
+    HANDLE              _hCancel;
+    LONGLONG            _activityTime;
+    unsigned            _wakeUps;
+    unsigned            _completions;
+};
+
+
+Harness* Harness::Instance = NULL;
+
+
+/**
+ *  \brief
+ */
+Harness::Harness(const Options& opts, Reporter& reporter, const DbHandle& db, const char* grepTag) :
+    _opts(opts), _reporter(reporter), _db(db), _grepTag(grepTag), _pending(0), _hCancel(NULL), _activityTime(0),
+    _wakeUps(0), _completions(0)
+{
+    Instance = this;
+    MainWndH = CompatCreateWindow(wndProc);
+}
+
+
+/**
+ *  \brief
+ */
+Harness::~Harness()
+{
+    CompatDestroyWindow(MainWndH);
+    MainWndH = NULL;
+    Instance = NULL;
+}
+
+
+/**
+ *  \brief  Mirrors the ResultWin handling of the CmdEngine messages
+ */
+LRESULT CALLBACK Harness::wndProc(HWND, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+    switch (uMsg)
+    {
+        case WM_RUN_CMD_CALLBACK:
+            Instance->_wakeUps++;
+            Instance->_completions += CmdEngine::RunCompletions();
+        return 0;
+
+        case WM_OPEN_ACTIVITY_WIN:
+            Instance->_hCancel = reinterpret_cast<HANDLE>(lParam);
+            Instance->_activityTime = CmdTiming::Now();
+        return 0;
+
+        case WM_CLOSE_ACTIVITY_WIN:
+            if (Instance->_hCancel == reinterpret_cast<HANDLE>(lParam))
+                Instance->_hCancel = NULL;
+            CloseHandle(reinterpret_cast<HANDLE>(lParam));
+        return 0;
+    }
+
+    return 0;
+}
+
+
+/**
+ *  \brief
+ */
+void Harness::onComplete(const CmdPtr_t& cmd)
+{
+    const LONGLONG now = CmdTiming::Now();
+
+    for (auto& run : Instance->_runs)
+    {
+        if (run._cmd == cmd && !run._done)
+        {
+            run._done       = true;
+            run._doneTime   = now;
+            run._status     = cmd->Status();
+            run._timing     = cmd->Timing();
+            run._cmd.reset();
+            --Instance->_pending;
+            break;
+        }
+    }
+}
+
+
+/**
+ *  \brief  The stub global reads its output profile from the environment it inherits
+ */
+void Harness::setBackendEnv(unsigned delayMs) const
+{
+    TCHAR buf[32];
+
+    _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%u"), _opts._files);
+    SetEnvironmentVariable(_T("FAKE_GLOBAL_FILES"), buf);
+    _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%u"), _opts._hits);
+    SetEnvironmentVariable(_T("FAKE_GLOBAL_HITS"), buf);
+    _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%u"), _opts._symbols);
+    SetEnvironmentVariable(_T("FAKE_GLOBAL_SYMBOLS"), buf);
+    _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%u"), delayMs);
+    SetEnvironmentVariable(_T("FAKE_GLOBAL_DELAY_MS"), buf);
+    _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%u"), _opts._rate);
+    SetEnvironmentVariable(_T("FAKE_GLOBAL_BYTES_PER_SEC"), buf);
+}
+
+
+/**
+ *  \brief
+ */
+bool Harness::start(const CmdDesc& desc, bool useCache)
+{
+    // The whole command path is measured unless testing the cache
+    if (!useCache)
+        ResultCache::Get().Clear();
+
+    ParserPtr_t parser;
+    if (desc._parser == 1)
+        parser.reset(new LineParser);
+    else if (desc._parser == 2)
+        parser.reset(new TabParser);
+
+    CText name(desc._name);
+    // Grep commands search the generated source tree
+    const TCHAR* tag = (desc._id == GREP || desc._id == GREP_TEXT) ? _grepTag.C_str() : desc._tag;
+
+    CmdPtr_t cmd(new Cmd(desc._id, name.C_str(), desc._useDb ? _db : NULL, parser, tag));
+
+    _runs.push_back(Run(desc, cmd));
+
+    if (!CmdEngine::Run(cmd, onComplete))
+    {
+        Run& run = _runs.back();
+        run._done       = true;
+        run._status     = cmd->Status();
+        run._timing     = cmd->Timing();
+        run._doneTime   = CmdTiming::Now();
+        run._cmd.reset();
+        return false;
+    }
+
+    ++_pending;
+
+    return true;
+}
+
+
+/**
+ *  \brief  Pumps the messages until all started commands complete. If
+ *          cancelAfterMs is set the command is cancelled that long after its
+ *          activity window is shown - as if the user has clicked Cancel.
+ */
+void Harness::waitAll(unsigned cancelAfterMs)
+{
+    while (_pending)
+    {
+        CompatPumpMessages(5);
+
+        if (cancelAfterMs && _hCancel && CmdTiming::ToMs(CmdTiming::Now() - _activityTime) >= cancelAfterMs)
+        {
+            for (auto& run : _runs)
+                if (!run._done && !run._cancelTime)
+                    run._cancelTime = CmdTiming::Now();
+
+            SetEvent(_hCancel);
+            _hCancel = NULL;
+        }
+    }
+}
+
+
+/**
+ *  \brief
+ */
+void Harness::collect(Stats& stats, const CmdDesc* desc)
+{
+    for (const auto& run : _runs)
+    {
+        if (desc && run._desc != desc)
+            continue;
+
+        const LONGLONG queued = run._timing.Get(CmdTiming::QUEUED);
+
+        ++stats._runs;
+
+        if (run._status == OK)
+            ++stats._ok;
+        else if (run._status == CANCELLED)
+            ++stats._cancelled;
+        else
+            ++stats._failed;
+
+        stats._bytes += run._timing.BytesRead();
+
+        if (!queued)
+            continue;
+
+        if (run._timing.Get(CmdTiming::FIRST_BYTE))
+            stats._firstResultMs.push_back(CmdTiming::ToMs(run._timing.Get(CmdTiming::FIRST_BYTE) - queued));
+
+        stats._completeMs.push_back(CmdTiming::ToMs(run._doneTime - queued));
+
+        if (run._cancelTime)
+            stats._cancelMs.push_back(CmdTiming::ToMs(run._doneTime - run._cancelTime));
+    }
+}
+
+
+/**
+ *  \brief  Each command alone - the baseline latency
+ */
+void Harness::Sequential()
+{
+    setBackendEnv(_opts._delayMs);
+
+    for (const auto& desc : cCmds)
+    {
+        const std::string name = std::string("sequential.") + desc._name;
+        if (!enabled(name))
+            continue;
+
+        _runs.clear();
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            start(desc);
+            waitAll();
+        }
+
+        Stats stats;
+        collect(stats);
+        _reporter.Add(name, stats);
+    }
+}
+
+
+/**
+ *  \brief  Batches of mixed search commands started at once. The pipe handles
+ *          are inheritable so each child also holds the pipes of the commands
+ *          started before it - a command completes only when the processes
+ *          spawned together with it exit.
+ */
+void Harness::Concurrent()
+{
+    static const CmdId_t cMix[] =
+    {
+        FIND_DEFINITION, FIND_REFERENCE, GREP, AUTOCOMPLETE, FIND_FILE, FIND_SYMBOL, GREP_TEXT, AUTOCOMPLETE_FILE
+    };
+
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "concurrent%u.", _opts._concurrency);
+
+    bool any = false;
+    for (const auto& desc : cCmds)
+        if (std::find(cMix, cMix + _countof(cMix), desc._id) != cMix + _countof(cMix) &&
+                enabled(prefix + std::string(desc._name)))
+            any = true;
+    if (!any)
+        return;
+
+    setBackendEnv(_opts._delayMs);
+
+    _runs.clear();
+
+    unsigned next = 0;
+    for (unsigned i = 0; i < _opts._runs; ++i)
+    {
+        for (unsigned j = 0; j < _opts._concurrency; ++j)
+        {
+            const CmdId_t id = cMix[next++ % _countof(cMix)];
+
+            for (const auto& desc : cCmds)
+                if (desc._id == id)
+                    start(desc);
+        }
+
+        waitAll();
+    }
+
+    for (const auto& desc : cCmds)
+    {
+        const std::string name = prefix + std::string(desc._name);
+        if (!enabled(name))
+            continue;
+
+        Stats stats;
+        collect(stats, &desc);
+        if (stats._runs)
+            _reporter.Add(name, stats);
+    }
+}
+
+
+/**
+ *  \brief  Commands that would run for a minute cancelled through the activity
+ *          window event - measures the time from cancel to completion
+ */
+void Harness::Cancel()
+{
+    static const CmdId_t cCancelled[] = { FIND_REFERENCE, GREP, CREATE_DATABASE };
+
+    // Long enough to never finish on its own
+    setBackendEnv(60000);
+
+    for (const auto& desc : cCmds)
+    {
+        if (std::find(cCancelled, cCancelled + _countof(cCancelled), desc._id) == cCancelled + _countof(cCancelled))
+            continue;
+
+        const std::string name = std::string("cancel.") + desc._name;
+        if (!enabled(name))
+            continue;
+
+        _runs.clear();
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            start(desc);
+            waitAll(_opts._cancelAfterMs ? _opts._cancelAfterMs : 1);
+        }
+
+        Stats stats;
+        collect(stats);
+        _reporter.Add(name, stats);
+    }
+
+    setBackendEnv(_opts._delayMs);
+}
+
+
+/**
+ *  \brief  Output far over the max size - measures the time until the child
+ *          is stopped and the truncated result parsed
+ */
+void Harness::Truncate()
+{
+    static const char cName[] = "truncate.FindReference";
+
+    if (!enabled(cName))
+        return;
+
+    const CmdDesc* desc = std::find_if(cCmds, cCmds + _countof(cCmds),
+            [](const CmdDesc& cmd) { return cmd._id == FIND_REFERENCE; });
+
+    // About 100 times the 1 MB limit
+    setBackendEnv(_opts._delayMs);
+
+    TCHAR buf[32];
+    _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%u"), _opts._files * 100);
+    SetEnvironmentVariable(_T("FAKE_GLOBAL_FILES"), buf);
+
+    const unsigned maxOutput = GTagsSettings._maxOutput;
+    GTagsSettings._maxOutput = 1;
+
+    _runs.clear();
+
+    for (unsigned i = 0; i < _opts._runs; ++i)
+    {
+        start(*desc);
+        waitAll();
+    }
+
+    Stats stats;
+    collect(stats);
+    _reporter.Add(cName, stats);
+
+    GTagsSettings._maxOutput = maxOutput;
+    setBackendEnv(_opts._delayMs);
+}
+
+
+/**
+ *  \brief  Tagging of an edited (unsaved) buffer through the stub global -f
+ *          and the cost of merging its tags into the search results
+ */
+void Harness::Overlay(const char* dbDir, const std::string& file)
+{
+    static const CmdId_t cMerged[] = { FIND_DEFINITION, FIND_REFERENCE, AUTOCOMPLETE };
+
+    const CPath path(CText((std::string(dbDir) + "/" + file).c_str()).C_str());
+
+    // The file as being edited - with one new definition of the searched tag
+    std::string text;
+    {
+        FILE* fp = fopen((std::string(dbDir) + "/" + file).c_str(), "rb");
+        if (fp == NULL)
+            return;
+
+        char buf[4096];
+        for (size_t len; (len = fread(buf, 1, sizeof(buf), fp)) > 0;)
+            text.append(buf, len);
+        fclose(fp);
+
+        text += CTextA(_grepTag.C_str()).C_str();
+        text += "(void);\n";
+    }
+
+    const CTextA textA(text.c_str());
+
+    // The buffer database is looked up by its tags file
+    FILE* fp = fopen((std::string(dbDir) + "/GTAGS").c_str(), "ab");
+    if (fp == NULL)
+        return;
+    fclose(fp);
+
+    // Registered as being created - the overlay needs it unlocked
+    DbManager::Get().PutDb(_db);
+
+    setBackendEnv(_opts._delayMs);
+
+    if (enabled("overlay.update"))
+    {
+        Stats stats;
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            OverlayIndex::Get().Remove(path);
+
+            ++stats._runs;
+
+            const LONGLONG start = CmdTiming::Now();
+
+            // As the overlay timer does it
+            bool success;
+            DbHandle db = DbManager::Get().GetDb(path, false, &success);
+            if (!db || !success)
+            {
+                ++stats._failed;
+                continue;
+            }
+
+            OverlayIndex::Get().Update(db, path, textA);
+
+            // The re-tag is not a user command - the background work must not yield to it
+            const bool busy = CmdEngine::IsBusy();
+
+            while (!OverlayIndex::Get().Contains(path) && CmdTiming::ToMs(CmdTiming::Now() - start) < 5000)
+                CompatPumpMessages(5);
+
+            if (OverlayIndex::Get().Contains(path) && !busy)
+            {
+                ++stats._ok;
+                stats._completeMs.push_back(CmdTiming::ToMs(CmdTiming::Now() - start));
+            }
+            else
+            {
+                ++stats._failed;
+            }
+        }
+
+        _reporter.Add("overlay.update", stats);
+    }
+
+    if (!OverlayIndex::Get().Contains(path))
+    {
+        bool success;
+        DbHandle db = DbManager::Get().GetDb(path, false, &success);
+        if (db && success)
+            OverlayIndex::Get().Update(db, path, textA);
+
+        const LONGLONG start = CmdTiming::Now();
+        while (!OverlayIndex::Get().Contains(path) && CmdTiming::ToMs(CmdTiming::Now() - start) < 5000)
+            CompatPumpMessages(5);
+    }
+
+    // Compare with the sequential.* results for the merge cost
+    for (const auto& desc : cCmds)
+    {
+        if (std::find(cMerged, cMerged + _countof(cMerged), desc._id) == cMerged + _countof(cMerged))
+            continue;
+
+        const std::string name = std::string("overlay.") + desc._name;
+        if (!enabled(name))
+            continue;
+
+        _runs.clear();
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            start(desc);
+            waitAll();
+        }
+
+        Stats stats;
+        collect(stats);
+        _reporter.Add(name, stats);
+    }
+
+    OverlayIndex::Get().Remove(path);
+}
+
+
+/**
+ *  \brief  Saved files tagged into the database delta instead of updating
+ *          the database (compare with sequential.UpdateSingle), searches with
+ *          the delta merged and the folding of the delta into the database.
+ *          Runs after Overlay() - the database is created and unlocked.
+ */
+void Harness::Delta(const char* dbDir, const std::vector<std::string>& files)
+{
+    static const unsigned cCompactedFiles = 8;
+
+    if (files.size() < cCompactedFiles)
+        return;
+
+    std::vector<CPath> paths;
+    for (unsigned i = 0; i < cCompactedFiles; ++i)
+        paths.push_back(CPath(CText((std::string(dbDir) + "/" + files[i]).c_str()).C_str()));
+
+    setBackendEnv(_opts._delayMs);
+
+    // Tags the file into the delta and waits for it - returns the time taken or -1 on failure
+    auto save = [this](const CPath& path) -> double
+    {
+        bool success;
+        DbHandle db = DbManager::Get().GetDbAt(_db->GetPath(), true, &success);
+        if (!db || !success)
+            return -1;
+
+        const LONGLONG start = CmdTiming::Now();
+
+        if (!OverlayIndex::Get().AddDelta(std::vector<DbHandle>(1, db), path))
+        {
+            DbManager::Get().PutDb(db);
+            return -1;
+        }
+
+        while (!OverlayIndex::Get().InDelta(path) && CmdTiming::ToMs(CmdTiming::Now() - start) < 5000)
+            CompatPumpMessages(5);
+
+        return OverlayIndex::Get().InDelta(path) ? CmdTiming::ToMs(CmdTiming::Now() - start) : -1;
+    };
+
+    if (enabled("delta.save"))
+    {
+        Stats stats;
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            OverlayIndex::Get().DropDelta(_db->GetPath(), _db->GetPathId());
+
+            ++stats._runs;
+
+            const double ms = save(paths[0]);
+            if (ms < 0)
+            {
+                ++stats._failed;
+                continue;
+            }
+
+            ++stats._ok;
+            stats._completeMs.push_back(ms);
+        }
+
+        _reporter.Add("delta.save", stats);
+    }
+
+    if (!OverlayIndex::Get().InDelta(paths[0]))
+        save(paths[0]);
+
+    for (const auto& desc : cCmds)
+    {
+        if (desc._id != FIND_DEFINITION)
+            continue;
+
+        const std::string name = std::string("delta.") + desc._name;
+        if (!enabled(name))
+            continue;
+
+        _runs.clear();
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            start(desc);
+            waitAll();
+        }
+
+        Stats stats;
+        collect(stats);
+        _reporter.Add(name, stats);
+    }
+
+    // From the compaction start until the last file is folded into the database
+    if (enabled("delta.compact"))
+    {
+        Stats stats;
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            ++stats._runs;
+
+            bool saved = true;
+            for (const auto& path : paths)
+                saved = saved && (OverlayIndex::Get().InDelta(path) || save(path) >= 0);
+
+            if (!saved)
+            {
+                ++stats._failed;
+                continue;
+            }
+
+            const LONGLONG start = CmdTiming::Now();
+
+            OverlayIndex::Get().Compact();
+
+            auto folded = [&paths]() -> bool
+            {
+                for (const auto& path : paths)
+                    if (OverlayIndex::Get().InDelta(path))
+                        return false;
+                return true;
+            };
+
+            while (!folded() && CmdTiming::ToMs(CmdTiming::Now() - start) < 10000)
+                CompatPumpMessages(5);
+
+            if (!folded())
+            {
+                ++stats._failed;
+                continue;
+            }
+
+            ++stats._ok;
+            stats._completeMs.push_back(CmdTiming::ToMs(CmdTiming::Now() - start));
+        }
+
+        _reporter.Add("delta.compact", stats);
+    }
+
+    OverlayIndex::Get().DropDelta(_db->GetPath(), _db->GetPathId());
+
+    // A saved file in a database nested in the main one - tagged once for both
+    const std::string& file = files[0];
+    const size_t slash = file.rfind('/');
+
+    if (enabled("delta.nested") && slash != std::string::npos)
+    {
+        const std::string nestedDir = std::string(dbDir) + "/" + file.substr(0, slash);
+
+        FILE* fp = fopen((nestedDir + "/GTAGS").c_str(), "ab");
+        if (fp)
+            fclose(fp);
+
+        const CPath nestedPath(CText((nestedDir + "/").c_str()).C_str());
+        DbHandle nested = DbManager::Get().RegisterDb(nestedPath);
+        DbManager::Get().PutDb(nested);
+
+        Stats stats;
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            OverlayIndex::Get().DropDelta(_db->GetPath(), _db->GetPathId());
+            OverlayIndex::Get().DropDelta(nested->GetPath(), nested->GetPathId());
+
+            ++stats._runs;
+
+            bool success1, success2;
+            DbHandle db1 = DbManager::Get().GetDbAt(nested->GetPath(), true, &success1);
+            DbHandle db2 = DbManager::Get().GetDbAt(_db->GetPath(), true, &success2);
+
+            std::vector<DbHandle> dbs;
+            if (db1 && success1)
+                dbs.push_back(db1);
+            if (db2 && success2)
+                dbs.push_back(db2);
+
+            const LONGLONG start = CmdTiming::Now();
+
+            if (dbs.size() != 2 || !OverlayIndex::Get().AddDelta(dbs, paths[0]))
+            {
+                for (const auto& db : dbs)
+                    DbManager::Get().PutDb(db);
+
+                ++stats._failed;
+                continue;
+            }
+
+            while (!OverlayIndex::Get().InDelta(paths[0]) && CmdTiming::ToMs(CmdTiming::Now() - start) < 5000)
+                CompatPumpMessages(5);
+
+            // Both deltas are published together
+            fp = fopen((nestedDir + "/GDELTA").c_str(), "rb");
+            if (fp == NULL || !OverlayIndex::Get().InDelta(paths[0]))
+            {
+                if (fp)
+                    fclose(fp);
+
+                ++stats._failed;
+                continue;
+            }
+
+            fclose(fp);
+
+            ++stats._ok;
+            stats._completeMs.push_back(CmdTiming::ToMs(CmdTiming::Now() - start));
+        }
+
+        _reporter.Add("delta.nested", stats);
+
+        OverlayIndex::Get().DropDelta(_db->GetPath(), _db->GetPathId());
+        OverlayIndex::Get().DropDelta(nested->GetPath(), nested->GetPathId());
+
+        bool success;
+        nested = DbManager::Get().GetDbAt(nestedPath, true, &success);
+        if (nested && success)
+            DbManager::Get().UnregisterDb(nested);
+    }
+}
+
+
+/**
+ *  \brief  Definition looked up after the caret has rested on the word -
+ *          the prefetched result is served from the cache
+ */
+void Harness::Prefetch()
+{
+    if (!enabled("prefetch.FindDefinition"))
+        return;
+
+    setBackendEnv(_opts._delayMs);
+
+    for (const auto& desc : cCmds)
+    {
+        if (desc._id != FIND_DEFINITION)
+            continue;
+
+        _runs.clear();
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            ResultCache::Get().Clear();
+
+            bool success;
+            DbHandle db = DbManager::Get().GetDbAt(_db->GetPath(), false, &success);
+            if (!db || !success)
+                break;
+
+            Prefetcher::Get().Prefetch(db, desc._tag, false);
+
+            while (Prefetcher::Get().IsRunning())
+                CompatPumpMessages(5);
+
+            start(desc, true);
+            waitAll();
+        }
+
+        Stats stats;
+        collect(stats);
+        _reporter.Add("prefetch.FindDefinition", stats);
+    }
+}
+
+
+/**
+ *  \brief  Auto-complete query superseded by a newer one while its child is
+ *          still running - as the search window does when the typed prefix
+ *          changes. Measures the time from cancel until the stale query
+ *          completes and the latency of the query started right after it.
+ */
+void Harness::Supersede()
+{
+    static const DWORD cTypingMs = 30;
+
+    if (!enabled("complete.supersede"))
+        return;
+
+    for (const auto& desc : cCmds)
+    {
+        if (desc._id != AUTOCOMPLETE)
+            continue;
+
+        _runs.clear();
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            // Long enough to never finish on its own
+            setBackendEnv(60000);
+            start(desc);
+
+            // Let the stale query spawn its child before the environment changes
+            const LONGLONG typed = CmdTiming::Now();
+            while (CmdTiming::ToMs(CmdTiming::Now() - typed) < cTypingMs)
+                CompatPumpMessages(5);
+
+            Run& stale = _runs.back();
+            if (stale._cmd)
+            {
+                stale._cancelTime = CmdTiming::Now();
+                stale._cmd->Cancel();
+            }
+
+            setBackendEnv(_opts._delayMs);
+            start(desc);
+            waitAll();
+        }
+
+        Stats stats;
+        collect(stats);
+        _reporter.Add("complete.supersede", stats);
+    }
+}
+
+
+/**
+ *  \brief  Concurrent definition searches finishing while the UI thread is
+ *          busy (not pumping messages). The commands don't wait for the UI -
+ *          their completions are queued and handled in a batch on the first
+ *          wake-up message once the UI is free.
+ */
+void Harness::BusyUi()
+{
+    static const DWORD cBusyMs = 200;
+
+    if (!enabled("dispatch.busy_ui"))
+        return;
+
+    setBackendEnv(0);
+
+    for (const auto& desc : cCmds)
+    {
+        if (desc._id != FIND_DEFINITION)
+            continue;
+
+        _runs.clear();
+        _wakeUps = 0;
+        _completions = 0;
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            for (unsigned j = 0; j < std::max(_opts._concurrency, 2u); ++j)
+                start(desc);
+
+            Sleep(cBusyMs);
+            waitAll();
+        }
+
+        Stats stats;
+        collect(stats);
+        _reporter.Add("dispatch.busy_ui", stats);
+
+        char text[128];
+        snprintf(text, sizeof(text), "dispatch.busy_ui: %u completions on %u wake-ups, UI busy for %u ms",
+                _completions, _wakeUps, (unsigned)cBusyMs);
+        _reporter.Comment(text);
+    }
+}
+
+
+/**
+ *  \brief  A definition search finishing while the UI message queue is full
+ *          loses its wake-up message. The next finished search has to post
+ *          it again so both completions are handled. Each pair is a run, the
+ *          ones with completions left in the queue fail. Returns false if any
+ *          run failed.
+ */
+bool Harness::LostWakeUp()
+{
+    static const DWORD cTimeoutMs = 10000;
+
+    if (!enabled("dispatch.lost_wake_up"))
+        return true;
+
+    setBackendEnv(0);
+
+    const CmdDesc* desc = NULL;
+
+    for (const auto& cmdDesc : cCmds)
+        if (cmdDesc._id == FIND_DEFINITION)
+            desc = &cmdDesc;
+
+    Stats stats;
+
+    for (unsigned i = 0; i < _opts._runs; ++i)
+    {
+        _runs.clear();
+        _wakeUps = 0;
+        _completions = 0;
+
+        const LONGLONG begin = CmdTiming::Now();
+
+        CompatSetQueueFull(true);
+
+        start(*desc);
+
+        // The completion is queued right after the command stops counting as busy
+        while (CmdEngine::IsBusy() && CmdTiming::ToMs(CmdTiming::Now() - begin) < cTimeoutMs)
+            Sleep(5);
+        Sleep(50);
+
+        CompatSetQueueFull(false);
+
+        start(*desc);
+
+        while (_pending && CmdTiming::ToMs(CmdTiming::Now() - begin) < cTimeoutMs)
+            CompatPumpMessages(5);
+
+        ++stats._runs;
+
+        if (_pending || _completions != 2)
+        {
+            ++stats._failed;
+            _pending = 0;
+            continue;
+        }
+
+        ++stats._ok;
+        stats._completeMs.push_back(CmdTiming::ToMs(CmdTiming::Now() - begin));
+    }
+
+    _reporter.Add("dispatch.lost_wake_up", stats);
+
+    return (stats._failed == 0);
+}
+
+
+/**
+ *  \brief  Startup warm-up of the database of the open documents (all the
+ *          generated files) with a 64 MB GRTAGS - the time the UI thread
+ *          spends in it, until it is done and a definition search run
+ *          while the files are read (compare with sequential.FindDefinition)
+ */
+void Harness::Warmup(const char* dbDir, const std::vector<std::string>& files)
+{
+    static const unsigned cStepBudgetMs = 10;
+    static const size_t cRefsSize = 64 * 1024 * 1024;
+
+    if (!enabled("warmup"))
+        return;
+
+    const std::string refsFile = std::string(dbDir) + "/GRTAGS";
+
+    {
+        FILE* fp = fopen(refsFile.c_str(), "wb");
+        if (fp == NULL)
+            return;
+
+        const std::vector<char> chunk(1024 * 1024, 'r');
+        for (size_t size = 0; size < cRefsSize; size += chunk.size())
+            fwrite(chunk.data(), 1, chunk.size(), fp);
+
+        fclose(fp);
+    }
+
+    std::vector<CPath> paths;
+    for (const auto& file : files)
+        paths.push_back(CPath(CText((std::string(dbDir) + "/" + file).c_str()).C_str()));
+
+    setBackendEnv(_opts._delayMs);
+
+    Stats uiStats, doneStats;
+    unsigned yields = 0;
+    ULONGLONG bytes = 0;
+
+    const CmdDesc* findDefinition = NULL;
+    for (const auto& desc : cCmds)
+        if (desc._id == FIND_DEFINITION)
+            findDefinition = &desc;
+
+    _runs.clear();
+
+    for (unsigned i = 0; i < _opts._runs; ++i)
+    {
+        DbWarmup::Get().Start(paths);
+
+        double uiMs = 0;
+
+        // As the UI timer does it
+        for (bool more = true; more;)
+        {
+            const LONGLONG start = CmdTiming::Now();
+            more = DbWarmup::Get().Step(cStepBudgetMs);
+            uiMs += CmdTiming::ToMs(CmdTiming::Now() - start);
+        }
+
+        ++uiStats._runs;
+        ++uiStats._ok;
+        uiStats._completeMs.push_back(uiMs);
+
+        if (findDefinition && enabled("warmup.FindDefinition"))
+        {
+            start(*findDefinition);
+            waitAll();
+        }
+
+        while (DbWarmup::Get().IsRunning())
+            CompatPumpMessages(5);
+
+        DbWarmup::Stats stats;
+        DbWarmup::Get().GetStats(stats);
+
+        ++doneStats._runs;
+
+        if (stats._doneTime && stats._dbs == 1 && stats._files == paths.size())
+        {
+            ++doneStats._ok;
+            doneStats._completeMs.push_back(CmdTiming::ToMs(stats._doneTime - stats._startTime));
+        }
+        else
+        {
+            ++doneStats._failed;
+        }
+
+        yields += stats._yields;
+        bytes = stats._bytes;
+    }
+
+    DbWarmup::Get().Stop();
+
+    _reporter.Add("warmup.ui_thread", uiStats);
+    _reporter.Add("warmup.done", doneStats);
+
+    if (findDefinition && enabled("warmup.FindDefinition"))
+    {
+        Stats stats;
+        collect(stats);
+        _reporter.Add("warmup.FindDefinition", stats);
+    }
+
+    char text[128];
+    snprintf(text, sizeof(text), "warmup: %u documents, %llu MB read per run, %u waits for user commands",
+            (unsigned)paths.size(), (unsigned long long)(bytes / (1024 * 1024)), yields);
+    _reporter.Comment(text);
+
+    remove(refsFile.c_str());
+}
+
+
+/**
+ *  \brief  Checks the SymbolResolver per-buffer cache - names are served
+ *          from it until the buffer is modified or closed, each buffer has its
+ *          own and the kinds stay the same. The table load must not count as
+ *          a user command. Each check is a run, the failed ones are reported.
+ *          Returns false if any check failed.
+ */
+bool Harness::SymbolCache(const char* dbDir, const std::string& file, const std::string& symbol)
+{
+    static bool TableReady;
+
+    if (!enabled("symbol_cache.checks"))
+        return true;
+
+    struct ReadyCB
+    {
+        static void Ready() { TableReady = true; }
+    };
+
+    const CPath path(CText((std::string(dbDir) + "/" + file).c_str()).C_str());
+
+    std::vector<std::string> names;
+    names.push_back(symbol);
+    names.push_back("no_such_symbol_in_the_database");
+
+    SymbolResolver& resolver = SymbolResolver::Get();
+    Stats stats;
+
+    std::vector<SymbolTable::Kind_t> kinds;
+
+    // Resolves in bufferId, checks the kinds and that cacheHits names were served from the cache
+    auto check = [&](LRESULT bufferId, unsigned cacheHits) -> bool
+    {
+        SymbolResolver::Stats before;
+        resolver.GetStats(before);
+
+        const LONGLONG start = CmdTiming::Now();
+        const bool resolved = resolver.Resolve(path, bufferId, names, kinds);
+        const double ms = CmdTiming::ToMs(CmdTiming::Now() - start);
+
+        SymbolResolver::Stats after;
+        resolver.GetStats(after);
+
+        ++stats._runs;
+
+        if (!resolved || kinds.size() != names.size() || kinds[0] != SymbolTable::DEFINITION ||
+                kinds[1] != SymbolTable::UNKNOWN || after._cacheHits - before._cacheHits != cacheHits ||
+                after._tableLoads != 1)
+        {
+            ++stats._failed;
+            return false;
+        }
+
+        ++stats._ok;
+        stats._completeMs.push_back(ms);
+        return true;
+    };
+
+    TableReady = false;
+
+    bool busy = false;
+
+    // The first call loads the table in the background
+    if (!resolver.Resolve(path, 1, names, kinds, ReadyCB::Ready))
+    {
+        // The load is not a user command - the background work must not yield to it
+        busy = CmdEngine::IsBusy();
+
+        const LONGLONG start = CmdTiming::Now();
+
+        while (!TableReady && CmdTiming::ToMs(CmdTiming::Now() - start) < 10000)
+            CompatPumpMessages(5);
+    }
+
+    ++stats._runs;
+    if (busy)
+        ++stats._failed;
+    else
+        ++stats._ok;
+
+    const unsigned n = (unsigned)names.size();
+
+    check(1, 0);        // Resolved from the table
+    check(1, n);        // Same buffer version - cached
+    resolver.BufferModified(1);
+    check(1, 0);        // Modified - resolved again
+    check(1, n);
+    check(2, 0);        // Other buffer has its own cache
+    resolver.BufferClosed(1);
+    check(1, 0);        // Closed - the cache is dropped
+    check(2, n);
+
+    resolver.BufferClosed(1);
+    resolver.BufferClosed(2);
+
+    const bool passed = (stats._failed == 0);
+
+    _reporter.Add("symbol_cache.checks", stats);
+
+    return passed;
+}
+
+
+/**
+ *  \brief  The plugin work on the editor start path with the generated files
+ *          open - DLL load and setInfo have nothing left to do, ready loads
+ *          the settings and the rest is initialized on first use. A run over
+ *          the Startup::cBudgetMs fails. An init called again while it runs
+ *          (from a modal dialog it shows) must not run twice - that is one
+ *          more run. Returns false if any run failed.
+ */
+bool Harness::StartupTime(const char* dbDir, const std::vector<std::string>& files)
+{
+    static unsigned InitCalls;
+
+    if (!enabled("startup.ready"))
+        return true;
+
+    struct NestedInit
+    {
+        static bool Init()
+        {
+            ++InitCalls;
+            return !Startup::Get().Init(Startup::COM, Init);
+        }
+    };
+
+    std::vector<CPath> paths;
+    for (const auto& file : files)
+        paths.push_back(CPath(CText((std::string(dbDir) + "/" + file).c_str()).C_str()));
+
+    Startup& startup = Startup::Get();
+    Stats stats;
+
+    for (unsigned i = 0; i < _opts._runs; ++i)
+    {
+        // As OnNppReady does it
+        startup.Begin(Startup::READY);
+
+        Settings settings;
+        settings.Load();
+
+        std::vector<CPath> openFiles;
+        INpp::Get().GetOpenFiles(openFiles);
+        if (openFiles.empty())
+            openFiles = paths;
+
+        DbWarmup::Get().Start(openFiles);
+
+        startup.End(Startup::READY);
+
+        ++stats._runs;
+        stats._completeMs.push_back(startup.StartupMs());
+
+        if (startup.WithinBudget())
+            ++stats._ok;
+        else
+            ++stats._failed;
+    }
+
+    DbWarmup::Get().Stop();
+
+    const unsigned overBudget = stats._failed;
+
+    InitCalls = 0;
+
+    ++stats._runs;
+    if (startup.Init(Startup::COM, NestedInit::Init) && InitCalls == 1 && startup.Init(Startup::COM, NULL))
+        ++stats._ok;
+    else
+        ++stats._failed;
+
+    const bool passed = (stats._failed == 0);
+
+    _reporter.Add("startup.ready", stats);
+
+    char text[128];
+    snprintf(text, sizeof(text), "startup: %u documents open, %u of %u runs over the %.1f ms budget",
+            (unsigned)paths.size(), overBudget, _opts._runs, Startup::cBudgetMs);
+    _reporter.Comment(text);
+
+    return passed;
+}
+
+
+/**
+ *  \brief
+ */
+bool parseOptions(int argc, char* argv[], Options& opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* val = strchr(arg, '=');
+
+        if (strncmp(arg, "--", 2) || !val)
+            return false;
+
+        const std::string key(arg + 2, val - arg - 2);
+        ++val;
+
+        if (key == "runs")
+            opts._runs = strtoul(val, NULL, 10);
+        else if (key == "concurrency")
+            opts._concurrency = strtoul(val, NULL, 10);
+        else if (key == "cancel-after")
+            opts._cancelAfterMs = strtoul(val, NULL, 10);
+        else if (key == "files")
+            opts._files = strtoul(val, NULL, 10);
+        else if (key == "hits")
+            opts._hits = strtoul(val, NULL, 10);
+        else if (key == "symbols")
+            opts._symbols = strtoul(val, NULL, 10);
+        else if (key == "delay-ms")
+            opts._delayMs = strtoul(val, NULL, 10);
+        else if (key == "rate")
+            opts._rate = strtoul(val, NULL, 10);
+        else if (key == "filter")
+            opts._filter = val;
+        else if (key == "format")
+            opts._format = val;
+        else if (key == "output")
+            opts._output = val;
+        else if (key == "backend-dir")
+            opts._backendDir = val;
+        else
+            return false;
+    }
+
+    if (opts._format != "json" && opts._format != "csv" && opts._format != "text")
+        return false;
+
+    if (!opts._runs || !opts._concurrency || !opts._files || !opts._symbols)
+        return false;
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+int removeEntry(const char* path, const struct stat*, int, struct FTW*)
+{
+    return remove(path);
+}
+
+} // anonymous namespace
+
+
+/**
+ *  \brief  Searches done in an earlier session served from the database
+ *          query cache file - the cache is written out and dropped from
+ *          memory before each run as on exit. The file must not be used
+ *          once GTAGS changes.
+ */
+void Harness::Persistent(const char* dbDir)
+{
+    setBackendEnv(_opts._delayMs);
+
+    GTagsSettings._queryCache = true;
+
+    for (const auto& desc : cCmds)
+    {
+        if (!QueryCache::IsCached(desc._id))
+            continue;
+
+        const std::string name = std::string("querycache.") + desc._name;
+        if (!enabled(name))
+            continue;
+
+        _runs.clear();
+
+        // Stored by the first session
+        start(desc);
+        waitAll();
+        _runs.clear();
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            QueryCache::Get().Compact();
+
+            start(desc);
+            waitAll();
+        }
+
+        Stats stats;
+        collect(stats);
+        _reporter.Add(name, stats);
+    }
+
+    const CmdDesc* findDefinition = NULL;
+    for (const auto& desc : cCmds)
+        if (desc._id == FIND_DEFINITION)
+            findDefinition = &desc;
+
+    if (enabled("querycache.invalidated") && findDefinition)
+    {
+        Stats stats;
+
+        for (unsigned i = 0; i < _opts._runs; ++i)
+        {
+            QueryCache::Stats before, after;
+            QueryCache::Get().GetStats(before);
+
+            // The database is updated meanwhile
+            FILE* fp = fopen((std::string(dbDir) + "/GTAGS").c_str(), "ab");
+            if (fp)
+            {
+                fputc(0, fp);
+                fclose(fp);
+            }
+
+            QueryCache::Get().Compact();
+
+            _runs.clear();
+            start(*findDefinition);
+            waitAll();
+
+            QueryCache::Get().GetStats(after);
+
+            ++stats._runs;
+
+            if (after._invalidated > before._invalidated && after._hits == before._hits)
+                ++stats._ok;
+            else
+                ++stats._failed;
+        }
+
+        _reporter.Add("querycache.invalidated", stats);
+    }
+
+    QueryCache::Get().Compact();
+
+    GTagsSettings._queryCache = false;
+}
+
+
+/**
+ *  \brief
+ */
+int main(int argc, char* argv[])
+{
+    Options opts;
+
+    // The whole command path is measured - the query cache has its own benchmarks
+    GTagsSettings._queryCache = false;
+
+    if (!parseOptions(argc, argv, opts))
+    {
+        fputs(cUsage, stderr);
+        return 1;
+    }
+
+    if (opts._backendDir.empty())
+    {
+        char exePath[4096];
+        const ssize_t len = readlink("/proc/self/exe", exePath, sizeof(exePath) - 1);
+        if (len <= 0)
+        {
+            fputs("Cannot find the executable directory, use --backend-dir\n", stderr);
+            return 1;
+        }
+
+        exePath[len] = 0;
+        opts._backendDir = exePath;
+        opts._backendDir.erase(opts._backendDir.rfind('/'));
+    }
+
+    // CmdEngine runs <DllPath dir>\NppGTags\global.exe
+    DllPath = CText((opts._backendDir + "/NppGTags.dll").c_str()).C_str();
+
+    char dbDir[] = "/tmp/gtags_latency.XXXXXX";
+    if (!mkdtemp(dbDir))
+    {
+        fputs("Cannot create the database directory\n", stderr);
+        return 1;
+    }
+
+    FILE* fp = stdout;
+    bool checksPassed = true;
+
+    if (!opts._output.empty())
+    {
+        fp = fopen(opts._output.c_str(), "w");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "Cannot open %s\n", opts._output.c_str());
+            nftw(dbDir, removeEntry, 8, FTW_DEPTH | FTW_PHYS);
+            return 1;
+        }
+    }
+
+    {
+        // The same files the stub global lists with -P
+        ResultGen::Params params;
+        params._files       = opts._files;
+        params._hitsPerFile = opts._hits;
+        params._symbols     = opts._symbols;
+
+        ResultGen gen(params);
+        gen.WriteTree(dbDir);
+
+        const DbHandle& db = DbManager::Get().RegisterDb(CPath(CText((std::string(dbDir) + "/").c_str()).C_str()));
+
+        Reporter reporter(opts, fp);
+        Harness harness(opts, reporter, db, gen.Tag().c_str());
+
+        reporter.Header();
+
+        harness.Sequential();
+        harness.Concurrent();
+        harness.Cancel();
+        harness.Truncate();
+        harness.Overlay(dbDir, gen.Files()[0]);
+        harness.Delta(dbDir, gen.Files());
+        harness.Prefetch();
+        harness.Supersede();
+        harness.BusyUi();
+        harness.Persistent(dbDir);
+        harness.Warmup(dbDir, gen.Files());
+
+        checksPassed = harness.LostWakeUp();
+        checksPassed = harness.SymbolCache(dbDir, gen.Files()[0], gen.Tag()) && checksPassed;
+        checksPassed = harness.StartupTime(dbDir, gen.Files()) && checksPassed;
+    }
+
+    if (fp != stdout)
+        fclose(fp);
+
+    nftw(dbDir, removeEntry, 8, FTW_DEPTH | FTW_PHYS);
+
+    if (!checksPassed)
+    {
+        fputs("Checks failed - see the runs not OK\n", stderr);
+        return 2;
+    }
+
+    return 0;
+}
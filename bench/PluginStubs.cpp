@@ -0,0 +1,48 @@
+/**
+ *  \file
+ *  \brief  Plugin globals and the parts of the plugin not built into the benchmarks
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include "Common.h"
+#include "INpp.h"
+#include "GTags.h"
+#include "Config.h"
+
+
+namespace GTags
+{
+
+FuncItem Menu[23];
+
+HINSTANCE HMod = NULL;
+CPath DllPath;
+
+CText UIFontName;
+unsigned UIFontSize;
+
+HWND MainWndH = NULL;
+
+Settings GTagsSettings;
+
+} // namespace GTags
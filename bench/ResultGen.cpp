@@ -0,0 +1,300 @@
+/**
+ *  \file
+ *  \brief  Synthetic GTags command output generator for the benchmarks
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#define MKDIR(path)     _mkdir(path)
+#else
+#define MKDIR(path)     mkdir(path, 0755)
+#endif
+#include <algorithm>
+#include <set>
+#include "ResultGen.h"
+
+
+namespace
+{
+
+const char* const cVerbs[] =
+{
+    "get", "set", "is", "has", "create", "destroy", "update", "find", "parse", "read", "write", "init", "on"
+};
+
+const char* const cNouns[] =
+{
+    "Buffer", "Node", "Item", "Path", "File", "Tag", "Window", "Line", "Result", "Config", "Db", "Cmd",
+    "Text", "List", "Entry", "State", "Style", "Font", "Pipe", "Lock"
+};
+
+const char* const cDirs[] =
+{
+    "src", "lib", "include", "core", "util", "ui", "net", "io", "test", "plugins", "common", "third_party"
+};
+
+const char* const cExts[] = { ".c", ".cpp", ".h", ".hpp" };
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+/**
+ *  \brief
+ */
+ResultGen::ResultGen(const Params& params) : _params(params), _state(params._seed ? params._seed : 1)
+{
+    std::set<std::string> symbols;
+    for (unsigned tries = 0; symbols.size() < _params._symbols && tries < _params._symbols * 8; ++tries)
+        symbols.insert(identifier());
+    _symbols.assign(symbols.begin(), symbols.end());
+
+    std::set<std::string> files;
+    for (unsigned tries = 0; files.size() < _params._files && tries < _params._files * 8; ++tries)
+    {
+        std::string file;
+        const unsigned depth = 1 + next() % (_params._pathDepth ? _params._pathDepth : 1);
+
+        for (unsigned i = 0; i < depth; ++i)
+        {
+            file += cDirs[next() % (sizeof(cDirs) / sizeof(cDirs[0]))];
+            file += '/';
+        }
+
+        std::string name = identifier();
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+        file += name;
+        file += cExts[next() % (sizeof(cExts) / sizeof(cExts[0]))];
+
+        files.insert(file);
+    }
+    _files.assign(files.begin(), files.end());
+}
+
+
+/**
+ *  \brief  global -d/-r/-s/-g --result=grep output - "path:line:source line"
+ */
+void ResultGen::Grep(std::vector<char>& out, bool libDuplicates)
+{
+    out.clear();
+
+    for (const auto& file : _files)
+    {
+        unsigned line = 1;
+
+        for (unsigned hit = 0; hit < _params._hitsPerFile; ++hit)
+        {
+            line += 1 + next() % 50;
+
+            const size_t lineStart = out.size();
+            appendLine(out, file, line);
+
+            // Library databases report the same definitions again
+            if (libDuplicates)
+            {
+                std::vector<char> dup(out.begin() + lineStart, out.end());
+                out.insert(out.end(), dup.begin(), dup.end());
+            }
+        }
+    }
+
+    out.push_back(0);
+}
+
+
+/**
+ *  \brief  global -P output - one path per line
+ */
+void ResultGen::FileList(std::vector<char>& out)
+{
+    out.clear();
+
+    for (const auto& file : _files)
+    {
+        out.insert(out.end(), file.begin(), file.end());
+        out.push_back('\n');
+    }
+
+    out.push_back(0);
+}
+
+
+/**
+ *  \brief  global -c output - sorted symbol names one per line
+ */
+void ResultGen::Completion(std::vector<char>& out, bool libDuplicates)
+{
+    out.clear();
+
+    for (int pass = libDuplicates ? 2 : 1; pass; --pass)
+    {
+        for (const auto& symbol : _symbols)
+        {
+            out.insert(out.end(), symbol.begin(), symbol.end());
+            out.push_back('\n');
+        }
+    }
+
+    out.push_back(0);
+}
+
+
+/**
+ *  \brief  Source file content - _fileLines call statements, _hitsPerFile of
+ *          them call Tag(). No NUL termination.
+ */
+void ResultGen::Source(std::vector<char>& out)
+{
+    out.clear();
+
+    unsigned step = _params._hitsPerFile ? _params._fileLines / _params._hitsPerFile : 0;
+    if (_params._hitsPerFile && !step)
+        step = 1;
+    const unsigned firstHit = step ? next() % step : 0;
+
+    for (unsigned line = 0; line < _params._fileLines; ++line)
+    {
+        const bool hit = step && line >= firstHit && (line - firstHit) % step == 0;
+
+        appendCode(out, hit ? Tag() : _symbols[next() % _symbols.size()], 1 + line % 3);
+    }
+}
+
+
+/**
+ *  \brief  Writes all Files() under root (native path, must exist).
+ *          Returns the total size of the written files.
+ */
+size_t ResultGen::WriteTree(const std::string& root)
+{
+    size_t total = 0;
+    std::vector<char> content;
+
+    for (const auto& file : _files)
+    {
+        std::string path = root;
+
+        for (size_t pos = 0, slash; (slash = file.find('/', pos)) != std::string::npos; pos = slash + 1)
+        {
+            path += '/';
+            path.append(file, pos, slash - pos);
+            MKDIR(path.c_str());
+        }
+
+        path = root + '/' + file;
+
+        FILE* fp = fopen(path.c_str(), "wb");
+        if (fp == NULL)
+            return 0;
+
+        Source(content);
+        fwrite(content.data(), 1, content.size(), fp);
+        fclose(fp);
+
+        total += content.size();
+    }
+
+    return total;
+}
+
+
+/**
+ *  \brief  xorshift32
+ */
+unsigned ResultGen::next()
+{
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+
+    return _state;
+}
+
+
+/**
+ *  \brief
+ */
+std::string ResultGen::identifier()
+{
+    std::string id = cVerbs[next() % (sizeof(cVerbs) / sizeof(cVerbs[0]))];
+
+    const unsigned nouns = 1 + next() % 3;
+    for (unsigned i = 0; i < nouns; ++i)
+        id += cNouns[next() % (sizeof(cNouns) / sizeof(cNouns[0]))];
+
+    if (next() % 4 == 0)
+    {
+        char num[16];
+        snprintf(num, sizeof(num), "%u", next() % 100);
+        id += num;
+    }
+
+    return id;
+}
+
+
+/**
+ *  \brief
+ */
+void ResultGen::appendLine(std::vector<char>& out, const std::string& file, unsigned line)
+{
+    char lineNum[16];
+    const int lineNumLen = snprintf(lineNum, sizeof(lineNum), ":%u:", line);
+
+    out.insert(out.end(), file.begin(), file.end());
+    out.insert(out.end(), lineNum, lineNum + lineNumLen);
+
+    appendCode(out, Tag(), 1 + line % 3);
+}
+
+
+/**
+ *  \brief  Call statement line - "callee(args...);"
+ */
+void ResultGen::appendCode(std::vector<char>& out, const std::string& callee, unsigned indent)
+{
+    const size_t lineStart = out.size();
+
+    out.insert(out.end(), 4 * indent, ' ');
+    out.insert(out.end(), callee.begin(), callee.end());
+    out.push_back('(');
+
+    while (out.size() - lineStart < _params._lineLen)
+    {
+        const std::string& arg = _symbols[next() % _symbols.size()];
+        out.insert(out.end(), arg.begin(), arg.end());
+        out.push_back(',');
+        out.push_back(' ');
+    }
+
+    out.push_back(')');
+    out.push_back(';');
+    out.push_back('\n');
+}
+
+} // namespace GTags
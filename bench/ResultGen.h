@@ -0,0 +1,87 @@
+/**
+ *  \file
+ *  \brief  Synthetic GTags command output generator for the benchmarks
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <vector>
+#include <string>
+
+
+namespace GTags
+{
+
+/**
+ *  \class  ResultGen
+ *  \brief  Generates deterministic output in the formats produced by global
+ *          for the different commands - the same seed and sizes always give
+ *          the same output so benchmark runs are comparable
+ */
+class ResultGen
+{
+public:
+    /**
+     *  \struct  Params
+     *  \brief
+     */
+    struct Params
+    {
+        Params() : _files(2000), _hitsPerFile(10), _symbols(20000), _pathDepth(3), _lineLen(60), _fileLines(200),
+                _seed(1) {}
+
+        unsigned    _files;
+        unsigned    _hitsPerFile;
+        unsigned    _symbols;
+        unsigned    _pathDepth;
+        unsigned    _lineLen;
+        unsigned    _fileLines;
+        unsigned    _seed;
+    };
+
+    ResultGen(const Params& params);
+    ~ResultGen() {}
+
+    inline const std::vector<std::string>& Files() const { return _files; }
+    inline const std::vector<std::string>& Symbols() const { return _symbols; }
+    inline const std::string& Tag() const { return _symbols[_symbols.size() / 2]; }
+
+    void Grep(std::vector<char>& out, bool libDuplicates = false);
+    void FileList(std::vector<char>& out);
+    void Completion(std::vector<char>& out, bool libDuplicates = false);
+    void Source(std::vector<char>& out);
+    size_t WriteTree(const std::string& root);
+
+private:
+    unsigned next();
+    std::string identifier();
+    void appendLine(std::vector<char>& out, const std::string& file, unsigned line);
+    void appendCode(std::vector<char>& out, const std::string& callee, unsigned indent);
+
+    const Params                _params;
+    unsigned                    _state;
+    std::vector<std::string>    _files;
+    std::vector<std::string>    _symbols;
+};
+
+} // namespace GTags
@@ -0,0 +1,1235 @@
+/**
+ *  \file
+ *  \brief  Minimal Win32 API subset needed to build the plugin core on POSIX
+ *          systems for the headless benchmarks
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <shlobj.h>
+#include <objbase.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include "internal.h"
+
+
+namespace Compat
+{
+
+/**
+ *  \brief
+ */
+static void appendUtf8(std::string& dst, wchar_t wc)
+{
+    unsigned c = (unsigned)wc;
+
+    if (c < 0x80)
+    {
+        dst += (char)c;
+    }
+    else if (c < 0x800)
+    {
+        dst += (char)(0xC0 | (c >> 6));
+        dst += (char)(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000)
+    {
+        dst += (char)(0xE0 | (c >> 12));
+        dst += (char)(0x80 | ((c >> 6) & 0x3F));
+        dst += (char)(0x80 | (c & 0x3F));
+    }
+    else
+    {
+        dst += (char)(0xF0 | (c >> 18));
+        dst += (char)(0x80 | ((c >> 12) & 0x3F));
+        dst += (char)(0x80 | ((c >> 6) & 0x3F));
+        dst += (char)(0x80 | (c & 0x3F));
+    }
+}
+
+
+/**
+ *  \brief
+ */
+std::string ToUtf8(const wchar_t* str, size_t len)
+{
+    std::string dst;
+    dst.reserve(len);
+
+    for (size_t i = 0; i < len; ++i)
+        appendUtf8(dst, str[i]);
+
+    return dst;
+}
+
+
+/**
+ *  \brief  Decodes UTF-8 falling back to byte widening on invalid sequences
+ */
+std::wstring FromUtf8(const char* str, size_t len)
+{
+    std::wstring dst;
+    dst.reserve(len);
+
+    const unsigned char* p = (const unsigned char*)str;
+    const unsigned char* end = p + len;
+
+    while (p < end)
+    {
+        unsigned c = *p;
+        int extra = (c >= 0xF0 && c < 0xF8) ? 3 : (c >= 0xE0) ? 2 : (c >= 0xC0) ? 1 : 0;
+
+        if (c >= 0x80 && c < 0xC0)
+            extra = -1;
+
+        if (extra > 0 && p + extra < end)
+        {
+            unsigned wc = c & (0x3F >> extra);
+            int i = 1;
+
+            for (; i <= extra && (p[i] & 0xC0) == 0x80; ++i)
+                wc = (wc << 6) | (p[i] & 0x3F);
+
+            if (i > extra)
+            {
+                dst += (wchar_t)wc;
+                p += extra + 1;
+                continue;
+            }
+        }
+
+        dst += (wchar_t)c;
+        ++p;
+    }
+
+    return dst;
+}
+
+
+/**
+ *  \brief  Converts Windows style path to native one
+ */
+std::string NativePath(const wchar_t* path)
+{
+    std::string dst = ToUtf8(path, wcslen(path));
+
+    for (auto& ch : dst)
+        if (ch == '\\')
+            ch = '/';
+
+    return dst;
+}
+
+
+} // namespace Compat
+
+
+using namespace Compat;
+
+
+namespace
+{
+
+/**
+ *  \brief  Converts MSVC wide printf format to ISO C one - %s and %c take
+ *          wide arguments unless prefixed with h, %S and %C take narrow ones
+ */
+std::wstring isoFormat(const wchar_t* format)
+{
+    std::wstring iso;
+    iso.reserve(wcslen(format) + 16);
+
+    for (const wchar_t* p = format; *p; ++p)
+    {
+        iso += *p;
+
+        if (*p != L'%')
+            continue;
+
+        if (*(p + 1) == L'%')
+        {
+            iso += *++p;
+            continue;
+        }
+
+        // flags, width and precision
+        while (*(p + 1) && wcschr(L"-+ #0123456789.*", *(p + 1)))
+            iso += *++p;
+
+        bool wide = true;
+        bool hasLen = false;
+
+        if (*(p + 1) == L'h' && (*(p + 2) == L's' || *(p + 2) == L'c'))
+        {
+            ++p;
+            wide = false;
+        }
+        else if (*(p + 1) == L'l' && (*(p + 2) == L's' || *(p + 2) == L'c'))
+        {
+            hasLen = true;
+        }
+        else if (*(p + 1) == L'I' && *(p + 2) == L'6' && *(p + 3) == L'4')
+        {
+            p += 3;
+            iso += L"ll";
+            continue;
+        }
+
+        if (!*(p + 1))
+            break;
+
+        const wchar_t conv = *(p + 1);
+
+        if ((conv == L's' || conv == L'c') && wide && !hasLen)
+        {
+            iso += L'l';
+        }
+        else if (conv == L'S' || conv == L'C')
+        {
+            iso += (conv == L'S') ? L's' : L'c';
+            ++p;
+        }
+    }
+
+    return iso;
+}
+
+
+/**
+ *  \brief  Formats in a growing buffer
+ */
+std::wstring vformat(const wchar_t* format, va_list args)
+{
+    const std::wstring iso = isoFormat(format);
+    std::vector<wchar_t> buf(1024);
+
+    for (;;)
+    {
+        va_list argsCopy;
+        va_copy(argsCopy, args);
+        const int len = vswprintf(buf.data(), buf.size(), iso.c_str(), argsCopy);
+        va_end(argsCopy);
+
+        if (len >= 0)
+            return std::wstring(buf.data(), len);
+
+        if (buf.size() >= (1 << 24))
+            return std::wstring();
+
+        buf.resize(buf.size() * 2);
+    }
+}
+
+
+/**
+ *  \struct  Message
+ *  \brief  _sent points to the waiting sender's reply slot, NULL for posted messages
+ */
+struct Message
+{
+    /**
+     *  \struct  Reply
+     *  \brief
+     */
+    struct Reply
+    {
+        Reply() : _done(false), _result(0) {}
+
+        bool    _done;
+        LRESULT _result;
+    };
+
+    HWND    _hWnd;
+    UINT    _msg;
+    WPARAM  _wParam;
+    LPARAM  _lParam;
+    Reply*  _sent;
+};
+
+
+/**
+ *  \class  WindowRegistry
+ *  \brief  Emulated windows - each one is a window procedure owned by the
+ *          thread that created it plus a common queue of pending messages
+ */
+class WindowRegistry
+{
+public:
+    static WindowRegistry& Get()
+    {
+        static WindowRegistry Instance;
+        return Instance;
+    }
+
+    HWND Add(WNDPROC wndProc);
+    void Remove(HWND hWnd);
+    WNDPROC Find(HWND hWnd, pthread_t* owner);
+
+    LRESULT Send(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
+    BOOL Post(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
+    BOOL ReplyCurrent(LRESULT result);
+    unsigned Pump(DWORD timeoutMs);
+
+    void SetQueueFull(bool full)
+    {
+        pthread_mutex_lock(&_lock);
+        _queueFull = full;
+        pthread_mutex_unlock(&_lock);
+    }
+
+private:
+    /**
+     *  \struct  Window
+     *  \brief
+     */
+    struct Window
+    {
+        WNDPROC     _wndProc;
+        pthread_t   _owner;
+    };
+
+    WindowRegistry() : _lastId(0x1000), _queueFull(false)
+    {
+        pthread_mutex_init(&_lock, NULL);
+
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&_cond, &attr);
+        pthread_condattr_destroy(&attr);
+    }
+
+    bool popOwnMessage(Message& msg);
+
+    static __thread Message::Reply* CurrentReply;
+
+    pthread_mutex_t             _lock;
+    pthread_cond_t              _cond;
+    UINT_PTR                    _lastId;
+    std::map<HWND, Window>      _windows;
+    std::list<Message>          _queue;
+    bool                        _queueFull;
+};
+
+
+__thread Message::Reply* WindowRegistry::CurrentReply = NULL;
+
+
+/**
+ *  \brief
+ */
+HWND WindowRegistry::Add(WNDPROC wndProc)
+{
+    pthread_mutex_lock(&_lock);
+
+    HWND hWnd = (HWND)(UINT_PTR)(++_lastId);
+    Window& win = _windows[hWnd];
+    win._wndProc = wndProc;
+    win._owner = pthread_self();
+
+    pthread_mutex_unlock(&_lock);
+
+    return hWnd;
+}
+
+
+/**
+ *  \brief
+ */
+void WindowRegistry::Remove(HWND hWnd)
+{
+    pthread_mutex_lock(&_lock);
+    _windows.erase(hWnd);
+    pthread_mutex_unlock(&_lock);
+}
+
+
+/**
+ *  \brief
+ */
+WNDPROC WindowRegistry::Find(HWND hWnd, pthread_t* owner)
+{
+    WNDPROC wndProc = NULL;
+
+    pthread_mutex_lock(&_lock);
+
+    auto iWin = _windows.find(hWnd);
+    if (iWin != _windows.end())
+    {
+        wndProc = iWin->second._wndProc;
+        *owner = iWin->second._owner;
+    }
+
+    pthread_mutex_unlock(&_lock);
+
+    return wndProc;
+}
+
+
+/**
+ *  \brief  Calls the window procedure directly if the window is owned by the
+ *          calling thread, otherwise waits for the owner to process the message
+ */
+LRESULT WindowRegistry::Send(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+    pthread_t owner;
+    WNDPROC wndProc = Find(hWnd, &owner);
+
+    if (!wndProc)
+        return 0;
+
+    if (pthread_equal(owner, pthread_self()))
+    {
+        Message::Reply* outerReply = CurrentReply;
+        CurrentReply = NULL;
+
+        LRESULT result = wndProc(hWnd, msg, wParam, lParam);
+
+        CurrentReply = outerReply;
+
+        return result;
+    }
+
+    Message::Reply reply;
+    Message m = { hWnd, msg, wParam, lParam, &reply };
+
+    pthread_mutex_lock(&_lock);
+
+    _queue.push_back(m);
+    pthread_cond_broadcast(&_cond);
+
+    while (!reply._done)
+        pthread_cond_wait(&_cond, &_lock);
+
+    pthread_mutex_unlock(&_lock);
+
+    return reply._result;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL WindowRegistry::Post(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+    Message m = { hWnd, msg, wParam, lParam, NULL };
+
+    pthread_mutex_lock(&_lock);
+
+    const bool posted = (_windows.find(hWnd) != _windows.end() && !_queueFull);
+    if (posted)
+    {
+        _queue.push_back(m);
+        pthread_cond_broadcast(&_cond);
+    }
+
+    pthread_mutex_unlock(&_lock);
+
+    return posted;
+}
+
+
+/**
+ *  \brief  Releases the sender of the message being processed - it must not
+ *          be accessed afterwards as the reply slot lives on the sender's stack
+ */
+BOOL WindowRegistry::ReplyCurrent(LRESULT result)
+{
+    Message::Reply* reply = CurrentReply;
+
+    if (!reply)
+        return FALSE;
+
+    CurrentReply = NULL;
+
+    pthread_mutex_lock(&_lock);
+
+    reply->_result = result;
+    reply->_done = true;
+    pthread_cond_broadcast(&_cond);
+
+    pthread_mutex_unlock(&_lock);
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief  Must be called with the lock held
+ */
+bool WindowRegistry::popOwnMessage(Message& msg)
+{
+    const pthread_t self = pthread_self();
+
+    for (auto iMsg = _queue.begin(); iMsg != _queue.end();)
+    {
+        auto iWin = _windows.find(iMsg->_hWnd);
+
+        if (iWin == _windows.end())
+        {
+            // Window destroyed - release the sender
+            if (iMsg->_sent)
+            {
+                iMsg->_sent->_done = true;
+                pthread_cond_broadcast(&_cond);
+            }
+
+            iMsg = _queue.erase(iMsg);
+            continue;
+        }
+
+        if (pthread_equal(iWin->second._owner, self))
+        {
+            msg = *iMsg;
+            _queue.erase(iMsg);
+            return true;
+        }
+
+        ++iMsg;
+    }
+
+    return false;
+}
+
+
+/**
+ *  \brief  Dispatches the messages queued for the windows of the calling thread.
+ *          Waits up to timeoutMs for the first one. Returns the number of
+ *          dispatched messages.
+ */
+unsigned WindowRegistry::Pump(DWORD timeoutMs)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec     += timeoutMs / 1000;
+    deadline.tv_nsec    += (long)(timeoutMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    unsigned dispatched = 0;
+
+    for (;;)
+    {
+        Message msg;
+        WNDPROC wndProc = NULL;
+
+        pthread_mutex_lock(&_lock);
+
+        while (!popOwnMessage(msg))
+        {
+            if (dispatched || timeoutMs == 0 ||
+                    (timeoutMs != INFINITE && pthread_cond_timedwait(&_cond, &_lock, &deadline) == ETIMEDOUT) ||
+                    (timeoutMs == INFINITE && pthread_cond_wait(&_cond, &_lock)))
+            {
+                pthread_mutex_unlock(&_lock);
+                return dispatched;
+            }
+        }
+
+        wndProc = _windows[msg._hWnd]._wndProc;
+
+        pthread_mutex_unlock(&_lock);
+
+        CurrentReply = msg._sent;
+
+        const LRESULT result = wndProc(msg._hWnd, msg._msg, msg._wParam, msg._lParam);
+
+        ReplyCurrent(result);
+
+        ++dispatched;
+    }
+}
+
+} // anonymous namespace
+
+
+/**
+ *  \brief
+ */
+BOOL QueryPerformanceCounter(LARGE_INTEGER* count)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    count->QuadPart = (LONGLONG)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* freq)
+{
+    freq->QuadPart = 1000000000LL;
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+DWORD GetTickCount()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (DWORD)((ULONGLONG)ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+
+/**
+ *  \brief
+ */
+void Sleep(DWORD ms)
+{
+    struct timespec ts;
+    ts.tv_sec   = ms / 1000;
+    ts.tv_nsec  = (long)(ms % 1000) * 1000000L;
+
+    while (nanosleep(&ts, &ts) && errno == EINTR);
+}
+
+
+/**
+ *  \brief
+ */
+BOOL InitializeCriticalSectionAndSpinCount(CRITICAL_SECTION* cs, DWORD)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&cs->_mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+void DeleteCriticalSection(CRITICAL_SECTION* cs)
+{
+    pthread_mutex_destroy(&cs->_mutex);
+}
+
+
+/**
+ *  \brief
+ */
+DWORD GetFileAttributesW(LPCWSTR fileName)
+{
+    struct stat st;
+
+    if (stat(NativePath(fileName).c_str(), &st))
+        return INVALID_FILE_ATTRIBUTES;
+
+    return S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL GetFileAttributesExW(LPCWSTR fileName, GET_FILEEX_INFO_LEVELS, LPVOID info)
+{
+    struct stat st;
+
+    if (stat(NativePath(fileName).c_str(), &st))
+        return FALSE;
+
+    WIN32_FILE_ATTRIBUTE_DATA* data = static_cast<WIN32_FILE_ATTRIBUTE_DATA*>(info);
+    memset(data, 0, sizeof(*data));
+
+    const unsigned long long writeTime =
+            (unsigned long long)st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+
+    data->dwFileAttributes                  = S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+    data->ftLastWriteTime.dwLowDateTime     = (DWORD)writeTime;
+    data->ftLastWriteTime.dwHighDateTime    = (DWORD)(writeTime >> 32);
+    data->nFileSizeLow                      = (DWORD)st.st_size;
+    data->nFileSizeHigh                     = (DWORD)((unsigned long long)st.st_size >> 32);
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL DeleteFileW(LPCWSTR fileName)
+{
+    return (unlink(NativePath(fileName).c_str()) == 0);
+}
+
+
+/**
+ *  \brief  Fails if the new file exists like the Windows one
+ */
+BOOL MoveFileW(LPCWSTR existingName, LPCWSTR newName)
+{
+    const std::string newPath = NativePath(newName);
+
+    if (access(newPath.c_str(), F_OK) == 0)
+        return FALSE;
+
+    return (rename(NativePath(existingName).c_str(), newPath.c_str()) == 0);
+}
+
+
+/**
+ *  \brief
+ */
+BOOL CreateDirectoryW(LPCWSTR pathName, SECURITY_ATTRIBUTES*)
+{
+    return (mkdir(NativePath(pathName).c_str(), 0755) == 0);
+}
+
+
+/**
+ *  \brief  The temp folder path with a trailing separator as on Windows
+ */
+DWORD GetTempPathW(DWORD bufLen, LPWSTR buf)
+{
+    static const wchar_t cTempPath[] = L"/tmp/";
+
+    if (bufLen < _countof(cTempPath))
+        return _countof(cTempPath);
+
+    wcscpy(buf, cTempPath);
+
+    return _countof(cTempPath) - 1;
+}
+
+
+/**
+ *  \brief
+ */
+HWND CompatCreateWindow(WNDPROC wndProc)
+{
+    return WindowRegistry::Get().Add(wndProc);
+}
+
+
+/**
+ *  \brief
+ */
+void CompatDestroyWindow(HWND hWnd)
+{
+    WindowRegistry::Get().Remove(hWnd);
+}
+
+
+/**
+ *  \brief
+ */
+unsigned CompatPumpMessages(DWORD timeoutMs)
+{
+    return WindowRegistry::Get().Pump(timeoutMs);
+}
+
+
+/**
+ *  \brief  PostMessage fails while the queue is set full
+ */
+void CompatSetQueueFull(bool full)
+{
+    WindowRegistry::Get().SetQueueFull(full);
+}
+
+
+/**
+ *  \brief
+ */
+LRESULT SendMessageW(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+    return WindowRegistry::Get().Send(hWnd, msg, wParam, lParam);
+}
+
+
+/**
+ *  \brief
+ */
+BOOL PostMessageW(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+    return WindowRegistry::Get().Post(hWnd, msg, wParam, lParam);
+}
+
+
+/**
+ *  \brief
+ */
+BOOL ReplyMessage(LRESULT result)
+{
+    return WindowRegistry::Get().ReplyCurrent(result);
+}
+
+
+/**
+ *  \brief  Prints the message to stderr and returns the negative answer
+ */
+int MessageBoxW(HWND, LPCWSTR text, LPCWSTR caption, UINT type)
+{
+    fprintf(stderr, "[%s] %s\n", caption ? ToUtf8(caption, wcslen(caption)).c_str() : "",
+            text ? ToUtf8(text, wcslen(text)).c_str() : "");
+
+    if (type & MB_YESNO)
+        return IDNO;
+    if (type & MB_OKCANCEL)
+        return IDCANCEL;
+
+    return IDOK;
+}
+
+
+/**
+ *  \brief
+ */
+int MessageBoxA(HWND, LPCSTR text, LPCSTR caption, UINT)
+{
+    fprintf(stderr, "[%s] %s\n", caption ? caption : "", text ? text : "");
+
+    return IDOK;
+}
+
+
+/**
+ *  \brief
+ */
+int GetSystemMetrics(int index)
+{
+    switch (index)
+    {
+        case SM_CXVIRTUALSCREEN:    return 1920;
+        case SM_CYVIRTUALSCREEN:    return 1080;
+    }
+
+    return 0;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL GetWindowRect(HWND, LPRECT rect)
+{
+    rect->left = rect->top = 0;
+    rect->right = 1920;
+    rect->bottom = 1080;
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL AdjustWindowRectEx(LPRECT, DWORD, BOOL, DWORD)
+{
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+HGDIOBJ SelectObject(HDC, HGDIOBJ obj)
+{
+    return obj;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL GetTextExtentPoint32W(HDC, LPCWSTR, int len, SIZE* size)
+{
+    size->cx = 8 * len;
+    size->cy = 16;
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief  Pretends to be Windows 7
+ */
+BOOL GetVersionExW(OSVERSIONINFO* info)
+{
+    info->dwMajorVersion    = 6;
+    info->dwMinorVersion    = 1;
+    info->dwBuildNumber     = 7601;
+    info->dwPlatformId      = 2;
+    info->szCSDVersion[0]   = 0;
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL SystemParametersInfoW(UINT action, UINT, LPVOID pParam, UINT)
+{
+    if (action != SPI_GETNONCLIENTMETRICS)
+        return FALSE;
+
+    NONCLIENTMETRICS* ncm = (NONCLIENTMETRICS*)pParam;
+
+    memset(&ncm->lfMenuFont, 0, sizeof(ncm->lfMenuFont));
+    ncm->lfMenuFont.lfHeight = -12;
+    ncm->lfMenuFont.lfWeight = FW_NORMAL;
+    ncm->lfMessageFont = ncm->lfMenuFont;
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+int GetDeviceCaps(HDC, int index)
+{
+    return (index == LOGPIXELSY) ? 96 : 0;
+}
+
+
+/**
+ *  \brief
+ */
+HFONT CreateFontIndirectW(const LOGFONT*)
+{
+    return NULL;
+}
+
+
+/**
+ *  \brief
+ */
+int MulDiv(int number, int numerator, int denominator)
+{
+    if (!denominator)
+        return -1;
+
+    return (int)(((LONGLONG)number * numerator + denominator / 2) / denominator);
+}
+
+
+/**
+ *  \brief
+ */
+HRESULT SHParseDisplayName(LPCWSTR, void*, LPITEMIDLIST*, ULONG, ULONG*)
+{
+    return E_FAIL;
+}
+
+
+/**
+ *  \brief
+ */
+LPITEMIDLIST SHBrowseForFolder(BROWSEINFO*)
+{
+    return NULL;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL SHGetPathFromIDList(LPITEMIDLIST, LPTSTR path)
+{
+    path[0] = 0;
+
+    return FALSE;
+}
+
+
+/**
+ *  \brief
+ */
+void CoTaskMemFree(LPVOID)
+{
+}
+
+
+/**
+ *  \brief
+ */
+int _tcscpy_s(wchar_t* dst, size_t size, const wchar_t* src)
+{
+    return _tcsncpy_s(dst, size, src, _TRUNCATE);
+}
+
+
+/**
+ *  \brief
+ */
+int _tcsncpy_s(wchar_t* dst, size_t size, const wchar_t* src, size_t count)
+{
+    if (!dst || !size)
+        return EINVAL;
+
+    size_t len = wcslen(src);
+    if (count != _TRUNCATE && len > count)
+        len = count;
+    if (len >= size)
+        len = size - 1;
+
+    wmemcpy(dst, src, len);
+    dst[len] = 0;
+
+    return 0;
+}
+
+
+/**
+ *  \brief
+ */
+int _tcscat_s(wchar_t* dst, size_t size, const wchar_t* src)
+{
+    const size_t len = wcslen(dst);
+
+    if (len >= size)
+        return EINVAL;
+
+    return _tcscpy_s(dst + len, size - len, src);
+}
+
+
+/**
+ *  \brief
+ */
+int strcpy_s(char* dst, size_t size, const char* src)
+{
+    return strncpy_s(dst, size, src, _TRUNCATE);
+}
+
+
+/**
+ *  \brief
+ */
+int strncpy_s(char* dst, size_t size, const char* src, size_t count)
+{
+    if (!dst || !size)
+        return EINVAL;
+
+    size_t len = strlen(src);
+    if (count != _TRUNCATE && len > count)
+        len = count;
+    if (len >= size)
+        len = size - 1;
+
+    memcpy(dst, src, len);
+    dst[len] = 0;
+
+    return 0;
+}
+
+
+/**
+ *  \brief
+ */
+int _itoa_s(int val, char* buf, size_t size, int radix)
+{
+    if (radix == 16)
+        snprintf(buf, size, "%x", val);
+    else
+        snprintf(buf, size, "%d", val);
+
+    return 0;
+}
+
+
+/**
+ *  \brief
+ */
+int mbstowcs_s(size_t* converted, wchar_t* dst, size_t size, const char* src, size_t count)
+{
+    size_t len = strlen(src);
+    if (count != _TRUNCATE && len > count)
+        len = count;
+    if (len >= size)
+        len = size - 1;
+
+    for (size_t i = 0; i < len; ++i)
+        dst[i] = (wchar_t)(unsigned char)src[i];
+    dst[len] = 0;
+
+    if (converted)
+        *converted = len + 1;
+
+    return 0;
+}
+
+
+/**
+ *  \brief
+ */
+int wcstombs_s(size_t* converted, char* dst, size_t size, const wchar_t* src, size_t count)
+{
+    size_t len = wcslen(src);
+    if (count != _TRUNCATE && len > count)
+        len = count;
+    if (len >= size)
+        len = size - 1;
+
+    for (size_t i = 0; i < len; ++i)
+        dst[i] = ((unsigned)src[i] < 0x100) ? (char)src[i] : '?';
+    dst[len] = 0;
+
+    if (converted)
+        *converted = len + 1;
+
+    return 0;
+}
+
+
+/**
+ *  \brief
+ */
+int _sntprintf_s(wchar_t* buf, size_t size, size_t count, const wchar_t* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const std::wstring str = vformat(format, args);
+    va_end(args);
+
+    size_t len = str.size();
+    if (count != _TRUNCATE && len > count)
+        len = count;
+
+    const bool truncated = (len >= size);
+    if (truncated)
+        len = size - 1;
+
+    wmemcpy(buf, str.c_str(), len);
+    buf[len] = 0;
+
+    return truncated ? -1 : (int)len;
+}
+
+
+/**
+ *  \brief
+ */
+int _stprintf_s(wchar_t* buf, size_t size, const wchar_t* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const std::wstring str = vformat(format, args);
+    va_end(args);
+
+    size_t len = str.size();
+    if (len >= size)
+        len = size - 1;
+
+    wmemcpy(buf, str.c_str(), len);
+    buf[len] = 0;
+
+    return (int)len;
+}
+
+
+/**
+ *  \brief
+ */
+int _ftprintf_s(FILE* fp, const wchar_t* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const std::wstring str = vformat(format, args);
+    va_end(args);
+
+    const std::string utf8 = ToUtf8(str.c_str(), str.size());
+
+    if (fwrite(utf8.c_str(), 1, utf8.size(), fp) != utf8.size())
+        return -1;
+
+    return (int)str.size();
+}
+
+
+/**
+ *  \brief
+ */
+int _snprintf_s(char* buf, size_t size, size_t count, const char* format, ...)
+{
+    if (count != _TRUNCATE && count < size)
+        size = count + 1;
+
+    va_list args;
+    va_start(args, format);
+    const int len = vsnprintf(buf, size, format, args);
+    va_end(args);
+
+    return (len < 0 || (size_t)len >= size) ? -1 : len;
+}
+
+
+/**
+ *  \brief
+ */
+int _tfopen_s(FILE** fp, const wchar_t* fileName, const wchar_t* mode)
+{
+    std::string nativeMode;
+
+    for (const wchar_t* m = mode; *m; ++m)
+        if (*m != L't' && *m != L',')
+            nativeMode += (char)*m;
+        else if (*m == L',')
+            break;
+
+    *fp = fopen(NativePath(fileName).c_str(), nativeMode.c_str());
+
+    return *fp ? 0 : errno;
+}
+
+
+/**
+ *  \brief
+ */
+wchar_t* _fgetts(wchar_t* buf, int size, FILE* fp)
+{
+    std::vector<char> line(size);
+
+    if (!fgets(line.data(), size, fp))
+        return NULL;
+
+    const std::wstring wline = FromUtf8(line.data(), strlen(line.data()));
+
+    _tcscpy_s(buf, size, wline.c_str());
+
+    return buf;
+}
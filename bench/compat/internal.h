@@ -0,0 +1,41 @@
+/**
+ *  \file
+ *  \brief  Helpers shared by the POSIX compat layer sources
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <string>
+
+
+namespace Compat
+{
+
+std::string ToUtf8(const wchar_t* str, size_t len);
+std::wstring FromUtf8(const char* str, size_t len);
+
+// Converts Windows style path to native one ('\\' to '/') in UTF-8
+std::string NativePath(const wchar_t* path);
+
+} // namespace Compat
@@ -0,0 +1,988 @@
+/**
+ *  \file
+ *  \brief  Kernel objects (events, threads, processes, pipes) for the POSIX compat layer
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <process.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "internal.h"
+
+
+using namespace Compat;
+
+
+namespace
+{
+
+pthread_mutex_t WaitLock    = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t  WaitCond;
+pthread_once_t  WaitOnce    = PTHREAD_ONCE_INIT;
+
+// Serializes environment changes with process creation
+pthread_mutex_t EnvLock     = PTHREAD_MUTEX_INITIALIZER;
+
+// Mapped views and their sizes needed to unmap them
+pthread_mutex_t ViewsLock   = PTHREAD_MUTEX_INITIALIZER;
+std::map<const void*, size_t> Views;
+
+
+/**
+ *  \brief
+ */
+void initWaitCond()
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&WaitCond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+
+/**
+ *  \class  Object
+ *  \brief  Reference counted kernel object. The state of the waitable ones
+ *          is guarded by WaitLock and every change is broadcast on WaitCond.
+ */
+class Object
+{
+public:
+    Object() : _refs(1) {}
+    virtual ~Object() {}
+
+    inline void AddRef() { InterlockedIncrement(&_refs); }
+    inline void Release()
+    {
+        if (InterlockedDecrement(&_refs) == 0)
+            delete this;
+    }
+
+    // Called with WaitLock held
+    virtual bool IsSignaled() const { return false; }
+    virtual void Acquire() {}
+
+private:
+    volatile LONG _refs;
+};
+
+
+/**
+ *  \class  Event
+ *  \brief
+ */
+class Event : public Object
+{
+public:
+    Event(bool manualReset, bool signaled) : _manualReset(manualReset), _signaled(signaled) {}
+
+    virtual bool IsSignaled() const { return _signaled; }
+    virtual void Acquire()
+    {
+        if (!_manualReset)
+            _signaled = false;
+    }
+
+    void Set(bool signaled)
+    {
+        pthread_mutex_lock(&WaitLock);
+        _signaled = signaled;
+        pthread_cond_broadcast(&WaitCond);
+        pthread_mutex_unlock(&WaitLock);
+    }
+
+private:
+    const bool  _manualReset;
+    bool        _signaled;
+};
+
+
+/**
+ *  \class  Completion
+ *  \brief  Signaled once the thread or process finishes
+ */
+class Completion : public Object
+{
+public:
+    Completion() : _done(false), _exitCode(STILL_ACTIVE) {}
+
+    virtual bool IsSignaled() const { return _done; }
+
+    void Finish(DWORD exitCode)
+    {
+        pthread_mutex_lock(&WaitLock);
+        _done = true;
+        _exitCode = exitCode;
+        pthread_cond_broadcast(&WaitCond);
+        pthread_mutex_unlock(&WaitLock);
+    }
+
+    DWORD ExitCode() const
+    {
+        pthread_mutex_lock(&WaitLock);
+        const DWORD exitCode = _done ? _exitCode : STILL_ACTIVE;
+        pthread_mutex_unlock(&WaitLock);
+
+        return exitCode;
+    }
+
+protected:
+    bool    _done;
+    DWORD   _exitCode;
+};
+
+
+/**
+ *  \class  Thread
+ *  \brief
+ */
+class Thread : public Completion
+{
+public:
+    Thread(unsigned (__stdcall *func)(void*), void* arg) : _func(func), _arg(arg) {}
+
+    static void* Run(void* data)
+    {
+        Thread* thread = static_cast<Thread*>(data);
+
+        thread->Finish(thread->_func(thread->_arg));
+        thread->Release();
+
+        return NULL;
+    }
+
+private:
+    unsigned (__stdcall *_func)(void*);
+    void* _arg;
+};
+
+
+/**
+ *  \class  Process
+ *  \brief  A reaper thread waits for the child and keeps a reference until then
+ */
+class Process : public Completion
+{
+public:
+    Process(pid_t pid) : _pid(pid), _terminated(false), _terminateCode(0) {}
+
+    static void* Reap(void* data)
+    {
+        Process* process = static_cast<Process*>(data);
+
+        int status = 0;
+        while (waitpid(process->_pid, &status, 0) < 0 && errno == EINTR);
+
+        pthread_mutex_lock(&WaitLock);
+        const bool terminated = process->_terminated;
+        pthread_mutex_unlock(&WaitLock);
+
+        DWORD exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+        if (terminated)
+            exitCode = process->_terminateCode;
+
+        process->Finish(exitCode);
+        process->Release();
+
+        return NULL;
+    }
+
+    bool Terminate(UINT exitCode)
+    {
+        pthread_mutex_lock(&WaitLock);
+
+        // The pid is not reused before it is reaped
+        const bool running = !_done;
+        if (running)
+        {
+            _terminated = true;
+            _terminateCode = exitCode;
+            kill(_pid, SIGKILL);
+        }
+
+        pthread_mutex_unlock(&WaitLock);
+
+        return running;
+    }
+
+    inline pid_t Pid() const { return _pid; }
+
+private:
+    const pid_t _pid;
+    bool        _terminated;
+    UINT        _terminateCode;
+};
+
+
+/**
+ *  \class  File
+ *  \brief  File descriptor - the pipe ends
+ */
+class File : public Object
+{
+public:
+    File(int fd) : _fd(fd) {}
+    virtual ~File() { close(_fd); }
+
+    inline int Fd() const { return _fd; }
+
+private:
+    const int _fd;
+};
+
+
+/**
+ *  \class  Mapping
+ *  \brief  File mapping keeps its own descriptor so the file handle can be closed
+ */
+class Mapping : public Object
+{
+public:
+    Mapping(int fd, size_t size, bool writable) : _fd(fd), _size(size), _writable(writable) {}
+    virtual ~Mapping() { close(_fd); }
+
+    inline int Fd() const { return _fd; }
+    inline size_t Size() const { return _size; }
+    inline bool IsWritable() const { return _writable; }
+
+private:
+    const int       _fd;
+    const size_t    _size;
+    const bool      _writable;
+};
+
+
+/**
+ *  \brief
+ */
+inline Object* toObject(HANDLE h)
+{
+    return (h && h != INVALID_HANDLE_VALUE) ? static_cast<Object*>(h) : NULL;
+}
+
+
+/**
+ *  \brief  Splits the command line following the MS C runtime rules
+ */
+std::vector<std::wstring> splitCmdLine(const wchar_t* cmdLine)
+{
+    std::vector<std::wstring> args;
+    std::wstring arg;
+    bool inArg = false;
+    bool inQuotes = false;
+
+    for (const wchar_t* p = cmdLine; ; ++p)
+    {
+        if (*p == 0 || ((*p == L' ' || *p == L'\t') && !inQuotes))
+        {
+            if (inArg)
+                args.push_back(arg);
+
+            arg.clear();
+            inArg = false;
+
+            if (*p == 0)
+                break;
+            continue;
+        }
+
+        inArg = true;
+
+        if (*p == L'\\')
+        {
+            unsigned slashes = 0;
+            while (*p == L'\\')
+            {
+                ++slashes;
+                ++p;
+            }
+
+            if (*p == L'"')
+            {
+                arg.append(slashes / 2, L'\\');
+                if (slashes % 2)
+                    arg += L'"';
+                else
+                    inQuotes = !inQuotes;
+            }
+            else
+            {
+                arg.append(slashes, L'\\');
+                --p;
+            }
+        }
+        else if (*p == L'"')
+        {
+            inQuotes = !inQuotes;
+        }
+        else
+        {
+            arg += *p;
+        }
+    }
+
+    return args;
+}
+
+
+/**
+ *  \brief
+ */
+void setCloseOnExec(int fd, bool closeOnExec)
+{
+    int flags = fcntl(fd, F_GETFD);
+    if (closeOnExec)
+        flags |= FD_CLOEXEC;
+    else
+        flags &= ~FD_CLOEXEC;
+    fcntl(fd, F_SETFD, flags);
+}
+
+} // anonymous namespace
+
+
+/**
+ *  \brief
+ */
+BOOL CloseHandle(HANDLE h)
+{
+    Object* obj = toObject(h);
+
+    if (!obj)
+        return FALSE;
+
+    obj->Release();
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief  Only within the current process - the duplicate is another reference to the object
+ */
+BOOL DuplicateHandle(HANDLE, HANDLE hSrc, HANDLE, HANDLE* hDst, DWORD, BOOL, DWORD)
+{
+    Object* obj = toObject(hSrc);
+
+    if (!obj || !hDst)
+        return FALSE;
+
+    obj->AddRef();
+    *hDst = hSrc;
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+DWORD WaitForSingleObject(HANDLE h, DWORD timeoutMs)
+{
+    return WaitForMultipleObjects(1, &h, FALSE, timeoutMs);
+}
+
+
+/**
+ *  \brief
+ */
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL waitAll, DWORD timeoutMs)
+{
+    if (!count || waitAll)
+        return WAIT_FAILED;
+
+    for (DWORD i = 0; i < count; ++i)
+        if (!toObject(handles[i]))
+            return WAIT_FAILED;
+
+    pthread_once(&WaitOnce, initWaitCond);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec     += timeoutMs / 1000;
+    deadline.tv_nsec    += (long)(timeoutMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&WaitLock);
+
+    for (;;)
+    {
+        for (DWORD i = 0; i < count; ++i)
+        {
+            Object* obj = toObject(handles[i]);
+
+            if (obj->IsSignaled())
+            {
+                obj->Acquire();
+                pthread_mutex_unlock(&WaitLock);
+                return WAIT_OBJECT_0 + i;
+            }
+        }
+
+        if (timeoutMs == 0)
+            break;
+
+        if (timeoutMs == INFINITE)
+            pthread_cond_wait(&WaitCond, &WaitLock);
+        else if (pthread_cond_timedwait(&WaitCond, &WaitLock, &deadline) == ETIMEDOUT)
+            timeoutMs = 0;
+    }
+
+    pthread_mutex_unlock(&WaitLock);
+
+    return WAIT_TIMEOUT;
+}
+
+
+/**
+ *  \brief
+ */
+HANDLE CreateEventW(SECURITY_ATTRIBUTES*, BOOL manualReset, BOOL initialState, LPCWSTR)
+{
+    pthread_once(&WaitOnce, initWaitCond);
+
+    return new Event(manualReset, initialState);
+}
+
+
+/**
+ *  \brief
+ */
+BOOL SetEvent(HANDLE hEvent)
+{
+    Event* event = dynamic_cast<Event*>(toObject(hEvent));
+
+    if (!event)
+        return FALSE;
+
+    event->Set(true);
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL ResetEvent(HANDLE hEvent)
+{
+    Event* event = dynamic_cast<Event*>(toObject(hEvent));
+
+    if (!event)
+        return FALSE;
+
+    event->Set(false);
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+uintptr_t _beginthreadex(void*, unsigned, unsigned (__stdcall *startAddress)(void*), void* arg,
+        unsigned, unsigned* threadId)
+{
+    pthread_once(&WaitOnce, initWaitCond);
+
+    Thread* thread = new Thread(startAddress, arg);
+
+    // One reference for the handle, one for the running thread
+    thread->AddRef();
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    pthread_t tid;
+    const int err = pthread_create(&tid, &attr, Thread::Run, thread);
+
+    pthread_attr_destroy(&attr);
+
+    if (err)
+    {
+        thread->Release();
+        thread->Release();
+        return 0;
+    }
+
+    if (threadId)
+        *threadId = 0;
+
+    return (uintptr_t)static_cast<Object*>(thread);
+}
+
+
+/**
+ *  \brief  Pseudo handle as the Windows one
+ */
+HANDLE GetCurrentThread()
+{
+    return (HANDLE)(intptr_t)-2;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL SetThreadPriority(HANDLE, int)
+{
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+void GetSystemInfo(SYSTEM_INFO* si)
+{
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    si->dwPageSize              = (DWORD)sysconf(_SC_PAGESIZE);
+    si->dwNumberOfProcessors    = (cpus > 0) ? (DWORD)cpus : 1;
+}
+
+
+/**
+ *  \brief
+ */
+HANDLE CreateFileW(LPCWSTR fileName, DWORD access, DWORD, SECURITY_ATTRIBUTES*, DWORD creation, DWORD flags, HANDLE)
+{
+    const std::string path = NativePath(fileName);
+    int fd;
+
+    if (access == GENERIC_READ && creation == OPEN_EXISTING)
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    else if (access == (GENERIC_READ | GENERIC_WRITE) && creation == CREATE_ALWAYS)
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    else
+        return INVALID_HANDLE_VALUE;
+
+    if (fd < 0)
+        return INVALID_HANDLE_VALUE;
+
+    // The open descriptor keeps the file data until closed
+    if (flags & FILE_FLAG_DELETE_ON_CLOSE)
+        unlink(path.c_str());
+
+    return static_cast<Object*>(new File(fd));
+}
+
+
+/**
+ *  \brief
+ */
+BOOL GetFileSizeEx(HANDLE hFile, LARGE_INTEGER* size)
+{
+    File* file = dynamic_cast<File*>(toObject(hFile));
+
+    struct stat st;
+    if (!file || fstat(file->Fd(), &st))
+        return FALSE;
+
+    size->QuadPart = st.st_size;
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief  Maps the whole file - read-write mappings extend it to the given size
+ */
+HANDLE CreateFileMappingW(HANDLE hFile, SECURITY_ATTRIBUTES*, DWORD protect, DWORD sizeHigh, DWORD sizeLow,
+        LPCWSTR)
+{
+    File* file = dynamic_cast<File*>(toObject(hFile));
+
+    struct stat st;
+    if (!file || (protect != PAGE_READONLY && protect != PAGE_READWRITE) || fstat(file->Fd(), &st))
+        return NULL;
+
+    size_t size = st.st_size;
+
+    if (protect == PAGE_READWRITE)
+    {
+        const size_t newSize = ((size_t)sizeHigh << 32) | sizeLow;
+        if (newSize > size)
+        {
+            if (ftruncate(file->Fd(), newSize))
+                return NULL;
+            size = newSize;
+        }
+    }
+
+    if (size == 0)
+        return NULL;
+
+    const int fd = fcntl(file->Fd(), F_DUPFD_CLOEXEC, 0);
+    if (fd < 0)
+        return NULL;
+
+    return static_cast<Object*>(new Mapping(fd, size, protect == PAGE_READWRITE));
+}
+
+
+/**
+ *  \brief
+ */
+LPVOID MapViewOfFile(HANDLE hMap, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T size)
+{
+    Mapping* mapping = dynamic_cast<Mapping*>(toObject(hMap));
+
+    if (!mapping || offsetHigh || offsetLow)
+        return NULL;
+
+    const bool write = (access == FILE_MAP_WRITE);
+    if ((!write && access != FILE_MAP_READ) || (write && !mapping->IsWritable()))
+        return NULL;
+
+    if (!size || size > mapping->Size())
+        size = mapping->Size();
+
+    void* addr = write ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mapping->Fd(), 0) :
+            mmap(NULL, size, PROT_READ, MAP_PRIVATE, mapping->Fd(), 0);
+    if (addr == MAP_FAILED)
+        return NULL;
+
+    pthread_mutex_lock(&ViewsLock);
+    Views[addr] = size;
+    pthread_mutex_unlock(&ViewsLock);
+
+    return addr;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL UnmapViewOfFile(LPCVOID addr)
+{
+    pthread_mutex_lock(&ViewsLock);
+
+    auto iView = Views.find(addr);
+    if (iView == Views.end())
+    {
+        pthread_mutex_unlock(&ViewsLock);
+        return FALSE;
+    }
+
+    const size_t size = iView->second;
+    Views.erase(iView);
+
+    pthread_mutex_unlock(&ViewsLock);
+
+    return (munmap(const_cast<void*>(addr), size) == 0);
+}
+
+
+/**
+ *  \brief
+ */
+BOOL CreatePipe(PHANDLE hRead, PHANDLE hWrite, SECURITY_ATTRIBUTES* attr, DWORD)
+{
+    int fds[2];
+
+    if (pipe(fds))
+        return FALSE;
+
+    const bool inherit = (attr && attr->bInheritHandle);
+    setCloseOnExec(fds[0], !inherit);
+    setCloseOnExec(fds[1], !inherit);
+
+    *hRead  = static_cast<Object*>(new File(fds[0]));
+    *hWrite = static_cast<Object*>(new File(fds[1]));
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief  Inheritable handles are the descriptors kept open on exec
+ */
+BOOL SetHandleInformation(HANDLE h, DWORD mask, DWORD flags)
+{
+    File* file = dynamic_cast<File*>(toObject(h));
+
+    if (!file)
+        return FALSE;
+
+    if (mask & HANDLE_FLAG_INHERIT)
+        setCloseOnExec(file->Fd(), !(flags & HANDLE_FLAG_INHERIT));
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief  Fails at end of file like reading a broken pipe does
+ */
+BOOL ReadFile(HANDLE h, LPVOID buf, DWORD size, LPDWORD bytesRead, LPVOID)
+{
+    File* file = dynamic_cast<File*>(toObject(h));
+
+    if (bytesRead)
+        *bytesRead = 0;
+
+    if (!file)
+        return FALSE;
+
+    ssize_t r;
+    while ((r = read(file->Fd(), buf, size)) < 0 && errno == EINTR);
+
+    if (r <= 0)
+        return FALSE;
+
+    if (bytesRead)
+        *bytesRead = (DWORD)r;
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief  Like on Windows the child inherits all inheritable handles of the
+ *          parent when inheritHandles is TRUE - including the pipe ends created
+ *          concurrently by other threads
+ */
+BOOL CreateProcessW(LPCWSTR appName, LPWSTR cmdLine, SECURITY_ATTRIBUTES*, SECURITY_ATTRIBUTES*,
+        BOOL inheritHandles, DWORD, LPVOID, LPCWSTR currentDir, STARTUPINFO* si, PROCESS_INFORMATION* pi)
+{
+    const std::vector<std::wstring> argsW = splitCmdLine(cmdLine ? cmdLine : appName);
+
+    if (argsW.empty())
+        return FALSE;
+
+    std::vector<std::string> args;
+    args.push_back(NativePath(argsW[0].c_str()));
+    for (size_t i = 1; i < argsW.size(); ++i)
+        args.push_back(ToUtf8(argsW[i].c_str(), argsW[i].size()));
+
+    std::vector<char*> argv;
+    for (auto& arg : args)
+        argv.push_back(&arg[0]);
+    argv.push_back(NULL);
+
+    std::string dir;
+    if (currentDir)
+    {
+        dir = NativePath(currentDir);
+
+        struct stat st;
+        if (stat(dir.c_str(), &st) || !S_ISDIR(st.st_mode))
+            return FALSE;
+    }
+
+    int stdOut = -1;
+    int stdErr = -1;
+
+    if (si && (si->dwFlags & STARTF_USESTDHANDLES))
+    {
+        File* out = dynamic_cast<File*>(toObject(si->hStdOutput));
+        File* err = dynamic_cast<File*>(toObject(si->hStdError));
+
+        if (out)
+            stdOut = out->Fd();
+        if (err)
+            stdErr = err->Fd();
+    }
+
+    // exec errors are reported back through a close-on-exec pipe
+    int errPipe[2];
+    if (pipe(errPipe))
+        return FALSE;
+    setCloseOnExec(errPipe[0], true);
+    setCloseOnExec(errPipe[1], true);
+
+    const int devNull = open("/dev/null", O_RDWR | O_CLOEXEC);
+
+    pthread_mutex_lock(&EnvLock);
+
+    const pid_t pid = fork();
+
+    if (pid == 0)
+    {
+        // Only async-signal-safe calls from here on
+        if (devNull >= 0)
+            dup2(devNull, 0);
+        if (stdOut >= 0)
+            dup2(stdOut, 1);
+        if (stdErr >= 0)
+            dup2(stdErr, 2);
+
+        if (!inheritHandles)
+        {
+            const int maxFd = (int)sysconf(_SC_OPEN_MAX);
+            for (int fd = 3; fd < maxFd; ++fd)
+                if (fd != errPipe[1])
+                    close(fd);
+        }
+
+        int err = 0;
+
+        if (!dir.empty() && chdir(dir.c_str()))
+            err = errno;
+        else
+            execv(argv[0], argv.data());
+
+        if (!err)
+            err = errno;
+
+        while (write(errPipe[1], &err, sizeof(err)) < 0 && errno == EINTR);
+        _exit(127);
+    }
+
+    pthread_mutex_unlock(&EnvLock);
+
+    if (devNull >= 0)
+        close(devNull);
+    close(errPipe[1]);
+
+    if (pid < 0)
+    {
+        close(errPipe[0]);
+        return FALSE;
+    }
+
+    int childErr = 0;
+    ssize_t r;
+    while ((r = read(errPipe[0], &childErr, sizeof(childErr))) < 0 && errno == EINTR);
+    close(errPipe[0]);
+
+    if (r > 0)
+    {
+        while (waitpid(pid, NULL, 0) < 0 && errno == EINTR);
+        return FALSE;
+    }
+
+    pthread_once(&WaitOnce, initWaitCond);
+
+    Process* process = new Process(pid);
+
+    // Handles for the process and its main thread plus one reference for the reaper
+    process->AddRef();
+    process->AddRef();
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    pthread_t tid;
+    if (pthread_create(&tid, &attr, Process::Reap, process))
+    {
+        // Cannot track the child without a reaper
+        kill(pid, SIGKILL);
+        while (waitpid(pid, NULL, 0) < 0 && errno == EINTR);
+        process->Release();
+        process->Release();
+        process->Release();
+        pthread_attr_destroy(&attr);
+        return FALSE;
+    }
+
+    pthread_attr_destroy(&attr);
+
+    pi->hProcess    = static_cast<Object*>(process);
+    pi->hThread     = static_cast<Object*>(process);
+    pi->dwProcessId = (DWORD)pid;
+    pi->dwThreadId  = (DWORD)pid;
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL GetExitCodeProcess(HANDLE hProcess, LPDWORD exitCode)
+{
+    Process* process = dynamic_cast<Process*>(toObject(hProcess));
+
+    if (!process)
+        return FALSE;
+
+    *exitCode = process->ExitCode();
+
+    return TRUE;
+}
+
+
+/**
+ *  \brief
+ */
+BOOL TerminateProcess(HANDLE hProcess, UINT exitCode)
+{
+    Process* process = dynamic_cast<Process*>(toObject(hProcess));
+
+    if (!process)
+        return FALSE;
+
+    return process->Terminate(exitCode);
+}
+
+
+/**
+ *  \brief
+ */
+DWORD GetCurrentProcessId()
+{
+    return (DWORD)getpid();
+}
+
+
+/**
+ *  \brief
+ */
+BOOL SetEnvironmentVariableW(LPCWSTR name, LPCWSTR value)
+{
+    const std::string nameA = ToUtf8(name, wcslen(name));
+
+    pthread_mutex_lock(&EnvLock);
+
+    int r;
+    if (value)
+    {
+        const std::string valueA = ToUtf8(value, wcslen(value));
+        r = setenv(nameA.c_str(), valueA.c_str(), 1);
+    }
+    else
+    {
+        r = unsetenv(nameA.c_str());
+    }
+
+    pthread_mutex_unlock(&EnvLock);
+
+    return (r == 0);
+}
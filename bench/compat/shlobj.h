@@ -0,0 +1,64 @@
+/**
+ *  \file
+ *  \brief  Shell folder browsing stubs for the POSIX compat layer
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+
+
+#define S_OK                    ((HRESULT)0)
+#define E_FAIL                  ((HRESULT)0x80004005)
+
+#define BIF_RETURNONLYFSDIRS    0x0001
+#define BIF_NEWDIALOGSTYLE      0x0040
+#define BIF_USENEWUI            0x0050
+#define BIF_NONEWFOLDERBUTTON   0x0200
+
+#define BFFM_INITIALIZED        1
+#define BFFM_SETSELECTION       (WM_USER + 103)
+
+
+typedef struct _ITEMIDLIST { BYTE _dummy; } ITEMIDLIST;
+typedef ITEMIDLIST*         LPITEMIDLIST;
+typedef const ITEMIDLIST*   PCIDLIST_ABSOLUTE;
+typedef int (CALLBACK* BFFCALLBACK)(HWND hWnd, UINT msg, LPARAM lParam, LPARAM lpData);
+
+typedef struct
+{
+    HWND            hwndOwner;
+    LPITEMIDLIST    pidlRoot;
+    LPTSTR          pszDisplayName;
+    LPCTSTR         lpszTitle;
+    UINT            ulFlags;
+    BFFCALLBACK     lpfn;
+    LPARAM          lParam;
+    int             iImage;
+} BROWSEINFO;
+
+
+// There is no UI - browsing for folder is always cancelled
+HRESULT SHParseDisplayName(LPCWSTR name, void* bindCtx, LPITEMIDLIST* pidl, ULONG in, ULONG* out);
+LPITEMIDLIST SHBrowseForFolder(BROWSEINFO* bi);
+BOOL SHGetPathFromIDList(LPITEMIDLIST pidl, LPTSTR path);
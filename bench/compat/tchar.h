@@ -0,0 +1,91 @@
+/**
+ *  \file
+ *  \brief  Generic-text mappings (UNICODE only) for the POSIX compat layer
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <wchar.h>
+#include <wctype.h>
+#include <stdio.h>
+
+
+#ifndef UNICODE
+#error "The compat layer supports UNICODE builds only"
+#endif
+
+
+#define __T(x)      L##x
+#define _T(x)       __T(x)
+#define _TEXT(x)    __T(x)
+
+
+// String functions
+
+#define _tcslen     wcslen
+#define _tcscmp     wcscmp
+#define _tcsncmp    wcsncmp
+#define _tcsicmp    wcscasecmp
+#define _tcsnicmp   wcsncasecmp
+#define _tcschr     wcschr
+#define _tcsrchr    wcsrchr
+#define _tcsstr     wcsstr
+#define _tcstoul    wcstoul
+#define _tcstol     wcstol
+#define _tcstok_s   wcstok
+#define _totlower   towlower
+#define _totupper   towupper
+#define _istspace   iswspace
+#define _istalnum   iswalnum
+#define _istdigit   iswdigit
+
+int _tcscpy_s(wchar_t* dst, size_t size, const wchar_t* src);
+int _tcsncpy_s(wchar_t* dst, size_t size, const wchar_t* src, size_t count);
+int _tcscat_s(wchar_t* dst, size_t size, const wchar_t* src);
+
+int strcpy_s(char* dst, size_t size, const char* src);
+int strncpy_s(char* dst, size_t size, const char* src, size_t count);
+int _itoa_s(int val, char* buf, size_t size, int radix);
+
+
+// Conversions - the MSVC "C" locale maps bytes to the first 256 code points
+
+int mbstowcs_s(size_t* converted, wchar_t* dst, size_t size, const char* src, size_t count);
+int wcstombs_s(size_t* converted, char* dst, size_t size, const wchar_t* src, size_t count);
+
+
+// Formatted output - the format strings follow the MSVC wide conventions
+// (%s and %c take wide arguments) and are converted to the ISO C ones
+
+int _sntprintf_s(wchar_t* buf, size_t size, size_t count, const wchar_t* format, ...);
+int _stprintf_s(wchar_t* buf, size_t size, const wchar_t* format, ...);
+int _ftprintf_s(FILE* fp, const wchar_t* format, ...);
+int _snprintf_s(char* buf, size_t size, size_t count, const char* format, ...);
+
+
+// Files - the names are converted to UTF-8 with '\\' replaced by '/',
+// the content is read and written as UTF-8
+
+int _tfopen_s(FILE** fp, const wchar_t* fileName, const wchar_t* mode);
+wchar_t* _fgetts(wchar_t* buf, int size, FILE* fp);
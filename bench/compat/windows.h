@@ -0,0 +1,473 @@
+/**
+ *  \file
+ *  \brief  Minimal Win32 API subset needed to build the plugin core on POSIX
+ *          systems for the headless benchmarks
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include <stdio.h>
+#include <pthread.h>
+
+
+#define WINAPI
+#define APIENTRY
+#define CALLBACK
+#define __stdcall
+#define __cdecl
+#define __declspec(x)
+
+#define _countof(a)     (sizeof(a) / sizeof((a)[0]))
+#define _TRUNCATE       ((size_t)-1)
+
+#define TRUE            1
+#define FALSE           0
+#define MAX_PATH        260
+
+
+typedef int                 BOOL;
+typedef unsigned char       BYTE;
+typedef unsigned char       UCHAR;
+typedef unsigned short      WORD;
+typedef unsigned int        DWORD;
+typedef unsigned int        UINT;
+typedef int                 LONG;
+typedef unsigned int        ULONG;
+typedef long long           LONGLONG;
+typedef unsigned long long  ULONGLONG;
+typedef intptr_t            LONG_PTR;
+typedef uintptr_t           ULONG_PTR;
+typedef uintptr_t           UINT_PTR;
+typedef intptr_t            INT_PTR;
+typedef ULONG_PTR           DWORD_PTR;
+typedef ULONG_PTR           SIZE_T;
+typedef UINT_PTR            WPARAM;
+typedef LONG_PTR            LPARAM;
+typedef LONG_PTR            LRESULT;
+typedef LONG                HRESULT;
+
+typedef void*               HANDLE;
+typedef HANDLE*             PHANDLE;
+typedef void*               LPVOID;
+typedef void*               PVOID;
+typedef const void*         LPCVOID;
+typedef DWORD*              LPDWORD;
+
+struct HWND__;
+typedef HWND__*             HWND;
+struct HINSTANCE__;
+typedef HINSTANCE__*        HINSTANCE;
+typedef HINSTANCE           HMODULE;
+typedef HANDLE              HDC;
+typedef HANDLE              HFONT;
+typedef HANDLE              HGDIOBJ;
+typedef HANDLE              HBRUSH;
+typedef HANDLE              HMENU;
+typedef HANDLE              HICON;
+typedef HANDLE              HCURSOR;
+typedef HANDLE              HBITMAP;
+
+typedef DWORD               COLORREF;
+typedef char                CHAR;
+typedef wchar_t             WCHAR;
+typedef const char*         LPCSTR;
+typedef char*               LPSTR;
+typedef const wchar_t*      LPCWSTR;
+typedef wchar_t*            LPWSTR;
+
+#ifdef UNICODE
+typedef wchar_t             TCHAR;
+#else
+typedef char                TCHAR;
+#endif
+typedef const TCHAR*        LPCTSTR;
+typedef TCHAR*              LPTSTR;
+
+
+typedef union _LARGE_INTEGER
+{
+    struct
+    {
+        DWORD LowPart;
+        LONG  HighPart;
+    };
+    LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef struct { LONG left, top, right, bottom; } RECT, *LPRECT;
+typedef struct { LONG x, y; } POINT;
+typedef struct { LONG cx, cy; } SIZE;
+typedef struct { HWND hwndFrom; UINT_PTR idFrom; UINT code; } NMHDR, *LPNMHDR;
+
+typedef struct
+{
+    DWORD dwOSVersionInfoSize;
+    DWORD dwMajorVersion;
+    DWORD dwMinorVersion;
+    DWORD dwBuildNumber;
+    DWORD dwPlatformId;
+    TCHAR szCSDVersion[128];
+} OSVERSIONINFO;
+
+typedef struct
+{
+    LONG  lfHeight;
+    LONG  lfWidth;
+    LONG  lfWeight;
+    TCHAR lfFaceName[32];
+} LOGFONT;
+
+typedef struct
+{
+    UINT    cbSize;
+    int     iBorderWidth;
+    LOGFONT lfMenuFont;
+    LOGFONT lfMessageFont;
+} NONCLIENTMETRICS;
+
+typedef struct
+{
+    HANDLE hProcess;
+    HANDLE hThread;
+    DWORD  dwProcessId;
+    DWORD  dwThreadId;
+} PROCESS_INFORMATION;
+
+typedef struct
+{
+    DWORD  nLength;
+    LPVOID lpSecurityDescriptor;
+    BOOL   bInheritHandle;
+} SECURITY_ATTRIBUTES;
+
+typedef struct
+{
+    DWORD  cb;
+    DWORD  dwFlags;
+    WORD   wShowWindow;
+    HANDLE hStdInput;
+    HANDLE hStdOutput;
+    HANDLE hStdError;
+} STARTUPINFO;
+
+typedef struct
+{
+    DWORD dwPageSize;
+    DWORD dwNumberOfProcessors;
+} SYSTEM_INFO;
+
+typedef LRESULT (*WNDPROC)(HWND, UINT, WPARAM, LPARAM);
+
+
+#define INVALID_HANDLE_VALUE        ((HANDLE)(LONG_PTR)-1)
+#define INVALID_FILE_ATTRIBUTES     ((DWORD)-1)
+#define FILE_ATTRIBUTE_DIRECTORY    0x10
+#define FILE_ATTRIBUTE_NORMAL       0x80
+#define FILE_ATTRIBUTE_TEMPORARY    0x100
+#define FILE_FLAG_DELETE_ON_CLOSE   0x04000000
+#define FILE_FLAG_SEQUENTIAL_SCAN   0x08000000
+#define GENERIC_READ                0x80000000
+#define GENERIC_WRITE               0x40000000
+#define FILE_SHARE_READ             0x01
+#define FILE_SHARE_WRITE            0x02
+#define CREATE_ALWAYS               2
+#define OPEN_EXISTING               3
+#define PAGE_READONLY               0x02
+#define PAGE_READWRITE              0x04
+#define FILE_MAP_WRITE              0x02
+#define FILE_MAP_READ               0x04
+#define DUPLICATE_SAME_ACCESS       0x02
+
+#define INFINITE                    0xFFFFFFFF
+#define WAIT_OBJECT_0               0
+#define WAIT_TIMEOUT                258
+#define WAIT_FAILED                 0xFFFFFFFF
+#define STILL_ACTIVE                259
+
+#define HANDLE_FLAG_INHERIT         0x01
+#define NORMAL_PRIORITY_CLASS       0x20
+#define IDLE_PRIORITY_CLASS         0x40
+#define CREATE_UNICODE_ENVIRONMENT  0x400
+#define CREATE_NO_WINDOW            0x08000000
+#define STARTF_USESTDHANDLES        0x100
+#define THREAD_PRIORITY_NORMAL      0
+#define THREAD_PRIORITY_IDLE        (-15)
+
+#define MB_OK                       0x00
+#define MB_OKCANCEL                 0x01
+#define MB_YESNO                    0x04
+#define MB_ICONERROR                0x10
+#define MB_ICONQUESTION             0x20
+#define MB_ICONEXCLAMATION          0x30
+#define MB_ICONINFORMATION          0x40
+#define IDOK                        1
+#define IDCANCEL                    2
+#define IDYES                       6
+#define IDNO                        7
+
+#define WM_USER                     0x0400
+#define WM_APP                      0x8000
+
+#define SM_XVIRTUALSCREEN           76
+#define SM_YVIRTUALSCREEN           77
+#define SM_CXVIRTUALSCREEN          78
+#define SM_CYVIRTUALSCREEN          79
+#define LOGPIXELSY                  90
+#define SPI_GETNONCLIENTMETRICS     0x0029
+#define FW_NORMAL                   400
+
+
+#define MAKELONG(a, b)  ((LONG)(((WORD)((DWORD_PTR)(a) & 0xffff)) | ((DWORD)((WORD)((DWORD_PTR)(b) & 0xffff))) << 16))
+#define LOWORD(l)       ((WORD)((DWORD_PTR)(l) & 0xffff))
+#define HIWORD(l)       ((WORD)((DWORD_PTR)(l) >> 16))
+#define RGB(r, g, b)    ((COLORREF)(((BYTE)(r) | ((WORD)((BYTE)(g)) << 8)) | (((DWORD)(BYTE)(b)) << 16)))
+
+
+// Time
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* count);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* freq);
+DWORD GetTickCount();
+void Sleep(DWORD ms);
+
+
+// Interlocked operations and barriers
+
+inline LONG InterlockedIncrement(volatile LONG* val)
+{
+    return __atomic_add_fetch(val, 1, __ATOMIC_SEQ_CST);
+}
+
+inline LONG InterlockedDecrement(volatile LONG* val)
+{
+    return __atomic_sub_fetch(val, 1, __ATOMIC_SEQ_CST);
+}
+
+inline LONG InterlockedExchange(volatile LONG* target, LONG val)
+{
+    return __atomic_exchange_n(target, val, __ATOMIC_SEQ_CST);
+}
+
+inline LONG InterlockedExchangeAdd(volatile LONG* target, LONG val)
+{
+    return __atomic_fetch_add(target, val, __ATOMIC_SEQ_CST);
+}
+
+inline LONG InterlockedCompareExchange(volatile LONG* target, LONG val, LONG comparand)
+{
+    __atomic_compare_exchange_n(target, &comparand, val, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+inline LONGLONG InterlockedExchange64(volatile LONGLONG* target, LONGLONG val)
+{
+    return __atomic_exchange_n(target, val, __ATOMIC_SEQ_CST);
+}
+
+inline LONGLONG InterlockedExchangeAdd64(volatile LONGLONG* target, LONGLONG val)
+{
+    return __atomic_fetch_add(target, val, __ATOMIC_SEQ_CST);
+}
+
+inline LONGLONG InterlockedCompareExchange64(volatile LONGLONG* target, LONGLONG val, LONGLONG comparand)
+{
+    __atomic_compare_exchange_n(target, &comparand, val, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+inline PVOID InterlockedExchangePointer(PVOID volatile* target, PVOID val)
+{
+    return __atomic_exchange_n(target, val, __ATOMIC_SEQ_CST);
+}
+
+inline PVOID InterlockedCompareExchangePointer(PVOID volatile* target, PVOID val, PVOID comparand)
+{
+    __atomic_compare_exchange_n(target, &comparand, val, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+
+#define MemoryBarrier()     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+
+// Critical section - recursive like the Win32 one
+
+typedef struct
+{
+    pthread_mutex_t _mutex;
+} CRITICAL_SECTION;
+
+BOOL InitializeCriticalSectionAndSpinCount(CRITICAL_SECTION* cs, DWORD spinCount);
+void DeleteCriticalSection(CRITICAL_SECTION* cs);
+
+inline void EnterCriticalSection(CRITICAL_SECTION* cs)
+{
+    pthread_mutex_lock(&cs->_mutex);
+}
+
+inline BOOL TryEnterCriticalSection(CRITICAL_SECTION* cs)
+{
+    return (pthread_mutex_trylock(&cs->_mutex) == 0);
+}
+
+inline void LeaveCriticalSection(CRITICAL_SECTION* cs)
+{
+    pthread_mutex_unlock(&cs->_mutex);
+}
+
+
+// Files
+
+typedef struct _FILETIME
+{
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+} FILETIME;
+
+typedef struct _WIN32_FILE_ATTRIBUTE_DATA
+{
+    DWORD       dwFileAttributes;
+    FILETIME    ftCreationTime;
+    FILETIME    ftLastAccessTime;
+    FILETIME    ftLastWriteTime;
+    DWORD       nFileSizeHigh;
+    DWORD       nFileSizeLow;
+} WIN32_FILE_ATTRIBUTE_DATA;
+
+enum GET_FILEEX_INFO_LEVELS { GetFileExInfoStandard };
+
+DWORD GetFileAttributesW(LPCWSTR fileName);
+// Only the attributes, the last write time (ns since the epoch) and the size are filled
+BOOL GetFileAttributesExW(LPCWSTR fileName, GET_FILEEX_INFO_LEVELS level, LPVOID info);
+BOOL DeleteFileW(LPCWSTR fileName);
+BOOL MoveFileW(LPCWSTR existingName, LPCWSTR newName);
+BOOL CreateDirectoryW(LPCWSTR pathName, SECURITY_ATTRIBUTES* attr);
+DWORD GetTempPathW(DWORD bufLen, LPWSTR buf);
+
+// Read-only access to existing files and read-write access to new ones,
+// mappings are either read-only or read-write ones extending the file
+HANDLE CreateFileW(LPCWSTR fileName, DWORD access, DWORD shareMode, SECURITY_ATTRIBUTES* attr,
+        DWORD creation, DWORD flags, HANDLE hTemplate);
+BOOL GetFileSizeEx(HANDLE hFile, LARGE_INTEGER* size);
+HANDLE CreateFileMappingW(HANDLE hFile, SECURITY_ATTRIBUTES* attr, DWORD protect, DWORD sizeHigh,
+        DWORD sizeLow, LPCWSTR name);
+LPVOID MapViewOfFile(HANDLE hMap, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T size);
+BOOL UnmapViewOfFile(LPCVOID addr);
+
+#define GetFileAttributes   GetFileAttributesW
+#define GetFileAttributesEx GetFileAttributesExW
+#define DeleteFile          DeleteFileW
+#define MoveFile            MoveFileW
+#define CreateDirectory     CreateDirectoryW
+#define GetTempPath         GetTempPathW
+#define CreateFile          CreateFileW
+#define CreateFileMapping   CreateFileMappingW
+
+
+// Kernel objects - events, threads, processes and anonymous pipes. Waiting
+// for multiple objects supports only the wait for any of them.
+
+BOOL CloseHandle(HANDLE h);
+BOOL DuplicateHandle(HANDLE hSrcProcess, HANDLE hSrc, HANDLE hDstProcess, HANDLE* hDst, DWORD access,
+        BOOL inherit, DWORD options);
+DWORD WaitForSingleObject(HANDLE h, DWORD timeoutMs);
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL waitAll, DWORD timeoutMs);
+
+HANDLE CreateEventW(SECURITY_ATTRIBUTES* attr, BOOL manualReset, BOOL initialState, LPCWSTR name);
+BOOL SetEvent(HANDLE hEvent);
+BOOL ResetEvent(HANDLE hEvent);
+
+// Priorities are ignored
+HANDLE GetCurrentThread();
+BOOL SetThreadPriority(HANDLE hThread, int priority);
+void GetSystemInfo(SYSTEM_INFO* si);
+
+BOOL CreatePipe(PHANDLE hRead, PHANDLE hWrite, SECURITY_ATTRIBUTES* attr, DWORD size);
+BOOL SetHandleInformation(HANDLE h, DWORD mask, DWORD flags);
+BOOL ReadFile(HANDLE h, LPVOID buf, DWORD size, LPDWORD bytesRead, LPVOID overlapped);
+
+// The executable path in the command line is converted to native one,
+// the arguments are passed as they are (UTF-8)
+BOOL CreateProcessW(LPCWSTR appName, LPWSTR cmdLine, SECURITY_ATTRIBUTES* procAttr,
+        SECURITY_ATTRIBUTES* threadAttr, BOOL inheritHandles, DWORD flags, LPVOID env,
+        LPCWSTR currentDir, STARTUPINFO* si, PROCESS_INFORMATION* pi);
+BOOL GetExitCodeProcess(HANDLE hProcess, LPDWORD exitCode);
+BOOL TerminateProcess(HANDLE hProcess, UINT exitCode);
+DWORD GetCurrentProcessId();
+
+inline HANDLE GetCurrentProcess()
+{
+    return (HANDLE)(LONG_PTR)-1;
+}
+
+BOOL SetEnvironmentVariableW(LPCWSTR name, LPCWSTR value);
+
+#define CreateEvent             CreateEventW
+#define CreateProcess           CreateProcessW
+#define SetEnvironmentVariable  SetEnvironmentVariableW
+
+
+// Windows and messages - windows are emulated by a registry of window
+// procedures. Messages sent from other threads are queued and dispatched
+// by the thread that created the window when it calls CompatPumpMessages().
+// PostMessage fails when the queue is full - CompatSetQueueFull() makes every
+// post fail until it is called again with false.
+
+HWND CompatCreateWindow(WNDPROC wndProc);
+void CompatDestroyWindow(HWND hWnd);
+unsigned CompatPumpMessages(DWORD timeoutMs);
+void CompatSetQueueFull(bool full);
+
+LRESULT SendMessageW(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
+BOOL PostMessageW(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
+BOOL ReplyMessage(LRESULT result);
+
+int MessageBoxW(HWND hWnd, LPCWSTR text, LPCWSTR caption, UINT type);
+int MessageBoxA(HWND hWnd, LPCSTR text, LPCSTR caption, UINT type);
+
+#define SendMessage         SendMessageW
+#define PostMessage         PostMessageW
+#define MessageBox          MessageBoxW
+
+
+// GDI and system metrics - no display, fixed values
+
+int GetSystemMetrics(int index);
+BOOL GetWindowRect(HWND hWnd, LPRECT rect);
+BOOL AdjustWindowRectEx(LPRECT rect, DWORD style, BOOL menu, DWORD styleEx);
+HGDIOBJ SelectObject(HDC hdc, HGDIOBJ obj);
+BOOL GetTextExtentPoint32W(HDC hdc, LPCWSTR str, int len, SIZE* size);
+BOOL GetVersionExW(OSVERSIONINFO* info);
+BOOL SystemParametersInfoW(UINT action, UINT param, LPVOID pParam, UINT winIni);
+int GetDeviceCaps(HDC hdc, int index);
+HFONT CreateFontIndirectW(const LOGFONT* font);
+int MulDiv(int number, int numerator, int denominator);
+
+#define GetTextExtentPoint32    GetTextExtentPoint32W
+#define GetVersionEx            GetVersionExW
+#define SystemParametersInfo    SystemParametersInfoW
+#define CreateFontIndirect      CreateFontIndirectW
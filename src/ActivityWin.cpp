@@ -46,13 +46,19 @@ const int ActivityWin::cWidth           = 600;
 std::list<ActivityWin*> ActivityWin::WindowList;
 HFONT                   ActivityWin::HFont = NULL;
 unsigned                ActivityWin::TxtHeight = 0;
+bool                    ActivityWin::Registered = false;
 
 
 /**
- *  \brief
+ *  \brief  Called on the first Show
  */
 void ActivityWin::Register()
 {
+    if (Registered)
+        return;
+
+    Registered = true;
+
     WNDCLASS wc         = {0};
     wc.style            = CS_HREDRAW | CS_VREDRAW;
     wc.lpfnWndProc      = wndProc;
@@ -76,6 +82,11 @@ void ActivityWin::Register()
  */
 void ActivityWin::Unregister()
 {
+    if (!Registered)
+        return;
+
+    Registered = false;
+
     UnregisterClass(cClassName, HMod);
 }
 
@@ -88,12 +99,55 @@ void ActivityWin::Show(const TCHAR* text, HANDLE hCancel)
     if (!hCancel)
         return;
 
+    Register();
+
     ActivityWin* aw = new ActivityWin(hCancel);
     if (aw->composeWindow(text) == NULL)
         delete aw;
 }
 
 
+/**
+ *  \brief  Appends progressText to the window header text. If percent is
+ *          non-negative the marquee is replaced by determinate progress bar.
+ */
+void ActivityWin::Update(HANDLE hCancel, const TCHAR* progressText, int percent)
+{
+    for (auto iWin = WindowList.begin(); iWin != WindowList.end(); ++iWin)
+    {
+        ActivityWin* aw = *iWin;
+
+        if (aw->_hCancel != hCancel)
+            continue;
+
+        if (progressText && *progressText)
+        {
+            CText txt(aw->_header);
+            txt += _T(" [");
+            txt += progressText;
+            txt += _T(']');
+            SetWindowText(aw->_hTxt, txt.C_str());
+        }
+
+        if (percent >= 0)
+        {
+            if (aw->_marquee)
+            {
+                aw->_marquee = false;
+                SendMessage(aw->_hPBar, PBM_SETMARQUEE, FALSE, 0);
+                SetWindowLongPtr(aw->_hPBar, GWL_STYLE,
+                        GetWindowLongPtr(aw->_hPBar, GWL_STYLE) & ~PBS_MARQUEE);
+                SendMessage(aw->_hPBar, PBM_SETRANGE32, 0, 100);
+            }
+
+            SendMessage(aw->_hPBar, PBM_SETPOS, percent, 0);
+        }
+
+        break;
+    }
+}
+
+
 /**
  *  \brief
  */
@@ -202,7 +256,9 @@ HWND ActivityWin::composeWindow(const TCHAR* text)
     WindowList.push_back(this);
     int winNum = WindowList.size();
 
-    HWND hWndTxt = CreateWindowEx(0, _T("STATIC"), text,
+    _header = text;
+
+    _hTxt = CreateWindowEx(0, _T("STATIC"), text,
             WS_CHILD | WS_VISIBLE | SS_LEFT | SS_PATHELLIPSIS,
             0, 0, 0, 0, _hWnd, NULL, HMod, NULL);
 
@@ -213,13 +269,13 @@ HWND ActivityWin::composeWindow(const TCHAR* text)
     int width = win.right - win.left;
     int height = win.bottom - win.top;
 
-    MoveWindow(hWndTxt, 5, 5, width - 95, TxtHeight, TRUE);
+    MoveWindow(_hTxt, 5, 5, width - 95, TxtHeight, TRUE);
 
-    HWND hPBar = CreateWindowEx(0, PROGRESS_CLASS, NULL,
+    _hPBar = CreateWindowEx(0, PROGRESS_CLASS, NULL,
             WS_CHILD | WS_VISIBLE | PBS_MARQUEE,
             5, TxtHeight + 10, width - 95, 10,
             _hWnd, NULL, HMod, NULL);
-    SendMessage(hPBar, PBM_SETMARQUEE, TRUE, 100);
+    SendMessage(_hPBar, PBM_SETMARQUEE, TRUE, 100);
 
     _hBtn = CreateWindowEx(0, _T("BUTTON"), _T("Cancel"),
             WS_CHILD | WS_VISIBLE | BS_PUSHBUTTON,
@@ -228,7 +284,7 @@ HWND ActivityWin::composeWindow(const TCHAR* text)
 
     if (HFont)
     {
-        SendMessage(hWndTxt, WM_SETFONT, (WPARAM)HFont, TRUE);
+        SendMessage(_hTxt, WM_SETFONT, (WPARAM)HFont, TRUE);
         SendMessage(_hBtn, WM_SETFONT, (WPARAM)HFont, TRUE);
     }
 
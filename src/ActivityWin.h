@@ -28,6 +28,7 @@
 #include <windows.h>
 #include <tchar.h>
 #include <list>
+#include "Common.h"
 
 
 namespace GTags
@@ -40,10 +41,21 @@ namespace GTags
 class ActivityWin
 {
 public:
+    /**
+     *  \struct  Progress
+     *  \brief
+     */
+    struct Progress
+    {
+        const TCHAR*    _text;
+        int             _percent;
+    };
+
     static void Register();
     static void Unregister();
 
     static void Show(const TCHAR* text, HANDLE hCancel);
+    static void Update(HANDLE hCancel, const TCHAR* progressText, int percent);
     static HWND GetHwnd(HANDLE hCancel);
 
     static void UpdatePositions();
@@ -55,12 +67,13 @@ private:
     static const int        cWidth;
 
     static std::list<ActivityWin*>  WindowList;
+    static bool                     Registered;
     static HFONT                    HFont;
     static unsigned                 TxtHeight;
 
     static LRESULT APIENTRY wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
-    ActivityWin(HANDLE hCancel) : _hCancel(hCancel), _hWnd(NULL) {}
+    ActivityWin(HANDLE hCancel) : _hCancel(hCancel), _hWnd(NULL), _hTxt(NULL), _hPBar(NULL), _marquee(true) {}
     ActivityWin(const ActivityWin&);
     ~ActivityWin();
 
@@ -70,7 +83,11 @@ private:
 
     HANDLE  _hCancel;
     HWND    _hWnd;
+    HWND    _hTxt;
+    HWND    _hPBar;
     HWND    _hBtn;
+    CText   _header;
+    bool    _marquee;
     int     _initRefCount;
 };
 
@@ -44,13 +44,19 @@ const int AutoCompleteWin::cWidth           = 400;
 
 
 AutoCompleteWin* AutoCompleteWin::ACW = NULL;
+bool             AutoCompleteWin::Registered = false;
 
 
 /**
- *  \brief
+ *  \brief  Called on the first Show
  */
 void AutoCompleteWin::Register()
 {
+    if (Registered)
+        return;
+
+    Registered = true;
+
     WNDCLASS wc         = {0};
     wc.style            = CS_HREDRAW | CS_VREDRAW;
     wc.lpfnWndProc      = wndProc;
@@ -74,6 +80,11 @@ void AutoCompleteWin::Register()
  */
 void AutoCompleteWin::Unregister()
 {
+    if (!Registered)
+        return;
+
+    Registered = false;
+
     UnregisterClass(cClassName, HMod);
 }
 
@@ -86,12 +97,17 @@ void AutoCompleteWin::Show(const CmdPtr_t& cmd)
     if (ACW)
         return;
 
+    Register();
+
     ACW = new AutoCompleteWin(cmd);
     if (ACW->composeWindow(cmd->Name()) == NULL)
     {
         delete ACW;
         ACW = NULL;
+        return;
     }
+
+    cmd->Timing().Mark(CmdTiming::RENDERED);
 }
 
 
@@ -197,25 +213,16 @@ int AutoCompleteWin::filterLV(const CText& filter)
     LVITEM lvItem   = {0};
     lvItem.mask     = LVIF_TEXT | LVIF_STATE;
 
-    int len = filter.Len();
-
     ListView_DeleteAllItems(_hLVWnd);
 
-    int (*pCompare)(const TCHAR*, const TCHAR*, size_t);
+    std::vector<TCHAR*> filtered;
+    _completion->FilterList(filter.C_str(), filter.Len(), _ic, filtered);
 
-    if (_ic)
-        pCompare = &_tcsnicmp;
-    else
-        pCompare = &_tcsncmp;
-
-    for (const auto& complEntry : _completion->GetList())
+    for (const auto& complEntry : filtered)
     {
-        if (!len || !pCompare(complEntry, filter.C_str(), len))
-        {
-            lvItem.pszText = complEntry;
-            ListView_InsertItem(_hLVWnd, &lvItem);
-            ++lvItem.iItem;
-        }
+        lvItem.pszText = complEntry;
+        ListView_InsertItem(_hLVWnd, &lvItem);
+        ++lvItem.iItem;
     }
 
     if (lvItem.iItem > 0)
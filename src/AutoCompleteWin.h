@@ -66,6 +66,7 @@ private:
     bool onKeyDown(int keyCode);
 
     static AutoCompleteWin* ACW;
+    static bool             Registered;
 
     HWND            _hWnd;
     HWND            _hLVWnd;
@@ -0,0 +1,165 @@
+/**
+ *  \file
+ *  \brief  Database creation progress tracker
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include "BuildProgress.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \brief
+ */
+BuildProgress::BuildProgress(unsigned expectedFiles) :
+    _expectedFiles(expectedFiles), _startTime(GetTickCount()), _firstFileTime(0), _lastFileTime(0), _files(0)
+{
+}
+
+
+/**
+ *  \brief  Called from the pipe reading thread for each complete line.
+ *          gtags verbose messages are either time-stamped ("[date] ...") or
+ *          indented (" [N] extracting tags of file", " Using ..."), while
+ *          warnings and errors start at the first column.
+ */
+bool BuildProgress::FilterLine(const char* line, unsigned len)
+{
+    if (!len || (line[0] != '[' && line[0] != ' '))
+        return false;
+
+    unsigned i = 0;
+    while (i < len && line[i] == ' ')
+        ++i;
+
+    if (i < len && line[i] == '[' && i + 1 < len && line[i + 1] >= '0' && line[i + 1] <= '9')
+    {
+        unsigned fileNum = 0;
+        for (++i; i < len && line[i] >= '0' && line[i] <= '9'; ++i)
+            fileNum = fileNum * 10 + (line[i] - '0');
+
+        if (i < len && line[i] == ']')
+        {
+            const DWORD now = GetTickCount();
+
+            AUTOLOCK(_lock);
+
+            if (!_files)
+                _firstFileTime = now;
+            _lastFileTime = now;
+
+            if (_files < fileNum)
+                _files = fileNum;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ *  \brief  Fills txt with human readable progress info.
+ *          Returns percent done or -1 if it cannot be estimated.
+ */
+int BuildProgress::GetProgress(CText& txt)
+{
+    const DWORD now = GetTickCount();
+
+    unsigned files;
+    DWORD firstFileTime;
+    {
+        AUTOLOCK(_lock);
+        files           = _files;
+        firstFileTime   = _firstFileTime;
+    }
+
+    TCHAR buf[128];
+
+    if (!files)
+    {
+        txt = _T("scanning files...");
+        return (_expectedFiles ? 0 : -1);
+    }
+
+    const DWORD elapsed = now - firstFileTime;
+    const unsigned filesPerSec = elapsed ? (unsigned)((ULONGLONG)files * 1000 / elapsed) : 0;
+
+    if (!_expectedFiles)
+    {
+        _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%u files, %u files/s"), files, filesPerSec);
+        txt = buf;
+        return -1;
+    }
+
+    int percent = (int)((ULONGLONG)files * 100 / _expectedFiles);
+    if (percent > 99)
+        percent = 99;
+
+    if (filesPerSec && files < _expectedFiles)
+    {
+        const unsigned eta = (_expectedFiles - files) / filesPerSec;
+        _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%u of ~%u files, %u files/s, %d%%, ETA %u:%02u"),
+                files, _expectedFiles, filesPerSec, percent, eta / 60, eta % 60);
+    }
+    else
+    {
+        _sntprintf_s(buf, _countof(buf), _TRUNCATE, _T("%u of ~%u files, %u files/s, %d%%"),
+                files, _expectedFiles, filesPerSec, percent);
+    }
+
+    txt = buf;
+
+    return percent;
+}
+
+
+/**
+ *  \brief  Called once the gtags process has exited to get the timing
+ *          breakdown - scan (until the first file is parsed), parse and
+ *          write (from the last parsed file until exit) phases.
+ */
+void BuildProgress::Finish(DbConfig::BuildStats& stats)
+{
+    const DWORD now = GetTickCount();
+
+    AUTOLOCK(_lock);
+
+    stats._files = _files;
+
+    if (_files)
+    {
+        stats._scanTime     = _firstFileTime - _startTime;
+        stats._parseTime    = _lastFileTime - _firstFileTime;
+        stats._writeTime    = now - _lastFileTime;
+    }
+    else
+    {
+        stats._scanTime     = now - _startTime;
+        stats._parseTime    = 0;
+        stats._writeTime    = 0;
+    }
+}
+
+} // namespace GTags
@@ -0,0 +1,69 @@
+/**
+ *  \file
+ *  \brief  Database creation progress tracker
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include "Common.h"
+#include "AutoLock.h"
+#include "ReadPipe.h"
+#include "Config.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  BuildProgress
+ *  \brief  Consumes gtags verbose output (-v) from the error pipe while the
+ *          database is being created and tracks the number of parsed files.
+ *          Lines that are not progress messages (warnings, errors) are left
+ *          in the pipe output.
+ */
+class BuildProgress : public PipeLineFilter
+{
+public:
+    BuildProgress(unsigned expectedFiles);
+    virtual ~BuildProgress() {}
+
+    virtual bool FilterLine(const char* line, unsigned len);
+
+    int GetProgress(CText& txt);
+    void Finish(DbConfig::BuildStats& stats);
+
+private:
+    BuildProgress(const BuildProgress&);
+    const BuildProgress& operator=(const BuildProgress&);
+
+    Mutex           _lock;
+    const unsigned  _expectedFiles;
+    const DWORD     _startTime;
+    DWORD           _firstFileTime;
+    DWORD           _lastFileTime;
+    unsigned        _files;
+};
+
+} // namespace GTags
@@ -28,13 +28,43 @@
 namespace GTags
 {
 
+/**
+ *  \brief  Collects the list entries starting with filter (all if len is 0)
+ */
+void ResultParser::FilterList(const TCHAR* filter, size_t len, bool ignoreCase,
+        std::vector<TCHAR*>& filtered) const
+{
+    const std::vector<TCHAR*>& list = GetList();
+
+    filtered.clear();
+
+    if (!len)
+    {
+        filtered = list;
+        return;
+    }
+
+    int (*pCompare)(const TCHAR*, const TCHAR*, size_t);
+
+    if (ignoreCase)
+        pCompare = &_tcsnicmp;
+    else
+        pCompare = &_tcsncmp;
+
+    for (const auto& entry : list)
+        if (!pCompare(entry, filter, len))
+            filtered.push_back(entry);
+}
+
+
 /**
  *  \brief
  */
 Cmd::Cmd(CmdId_t id, const TCHAR* name, DbHandle db, ParserPtr_t parser,
         const TCHAR* tag, bool ignoreCase, bool regExp) :
         _id(id), _db(db), _parser(parser),
-        _ignoreCase(ignoreCase), _regExp(regExp), _skipLibs(false), _status(CANCELLED)
+        _ignoreCase(ignoreCase), _regExp(regExp), _skipLibs(false),
+        _background(false), _cancel(0), _status(CANCELLED), _truncated(false)
 {
     if (name)
         _name = name;
@@ -44,12 +74,48 @@ Cmd::Cmd(CmdId_t id, const TCHAR* name, DbHandle db, ParserPtr_t parser,
 }
 
 
+/**
+ *  \brief
+ */
 void Cmd::AppendToResult(const std::vector<char>& data)
 {
     // remove \0 string termination
-    if (!_result.empty())
-        _result.pop_back();
-    _result.insert(_result.cend(), data.begin(), data.end());
+    if (!_result.Empty())
+        _result.Resize(_result.Size() - 1);
+    _result.Append(data.data(), data.size());
+}
+
+
+/**
+ *  \brief
+ */
+void Cmd::AppendToResult(const CTextA& txt)
+{
+    // remove \0 string termination
+    if (!_result.Empty())
+        _result.Resize(_result.Size() - 1);
+    _result.Append(txt.C_str(), txt.Len() + 1);
+}
+
+
+/**
+ *  \brief  data is moved (not copied) if the result is empty
+ */
+void Cmd::AppendToResult(OutputBuffer& data)
+{
+    if (data.Empty())
+        return;
+
+    if (_result.Empty())
+    {
+        _result.Swap(data);
+        _result.MaxSize(0);
+        return;
+    }
+
+    // remove \0 string termination
+    _result.Resize(_result.Size() - 1);
+    _result.Append(data.Data(), data.Size());
 }
 
 } // namespace GTags
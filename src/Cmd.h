@@ -31,6 +31,8 @@
 #include "Common.h"
 #include "CmdDefines.h"
 #include "DbManager.h"
+#include "CmdTrace.h"
+#include "OutputBuffer.h"
 
 
 namespace GTags
@@ -52,6 +54,8 @@ public:
     virtual const CTextA& GetText() const { return _buf; }
     virtual const std::vector<TCHAR*>& GetList() const { return _lines; }
 
+    void FilterList(const TCHAR* filter, size_t len, bool ignoreCase, std::vector<TCHAR*>& filtered) const;
+
 protected:
     CTextA              _buf;
     std::vector<TCHAR*> _lines;
@@ -78,6 +82,7 @@ public:
     inline DbHandle Db() const { return _db; }
 
     inline void Tag(const CText& tag) { _tag = tag; }
+    inline void Tag(CText&& tag) { _tag = std::move(tag); }
     inline const CText& Tag() const { return _tag; }
 
     inline void Parser(const ParserPtr_t& parser) { _parser = parser; }
@@ -92,18 +97,48 @@ public:
     inline void SkipLibs(bool skipLibs) { _skipLibs = skipLibs; }
     inline bool SkipLibs() const { return _skipLibs; }
 
+    // Background commands are not requested by the user - they run quietly
+    // at low priority and are cancelled when an interactive command starts
+    inline void Background(bool background) { _background = background; }
+    inline bool Background() const { return _background; }
+
+    // Can be called from any thread - the child process is terminated and the parsing stopped
+    inline void Cancel() { InterlockedExchange(&_cancel, 1); }
+    inline bool IsCancelled() const { return (_cancel != 0); }
+
     inline void Status(CmdStatus_t stat) { _status = stat; }
     inline CmdStatus_t Status() const { return _status; }
 
-    inline char* Result() { return _result.data(); }
-    inline const char* Result() const { return _result.data(); }
-    inline unsigned ResultLen() const { return _result.size() - 1; }
+    // The result may be a view of a spill file - it is NULL if empty
+    inline char* Result() { return _result.Data(); }
+    inline const char* Result() const { return _result.Data(); }
+    inline unsigned ResultLen() const { return (unsigned)_result.Size() - 1; }
+
+    // The output exceeded the max size and was cut
+    inline bool IsTruncated() const { return _truncated; }
 
     void AppendToResult(const std::vector<char>& data);
+    void AppendToResult(const CTextA& txt);
+    void AppendToResult(OutputBuffer& data);
+    void SetResult(OutputBuffer& data)
+    {
+        _result.Clear();
+        AppendToResult(data);
+    }
     void SetResult(const std::vector<char>& data)
     {
-        _result.assign(data.begin(), data.end());
+        _result.Clear();
+        _result.Append(data.data(), data.size());
+    }
+    void SetResult(const CTextA& txt)
+    {
+        _result.Clear();
+        AppendToResult(txt);
     }
+    void ClearResult() { _result.Clear(); }
+
+    inline CmdTiming& Timing() { return _timing; }
+    inline const CmdTiming& Timing() const { return _timing; }
 
 private:
     friend class CmdEngine;
@@ -117,9 +152,14 @@ private:
     bool                _ignoreCase;
     bool                _regExp;
     bool                _skipLibs;
+    bool                _background;
+    volatile LONG       _cancel;
 
     CmdStatus_t         _status;
-    std::vector<char>   _result;
+    OutputBuffer        _result;
+    bool                _truncated;
+
+    CmdTiming           _timing;
 };
 
 } // namespace GTags
@@ -45,7 +45,11 @@ enum CmdId_t
     GREP,
     GREP_TEXT,
     VERSION,
-    CTAGS_VERSION
+    CTAGS_VERSION,
+    LIST_DEFINITIONS,
+    LIST_SYMBOLS,
+    OVERLAY_DEFINITIONS,
+    OVERLAY_REFERENCES
 };
 
 
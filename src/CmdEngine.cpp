@@ -28,16 +28,25 @@
 #include "Common.h"
 #include "INpp.h"
 #include "Config.h"
+#include "PathTable.h"
 #include "GTags.h"
 #include "ReadPipe.h"
+#include "ActivityWin.h"
+#include "BuildProgress.h"
+#include "GrepEngine.h"
+#include "GrepIndex.h"
+#include "OverlayIndex.h"
+#include "ResultCache.h"
+#include "QueryCache.h"
 #include "CmdEngine.h"
 #include "Cmd.h"
+#include <memory>
 
 
 namespace GTags
 {
 
-const TCHAR CmdEngine::cCreateDatabaseCmd[] = _T("\"%s\\gtags.exe\" -c --skip-unreadable");
+const TCHAR CmdEngine::cCreateDatabaseCmd[] = _T("\"%s\\gtags.exe\" -c -v --skip-unreadable");
 const TCHAR CmdEngine::cUpdateSingleCmd[]   = _T("\"%s\\gtags.exe\" -c --skip-unreadable --single-update \"%s\"");
 const TCHAR CmdEngine::cAutoComplCmd[]      = _T("\"%s\\global.exe\" -cT \"%s\"");
 const TCHAR CmdEngine::cAutoComplSymCmd[]   = _T("\"%s\\global.exe\" -cs \"%s\"");
@@ -46,10 +55,22 @@ const TCHAR CmdEngine::cFindFileCmd[]       = _T("\"%s\\global.exe\" -P \"%s\"")
 const TCHAR CmdEngine::cFindDefinitionCmd[] = _T("\"%s\\global.exe\" -dT --result=grep \"%s\"");
 const TCHAR CmdEngine::cFindReferenceCmd[]  = _T("\"%s\\global.exe\" -r --result=grep \"%s\"");
 const TCHAR CmdEngine::cFindSymbolCmd[]     = _T("\"%s\\global.exe\" -s --result=grep \"%s\"");
-const TCHAR CmdEngine::cGrepCmd[]           = _T("\"%s\\global.exe\" -g --result=grep \"%s\"");
-const TCHAR CmdEngine::cGrepTxtCmd[]        = _T("\"%s\\global.exe\" -gO --result=grep \"%s\"");
+const TCHAR CmdEngine::cGrepCmd[]           = _T("\"%s\\global.exe\" -P");
+const TCHAR CmdEngine::cGrepTxtCmd[]        = _T("\"%s\\global.exe\" -PO");
 const TCHAR CmdEngine::cVersionCmd[]        = _T("\"%s\\global.exe\" --version");
 const TCHAR CmdEngine::cCtagsVersionCmd[]   = _T("\"%s\\ctags.exe\" --version");
+const TCHAR CmdEngine::cListAllFilesCmd[]   = _T("\"%s\\global.exe\" -Po");
+const TCHAR CmdEngine::cListDefsCmd[]       = _T("\"%s\\global.exe\" -cT");
+const TCHAR CmdEngine::cListSymsCmd[]       = _T("\"%s\\global.exe\" -cs");
+const TCHAR CmdEngine::cOverlayDefsCmd[]    = _T("\"%s\\global.exe\" -f \"%s\"");
+const TCHAR CmdEngine::cOverlayRefsCmd[]    = _T("\"%s\\global.exe\" -fr \"%s\"");
+
+const DWORD CmdEngine::cProgressUpdateTime  = 500;
+const DWORD CmdEngine::cBackgroundPollTime  = 20;
+const DWORD CmdEngine::cCancelPollTime      = 10;
+
+volatile LONG CmdEngine::InteractiveCount = 0;
+CompletionQueue CmdEngine::Completions;
 
 
 /**
@@ -62,6 +83,7 @@ bool CmdEngine::Run(const CmdPtr_t& cmd, CompletionCB complCB)
 
     CmdEngine* engine = new CmdEngine(cmd, complCB);
     cmd->Status(RUN_ERROR);
+    cmd->_timing.Start();
 
     engine->_hThread = (HANDLE)_beginthreadex(NULL, 0, threadFunc, engine, 0, NULL);
     if (engine->_hThread == NULL)
@@ -78,8 +100,10 @@ bool CmdEngine::Run(const CmdPtr_t& cmd, CompletionCB complCB)
  *  \brief
  */
 CmdEngine::CmdEngine(const CmdPtr_t& cmd, CompletionCB complCB) :
-    _cmd(cmd), _complCB(complCB), _hThread(NULL)
+    _cmd(cmd), _complCB(complCB), _hThread(NULL), _interactive(!cmd->_background && !isAuxiliary(cmd->_id))
 {
+    if (_interactive)
+        InterlockedIncrement(&InteractiveCount);
 }
 
 
@@ -88,13 +112,72 @@ CmdEngine::CmdEngine(const CmdPtr_t& cmd, CompletionCB complCB) :
  */
 CmdEngine::~CmdEngine()
 {
-    SendMessage(MainWndH, WM_RUN_CMD_CALLBACK, (WPARAM)_complCB, (LPARAM)(&_cmd));
+    if (_interactive)
+        InterlockedDecrement(&InteractiveCount);
+
+    // Don't wait for the UI thread - it is woken up once for all queued completions
+    // If the message queue is full the next completion posts the wake-up again
+    if (Completions.Push(_cmd, _complCB) && !PostMessage(MainWndH, WM_RUN_CMD_CALLBACK, 0, 0))
+        Completions.WakeUpLost();
 
     if (_hThread)
         CloseHandle(_hThread);
 }
 
 
+/**
+ *  \brief  Commands the plugin runs on its own that the user waits for
+ *          indirectly (symbol tables, buffer overlays) - they are not
+ *          background ones but don't count as interactive so the background
+ *          work doesn't yield to them
+ */
+bool CmdEngine::isAuxiliary(CmdId_t id)
+{
+    return (id == LIST_DEFINITIONS || id == LIST_SYMBOLS || id == OVERLAY_DEFINITIONS || id == OVERLAY_REFERENCES);
+}
+
+
+/**
+ *  \brief  Returns the number of callbacks run
+ */
+unsigned CmdEngine::RunCompletions()
+{
+    unsigned count = 0;
+
+    CompletionQueue::Completion* completion = Completions.PopAll();
+
+    while (completion)
+    {
+        const CmdPtr_t& cmd = completion->_cmd;
+
+        if (completion->_complCB && cmd)
+        {
+            const CmdId_t       id      = cmd->Id();
+            const CmdStatus_t   status  = cmd->Status();
+            const CmdTiming     timing  = cmd->Timing();
+
+            completion->_complCB(cmd);
+
+            const TCHAR* dbPath = cmd->Db() ? cmd->Db()->GetPath().C_str() : NULL;
+
+            // The callback could have re-run the same command - keep the timings of the finished run then
+            if (cmd->Timing().RunId() == timing.RunId())
+                CmdTrace::Get().Record(id, status, dbPath, cmd->Timing());
+            else
+                CmdTrace::Get().Record(id, status, dbPath, timing);
+
+            ++count;
+        }
+
+        CompletionQueue::Completion* next = completion->_next;
+        delete completion;
+        completion = next;
+    }
+
+    return count;
+}
+
+
 /**
  *  \brief
  */
@@ -114,20 +197,137 @@ unsigned __stdcall CmdEngine::threadFunc(void* data)
  */
 unsigned CmdEngine::start()
 {
-    ReadPipe dataPipe;
-    ReadPipe errorPipe;
+    _cmd->_timing.Mark(CmdTiming::STARTED);
+
+    // Definitions looked up (or prefetched) before are served from the cache
+    if (_cmd->_id == FIND_DEFINITION && !_cmd->_background && ResultCache::Get().Lookup(_cmd))
+    {
+        _cmd->_timing.Mark(CmdTiming::EXITED);
+        _cmd->_status = OK;
+
+        return parse() ? 0 : 1;
+    }
+
+    // Definitions and completions looked up in an earlier session are kept in the database folder
+    if (GTagsSettings._queryCache && QueryCache::Get().Lookup(_cmd))
+    {
+        _cmd->_timing.Mark(CmdTiming::EXITED);
+
+        OverlayIndex::Get().Merge(_cmd);
+        _cmd->_status = OK;
+
+        if (_cmd->_id == FIND_DEFINITION)
+            ResultCache::Get().Store(_cmd);
+
+        return parse() ? 0 : 1;
+    }
+
+    std::unique_ptr<BuildProgress> progress;
+
+    // gtags -v progress messages are consumed from the error pipe while the database is being created
+    if (_cmd->_id == CREATE_DATABASE)
+        progress.reset(new BuildProgress(_cmd->Db()->GetConfig()->_buildStats._files));
+
+    // Output beyond the limit is cut and the command stopped so a careless search cannot exhaust the memory
+    const size_t maxOutput = (size_t)GTagsSettings._maxOutput * 1024 * 1024;
+    const bool isGrep = (_cmd->_id == GREP || _cmd->_id == GREP_TEXT);
+
+    ReadPipe dataPipe(NULL, isGrep ? 0 : maxOutput);
+    ReadPipe errorPipe(progress.get());
+
+    // Grep commands only list the files with global, the search is done in-process
+    GrepIndex index;
+    std::unique_ptr<GrepEngine> grep;
+    if (isGrep)
+    {
+        CTextA pattern(_cmd->Tag().C_str());
+        grep.reset(new GrepEngine(pattern.C_str(), _cmd->_ignoreCase, _cmd->_regExp));
+        grep->MaxOutput(maxOutput);
+
+        if (!grep->IsValid())
+        {
+            static const char cInvalidPattern[] = "Invalid search pattern";
+
+            _cmd->SetResult(std::vector<char>(cInvalidPattern, cInvalidPattern + sizeof(cInvalidPattern)));
+            _cmd->_status = FAILED;
+            return 1;
+        }
+
+        // Only the files that may contain the pattern are searched
+        if (_cmd->Db()->GetConfig()->_useGrepIndex && index.Open(_cmd->Db()->GetPath()))
+        {
+            index.Narrow(pattern.C_str(), _cmd->_regExp);
+            grep->UseIndex(&index);
+        }
+    }
 
     PROCESS_INFORMATION pi;
 
     if (!runProcess(pi, dataPipe, errorPipe))
         return 1;
 
+    HANDLE hDone = pi.hProcess;
+
+    if (grep)
+    {
+        if (!grep->Start(_cmd->Db()->GetPath(), dataPipe, _cmd->Db()->GetConfig()))
+        {
+            endProcess(pi);
+            _cmd->_status = RUN_ERROR;
+            return 1;
+        }
+
+        hDone = grep->GetWaitHandle();
+    }
+
     bool showActivityWin = true;
-    if (_cmd->_id != CREATE_DATABASE && _cmd->_id != UPDATE_SINGLE)
+    if (_cmd->_background)
     {
-        // Wait 300 ms and if process has finished don't show Activity Window
-        if (WaitForSingleObject(pi.hProcess, 300) == WAIT_OBJECT_0)
-            showActivityWin = false;
+        // Yield to the interactive commands
+        while (WaitForSingleObject(hDone, cBackgroundPollTime) == WAIT_TIMEOUT)
+        {
+            if (_cmd->IsCancelled() || InteractiveCount)
+            {
+                _cmd->_status = CANCELLED;
+                break;
+            }
+        }
+
+        showActivityWin = false;
+    }
+    else if (isAuxiliary(_cmd->_id))
+    {
+        // Not requested by the user - no activity window, stopped when superseded
+        while (WaitForSingleObject(hDone, cCancelPollTime) == WAIT_TIMEOUT)
+        {
+            if (_cmd->IsCancelled())
+            {
+                _cmd->_status = CANCELLED;
+                break;
+            }
+        }
+
+        showActivityWin = false;
+    }
+    else if (_cmd->_id != CREATE_DATABASE && _cmd->_id != UPDATE_SINGLE)
+    {
+        // Wait 300 ms and if process has finished don't show Activity Window.
+        // Superseded commands (auto-complete while typing) are cancelled meanwhile.
+        for (DWORD waited = 0; waited < 300; waited += cCancelPollTime)
+        {
+            if (WaitForSingleObject(hDone, cCancelPollTime) == WAIT_OBJECT_0)
+            {
+                showActivityWin = false;
+                break;
+            }
+
+            if (_cmd->IsCancelled())
+            {
+                _cmd->_status = CANCELLED;
+                showActivityWin = false;
+                break;
+            }
+        }
     }
 
     if (showActivityWin)
@@ -151,31 +351,87 @@ unsigned CmdEngine::start()
             SendMessage(MainWndH, WM_OPEN_ACTIVITY_WIN,
                     reinterpret_cast<WPARAM>(header.C_str()), reinterpret_cast<LPARAM>(hCancel));
 
-            HANDLE waitHandles[] = {pi.hProcess, hCancel};
-            DWORD handleId = WaitForMultipleObjects(2, waitHandles, FALSE, INFINITE) - WAIT_OBJECT_0;
+            HANDLE waitHandles[] = {hDone, hCancel};
+            DWORD handleId;
+            DWORD lastUpdate = GetTickCount();
+
+            for (;;)
+            {
+                handleId = WaitForMultipleObjects(2, waitHandles, FALSE, cCancelPollTime);
+                if (handleId != WAIT_TIMEOUT)
+                    break;
+
+                if (_cmd->IsCancelled())
+                {
+                    handleId = WAIT_OBJECT_0 + 1;
+                    break;
+                }
+
+                if (!progress || GetTickCount() - lastUpdate < cProgressUpdateTime)
+                    continue;
+
+                lastUpdate = GetTickCount();
+
+                CText progressTxt;
+                ActivityWin::Progress update;
+                update._percent = progress->GetProgress(progressTxt);
+                update._text    = progressTxt.C_str();
+
+                SendMessage(MainWndH, WM_UPDATE_ACTIVITY_WIN,
+                        reinterpret_cast<WPARAM>(&update), reinterpret_cast<LPARAM>(hCancel));
+            }
+
+            handleId -= WAIT_OBJECT_0;
             if (handleId > 0 && handleId < 2 && waitHandles[handleId] == hCancel)
                 _cmd->_status = CANCELLED;
 
-            SendMessage(MainWndH, WM_CLOSE_ACTIVITY_WIN, 0, reinterpret_cast<LPARAM>(hCancel));
-
-            CloseHandle(hCancel);
+            // The UI thread closes hCancel with the window - don't wait for it
+            if (!PostMessage(MainWndH, WM_CLOSE_ACTIVITY_WIN, 0, reinterpret_cast<LPARAM>(hCancel)))
+                CloseHandle(hCancel);
         }
         else
         {
-            WaitForSingleObject(pi.hProcess, INFINITE);
+            WaitForSingleObject(hDone, INFINITE);
         }
     }
 
+    _cmd->_timing.Mark(CmdTiming::EXITED);
+
+    // Cancelled just as it finished - the result is not wanted anymore
+    if (_cmd->IsCancelled())
+        _cmd->_status = CANCELLED;
+
+    if (grep && _cmd->_status == CANCELLED)
+        grep->Cancel();
+
     endProcess(pi);
 
     if (_cmd->_status == CANCELLED)
         return 1;
 
-    if (!dataPipe.GetOutput().empty())
+    OutputBuffer& output = grep ? grep->GetOutput() : dataPipe.GetOutput();
+
+    if (!output.Empty())
+        _cmd->_timing.Set(CmdTiming::FIRST_BYTE, grep ? grep->GetFirstHitTime() : dataPipe.GetFirstByteTime());
+    else if (!errorPipe.GetOutput().Empty())
+        _cmd->_timing.Set(CmdTiming::FIRST_BYTE, errorPipe.GetFirstByteTime());
+
+    _cmd->_timing.BytesRead((unsigned)(output.Size() + errorPipe.GetOutput().Size()));
+    _cmd->_truncated = output.IsTruncated();
+
+    DbConfig::BuildStats buildStats;
+    if (progress)
+    {
+        // Make sure all progress lines are consumed before taking the final timings
+        errorPipe.GetOutput();
+        progress->Finish(buildStats);
+    }
+
+    if (!output.Empty())
     {
-        _cmd->AppendToResult(dataPipe.GetOutput());
+        _cmd->AppendToResult(output);
     }
-    else if (!errorPipe.GetOutput().empty())
+    else if (!errorPipe.GetOutput().Empty())
     {
         _cmd->SetResult(errorPipe.GetOutput());
 
@@ -186,23 +442,70 @@ unsigned CmdEngine::start()
         }
     }
 
+    if (GTagsSettings._queryCache && !_cmd->_truncated)
+        QueryCache::Get().Store(_cmd);
+
+    // Tags of the modified buffers replace the database ones for the same files. The overlays hold no
+    // symbols and no file list - the other tag queries see the database until the delta is folded into it
+    if (_cmd->_id == FIND_DEFINITION || _cmd->_id == FIND_REFERENCE || _cmd->_id == AUTOCOMPLETE)
+        OverlayIndex::Get().Merge(_cmd);
+
     _cmd->_status = OK;
 
+    if (_cmd->_id == FIND_DEFINITION && !_cmd->_truncated)
+        ResultCache::Get().Store(_cmd);
+
+    if (!parse())
+        return 1;
+
+    if (_cmd->_id == CREATE_DATABASE || _cmd->_id == UPDATE_SINGLE)
+        updateGrepIndex();
+
+    if (_cmd->_id == CREATE_DATABASE)
+    {
+        _cmd->Db()->SetBuildStats(buildStats);
+        _cmd->Db()->SaveCfg();
+    }
+
+    return 0;
+}
+
+
+/**
+ *  \brief  Runs the command parser on the result. Returns false if there is nothing to show.
+ */
+bool CmdEngine::parse()
+{
+    if (_cmd->IsCancelled())
+    {
+        _cmd->_status = CANCELLED;
+        return false;
+    }
+
     if (_cmd->_parser)
     {
         if (_cmd->Result())
         {
             const int parsedEntries = _cmd->_parser->Parse(_cmd);
+            _cmd->_timing.Mark(CmdTiming::PARSED);
+            _cmd->_timing.Entries(parsedEntries);
+
+            // The parser stops early on cancel
+            if (_cmd->IsCancelled())
+            {
+                _cmd->_status = CANCELLED;
+                return false;
+            }
 
             if (parsedEntries < 0)
             {
                 _cmd->_status = PARSE_ERROR;
-                return 1;
+                return false;
             }
             else if (parsedEntries == 0)
             {
                 _cmd->_status = PARSE_EMPTY; // No results to display actually (due to some filtering)
-                return 1;
+                return false;
             }
         }
         // Blink the auto-complete word to inform the user if nothing is found
@@ -229,10 +532,7 @@ unsigned CmdEngine::start()
         }
     }
 
-    if (_cmd->_id == CREATE_DATABASE)
-        _cmd->Db()->SaveCfg();
-
-    return 0;
+    return true;
 }
 
 
@@ -269,6 +569,14 @@ const TCHAR* CmdEngine::getCmdLine() const
             return cVersionCmd;
         case CTAGS_VERSION:
             return cCtagsVersionCmd;
+        case LIST_DEFINITIONS:
+            return cListDefsCmd;
+        case LIST_SYMBOLS:
+            return cListSymsCmd;
+        case OVERLAY_DEFINITIONS:
+            return cOverlayDefsCmd;
+        case OVERLAY_REFERENCES:
+            return cOverlayRefsCmd;
     }
 
     return NULL;
@@ -286,12 +594,16 @@ void CmdEngine::composeCmd(CText& buf) const
 
     buf.Resize(2048);
 
-    if (_cmd->_id == CREATE_DATABASE || _cmd->_id == VERSION || _cmd->_id == CTAGS_VERSION)
+    const bool noTag = (_cmd->_id == CREATE_DATABASE || _cmd->_id == VERSION || _cmd->_id == CTAGS_VERSION ||
+            _cmd->_id == GREP || _cmd->_id == GREP_TEXT || _cmd->_id == LIST_DEFINITIONS || _cmd->_id == LIST_SYMBOLS);
+
+    if (noTag)
         _sntprintf_s(buf.C_str(), buf.Size(), _TRUNCATE, getCmdLine(), path.C_str());
     else
         _sntprintf_s(buf.C_str(), buf.Size(), _TRUNCATE, getCmdLine(), path.C_str(), _cmd->Tag().C_str());
 
-    if (_cmd->_id == CREATE_DATABASE || _cmd->_id == UPDATE_SINGLE)
+    if (_cmd->_id == CREATE_DATABASE || _cmd->_id == UPDATE_SINGLE ||
+            _cmd->_id == OVERLAY_DEFINITIONS || _cmd->_id == OVERLAY_REFERENCES)
     {
         path += _T("\\gtags.conf");
         if (path.FileExists())
@@ -300,10 +612,10 @@ void CmdEngine::composeCmd(CText& buf) const
             buf += path;
             buf += _T("\"");
             buf += _T(" --gtagslabel=");
-            buf += _cmd->Db()->GetConfig().Parser();
+            buf += _cmd->Db()->GetConfig()->Parser();
         }
     }
-    else if (_cmd->_id != VERSION && _cmd->_id != CTAGS_VERSION)
+    else if (!noTag)
     {
         if (_cmd->_ignoreCase)
             buf += _T(" -i");
@@ -323,28 +635,29 @@ void CmdEngine::setEnvironmentVars() const
 {
     CText buf;
 
-    if (!_cmd->_skipLibs && (_cmd->_id == AUTOCOMPLETE || _cmd->_id == FIND_DEFINITION))
+    if (!_cmd->_skipLibs &&
+            (_cmd->_id == AUTOCOMPLETE || _cmd->_id == FIND_DEFINITION || _cmd->_id == LIST_DEFINITIONS))
     {
-        const DbConfig& cfg = _cmd->Db()->GetConfig();
-        if (cfg._useLibDb && cfg._libDbPaths.size())
-        {
-            if (!cfg._libDbPaths[0].IsSubpathOf(_cmd->Db()->GetPath()))
-                buf += cfg._libDbPaths[0];
-
-            for (unsigned i = 1; i < cfg._libDbPaths.size(); ++i)
-            {
-                if (!cfg._libDbPaths[i].IsSubpathOf(_cmd->Db()->GetPath()))
-                {
-                    buf += _T(';');
-                    buf += cfg._libDbPaths[i];
-                }
-            }
-        }
+        const DbConfigPtr cfg = _cmd->Db()->GetConfig();
+        if (cfg->_useLibDb)
+            buf = cfg->_libPathEnv;
     }
 
     if (_cmd->Db())
         SetEnvironmentVariable(_T("GTAGSDBPATH"), _cmd->Db()->GetPath().C_str());
 
+    // Buffer overlays are tagged in the database tree mirror
+    if (_cmd->_id == OVERLAY_DEFINITIONS || _cmd->_id == OVERLAY_REFERENCES)
+    {
+        CPath mirror;
+        OverlayIndex::MirrorRoot(_cmd->Db()->GetPath(), mirror);
+        SetEnvironmentVariable(_T("GTAGSROOT"), mirror.C_str());
+    }
+    else
+    {
+        SetEnvironmentVariable(_T("GTAGSROOT"), NULL);
+    }
+
     SetEnvironmentVariable(_T("GTAGSLIBPATH"), buf.C_str());
 }
 
@@ -354,12 +667,37 @@ void CmdEngine::setEnvironmentVars() const
  */
 bool CmdEngine::runProcess(PROCESS_INFORMATION& pi, ReadPipe& dataPipe, ReadPipe& errorPipe)
 {
-    const DWORD createFlags = NORMAL_PRIORITY_CLASS | CREATE_NO_WINDOW | CREATE_UNICODE_ENVIRONMENT;
+    CText cmdBuf;
+    composeCmd(cmdBuf);
+
+    if (!spawnProcess(cmdBuf, pi, dataPipe, errorPipe))
+    {
+        _cmd->_status = RUN_ERROR;
+        return false;
+    }
+
+    _cmd->_timing.Mark(CmdTiming::SPAWNED);
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+bool CmdEngine::spawnProcess(CText& cmdLine, PROCESS_INFORMATION& pi, ReadPipe& dataPipe, ReadPipe& errorPipe)
+{
+    const DWORD createFlags = (_cmd->_background ? IDLE_PRIORITY_CLASS : NORMAL_PRIORITY_CLASS) |
+            CREATE_NO_WINDOW | CREATE_UNICODE_ENVIRONMENT;
     const TCHAR* currentDir = (_cmd->_id == VERSION || _cmd->_id == CTAGS_VERSION) ?
             NULL : _cmd->Db()->GetPath().C_str();
 
-    CText cmdBuf;
-    composeCmd(cmdBuf);
+    CPath mirror;
+    if (_cmd->_id == OVERLAY_DEFINITIONS || _cmd->_id == OVERLAY_REFERENCES)
+    {
+        OverlayIndex::MirrorRoot(_cmd->Db()->GetPath(), mirror);
+        currentDir = mirror.C_str();
+    }
 
     setEnvironmentVars();
 
@@ -369,18 +707,14 @@ bool CmdEngine::runProcess(PROCESS_INFORMATION& pi, ReadPipe& dataPipe, ReadPipe
     si.hStdError    = errorPipe.GetInputHandle();
     si.hStdOutput   = dataPipe.GetInputHandle();
 
-    if (!CreateProcess(NULL, cmdBuf.C_str(), NULL, NULL, TRUE, createFlags, NULL, currentDir, &si, &pi))
-    {
-        _cmd->_status = RUN_ERROR;
+    if (!CreateProcess(NULL, cmdLine.C_str(), NULL, NULL, TRUE, createFlags, NULL, currentDir, &si, &pi))
         return false;
-    }
 
     SetThreadPriority(pi.hThread, THREAD_PRIORITY_NORMAL);
 
-    if (!errorPipe.Open() || !dataPipe.Open())
+    if (!errorPipe.Open() || !dataPipe.Open(pi.hProcess))
     {
         endProcess(pi);
-        _cmd->_status = RUN_ERROR;
         return false;
     }
 
@@ -388,6 +722,62 @@ bool CmdEngine::runProcess(PROCESS_INFORMATION& pi, ReadPipe& dataPipe, ReadPipe
 }
 
 
+/**
+ *  \brief  Keeps the database trigram index in sync with the tags or removes
+ *          it if disabled so a stale index is never used later
+ */
+void CmdEngine::updateGrepIndex()
+{
+    const CPath& dbPath = _cmd->Db()->GetPath();
+
+    if (!_cmd->Db()->GetConfig()->_useGrepIndex)
+    {
+        GrepIndex::Delete(dbPath);
+        return;
+    }
+
+    bool success;
+
+    if (_cmd->_id == CREATE_DATABASE)
+        success = buildGrepIndex();
+    else
+        success = GrepIndex::Update(dbPath, CPath(_cmd->Tag().C_str()));
+
+    if (!success)
+        GrepIndex::Delete(dbPath);
+}
+
+
+/**
+ *  \brief  Indexes all database files - both source and other (text) ones
+ */
+bool CmdEngine::buildGrepIndex()
+{
+    CPath path(DllPath);
+    path.StripFilename();
+    path += cPluginName;
+
+    CText cmdBuf;
+    cmdBuf.Resize(2048);
+    _sntprintf_s(cmdBuf.C_str(), cmdBuf.Size(), _TRUNCATE, cListAllFilesCmd, path.C_str());
+
+    ReadPipe dataPipe;
+    ReadPipe errorPipe;
+    PROCESS_INFORMATION pi;
+
+    if (!spawnProcess(cmdBuf, pi, dataPipe, errorPipe))
+        return false;
+
+    OutputBuffer& fileList = dataPipe.GetOutput();
+    endProcess(pi);
+
+    if (fileList.Empty())
+        return false;
+
+    return GrepIndex::Build(_cmd->Db()->GetPath(), fileList.Data());
+}
+
+
 /**
  *  \brief
  */
@@ -29,6 +29,7 @@
 #include <tchar.h>
 #include "Common.h"
 #include "CmdDefines.h"
+#include "CompletionQueue.h"
 
 
 class ReadPipe;
@@ -46,6 +47,12 @@ class CmdEngine
 public:
     static bool Run(const CmdPtr_t& cmd, CompletionCB complCB);
 
+    // Interactive (not background) commands are running
+    static inline bool IsBusy() { return (InteractiveCount != 0); }
+
+    // Runs the callbacks of all finished commands - the UI thread calls it on WM_RUN_CMD_CALLBACK
+    static unsigned RunCompletions();
+
 private:
     static const TCHAR  cCreateDatabaseCmd[];
     static const TCHAR  cUpdateSingleCmd[];
@@ -60,23 +67,41 @@ private:
     static const TCHAR  cGrepTxtCmd[];
     static const TCHAR  cVersionCmd[];
     static const TCHAR  cCtagsVersionCmd[];
+    static const TCHAR  cListAllFilesCmd[];
+    static const TCHAR  cListDefsCmd[];
+    static const TCHAR  cListSymsCmd[];
+    static const TCHAR  cOverlayDefsCmd[];
+    static const TCHAR  cOverlayRefsCmd[];
+
+    static const DWORD  cProgressUpdateTime;
+    static const DWORD  cBackgroundPollTime;
+    static const DWORD  cCancelPollTime;
+
+    static volatile LONG InteractiveCount;
+    static CompletionQueue Completions;
 
     static unsigned __stdcall threadFunc(void* data);
+    static bool isAuxiliary(CmdId_t id);
 
     CmdEngine(const CmdPtr_t& cmd, CompletionCB complCB);
     ~CmdEngine();
     CmdEngine& operator=(const CmdEngine&) = delete;
 
     unsigned start();
+    bool parse();
     const TCHAR* getCmdLine() const;
     void composeCmd(CText& buf) const;
     void setEnvironmentVars() const;
     bool runProcess(PROCESS_INFORMATION& pi, ReadPipe& dataPipe, ReadPipe& errorPipe);
+    bool spawnProcess(CText& cmdLine, PROCESS_INFORMATION& pi, ReadPipe& dataPipe, ReadPipe& errorPipe);
+    void updateGrepIndex();
+    bool buildGrepIndex();
     void endProcess(PROCESS_INFORMATION& pi);
 
     CmdPtr_t            _cmd;
     CompletionCB const  _complCB;
     HANDLE              _hThread;
+    const bool          _interactive;
 };
 
 } // namespace GTags
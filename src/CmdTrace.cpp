@@ -0,0 +1,322 @@
+/**
+ *  \file
+ *  \brief  Per-command latency tracing
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include "GTags.h"
+#include "CmdTrace.h"
+
+
+namespace
+{
+
+const TCHAR* cmdIdName(GTags::CmdId_t id)
+{
+    switch (id)
+    {
+        case GTags::CREATE_DATABASE:        return _T("CreateDatabase");
+        case GTags::UPDATE_SINGLE:          return _T("UpdateSingle");
+        case GTags::AUTOCOMPLETE:           return _T("AutoComplete");
+        case GTags::AUTOCOMPLETE_SYMBOL:    return _T("AutoCompleteSymbol");
+        case GTags::AUTOCOMPLETE_FILE:      return _T("AutoCompleteFile");
+        case GTags::FIND_FILE:              return _T("FindFile");
+        case GTags::FIND_DEFINITION:        return _T("FindDefinition");
+        case GTags::FIND_REFERENCE:         return _T("FindReference");
+        case GTags::FIND_SYMBOL:            return _T("FindSymbol");
+        case GTags::GREP:                   return _T("Grep");
+        case GTags::GREP_TEXT:              return _T("GrepText");
+        case GTags::VERSION:                return _T("Version");
+        case GTags::CTAGS_VERSION:          return _T("CtagsVersion");
+        case GTags::LIST_DEFINITIONS:       return _T("ListDefinitions");
+        case GTags::LIST_SYMBOLS:           return _T("ListSymbols");
+        case GTags::OVERLAY_DEFINITIONS:    return _T("OverlayDefinitions");
+        case GTags::OVERLAY_REFERENCES:     return _T("OverlayReferences");
+    }
+
+    return _T("Unknown");
+}
+
+
+const TCHAR* cmdStatusName(GTags::CmdStatus_t status)
+{
+    switch (status)
+    {
+        case GTags::CANCELLED:      return _T("Cancelled");
+        case GTags::RUN_ERROR:      return _T("RunError");
+        case GTags::FAILED:         return _T("Failed");
+        case GTags::PARSE_ERROR:    return _T("ParseError");
+        case GTags::PARSE_EMPTY:    return _T("Empty");
+        case GTags::OK:             return _T("OK");
+    }
+
+    return _T("Unknown");
+}
+
+
+/**
+ *  \brief  Returns the time in ms since the command was queued or -1 if the point wasn't reached
+ */
+double sinceQueued(const GTags::CmdTrace::Entry& entry, GTags::CmdTiming::Point_t point)
+{
+    if (!entry._time[point])
+        return -1.0;
+
+    return GTags::CmdTiming::ToMs(entry._time[point] - entry._time[GTags::CmdTiming::QUEUED]);
+}
+
+
+/**
+ *  \brief  Writes JSON string literal (UTF-8) escaping the special characters
+ */
+void writeJsonStr(FILE* fp, const TCHAR* str)
+{
+    CTextA strA(str);
+
+    fputc('"', fp);
+
+    for (const char* pCh = strA.C_str(); *pCh; ++pCh)
+    {
+        if (*pCh == '"' || *pCh == '\\')
+            fputc('\\', fp);
+        fputc(*pCh, fp);
+    }
+
+    fputc('"', fp);
+}
+
+
+/**
+ *  \brief  Writes Chrome trace-event complete event (ph: X) if both points are reached
+ */
+void writeSpan(FILE* fp, const char* name, unsigned tid, LONGLONG base, LONGLONG from, LONGLONG to)
+{
+    if (!from || !to || to < from)
+        return;
+
+    fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+            "\"ts\":%.1f,\"dur\":%.1f}",
+            name, tid, GTags::CmdTiming::ToMs(from - base) * 1000.0, GTags::CmdTiming::ToMs(to - from) * 1000.0);
+}
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+volatile LONG CmdTiming::RunCounter = 0;
+
+
+/**
+ *  \brief
+ */
+double CmdTiming::ToMs(LONGLONG ticks)
+{
+    static LONGLONG Freq = 0;
+
+    if (!Freq)
+    {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        Freq = f.QuadPart;
+    }
+
+    return (double)ticks * 1000.0 / (double)Freq;
+}
+
+
+/**
+ *  \brief  Starts new run - clears the previous timestamps
+ */
+void CmdTiming::Start()
+{
+    memset(_time, 0, sizeof(_time));
+    _bytesRead = 0;
+    _entries = 0;
+    _runId = (unsigned)InterlockedIncrement(&RunCounter);
+    Mark(QUEUED);
+}
+
+
+/**
+ *  \brief  Can be called from any thread
+ */
+void CmdTrace::Record(CmdId_t id, CmdStatus_t status, const TCHAR* dbPath, const CmdTiming& timing)
+{
+    const LONG idx = InterlockedIncrement(&_head) - 1;
+    Slot& slot = _slots[(unsigned)idx % cSize];
+
+    InterlockedExchange(&slot._seq, 2 * idx + 1);
+
+    slot._entry._runId  = timing.RunId();
+    slot._entry._id     = id;
+    slot._entry._status = status;
+    for (int i = 0; i < CmdTiming::POINTS_NUM; ++i)
+        slot._entry._time[i] = timing.Get((CmdTiming::Point_t)i);
+    slot._entry._lockWait   = timing.LockWait();
+    slot._entry._bytesRead  = timing.BytesRead();
+    slot._entry._entries    = timing.Entries();
+    _tcscpy_s(slot._entry._dbPath, _countof(slot._entry._dbPath), dbPath ? dbPath : _T(""));
+
+    InterlockedExchange(&slot._seq, 2 * idx + 2);
+}
+
+
+/**
+ *  \brief  Copies the recorded entries (oldest first) skipping the ones being overwritten at the moment
+ */
+void CmdTrace::Snapshot(std::vector<Entry>& entries) const
+{
+    entries.clear();
+
+    const LONG head = _head;
+    const LONG count = (head < (LONG)cSize) ? head : (LONG)cSize;
+
+    entries.reserve(count);
+
+    for (LONG idx = head - count; idx < head; ++idx)
+    {
+        const Slot& slot = _slots[(unsigned)idx % cSize];
+
+        const LONG seq = slot._seq;
+        MemoryBarrier();
+        Entry entry = slot._entry;
+        MemoryBarrier();
+
+        if (seq == 2 * idx + 2 && slot._seq == seq)
+            entries.push_back(entry);
+    }
+}
+
+
+/**
+ *  \brief
+ */
+bool CmdTrace::Dump(const CPath& file) const
+{
+    std::vector<Entry> entries;
+    Snapshot(entries);
+
+    FILE* fp;
+    _tfopen_s(&fp, file.C_str(), _T("wt"));
+    if (fp == NULL)
+        return false;
+
+    _ftprintf_s(fp, _T("# %s command timings - ms since the command was queued, -1 if not reached\n"),
+            cPluginName);
+    _ftprintf_s(fp, _T("%-20s %-12s %10s %10s %10s %10s %10s %10s %10s %10s %10s  %s\n"),
+            _T("# Command"), _T("Status"), _T("LockWait"), _T("Queue"), _T("Spawn"), _T("FirstByte"),
+            _T("Exit"), _T("Parse"), _T("Render"), _T("Bytes"), _T("Entries"), _T("Database"));
+
+    for (auto iEntry = entries.begin(); iEntry != entries.end(); ++iEntry)
+    {
+        _ftprintf_s(fp, _T("%-20s %-12s %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10u %10d  %s\n"),
+                cmdIdName(iEntry->_id), cmdStatusName(iEntry->_status),
+                CmdTiming::ToMs(iEntry->_lockWait),
+                sinceQueued(*iEntry, CmdTiming::STARTED),
+                sinceQueued(*iEntry, CmdTiming::SPAWNED),
+                sinceQueued(*iEntry, CmdTiming::FIRST_BYTE),
+                sinceQueued(*iEntry, CmdTiming::EXITED),
+                sinceQueued(*iEntry, CmdTiming::PARSED),
+                sinceQueued(*iEntry, CmdTiming::RENDERED),
+                iEntry->_bytesRead, iEntry->_entries, iEntry->_dbPath);
+    }
+
+    fclose(fp);
+
+    return true;
+}
+
+
+/**
+ *  \brief  Exports the recorded entries in Chrome trace-event JSON format
+ *          (chrome://tracing, Perfetto UI). Each command run is shown on its
+ *          own track with nested spans for its phases.
+ */
+bool CmdTrace::ExportChromeTrace(const CPath& file) const
+{
+    std::vector<Entry> entries;
+    Snapshot(entries);
+
+    FILE* fp;
+    _tfopen_s(&fp, file.C_str(), _T("wb"));
+    if (fp == NULL)
+        return false;
+
+    LONGLONG base = 0;
+    for (auto iEntry = entries.begin(); iEntry != entries.end(); ++iEntry)
+    {
+        const LONGLONG start = iEntry->_time[CmdTiming::QUEUED] - iEntry->_lockWait;
+        if (!base || start < base)
+            base = start;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"%s\"}}",
+            CTextA(cPluginName).C_str());
+
+    for (auto iEntry = entries.begin(); iEntry != entries.end(); ++iEntry)
+    {
+        const unsigned tid = iEntry->_runId;
+        const LONGLONG* time = iEntry->_time;
+        const LONGLONG start = time[CmdTiming::QUEUED] - iEntry->_lockWait;
+
+        LONGLONG end = 0;
+        for (int i = 0; i < CmdTiming::POINTS_NUM; ++i)
+            if (time[i] > end)
+                end = time[i];
+
+        const CTextA name(cmdIdName(iEntry->_id));
+
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                "\"args\":{\"name\":\"%s #%u\"}}", tid, name.C_str(), tid);
+
+        fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"cmd\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                "\"ts\":%.1f,\"dur\":%.1f,\"args\":{\"status\":\"%s\",\"db\":",
+                name.C_str(), tid, CmdTiming::ToMs(start - base) * 1000.0, CmdTiming::ToMs(end - start) * 1000.0,
+                CTextA(cmdStatusName(iEntry->_status)).C_str());
+        writeJsonStr(fp, iEntry->_dbPath);
+        fprintf(fp, ",\"bytesRead\":%u,\"entriesParsed\":%d,\"lockWaitMs\":%.3f,\"queueMs\":%.3f}}",
+                iEntry->_bytesRead, iEntry->_entries, CmdTiming::ToMs(iEntry->_lockWait),
+                time[CmdTiming::STARTED] ? CmdTiming::ToMs(time[CmdTiming::STARTED] - time[CmdTiming::QUEUED]) : 0.0);
+
+        writeSpan(fp, "lock wait", tid, base, start, time[CmdTiming::QUEUED]);
+        writeSpan(fp, "queue", tid, base, time[CmdTiming::QUEUED], time[CmdTiming::STARTED]);
+        writeSpan(fp, "spawn", tid, base, time[CmdTiming::STARTED], time[CmdTiming::SPAWNED]);
+        writeSpan(fp, "process", tid, base, time[CmdTiming::SPAWNED], time[CmdTiming::EXITED]);
+        writeSpan(fp, "wait output", tid, base, time[CmdTiming::SPAWNED], time[CmdTiming::FIRST_BYTE]);
+        writeSpan(fp, "parse", tid, base, time[CmdTiming::EXITED], time[CmdTiming::PARSED]);
+        writeSpan(fp, "render", tid, base,
+                time[CmdTiming::PARSED] ? time[CmdTiming::PARSED] : time[CmdTiming::EXITED],
+                time[CmdTiming::RENDERED]);
+    }
+
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    return true;
+}
+
+} // namespace GTags
@@ -0,0 +1,152 @@
+/**
+ *  \file
+ *  \brief  Per-command latency tracing
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <string.h>
+#include <vector>
+#include "Common.h"
+#include "CmdDefines.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  CmdTiming
+ *  \brief  Monotonic timestamps of a single command run
+ */
+class CmdTiming
+{
+public:
+    enum Point_t
+    {
+        QUEUED = 0,
+        STARTED,
+        SPAWNED,
+        FIRST_BYTE,
+        EXITED,
+        PARSED,
+        RENDERED,
+        POINTS_NUM
+    };
+
+    static LONGLONG Now()
+    {
+        LARGE_INTEGER t;
+        QueryPerformanceCounter(&t);
+        return t.QuadPart;
+    }
+
+    static double ToMs(LONGLONG ticks);
+
+    CmdTiming() : _runId(0), _lockWait(0), _bytesRead(0), _entries(0) { memset(_time, 0, sizeof(_time)); }
+
+    void Start();
+
+    inline void Mark(Point_t point) { _time[point] = Now(); }
+    inline void Set(Point_t point, LONGLONG time) { _time[point] = time; }
+    inline LONGLONG Get(Point_t point) const { return _time[point]; }
+    inline unsigned RunId() const { return _runId; }
+
+    // Time spent waiting for the database lock before the command was run - not cleared by Start()
+    inline void LockWait(LONGLONG ticks) { _lockWait = ticks; }
+    inline LONGLONG LockWait() const { return _lockWait; }
+
+    inline void BytesRead(unsigned bytes) { _bytesRead = bytes; }
+    inline unsigned BytesRead() const { return _bytesRead; }
+
+    inline void Entries(int entries) { _entries = entries; }
+    inline int Entries() const { return _entries; }
+
+private:
+    static volatile LONG RunCounter;
+
+    unsigned    _runId;
+    LONGLONG    _time[POINTS_NUM];
+    LONGLONG    _lockWait;
+    unsigned    _bytesRead;
+    int         _entries;
+};
+
+
+/**
+ *  \class  CmdTrace
+ *  \brief  Lock-free ring buffer keeping the timings of the last finished commands
+ */
+class CmdTrace
+{
+public:
+    /**
+     *  \struct  Entry
+     *  \brief
+     */
+    struct Entry
+    {
+        unsigned    _runId;
+        CmdId_t     _id;
+        CmdStatus_t _status;
+        LONGLONG    _time[CmdTiming::POINTS_NUM];
+        LONGLONG    _lockWait;
+        unsigned    _bytesRead;
+        int         _entries;
+        TCHAR       _dbPath[MAX_PATH];
+    };
+
+    static CmdTrace& Get()
+    {
+        static CmdTrace Instance;
+        return Instance;
+    }
+
+    void Record(CmdId_t id, CmdStatus_t status, const TCHAR* dbPath, const CmdTiming& timing);
+    void Snapshot(std::vector<Entry>& entries) const;
+    bool Dump(const CPath& file) const;
+    bool ExportChromeTrace(const CPath& file) const;
+
+private:
+    static const unsigned cSize = 256;
+
+    /**
+     *  \struct  Slot
+     *  \brief  _seq is odd while the slot is being written
+     */
+    struct Slot
+    {
+        volatile LONG   _seq;
+        Entry           _entry;
+    };
+
+    CmdTrace() : _head(0) { memset(_slots, 0, sizeof(_slots)); }
+    CmdTrace(const CmdTrace&);
+    ~CmdTrace() {}
+
+    volatile LONG   _head;
+    Slot            _slots[cSize];
+};
+
+} // namespace GTags
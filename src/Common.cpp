@@ -232,242 +232,231 @@ HFONT Tools::CreateFromSystemMenuFont(HDC hdc, unsigned fontHeight)
 
 
 /**
- *  \brief
+ *  \brief  Buffer for size characters to be written through C_str()
  */
-CTextW::CTextW(const wchar_t* str) : _invalidStrLen(false)
+template <typename CharT>
+CTextT<CharT>::CTextT(unsigned size)
 {
-    if (str)
-        _buf.assign(str, str + wcslen(str) + 1);
-    else
-        _buf.push_back(0);
+    init();
+    Resize(size);
 }
 
 
 /**
  *  \brief
  */
-CTextW::CTextW(const char* str) : _invalidStrLen(false)
+template <typename CharT>
+CTextT<CharT>::CTextT(const CharT* str)
 {
+    init();
+
     if (str)
-    {
-        _buf.resize(strlen(str) + 1, 0);
-        size_t cnt;
-        mbstowcs_s(&cnt, _buf.data(), _buf.size(), str, _TRUNCATE);
-    }
-    else
-    {
-        _buf.push_back(0);
-    }
+        assign(str, strLen(str));
 }
 
 
 /**
- *  \brief
+ *  \brief  Takes len characters from str (not required to be terminated)
  */
-CTextW& CTextW::operator=(const CTextW& txt)
+template <typename CharT>
+CTextT<CharT>::CTextT(const CharT* str, unsigned len)
 {
-    if (this != &txt)
-    {
-        _buf = txt._buf;
-        _invalidStrLen = txt._invalidStrLen;
-    }
-    return *this;
-}
-
+    init();
 
-/**
- *  \brief
- */
-CTextW& CTextW::operator=(const wchar_t* str)
-{
     if (str)
-    {
-        _buf.assign(str, str + wcslen(str) + 1);
-        _invalidStrLen = false;
-    }
-    return *this;
+        assign(str, len);
 }
 
 
 /**
  *  \brief
  */
-CTextW& CTextW::operator=(const char* str)
+template <typename CharT>
+CTextT<CharT>::CTextT(const CTextT& txt)
 {
-    if (str)
-    {
-        _buf.resize(strlen(str) + 1, 0);
-        size_t cnt;
-        mbstowcs_s(&cnt, _buf.data(), _buf.size(), str, _TRUNCATE);
-        _invalidStrLen = false;
-    }
+    init();
 
-    return *this;
+    reserve(txt._size);
+    memcpy(_str, txt._str, txt._size * sizeof(CharT));
+    _size = txt._size;
+    _invalidStrLen = txt._invalidStrLen;
 }
 
 
 /**
- *  \brief
+ *  \brief  Steals the heap buffer of txt leaving it empty
  */
-void CTextW::operator+=(const CTextW& txt)
+template <typename CharT>
+CTextT<CharT>::CTextT(CTextT&& txt)
 {
-    AutoFit();
-
-    _buf.pop_back();
-    _buf.insert(_buf.cend(), txt._buf.begin(), txt._buf.begin() + txt.Len() + 1);
+    init();
+    take(txt);
 }
 
 
 /**
  *  \brief
  */
-void CTextW::operator+=(const wchar_t* str)
+template <typename CharT>
+CTextT<CharT>& CTextT<CharT>::operator=(const CTextT& txt)
 {
-    AutoFit();
-
-    if (str)
+    if (this != &txt)
     {
-        unsigned len = wcslen(str);
-        if (len)
-        {
-            _buf.pop_back();
-            _buf.insert(_buf.cend(), str, str + len + 1);
-        }
+        _size = 1;
+        reserve(txt._size);
+        memcpy(_str, txt._str, txt._size * sizeof(CharT));
+        _size = txt._size;
+        _invalidStrLen = txt._invalidStrLen;
     }
+    return *this;
 }
 
 
 /**
  *  \brief
  */
-void CTextW::operator+=(const char* str)
+template <typename CharT>
+CTextT<CharT>& CTextT<CharT>::operator=(CTextT&& txt)
 {
-    AutoFit();
-
-    if (str)
+    if (this != &txt)
     {
-        unsigned len = strlen(str);
-        if (len)
-        {
-            _buf.pop_back();
-
-            unsigned size = _buf.size();
-            _buf.resize(size + len + 1, 0);
-
-            size_t cnt;
-            mbstowcs_s(&cnt, &_buf[size], len + 1, str, _TRUNCATE);
-        }
+        free();
+        init();
+        take(txt);
     }
+    return *this;
 }
 
 
 /**
  *  \brief
  */
-void CTextW::operator+=(wchar_t letter)
+template <typename CharT>
+CTextT<CharT>& CTextT<CharT>::operator=(const CharT* str)
 {
-    AutoFit();
-
-    _buf.pop_back();
-    _buf.push_back(letter);
-    _buf.push_back(0);
+    if (str)
+        assign(str, strLen(str));
+    return *this;
 }
 
 
 /**
  *  \brief
  */
-void CTextW::Append(const wchar_t* data, unsigned len)
+template <typename CharT>
+bool CTextT<CharT>::operator==(const CTextT& txt) const
 {
-    AutoFit();
+    const unsigned len = Len();
 
-    if (data && len)
-    {
-        _buf.pop_back();
-        _buf.insert(_buf.cend(), data, data + len);
-        _buf.push_back(0);
-    }
+    return (len == txt.Len() && !memcmp(_str, txt._str, len * sizeof(CharT)));
 }
 
 
 /**
  *  \brief
  */
-void CTextW::Append(const char* data, unsigned len)
+template <typename CharT>
+bool CTextT<CharT>::operator==(const CharT* str) const
 {
-    AutoFit();
+    const unsigned len = Len();
 
-    if (data && len)
-    {
-        const unsigned currentLen = Len();
-        _buf.resize(currentLen + len + 1, 0);
-        size_t cnt;
-        mbstowcs_s(&cnt, _buf.data() + currentLen, len + 1, data, _TRUNCATE);
-    }
+    return (len == strLen(str) && !memcmp(_str, str, len * sizeof(CharT)));
 }
 
 
 /**
  *  \brief
  */
-void CTextW::Insert(unsigned at_pos, wchar_t letter)
+template <typename CharT>
+void CTextT<CharT>::Append(const CharT* data, unsigned len)
 {
     AutoFit();
 
-    if (at_pos < _buf.size())
-        _buf.insert(_buf.cbegin() + at_pos, letter);
+    if (data && len)
+    {
+        // data may be part of this text
+        if (data >= _str && data < _str + _size)
+        {
+            const unsigned offset = (unsigned)(data - _str);
+            reserve(_size + len);
+            data = _str + offset;
+        }
+        else
+        {
+            reserve(_size + len);
+        }
+
+        memcpy(_str + _size - 1, data, len * sizeof(CharT));
+        _size += len;
+        _str[_size - 1] = 0;
+    }
 }
 
 
 /**
  *  \brief
  */
-void CTextW::Insert(unsigned at_pos, const wchar_t* data, unsigned len)
+template <typename CharT>
+void CTextT<CharT>::Insert(unsigned at_pos, const CharT* data, unsigned len)
 {
     AutoFit();
 
-    if ((at_pos < _buf.size()) && data && len)
-        _buf.insert(_buf.cbegin() + at_pos, data, data + len);
+    if ((at_pos < _size) && data && len)
+    {
+        reserve(_size + len);
+        memmove(_str + at_pos + len, _str + at_pos, (_size - at_pos) * sizeof(CharT));
+        memcpy(_str + at_pos, data, len * sizeof(CharT));
+        _size += len;
+    }
 }
 
 
 /**
  *  \brief
  */
-void CTextW::Erase(unsigned from_pos, unsigned len)
+template <typename CharT>
+void CTextT<CharT>::Erase(unsigned from_pos, unsigned len)
 {
     AutoFit();
 
-    if ((from_pos < _buf.size()) && len)
+    if ((from_pos < _size - 1) && len)
     {
-        if (len > _buf.size())
-            len = _buf.size();
+        if (len > _size - 1 - from_pos)
+            len = _size - 1 - from_pos;
 
-        _buf.erase(_buf.cbegin() + from_pos, _buf.cbegin() + from_pos + len);
+        memmove(_str + from_pos, _str + from_pos + len, (_size - from_pos - len) * sizeof(CharT));
+        _size -= len;
     }
 }
 
 
 /**
- *  \brief
+ *  \brief  Keeps the allocated buffer for reuse
  */
-void CTextW::Clear()
+template <typename CharT>
+void CTextT<CharT>::Clear()
 {
-    _buf.clear();
-    _buf.push_back(0);
+    _str[0] = 0;
+    _size = 1;
     _invalidStrLen = false;
 }
 
 
 /**
- *  \brief
+ *  \brief  Sets the buffer size to size characters (plus the termination)
+ *          keeping the text. The added part is zeroed.
  */
-void CTextW::Resize(unsigned size)
+template <typename CharT>
+void CTextT<CharT>::Resize(unsigned size)
 {
     const unsigned len = Len();
 
-    _buf.resize(size);
-    _buf.push_back(0);
+    reserve(size + 1);
+    if (size + 1 > _size)
+        memset(_str + _size, 0, (size + 1 - _size) * sizeof(CharT));
+
+    _size = size + 1;
+    _str[size] = 0;
     _invalidStrLen = _invalidStrLen || (size > len);
 }
 
@@ -475,158 +464,120 @@ void CTextW::Resize(unsigned size)
 /**
  *  \brief
  */
-CTextA::CTextA(const char* str) : _invalidStrLen(false)
+template <typename CharT>
+void CTextT<CharT>::assign(const CharT* data, unsigned len)
 {
-    if (str)
-        _buf.assign(str, str + strlen(str) + 1);
-    else
-        _buf.push_back(0);
+    _size = 1;
+    reserve(len + 1);
+    memmove(_str, data, len * sizeof(CharT));
+    _str[len] = 0;
+    _size = len + 1;
+    _invalidStrLen = false;
 }
 
 
 /**
- *  \brief
+ *  \brief  Makes the buffer hold at least size characters keeping the
+ *          current ones. Grows geometrically so appending is amortized.
  */
-CTextA::CTextA(const wchar_t* str) : _invalidStrLen(false)
+template <typename CharT>
+void CTextT<CharT>::reserve(unsigned size)
 {
-    if (str)
-    {
-        _buf.resize(wcslen(str) + 1, 0);
-        size_t cnt;
-        wcstombs_s(&cnt, _buf.data(), _buf.size(), str, _TRUNCATE);
-    }
-    else
-    {
-        _buf.push_back(0);
-    }
-}
+    if (size <= _capacity)
+        return;
 
+    unsigned capacity = _capacity * 2;
+    if (capacity < size)
+        capacity = size;
 
-/**
- *  \brief
- */
-CTextA& CTextA::operator=(const CTextA& txt)
-{
-    if (this != &txt)
-    {
-        _buf = txt._buf;
-        _invalidStrLen = txt._invalidStrLen;
-    }
-    return *this;
-}
+    CharT* str = new CharT[capacity];
+    memcpy(str, _str, _size * sizeof(CharT));
 
+    free();
 
-/**
- *  \brief
- */
-CTextA& CTextA::operator=(const char* str)
-{
-    if (str)
-    {
-        _buf.assign(str, str + strlen(str) + 1);
-        _invalidStrLen = false;
-    }
-    return *this;
+    _str = str;
+    _capacity = capacity;
 }
 
 
 /**
- *  \brief
+ *  \brief  Moves the text of txt (empty and inline) to this one (empty and inline)
  */
-CTextA& CTextA::operator=(const wchar_t* str)
+template <typename CharT>
+void CTextT<CharT>::take(CTextT& txt)
 {
-    if (str)
+    if (txt._str == txt._inline)
     {
-        _buf.resize(wcslen(str) + 1, 0);
-        size_t cnt;
-        wcstombs_s(&cnt, _buf.data(), _buf.size(), str, _TRUNCATE);
-        _invalidStrLen = false;
+        memcpy(_inline, txt._inline, txt._size * sizeof(CharT));
+    }
+    else
+    {
+        _str = txt._str;
+        _capacity = txt._capacity;
     }
 
-    return *this;
-}
+    _size = txt._size;
+    _invalidStrLen = txt._invalidStrLen;
 
+    txt.init();
+}
 
-/**
- *  \brief
- */
-void CTextA::operator+=(const CTextA& txt)
-{
-    AutoFit();
 
-    _buf.pop_back();
-    _buf.insert(_buf.cend(), txt._buf.begin(), txt._buf.begin() + txt.Len() + 1);
-}
+template class CTextT<wchar_t>;
+template class CTextT<char>;
 
 
 /**
  *  \brief
  */
-void CTextA::operator+=(const char* str)
+CTextW::CTextW(const char* str)
 {
-    AutoFit();
-
     if (str)
-    {
-        unsigned len = strlen(str);
-        if (len)
-        {
-            _buf.pop_back();
-            _buf.insert(_buf.cend(), str, str + len + 1);
-        }
-    }
+        Append(str, (unsigned)strlen(str));
 }
 
 
 /**
  *  \brief
  */
-void CTextA::operator+=(const wchar_t* str)
+CTextW& CTextW::operator=(const char* str)
 {
-    AutoFit();
-
     if (str)
     {
-        unsigned len = wcslen(str);
-        if (len)
-        {
-            _buf.pop_back();
-
-            unsigned size = _buf.size();
-            _buf.resize(size + len + 1, 0);
-
-            size_t cnt;
-            wcstombs_s(&cnt, &_buf[size], len + 1, str, _TRUNCATE);
-        }
+        Clear();
+        Append(str, (unsigned)strlen(str));
     }
+
+    return *this;
 }
 
 
 /**
  *  \brief
  */
-void CTextA::operator+=(char letter)
+void CTextW::operator+=(const char* str)
 {
-    AutoFit();
-
-    _buf.pop_back();
-    _buf.push_back(letter);
-    _buf.push_back(0);
+    if (str)
+        Append(str, (unsigned)strlen(str));
 }
 
 
 /**
- *  \brief
+ *  \brief  Converts len multibyte characters - the result may be shorter
  */
-void CTextA::Append(const char* data, unsigned len)
+void CTextW::Append(const char* data, unsigned len)
 {
     AutoFit();
 
     if (data && len)
     {
-        _buf.pop_back();
-        _buf.insert(_buf.cend(), data, data + len);
-        _buf.push_back(0);
+        reserve(_size + len);
+
+        size_t cnt = 0;
+        mbstowcs_s(&cnt, _str + _size - 1, len + 1, data, len);
+        if (cnt)
+            _size += (unsigned)cnt - 1;
+        _str[_size - 1] = 0;
     }
 }
 
@@ -634,85 +585,58 @@ void CTextA::Append(const char* data, unsigned len)
 /**
  *  \brief
  */
-void CTextA::Append(const wchar_t* data, unsigned len)
+CTextA::CTextA(const wchar_t* str)
 {
-    AutoFit();
-
-    if (data && len)
-    {
-        const unsigned currentLen = Len();
-        _buf.resize(currentLen + len + 1, 0);
-        size_t cnt;
-        wcstombs_s(&cnt, _buf.data() + currentLen, len + 1, data, _TRUNCATE);
-    }
+    if (str)
+        Append(str, (unsigned)wcslen(str));
 }
 
 
 /**
  *  \brief
  */
-void CTextA::Insert(unsigned at_pos, char letter)
+CTextA& CTextA::operator=(const wchar_t* str)
 {
-    AutoFit();
+    if (str)
+    {
+        Clear();
+        Append(str, (unsigned)wcslen(str));
+    }
 
-    if (at_pos < _buf.size())
-        _buf.insert(_buf.cbegin() + at_pos, letter);
+    return *this;
 }
 
 
 /**
  *  \brief
  */
-void CTextA::Insert(unsigned at_pos, const char* data, unsigned len)
+void CTextA::operator+=(const wchar_t* str)
 {
-    AutoFit();
-
-    if ((at_pos < _buf.size()) && data && len)
-        _buf.insert(_buf.cbegin() + at_pos, data, data + len);
+    if (str)
+        Append(str, (unsigned)wcslen(str));
 }
 
 
 /**
- *  \brief
+ *  \brief  Converts len wide characters - multibyte ones that don't fit are cut
  */
-void CTextA::Erase(unsigned from_pos, unsigned len)
+void CTextA::Append(const wchar_t* data, unsigned len)
 {
     AutoFit();
 
-    if ((from_pos < _buf.size()) && len)
+    if (data && len)
     {
-        if (len > _buf.size())
-            len = _buf.size();
+        reserve(_size + len);
 
-        _buf.erase(_buf.cbegin() + from_pos, _buf.cbegin() + from_pos + len);
+        size_t cnt = 0;
+        wcstombs_s(&cnt, _str + _size - 1, len + 1, data, _TRUNCATE);
+        if (cnt)
+            _size += (unsigned)cnt - 1;
+        _str[_size - 1] = 0;
     }
 }
 
 
-/**
- *  \brief
- */
-void CTextA::Clear()
-{
-    _buf.clear();
-    _buf.push_back(0);
-    _invalidStrLen = false;
-}
-
-
-/**
- *  \brief
- */
-void CTextA::Resize(unsigned size)
-{
-    const unsigned len = Len();
-
-    _buf.resize(size);
-    _buf.push_back(0);
-    _invalidStrLen = _invalidStrLen || (size > len);
-}
-
-
 /**
  *  \brief
  */
@@ -723,16 +647,15 @@ void CPath::AsFolder()
     unsigned len = Len();
 
     for (; len > 0; --len)
-        if (_buf[len - 1] != _T(' ') && _buf[len - 1] != _T('\t') &&
-                _buf[len - 1] != _T('\r') && _buf[len - 1] != _T('\n'))
+        if (_str[len - 1] != _T(' ') && _str[len - 1] != _T('\t') &&
+                _str[len - 1] != _T('\r') && _str[len - 1] != _T('\n'))
             break;
 
-    _buf.erase(_buf.begin() + len, _buf.end());
-
-    if (len > 0 && _buf[len - 1] != _T('\\') && _buf[len - 1] != _T('/'))
-        _buf.push_back(_T('\\'));
+    _str[len] = 0;
+    _size = len + 1;
 
-    _buf.push_back(0);
+    if (len > 0 && _str[len - 1] != _T('\\') && _str[len - 1] != _T('/'))
+        *this += _T('\\');
 }
 
 
@@ -746,11 +669,11 @@ unsigned CPath::StripFilename()
     unsigned len = Len();
 
     for (; len > 0; --len)
-        if (_buf[len - 1] == _T('\\') || _buf[len - 1] == _T('/'))
+        if (_str[len - 1] == _T('\\') || _str[len - 1] == _T('/'))
             break;
 
-    _buf.erase(_buf.begin() + len, _buf.end());
-    _buf.push_back(0);
+    _str[len] = 0;
+    _size = len + 1;
 
     return len;
 }
@@ -764,15 +687,15 @@ unsigned CPath::DirUp()
     AutoFit();
 
     unsigned len = Len();
-    if (_buf[len - 1] == _T('\\') || _buf[len - 1] == _T('/'))
+    if (len && (_str[len - 1] == _T('\\') || _str[len - 1] == _T('/')))
         --len;
 
     for (; len > 0; --len)
-        if (_buf[len - 1] == _T('\\') || _buf[len - 1] == _T('/'))
+        if (_str[len - 1] == _T('\\') || _str[len - 1] == _T('/'))
             break;
 
-    _buf.erase(_buf.begin() + len, _buf.end());
-    _buf.push_back(0);
+    _str[len] = 0;
+    _size = len + 1;
 
     return len;
 }
@@ -786,13 +709,13 @@ const TCHAR* CPath::GetFilename() const
     unsigned len = Len();
 
     for (; len > 0; --len)
-        if (_buf[len - 1] == _T('\\') || _buf[len - 1] == _T('/'))
+        if (_str[len - 1] == _T('\\') || _str[len - 1] == _T('/'))
         {
             ++len;
             break;
         }
 
-    return &_buf[len];
+    return &_str[len];
 }
 
 
@@ -806,8 +729,8 @@ bool CPath::pathMatches(const TCHAR* pathStr, unsigned len) const
 
     for (int i = (int)len - 1; i >= 0; --i)
     {
-        if ((_buf[i] != pathStr[i]) &&
-            !(_buf[i] == _T('\\') && pathStr[i] == _T('/')) && !(_buf[i] == _T('/') && pathStr[i] == _T('\\')))
+        if ((_str[i] != pathStr[i]) &&
+            !(_str[i] == _T('\\') && pathStr[i] == _T('/')) && !(_str[i] == _T('/') && pathStr[i] == _T('\\')))
         return false;
     }
 
@@ -824,7 +747,7 @@ bool CPath::IsParentOf(const CPath& path) const
     if (len > path.Len())
         return false;
 
-    return pathMatches(path._buf.data(), len);
+    return pathMatches(path._str, len);
 }
 
 
@@ -850,7 +773,7 @@ bool CPath::IsSubpathOf(const CPath& path) const
     if (len > Len())
         return false;
 
-    return pathMatches(path._buf.data(), len);
+    return pathMatches(path._str, len);
 }
 
 
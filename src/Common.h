@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <vector>
+#include <utility>
 
 
 #ifdef UNICODE
@@ -40,122 +41,150 @@
 
 
 /**
- *  \class  CTextW
- *  \brief
+ *  \class  CTextT
+ *  \brief  String buffer keeping texts shorter than cInlineSize in the object
+ *          itself - typical tags and paths need no heap allocation. The length
+ *          is cached except for buffers from the size constructor or Resize()
+ *          which are written through C_str() - their length is found on each
+ *          Len() until AutoFit().
  */
-class CTextW
+template <typename CharT>
+class CTextT
 {
-protected:
-    std::vector<wchar_t>    _buf;
-    bool                    _invalidStrLen;
-
 public:
-    CTextW() : _invalidStrLen(false) { _buf.push_back(0); }
-    CTextW(unsigned size) : _invalidStrLen(true) { _buf.resize(size + 1, 0); }
+    enum { cInlineSize = 64 };
 
-    CTextW(const wchar_t* str);
-    CTextW(const char* str);
-
-    CTextW(const CTextW& txt) : _buf(txt._buf), _invalidStrLen(txt._invalidStrLen) {}
-
-    ~CTextW() {}
+    CTextT() { init(); }
+    CTextT(unsigned size);
+    CTextT(const CharT* str);
+    CTextT(const CharT* str, unsigned len);
+    CTextT(const CTextT& txt);
+    CTextT(CTextT&& txt);
+    ~CTextT() { free(); }
 
     inline void AutoFit()
     {
         if (_invalidStrLen)
         {
-            _buf.resize(wcslen(_buf.data()) + 1);
+            _size = strLen(_str) + 1;
             _invalidStrLen = false;
         }
     }
 
-    CTextW& operator=(const CTextW& txt);
-    CTextW& operator=(const wchar_t* str);
-    CTextW& operator=(const char* str);
+    CTextT& operator=(const CTextT& txt);
+    CTextT& operator=(CTextT&& txt);
+    CTextT& operator=(const CharT* str);
 
-    inline bool operator==(const CTextW& txt) const { return (_buf == txt._buf); }
-    inline bool operator==(const wchar_t* str) const { return !wcscmp(_buf.data(), str); }
+    bool operator==(const CTextT& txt) const;
+    bool operator==(const CharT* str) const;
 
-    void operator+=(const CTextW& txt);
-    void operator+=(const wchar_t* str);
-    void operator+=(const char* str);
-    void operator+=(wchar_t letter);
+    void operator+=(const CTextT& txt) { Append(txt._str, txt.Len()); }
+    void operator+=(const CharT* str) { if (str) Append(str, strLen(str)); }
+    void operator+=(CharT letter) { Append(&letter, 1); }
 
-    void Append(const wchar_t* data, unsigned len);
-    void Append(const char* data, unsigned len);
-    void Insert(unsigned at_pos, wchar_t letter);
-    void Insert(unsigned at_pos, const wchar_t* data, unsigned len);
+    void Append(const CharT* data, unsigned len);
+    void Insert(unsigned at_pos, CharT letter) { Insert(at_pos, &letter, 1); }
+    void Insert(unsigned at_pos, const CharT* data, unsigned len);
     void Erase(unsigned from_pos, unsigned len);
 
     void Clear();
     void Resize(unsigned size);
 
-    inline unsigned Len() const { return (_invalidStrLen) ? wcslen(_buf.data()) : (_buf.size() - 1); }
+    inline unsigned Len() const { return (_invalidStrLen) ? strLen(_str) : (_size - 1); }
     inline bool IsEmpty() const { return (Len() == 0); }
-    inline const std::vector<wchar_t>& Vector() const { return _buf; }
-    inline const wchar_t* C_str() const { return _buf.data(); }
-    inline wchar_t* C_str() { return _buf.data(); }
-    inline unsigned Size() const { return _buf.size(); }
+    inline const CharT* C_str() const { return _str; }
+    inline CharT* C_str() { return _str; }
+    inline unsigned Size() const { return _size; }
+    inline bool IsInline() const { return (_str == _inline); }
+
+protected:
+    static inline unsigned strLen(const char* str) { return (unsigned)strlen(str); }
+    static inline unsigned strLen(const wchar_t* str) { return (unsigned)wcslen(str); }
+
+    inline void init()
+    {
+        _str            = _inline;
+        _str[0]         = 0;
+        _size           = 1;
+        _capacity       = cInlineSize;
+        _invalidStrLen  = false;
+    }
+
+    inline void free()
+    {
+        if (_str != _inline)
+            delete [] _str;
+    }
+
+    void assign(const CharT* data, unsigned len);
+    void reserve(unsigned size);
+    void take(CTextT& txt);
+
+    CharT*      _str;
+    unsigned    _size;      // Including the termination
+    unsigned    _capacity;
+    bool        _invalidStrLen;
+    CharT       _inline[cInlineSize];
 };
 
 
 /**
- *  \class  CTextA
+ *  \class  CTextW
  *  \brief
  */
-class CTextA
+class CTextW : public CTextT<wchar_t>
 {
-protected:
-    std::vector<char>   _buf;
-    bool                _invalidStrLen;
-
 public:
-    CTextA() : _invalidStrLen(false) { _buf.push_back(0); }
-    CTextA(unsigned size) : _invalidStrLen(true) { _buf.resize(size + 1, 0); }
+    CTextW() {}
+    CTextW(unsigned size) : CTextT<wchar_t>(size) {}
+    CTextW(const wchar_t* str) : CTextT<wchar_t>(str) {}
+    CTextW(const wchar_t* str, unsigned len) : CTextT<wchar_t>(str, len) {}
+    CTextW(const char* str);
+    CTextW(const CTextW& txt) : CTextT<wchar_t>(txt) {}
+    CTextW(CTextW&& txt) : CTextT<wchar_t>(std::move(txt)) {}
 
-    CTextA(const char* str);
-    CTextA(const wchar_t* str);
+    ~CTextW() {}
 
-    CTextA(const CTextA& txt) : _buf(txt._buf), _invalidStrLen(txt._invalidStrLen) {}
+    CTextW& operator=(const CTextW& txt) { CTextT<wchar_t>::operator=(txt); return *this; }
+    CTextW& operator=(CTextW&& txt) { CTextT<wchar_t>::operator=(std::move(txt)); return *this; }
+    CTextW& operator=(const wchar_t* str) { CTextT<wchar_t>::operator=(str); return *this; }
+    CTextW& operator=(const char* str);
 
-    ~CTextA() {}
+    using CTextT<wchar_t>::operator+=;
+    void operator+=(const char* str);
 
-    inline void AutoFit()
-    {
-        if (_invalidStrLen)
-        {
-            _buf.resize(strlen(_buf.data()) + 1);
-            _invalidStrLen = false;
-        }
-    }
+    using CTextT<wchar_t>::Append;
+    void Append(const char* data, unsigned len);
+};
 
-    CTextA& operator=(const CTextA& txt);
-    CTextA& operator=(const char* str);
-    CTextA& operator=(const wchar_t* str);
 
-    inline bool operator==(const CTextA& txt) const { return (_buf == txt._buf); }
-    inline bool operator==(const char* str) const { return !strcmp(_buf.data(), str); }
+/**
+ *  \class  CTextA
+ *  \brief
+ */
+class CTextA : public CTextT<char>
+{
+public:
+    CTextA() {}
+    CTextA(unsigned size) : CTextT<char>(size) {}
+    CTextA(const char* str) : CTextT<char>(str) {}
+    CTextA(const char* str, unsigned len) : CTextT<char>(str, len) {}
+    CTextA(const wchar_t* str);
+    CTextA(const CTextA& txt) : CTextT<char>(txt) {}
+    CTextA(CTextA&& txt) : CTextT<char>(std::move(txt)) {}
 
-    void operator+=(const CTextA& txt);
-    void operator+=(const char* str);
-    void operator+=(const wchar_t* str);
-    void operator+=(char letter);
+    ~CTextA() {}
 
-    void Append(const char* data, unsigned len);
-    void Append(const wchar_t* data, unsigned len);
-    void Insert(unsigned at_pos, char letter);
-    void Insert(unsigned at_pos, const char* data, unsigned len);
-    void Erase(unsigned from_pos, unsigned len);
+    CTextA& operator=(const CTextA& txt) { CTextT<char>::operator=(txt); return *this; }
+    CTextA& operator=(CTextA&& txt) { CTextT<char>::operator=(std::move(txt)); return *this; }
+    CTextA& operator=(const char* str) { CTextT<char>::operator=(str); return *this; }
+    CTextA& operator=(const wchar_t* str);
 
-    void Clear();
-    void Resize(unsigned size);
+    using CTextT<char>::operator+=;
+    void operator+=(const wchar_t* str);
 
-    inline unsigned Len() const { return (_invalidStrLen) ? strlen(_buf.data()) : (_buf.size() - 1); }
-    inline bool IsEmpty() const { return (Len() == 0); }
-    inline const std::vector<char>& Vector() const { return _buf; }
-    inline const char* C_str() const { return _buf.data(); }
-    inline char* C_str() { return _buf.data(); }
-    inline unsigned Size() const { return _buf.size(); }
+    using CTextT<char>::Append;
+    void Append(const wchar_t* data, unsigned len);
 };
 
 
@@ -168,11 +197,16 @@ class CPath : public CText
 public:
 	CPath() : CText() {}
     CPath(const CPath& path) : CText(path) {}
+    CPath(CPath&& path) : CText(std::move(path)) {}
 	CPath(const char* pathStr) : CText(pathStr) {}
 	CPath(const wchar_t* pathStr) : CText(pathStr) {}
+    CPath(const TCHAR* pathStr, unsigned len) : CText(pathStr, len) {}
     CPath(unsigned size) : CText(size) {}
     ~CPath() {}
 
+    CPath& operator=(const CPath& path) { CText::operator=(path); return *this; }
+    CPath& operator=(CPath&& path) { CText::operator=(std::move(path)); return *this; }
+
     inline bool Exists() const
     {
         if (IsEmpty())
@@ -0,0 +1,100 @@
+/**
+ *  \file
+ *  \brief  Lock-free queue of the finished commands waiting for their callbacks
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include <windows.h>
+#include "CompletionQueue.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \brief
+ */
+CompletionQueue::~CompletionQueue()
+{
+    Completion* completion = PopAll();
+
+    while (completion)
+    {
+        Completion* next = completion->_next;
+        delete completion;
+        completion = next;
+    }
+}
+
+
+/**
+ *  \brief  Can be called from any thread. Returns true if the queue was
+ *          empty or the last wake-up was lost - the consumer has to be woken
+ *          up then.
+ */
+bool CompletionQueue::Push(const CmdPtr_t& cmd, CompletionCB complCB)
+{
+    Completion* completion = new Completion;
+    completion->_cmd        = cmd;
+    completion->_complCB    = complCB;
+
+    Completion* head;
+
+    do
+    {
+        head = _head;
+        completion->_next = head;
+    }
+    while (InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&_head), completion, head) != head);
+
+    if (head == NULL)
+        return true;
+
+    return (InterlockedExchange(&_wakeUpLost, 0) != 0);
+}
+
+
+/**
+ *  \brief  Takes all queued completions in the order they were pushed. The
+ *          caller deletes them. Only one thread may call it.
+ */
+CompletionQueue::Completion* CompletionQueue::PopAll()
+{
+    Completion* completion = static_cast<Completion*>(
+            InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&_head), NULL));
+
+    // Reverse to the push order
+    Completion* ordered = NULL;
+
+    while (completion)
+    {
+        Completion* next = completion->_next;
+        completion->_next = ordered;
+        ordered = completion;
+        completion = next;
+    }
+
+    return ordered;
+}
+
+} // namespace GTags
@@ -0,0 +1,78 @@
+/**
+ *  \file
+ *  \brief  Lock-free queue of the finished commands waiting for their callbacks
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#pragma once
+
+
+#include <windows.h>
+#include "CmdDefines.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  CompletionQueue
+ *  \brief  Multiple producers (the command threads) push finished commands,
+ *          a single consumer (the UI thread) takes all of them at once. Push
+ *          never blocks - it is a compare-and-swap on the list head. Only the
+ *          push to an empty queue needs to wake up the consumer so a batch of
+ *          completions is handled on a single wake-up. If that wake-up could
+ *          not be sent the next push sends it again.
+ */
+class CompletionQueue
+{
+public:
+    /**
+     *  \struct  Completion
+     *  \brief
+     */
+    struct Completion
+    {
+        CmdPtr_t        _cmd;
+        CompletionCB    _complCB;
+        Completion*     _next;
+    };
+
+    CompletionQueue() : _head(NULL), _wakeUpLost(0) {}
+    ~CompletionQueue();
+
+    bool Push(const CmdPtr_t& cmd, CompletionCB complCB);
+    Completion* PopAll();
+
+    inline void WakeUpLost() { InterlockedExchange(&_wakeUpLost, 1); }
+
+    inline bool IsEmpty() const { return (_head == NULL); }
+
+private:
+    CompletionQueue(const CompletionQueue&);
+    CompletionQueue& operator=(const CompletionQueue&);
+
+    Completion* volatile    _head;  // Last pushed first
+    volatile LONG           _wakeUpLost;
+};
+
+} // namespace GTags
@@ -25,6 +25,7 @@
 #include <windows.h>
 #include <tchar.h>
 #include <stdio.h>
+#include <algorithm>
 #include "INpp.h"
 #include "Common.h"
 #include "Config.h"
@@ -43,6 +44,11 @@ const TCHAR Settings::cUseDefDbKey[]     = _T("UseDefaultDB = ");
 const TCHAR Settings::cDefDbPathKey[]    = _T("DefaultDBPath = ");
 const TCHAR Settings::cREOptionKey[]     = _T("RegExp = ");
 const TCHAR Settings::cICOptionKey[]     = _T("IgnoreCase = ");
+const TCHAR Settings::cPrefetchKey[]     = _T("PrefetchDefinitions = ");
+const TCHAR Settings::cHighlightKey[]    = _T("HighlightDefinitions = ");
+const TCHAR Settings::cQueryCacheKey[]   = _T("PersistentCache = ");
+const TCHAR Settings::cTabsMemoryKey[]   = _T("InactiveTabsMemoryMB = ");
+const TCHAR Settings::cMaxOutputKey[]    = _T("MaxOutputMB = ");
 
 const TCHAR DbConfig::cInfo[] =
         _T("# ") PLUGIN_NAME _T(" database config\n");
@@ -53,6 +59,9 @@ const TCHAR DbConfig::cUseLibDbKey[]        = _T("UseLibraryDBs = ");
 const TCHAR DbConfig::cLibDbPathsKey[]      = _T("LibraryDBPaths = ");
 const TCHAR DbConfig::cUsePathFilterKey[]   = _T("UsePathFilters = ");
 const TCHAR DbConfig::cPathFiltersKey[]     = _T("PathFilters = ");
+const TCHAR DbConfig::cUseGrepIndexKey[]    = _T("UseGrepIndex = ");
+const TCHAR DbConfig::cBuildFilesKey[]      = _T("LastBuildFiles = ");
+const TCHAR DbConfig::cBuildTimesKey[]      = _T("LastBuildTimes = ");
 
 const TCHAR DbConfig::cDefaultParser[]   = _T("default");
 const TCHAR DbConfig::cCtagsParser[]     = _T("ctags");
@@ -85,6 +94,11 @@ void DbConfig::SetDefaults()
     _libDbPaths.clear();
     _usePathFilter = false;
     _pathFilters.clear();
+    _useGrepIndex = false;
+    _buildStats = BuildStats();
+    _libPathEnv.Clear();
+    _isLibDb = false;
+    InternPaths();
 }
 
 
@@ -137,6 +151,29 @@ bool DbConfig::ReadOption(TCHAR* line)
         const unsigned pos = _countof(cPathFiltersKey) - 1;
         FiltersFromBuf(&line[pos], _T(";"));
     }
+    else if (!_tcsncmp(line, cUseGrepIndexKey, _countof(cUseGrepIndexKey) - 1))
+    {
+        const unsigned pos = _countof(cUseGrepIndexKey) - 1;
+        if (!_tcsncmp(&line[pos], _T("yes"), _countof(_T("yes")) - 1))
+            _useGrepIndex = true;
+        else
+            _useGrepIndex = false;
+    }
+    else if (!_tcsncmp(line, cBuildFilesKey, _countof(cBuildFilesKey) - 1))
+    {
+        const unsigned pos = _countof(cBuildFilesKey) - 1;
+        _buildStats._files = _tcstoul(&line[pos], NULL, 10);
+    }
+    else if (!_tcsncmp(line, cBuildTimesKey, _countof(cBuildTimesKey) - 1))
+    {
+        // scan;parse;write
+        TCHAR* pTmp = &line[_countof(cBuildTimesKey) - 1];
+        _buildStats._scanTime = _tcstoul(pTmp, &pTmp, 10);
+        if (*pTmp == _T(';'))
+            _buildStats._parseTime = _tcstoul(pTmp + 1, &pTmp, 10);
+        if (*pTmp == _T(';'))
+            _buildStats._writeTime = _tcstoul(pTmp + 1, &pTmp, 10);
+    }
     else
     {
         return false;
@@ -166,6 +203,26 @@ bool DbConfig::Write(FILE* fp) const
     if (_ftprintf_s(fp, _T("%s%s\n"), cLibDbPathsKey, libDbPaths.C_str()) > 0)
     if (_ftprintf_s(fp, _T("%s%s\n"), cUsePathFilterKey, (_usePathFilter ? _T("yes") : _T("no"))) > 0)
     if (_ftprintf_s(fp, _T("%s%s\n"), cPathFiltersKey, pathFilters.C_str()) > 0)
+    if (_ftprintf_s(fp, _T("%s%s\n"), cUseGrepIndexKey, (_useGrepIndex ? _T("yes") : _T("no"))) > 0)
+        success = true;
+
+    return success;
+}
+
+
+/**
+ *  \brief
+ */
+bool DbConfig::WriteBuildStats(FILE* fp) const
+{
+    if (!_buildStats._files)
+        return true;
+
+    bool success = false;
+
+    if (_ftprintf_s(fp, _T("%s%u\n"), cBuildFilesKey, _buildStats._files) > 0)
+    if (_ftprintf_s(fp, _T("%s%u;%u;%u\n"), cBuildTimesKey,
+            _buildStats._scanTime, _buildStats._parseTime, _buildStats._writeTime) > 0)
         success = true;
 
     return success;
@@ -229,7 +286,7 @@ bool DbConfig::SaveToFolder(const CPath& cfgFileFolder) const
     if (fp == NULL)
         return false;
 
-    bool success = Write(fp);
+    bool success = Write(fp) && WriteBuildStats(fp);
     fclose(fp);
 
     return success;
@@ -249,6 +306,8 @@ void DbConfig::DbPathsFromBuf(TCHAR* buf, const TCHAR* separators)
         if (db.Exists())
             _libDbPaths.push_back(db);
     }
+
+    InternPaths();
 }
 
 
@@ -269,6 +328,8 @@ void DbConfig::FiltersFromBuf(TCHAR* buf, const TCHAR* separators)
     TCHAR* pTmp = NULL;
     for (TCHAR* ptr = _tcstok_s(buf, separators, &pTmp); ptr; ptr = _tcstok_s(NULL, separators, &pTmp))
         _pathFilters.push_back(CPath(ptr));
+
+    InternPaths();
 }
 
 
@@ -281,6 +342,98 @@ void DbConfig::FiltersToBuf(CText& buf, TCHAR separator) const
 }
 
 
+/**
+ *  \brief
+ */
+void DbConfig::InternPaths()
+{
+    PathTable& paths = PathTable::Get();
+
+    _libDbIds.clear();
+    for (const auto& libDb : _libDbPaths)
+        _libDbIds.push_back(paths.Intern(libDb));
+
+    _filterIds.clear();
+    _filterMinDepth = 0;
+    _filterMaxDepth = 0;
+
+    for (const auto& filter : _pathFilters)
+    {
+        const PathId filterId = paths.Intern(filter);
+        const unsigned depth = paths.Depth(filterId);
+
+        if (_filterIds.empty() || depth < _filterMinDepth)
+            _filterMinDepth = depth;
+        if (depth > _filterMaxDepth)
+            _filterMaxDepth = depth;
+
+        _filterIds.push_back(filterId);
+    }
+
+    std::sort(_filterIds.begin(), _filterIds.end());
+    _filterIds.erase(std::unique(_filterIds.begin(), _filterIds.end()), _filterIds.end());
+}
+
+
+/**
+ *  \brief
+ */
+void DbConfig::Precompute(PathId dbPathId)
+{
+    const PathTable& paths = PathTable::Get();
+
+    _libPathEnv.Clear();
+    _isLibDb = false;
+
+    for (unsigned i = 0; i < _libDbIds.size(); ++i)
+    {
+        if (paths.IsParentOf(_libDbIds[i], dbPathId))
+            _isLibDb = true;
+
+        if (!paths.IsSubpathOf(_libDbIds[i], dbPathId))
+        {
+            if (!_libPathEnv.IsEmpty())
+                _libPathEnv += _T(';');
+            _libPathEnv += _libDbPaths[i];
+        }
+    }
+}
+
+
+/**
+ *  \brief  Walks up the entry parents in the filters depth range looking
+ *          each one up in the sorted filter IDs
+ */
+bool DbConfig::IsFiltered(PathId entryId) const
+{
+    if (!_usePathFilter || _filterIds.empty() || entryId == PathTable::cInvalidId)
+        return false;
+
+    const PathTable& paths = PathTable::Get();
+
+    PathId id = entryId;
+    unsigned depth = paths.Depth(id);
+
+    if (depth < _filterMinDepth)
+        return false;
+
+    for (; depth > _filterMaxDepth; --depth)
+        id = paths.Parent(id);
+
+    for (;;)
+    {
+        if (std::binary_search(_filterIds.begin(), _filterIds.end(), id))
+            return true;
+
+        if (depth == _filterMinDepth)
+            return false;
+
+        id = paths.Parent(id);
+        --depth;
+    }
+}
+
+
 /**
  *  \brief
  */
@@ -294,6 +447,14 @@ const DbConfig& DbConfig::operator=(const DbConfig& rhs)
         _libDbPaths     = rhs._libDbPaths;
         _usePathFilter  = rhs._usePathFilter;
         _pathFilters    = rhs._pathFilters;
+        _useGrepIndex   = rhs._useGrepIndex;
+        _libDbIds       = rhs._libDbIds;
+        _filterIds      = rhs._filterIds;
+        _filterMinDepth = rhs._filterMinDepth;
+        _filterMaxDepth = rhs._filterMaxDepth;
+        _libPathEnv     = rhs._libPathEnv;
+        _isLibDb        = rhs._isLibDb;
+        _buildStats     = rhs._buildStats;
     }
 
     return *this;
@@ -310,7 +471,8 @@ bool DbConfig::operator==(const DbConfig& rhs) const
 
     return (_parserIdx == rhs._parserIdx && _autoUpdate == rhs._autoUpdate &&
             _useLibDb == rhs._useLibDb && _libDbPaths == rhs._libDbPaths &&
-            _usePathFilter == rhs._usePathFilter && _pathFilters == rhs._pathFilters);
+            _usePathFilter == rhs._usePathFilter && _pathFilters == rhs._pathFilters &&
+            _useGrepIndex == rhs._useGrepIndex);
 }
 
 
@@ -350,6 +512,11 @@ void Settings::SetDefaults()
     _defDbPath.Clear();
     _re = false;
     _ic = false;
+    _prefetch = true;
+    _highlight = false;
+    _queryCache = true;
+    _tabsMemory = 64;
+    _maxOutput = 256;
 
     _genericDbCfg.SetDefaults();
 }
@@ -418,6 +585,40 @@ bool Settings::Load()
             else
                 _ic = false;
         }
+        else if (!_tcsncmp(line, cPrefetchKey, _countof(cPrefetchKey) - 1))
+        {
+            const unsigned pos = _countof(cPrefetchKey) - 1;
+            if (!_tcsncmp(&line[pos], _T("yes"), _countof(_T("yes")) - 1))
+                _prefetch = true;
+            else
+                _prefetch = false;
+        }
+        else if (!_tcsncmp(line, cHighlightKey, _countof(cHighlightKey) - 1))
+        {
+            const unsigned pos = _countof(cHighlightKey) - 1;
+            if (!_tcsncmp(&line[pos], _T("yes"), _countof(_T("yes")) - 1))
+                _highlight = true;
+            else
+                _highlight = false;
+        }
+        else if (!_tcsncmp(line, cQueryCacheKey, _countof(cQueryCacheKey) - 1))
+        {
+            const unsigned pos = _countof(cQueryCacheKey) - 1;
+            if (!_tcsncmp(&line[pos], _T("yes"), _countof(_T("yes")) - 1))
+                _queryCache = true;
+            else
+                _queryCache = false;
+        }
+        else if (!_tcsncmp(line, cTabsMemoryKey, _countof(cTabsMemoryKey) - 1))
+        {
+            const unsigned pos = _countof(cTabsMemoryKey) - 1;
+            _tabsMemory = _tcstoul(&line[pos], NULL, 10);
+        }
+        else if (!_tcsncmp(line, cMaxOutputKey, _countof(cMaxOutputKey) - 1))
+        {
+            const unsigned pos = _countof(cMaxOutputKey) - 1;
+            _maxOutput = _tcstoul(&line[pos], NULL, 10);
+        }
         else if (!_genericDbCfg.ReadOption(line))
         {
             success = false;
@@ -451,7 +652,12 @@ bool Settings::Save() const
     if (_ftprintf_s(fp, _T("%s%s\n"), cUseDefDbKey, (_useDefDb ? _T("yes") : _T("no"))) > 0)
     if (_ftprintf_s(fp, _T("%s%s\n"), cDefDbPathKey, _defDbPath.C_str()) > 0)
     if (_ftprintf_s(fp, _T("%s%s\n"), cREOptionKey, (_re ? _T("yes") : _T("no"))) > 0)
-    if (_ftprintf_s(fp, _T("%s%s\n\n"), cICOptionKey, (_ic ? _T("yes") : _T("no"))) > 0)
+    if (_ftprintf_s(fp, _T("%s%s\n"), cICOptionKey, (_ic ? _T("yes") : _T("no"))) > 0)
+    if (_ftprintf_s(fp, _T("%s%s\n"), cPrefetchKey, (_prefetch ? _T("yes") : _T("no"))) > 0)
+    if (_ftprintf_s(fp, _T("%s%s\n"), cHighlightKey, (_highlight ? _T("yes") : _T("no"))) > 0)
+    if (_ftprintf_s(fp, _T("%s%s\n"), cQueryCacheKey, (_queryCache ? _T("yes") : _T("no"))) > 0)
+    if (_ftprintf_s(fp, _T("%s%u\n"), cTabsMemoryKey, _tabsMemory) > 0)
+    if (_ftprintf_s(fp, _T("%s%u\n\n"), cMaxOutputKey, _maxOutput) > 0)
     if (_genericDbCfg.Write(fp))
         success = true;
 
@@ -475,6 +681,11 @@ const Settings& Settings::operator=(const Settings& rhs)
         _defDbPath      = rhs._defDbPath;
         _re             = rhs._re;
         _ic             = rhs._ic;
+        _prefetch       = rhs._prefetch;
+        _highlight      = rhs._highlight;
+        _queryCache     = rhs._queryCache;
+        _tabsMemory     = rhs._tabsMemory;
+        _maxOutput      = rhs._maxOutput;
         _genericDbCfg   = rhs._genericDbCfg;
     }
 
@@ -491,7 +702,10 @@ bool Settings::operator==(const Settings& rhs) const
         return true;
 
     return (_useDefDb == rhs._useDefDb && _defDbPath == rhs._defDbPath &&
-            _re == rhs._re && _ic == rhs._ic && _genericDbCfg == rhs._genericDbCfg);
+            _re == rhs._re && _ic == rhs._ic && _prefetch == rhs._prefetch &&
+            _highlight == rhs._highlight && _queryCache == rhs._queryCache &&
+            _tabsMemory == rhs._tabsMemory && _maxOutput == rhs._maxOutput &&
+            _genericDbCfg == rhs._genericDbCfg);
 }
 
 } // namespace GTags
@@ -28,7 +28,9 @@
 #include <windows.h>
 #include <tchar.h>
 #include <vector>
+#include <memory>
 #include "Common.h"
+#include "PathTable.h"
 
 
 namespace GTags
@@ -49,6 +51,20 @@ public:
         PARSER_LIST_END
     };
 
+    /**
+     *  \struct  BuildStats
+     *  \brief  Last database creation timing breakdown (times in ms)
+     */
+    struct BuildStats
+    {
+        BuildStats() : _files(0), _scanTime(0), _parseTime(0), _writeTime(0) {}
+
+        unsigned    _files;
+        unsigned    _scanTime;
+        unsigned    _parseTime;
+        unsigned    _writeTime;
+    };
+
     DbConfig();
     ~DbConfig() {}
 
@@ -69,6 +85,15 @@ public:
     void FiltersFromBuf(TCHAR* buf, const TCHAR* separators);
     void FiltersToBuf(CText& buf, TCHAR separator) const;
 
+    // Call after _libDbPaths or _pathFilters are changed directly
+    void InternPaths();
+
+    // Derives the per-command data for the database at dbPathId - called once per published config
+    void Precompute(PathId dbPathId);
+
+    // The entry is under one of the path filters (and they are enabled)
+    bool IsFiltered(PathId entryId) const;
+
     const DbConfig& operator=(const DbConfig&);
     bool operator==(const DbConfig&) const;
 
@@ -78,10 +103,24 @@ public:
     std::vector<CPath>  _libDbPaths;
     bool                _usePathFilter;
     std::vector<CPath>  _pathFilters;
+    bool                _useGrepIndex;
+
+    // Interned _libDbPaths and _pathFilters - the filter IDs are sorted
+    std::vector<PathId> _libDbIds;
+    std::vector<PathId> _filterIds;
+    unsigned            _filterMinDepth;
+    unsigned            _filterMaxDepth;
+
+    // Set by Precompute()
+    CText               _libPathEnv;    // GTAGSLIBPATH - the library databases outside the database
+    bool                _isLibDb;       // The database is under one of the library databases
 
+    BuildStats          _buildStats;
+
 private:
     bool ReadOption(TCHAR* line);
     bool Write(FILE* fp) const;
+    bool WriteBuildStats(FILE* fp) const;
 
     static const TCHAR cInfo[];
 
@@ -91,6 +130,9 @@ private:
     static const TCHAR cLibDbPathsKey[];
     static const TCHAR cUsePathFilterKey[];
     static const TCHAR cPathFiltersKey[];
+    static const TCHAR cUseGrepIndexKey[];
+    static const TCHAR cBuildFilesKey[];
+    static const TCHAR cBuildTimesKey[];
 
     static const TCHAR cDefaultParser[];
     static const TCHAR cCtagsParser[];
@@ -102,6 +144,13 @@ private:
 
     static void vectorToBuf(const std::vector<CPath>& vect, CText& buf, TCHAR separator);
 };
+
+
+/**
+ *  \brief  Published configs are never changed - a new one replaces them
+ *          so the commands running on other threads keep a consistent copy
+ */
+typedef std::shared_ptr<const DbConfig> DbConfigPtr;
 
 
 /**
@@ -125,6 +174,11 @@ public:
     CPath   _defDbPath;
     bool    _re;
     bool    _ic;
+    bool    _prefetch;
+    bool    _highlight;     // Mark the database definitions in the visible text
+    bool    _queryCache;    // Keep the search results in the database folder across sessions
+    unsigned _tabsMemory;   // MB for the inactive results window tabs
+    unsigned _maxOutput;    // MB of command output, the rest is cut
 
     DbConfig    _genericDbCfg;
 
@@ -137,6 +191,11 @@ private:
     static const TCHAR cDefDbPathKey[];
     static const TCHAR cREOptionKey[];
     static const TCHAR cICOptionKey[];
+    static const TCHAR cPrefetchKey[];
+    static const TCHAR cHighlightKey[];
+    static const TCHAR cQueryCacheKey[];
+    static const TCHAR cTabsMemoryKey[];
+    static const TCHAR cMaxOutputKey[];
 };
 
 } // namespace GTags
@@ -28,31 +28,91 @@
 #include "GTags.h"
 #include "Cmd.h"
 #include "CmdEngine.h"
+#include "GrepIndex.h"
+#include "DeltaLog.h"
+#include "QueryCache.h"
+#include "OverlayIndex.h"
 
 
-namespace GTags
+namespace
 {
 
+unsigned TagsVersionCounter = 0;
+
+} // anonymous namespace
+
+
+namespace GTags
+{
 
 /**
  *  \brief
  */
-GTagsDb::GTagsDb(const CPath& dbPath, bool writeEn) : _path(dbPath), _writeLock(writeEn)
+GTagsDb::GTagsDb(const CPath& dbPath, bool writeEn) :
+    _path(dbPath), _pathId(PathTable::Get().Intern(dbPath)), _writeLock(writeEn),
+    _tagsVersion(++TagsVersionCounter)
 {
-    if (!_cfg.LoadFromFolder(dbPath))
-        _cfg = GTagsSettings._genericDbCfg;
+    DbConfig* cfg = new DbConfig;
+
+    if (!cfg->LoadFromFolder(dbPath))
+        *cfg = GTagsSettings._genericDbCfg;
+
+    publishConfig(cfg);
 
     _readLocks = writeEn ? 0 : 1;
+
+    // Saved files not folded into the database before it was closed
+    OverlayIndex::Get().LoadDelta(_path, _pathId);
+}
+
+
+/**
+ *  \brief
+ */
+void GTagsDb::SetConfig(const DbConfig& cfg)
+{
+    publishConfig(new DbConfig(cfg));
+}
+
+
+/**
+ *  \brief
+ */
+void GTagsDb::SetBuildStats(const DbConfig::BuildStats& stats)
+{
+    // Under the lock so a concurrent SetConfig() is not lost
+    AUTOLOCK(_cfgLock);
+
+    DbConfig* cfg = new DbConfig(*_cfg);
+    cfg->_buildStats = stats;
+
+    _cfg.reset(cfg);
+}
+
+
+/**
+ *  \brief  Takes ownership of cfg and replaces the current config with it.
+ *          The commands holding the old one keep using it until they are done.
+ */
+void GTagsDb::publishConfig(DbConfig* cfg)
+{
+    cfg->Precompute(_pathId);
+
+    DbConfigPtr newCfg(cfg);
+
+    AUTOLOCK(_cfgLock);
+    _cfg.swap(newCfg);
 }
 
 
 /**
  *  \brief
  */
-void GTagsDb::Update(const CPath& file)
+void GTagsDb::Update(const CPath& file, LONGLONG lockWait)
 {
     CmdPtr_t cmd(new Cmd(UPDATE_SINGLE, _T("Database Single File Update"),
             this->shared_from_this(), NULL, file.C_str()));
+    cmd->Timing().LockWait(lockWait);
     CmdEngine::Run(cmd, dbUpdateCB);
 }
 
@@ -62,12 +122,14 @@ void GTagsDb::Update(const CPath& file)
  */
 void GTagsDb::ScheduleUpdate(const CPath& file)
 {
-    std::list<CPath>::reverse_iterator iFile;
-    for (iFile = _updateList.rbegin(); iFile != _updateList.rend(); ++iFile)
-        if (*iFile == file)
+    const PathId fileId = PathTable::Get().Intern(file);
+
+    std::list<ScheduledUpdate>::reverse_iterator iUpdate;
+    for (iUpdate = _updateList.rbegin(); iUpdate != _updateList.rend(); ++iUpdate)
+        if (iUpdate->_fileId == fileId)
             return;
 
-    _updateList.push_back(file);
+    _updateList.push_back(ScheduledUpdate(file, fileId, CmdTiming::Now()));
 }
 
 
@@ -103,6 +165,7 @@ bool GTagsDb::unlock()
     if (_writeLock)
     {
         _writeLock = false;
+        _tagsVersion = ++TagsVersionCounter;
     }
     else if (_readLocks > 0)
     {
@@ -124,10 +187,10 @@ void GTagsDb::runScheduledUpdate()
 
     lock(true);
 
-    CPath file = *(_updateList.begin());
+    ScheduledUpdate update = *(_updateList.begin());
     _updateList.erase(_updateList.begin());
 
-    Update(file);
+    Update(update._file, CmdTiming::Now() - update._time);
 }
 
 
@@ -146,6 +209,18 @@ void GTagsDb::dbUpdateCB(const CmdPtr_t& cmd)
         MessageBox(INpp::Get().GetHandle(), msg.C_str(), cmd->Name(), MB_OK | MB_ICONEXCLAMATION);
     }
 
+    // The saved file is in the database now - drop its overlay and delta unless edited / saved after that
+    const LONGLONG olderThan = cmd->Timing().Get(CmdTiming::QUEUED) - cmd->Timing().LockWait();
+    const CPath file(cmd->Tag().C_str());
+
+    const bool updated = (cmd->Status() == OK && !cmd->Result());
+
+    if (updated)
+        OverlayIndex::Get().Remove(file, olderThan);
+
+    OverlayIndex::Get().Folded(file, cmd->Db()->GetPathId(), updated ? olderThan : 0,
+            cmd->Db()->_updateList.empty());
+
     cmd->Db()->unlock();
     cmd->Db()->runScheduledUpdate();
 }
@@ -270,6 +345,8 @@ bool DbManager::deleteDb(CPath& dbPath)
 {
     BOOL ret = FALSE;
 
+    QueryCache::Get().Drop(dbPath);
+
     dbPath += _T("GTAGS");
     if (dbPath.FileExists())
         ret = DeleteFile(dbPath.C_str());
@@ -284,6 +361,16 @@ bool DbManager::deleteDb(CPath& dbPath)
     if (dbPath.FileExists())
         ret |= DeleteFile(dbPath.C_str());
 
+    dbPath.StripFilename();
+    dbPath += GrepIndex::cFileName;
+    if (dbPath.FileExists())
+        ret |= DeleteFile(dbPath.C_str());
+
+    dbPath.StripFilename();
+    dbPath += DeltaLog::cFileName;
+    if (dbPath.FileExists())
+        ret |= DeleteFile(dbPath.C_str());
+
     dbPath.StripFilename();
     dbPath += cPluginCfgFileName;
     if (dbPath.FileExists())
@@ -298,9 +385,11 @@ bool DbManager::deleteDb(CPath& dbPath)
  */
 const DbHandle& DbManager::lockDb(const CPath& dbPath, bool writeEn, bool* success)
 {
+    const PathId dbPathId = PathTable::Get().Intern(dbPath);
+
     for (std::list<DbHandle>::iterator dbi = _dbList.begin(); dbi != _dbList.end(); ++dbi)
     {
-        if ((*dbi)->_path == dbPath)
+        if ((*dbi)->_pathId == dbPathId)
         {
             *success = (*dbi)->lock(writeEn);
             return *dbi;
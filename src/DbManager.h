@@ -30,6 +30,8 @@
 #include <memory>
 #include "Common.h"
 #include "Config.h"
+#include "AutoLock.h"
+#include "PathTable.h"
 #include "CmdDefines.h"
 #include "GTags.h"
 
@@ -47,16 +49,27 @@ public:
     ~GTagsDb() {}
 
     inline const CPath& GetPath() const { return _path; }
+    inline PathId GetPathId() const { return _pathId; }
 
-    inline const DbConfig& GetConfig() const { return _cfg; }
-    inline void SetConfig(const DbConfig& cfg) { _cfg = cfg; }
+    // The snapshot stays valid (unchanged) while held even if the config is replaced meanwhile
+    inline DbConfigPtr GetConfig() const
+    {
+        AUTOLOCK(_cfgLock);
+        return _cfg;
+    }
+
+    void SetConfig(const DbConfig& cfg);
+    void SetBuildStats(const DbConfig::BuildStats& stats);
+
+    // Changes each time the database is written so data derived from the tags can be checked for staleness
+    inline unsigned TagsVersion() const { return _tagsVersion; }
 
-    void Update(const CPath& file);
+    void Update(const CPath& file, LONGLONG lockWait = 0);
     void ScheduleUpdate(const CPath& file);
 
     inline void SaveCfg()
     {
-        _cfg.SaveToFolder(_path);
+        GetConfig()->SaveToFolder(_path);
     }
 
 private:
@@ -70,14 +83,33 @@ private:
     bool unlock();
 
     void runScheduledUpdate();
+    void publishConfig(DbConfig* cfg);
+
+    /**
+     *  \struct  ScheduledUpdate
+     *  \brief
+     */
+    struct ScheduledUpdate
+    {
+        ScheduledUpdate(const CPath& file, PathId fileId, LONGLONG time) :
+            _file(file), _fileId(fileId), _time(time) {}
+
+        CPath       _file;
+        PathId      _fileId;
+        LONGLONG    _time;
+    };
 
     CPath       _path;
-    DbConfig    _cfg;
+    PathId      _pathId;
+
+    mutable Mutex   _cfgLock;
+    DbConfigPtr     _cfg;
 
-    int     _readLocks;
-    bool    _writeLock;
+    int         _readLocks;
+    bool        _writeLock;
+    unsigned    _tagsVersion;
 
-    std::list<CPath> _updateList;
+    std::list<ScheduledUpdate> _updateList;
 };
 
 
@@ -0,0 +1,260 @@
+/**
+ *  \file
+ *  \brief  Background warm-up of the databases of the documents open at startup
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include <process.h>
+#include "GTags.h"
+#include "Cmd.h"
+#include "CmdEngine.h"
+#include "DbManager.h"
+#include "GrepIndex.h"
+#include "QueryCache.h"
+#include "DbWarmup.h"
+
+
+namespace GTags
+{
+
+const TCHAR* const  DbWarmup::cDbFiles[]    = { _T("GTAGS"), _T("GPATH"), _T("GRTAGS"), GrepIndex::cFileName };
+const size_t        DbWarmup::cChunkSize    = 1024 * 1024;
+const ULONGLONG     DbWarmup::cMaxFileSize  = 512 * 1024 * 1024;
+const DWORD         DbWarmup::cYieldTime    = 50;
+
+
+/**
+ *  \brief  Called on the UI thread once the editor is ready
+ */
+void DbWarmup::Start(const std::vector<CPath>& files)
+{
+    Stop();
+
+    _files  = files;
+    _next   = 0;
+    _stop   = 0;
+    _dbs.clear();
+
+    memset(&_stats, 0, sizeof(_stats));
+    _stats._startTime = CmdTiming::Now();
+}
+
+
+/**
+ *  \brief  Opens the databases of the next documents for up to budgetMs -
+ *          called on the UI thread when no user command runs. Starts the
+ *          warm-up thread after the last document. Returns false when there
+ *          is nothing left to do on the UI thread.
+ */
+bool DbWarmup::Step(unsigned budgetMs)
+{
+    if (_next >= _files.size() || _stop)
+        return false;
+
+    const LONGLONG start = CmdTiming::Now();
+
+    while (_next < _files.size() && CmdTiming::ToMs(CmdTiming::Now() - start) < budgetMs)
+    {
+        const CPath& file = _files[_next++];
+        ++_stats._files;
+
+        bool success;
+        DbHandle db = DbManager::Get().GetDb(file, false, &success);
+
+        // Being created - nothing to warm up yet
+        if (!db || !success)
+            continue;
+
+        const DbConfigPtr cfg = db->GetConfig();
+        addDb(db->GetPath(), cfg);
+
+        DbManager::Get().PutDb(db);
+
+        if (cfg->_useLibDb)
+            for (const auto& libDbPath : cfg->_libDbPaths)
+                addDb(libDbPath, DbConfigPtr());
+    }
+
+    if (_next < _files.size())
+        return true;
+
+    _stats._resolvedTime = CmdTiming::Now();
+
+    if (_dbs.empty())
+        _stats._doneTime = _stats._resolvedTime;
+    else
+        _hThread = (HANDLE)_beginthreadex(NULL, 0, threadFunc, this, 0, NULL);
+
+    return false;
+}
+
+
+/**
+ *  \brief  Called on the UI thread - waits for the warm-up thread to leave
+ */
+void DbWarmup::Stop()
+{
+    InterlockedExchange(&_stop, 1);
+
+    if (_hThread)
+    {
+        WaitForSingleObject(_hThread, INFINITE);
+        CloseHandle(_hThread);
+        _hThread = NULL;
+    }
+
+    _next = _files.size();
+}
+
+
+/**
+ *  \brief
+ */
+bool DbWarmup::IsRunning() const
+{
+    if (_next < _files.size())
+        return true;
+
+    return (_hThread && WaitForSingleObject(_hThread, 0) == WAIT_TIMEOUT);
+}
+
+
+/**
+ *  \brief
+ */
+unsigned __stdcall DbWarmup::threadFunc(void* data)
+{
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+
+    static_cast<DbWarmup*>(data)->warm();
+
+    return 0;
+}
+
+
+/**
+ *  \brief  A library database shared by several projects is warmed up once
+ */
+void DbWarmup::addDb(const CPath& dbPath, const DbConfigPtr& cfg)
+{
+    Db db;
+    db._path = dbPath;
+    db._path.AsFolder();
+    db._pathId = PathTable::Get().Intern(db._path);
+    db._cfg = cfg;
+
+    for (auto& known : _dbs)
+    {
+        if (known._pathId == db._pathId)
+        {
+            if (cfg)
+                known._cfg = cfg;
+            return;
+        }
+    }
+
+    _dbs.push_back(db);
+    ++_stats._dbs;
+}
+
+
+/**
+ *  \brief  Runs on the warm-up thread
+ */
+void DbWarmup::warm()
+{
+    std::vector<char> buf(cChunkSize);
+
+    for (const auto& db : _dbs)
+    {
+        for (const auto name : cDbFiles)
+        {
+            CPath file(db._path);
+            file += name;
+
+            if (!touch(file, buf))
+                return;
+        }
+
+        if (db._cfg && GTagsSettings._queryCache)
+            QueryCache::Get().Preload(db._path, db._pathId, *db._cfg);
+    }
+
+    _stats._doneTime = CmdTiming::Now();
+}
+
+
+/**
+ *  \brief  Reads the file a chunk at a time - it is not kept open meanwhile
+ *          so the database can be recreated. Returns false if stopped.
+ */
+bool DbWarmup::touch(const CPath& file, std::vector<char>& buf)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if (!GetFileAttributesEx(file.C_str(), GetFileExInfoStandard, &data))
+        return true;
+
+    const ULONGLONG size = ((ULONGLONG)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+
+    if (size > cMaxFileSize)
+        return true;
+
+    for (ULONGLONG offset = 0; offset < size;)
+    {
+        if (CmdEngine::IsBusy())
+        {
+            ++_stats._yields;
+
+            while (CmdEngine::IsBusy() && !_stop)
+                Sleep(cYieldTime);
+        }
+
+        if (_stop)
+            return false;
+
+        FILE* fp;
+        _tfopen_s(&fp, file.C_str(), _T("rb"));
+        if (fp == NULL)
+            return true;
+
+        size_t read = 0;
+        if (!fseek(fp, (long)offset, SEEK_SET))
+            read = fread(buf.data(), 1, buf.size(), fp);
+
+        fclose(fp);
+
+        if (read == 0)
+            break;
+
+        offset += read;
+        _stats._bytes += read;
+    }
+
+    return true;
+}
+
+} // namespace GTags
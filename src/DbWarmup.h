@@ -0,0 +1,116 @@
+/**
+ *  \file
+ *  \brief  Background warm-up of the databases of the documents open at startup
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include "Common.h"
+#include "Config.h"
+#include "PathTable.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  DbWarmup
+ *  \brief  Takes the first search costs in each project off the user - the
+ *          databases of the open documents are found and opened (their
+ *          configs and deltas loaded) on the UI thread a few documents at a
+ *          time. Then a thread at idle priority reads the database files
+ *          into the system file cache and loads the query cache. Both stop
+ *          while user commands run.
+ */
+class DbWarmup
+{
+public:
+    /**
+     *  \struct  Stats
+     *  \brief
+     */
+    struct Stats
+    {
+        unsigned    _files;         // Documents resolved
+        unsigned    _dbs;
+        ULONGLONG   _bytes;         // Read from the database files
+        unsigned    _yields;        // Waits for user commands
+        LONGLONG    _startTime;
+        LONGLONG    _resolvedTime;
+        LONGLONG    _doneTime;
+    };
+
+    static DbWarmup& Get()
+    {
+        static DbWarmup Instance;
+        return Instance;
+    }
+
+    void Start(const std::vector<CPath>& files);
+    bool Step(unsigned budgetMs);
+    void Stop();
+
+    bool IsRunning() const;
+    void GetStats(Stats& stats) const { stats = _stats; }
+
+private:
+    static const TCHAR* const   cDbFiles[];
+    static const size_t         cChunkSize;
+    static const ULONGLONG      cMaxFileSize;
+    static const DWORD          cYieldTime;
+
+    /**
+     *  \struct  Db
+     *  \brief  Library databases have no config
+     */
+    struct Db
+    {
+        CPath       _path;
+        PathId      _pathId;
+        DbConfigPtr _cfg;
+    };
+
+    static unsigned __stdcall threadFunc(void* data);
+
+    DbWarmup() : _next(0), _hThread(NULL), _stop(0) { memset(&_stats, 0, sizeof(_stats)); }
+    DbWarmup(const DbWarmup&);
+    ~DbWarmup() { Stop(); }
+
+    void addDb(const CPath& dbPath, const DbConfigPtr& cfg);
+    void warm();
+    bool touch(const CPath& file, std::vector<char>& buf);
+
+    std::vector<CPath>  _files;
+    size_t              _next;
+    std::vector<Db>     _dbs;
+    HANDLE              _hThread;
+    volatile LONG       _stop;
+    Stats               _stats;
+};
+
+} // namespace GTags
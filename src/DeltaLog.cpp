@@ -0,0 +1,204 @@
+/**
+ *  \file
+ *  \brief  Append-only log of the database delta - the tags of the saved files not yet in the database
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include <string.h>
+#include "DeltaLog.h"
+#include "GrepEngine.h"
+
+
+namespace GTags
+{
+
+const TCHAR     DeltaLog::cFileName[]   = _T("GDELTA");
+const unsigned  DeltaLog::cVersion      = 1;
+const char      DeltaLog::cMagic[4]     = { 'N', 'G', 'D', 'L' };
+
+
+/**
+ *  \brief
+ */
+bool DeltaLog::Append(const CPath& dbPath, const std::vector<char>& record)
+{
+    CPath logFile(dbPath);
+    logFile += cFileName;
+
+    const bool exists = logFile.FileExists();
+
+    FILE* fp;
+    _tfopen_s(&fp, logFile.C_str(), _T("ab"));
+    if (fp == NULL)
+        return false;
+
+    bool success = (exists || writeHeader(fp));
+
+    const unsigned len = (unsigned)record.size();
+
+    if (success)
+        success = (fwrite(&len, sizeof(len), 1, fp) == 1);
+
+    if (success && len)
+        success = (fwrite(record.data(), len, 1, fp) == 1);
+
+    fclose(fp);
+
+    return success;
+}
+
+
+/**
+ *  \brief  Replaces the log with the given records - the log is deleted if there are none
+ */
+bool DeltaLog::Rewrite(const CPath& dbPath, const std::vector<std::vector<char>>& records)
+{
+    if (records.empty())
+    {
+        Delete(dbPath);
+        return true;
+    }
+
+    CPath logFile(dbPath);
+    logFile += cFileName;
+
+    FILE* fp;
+    _tfopen_s(&fp, logFile.C_str(), _T("wb"));
+    if (fp == NULL)
+        return false;
+
+    bool success = writeHeader(fp);
+
+    for (const auto& record : records)
+    {
+        const unsigned len = (unsigned)record.size();
+
+        if (success)
+            success = (fwrite(&len, sizeof(len), 1, fp) == 1);
+
+        if (success && len)
+            success = (fwrite(record.data(), len, 1, fp) == 1);
+    }
+
+    fclose(fp);
+
+    return success;
+}
+
+
+/**
+ *  \brief
+ */
+bool DeltaLog::Delete(const CPath& dbPath)
+{
+    CPath logFile(dbPath);
+    logFile += cFileName;
+
+    if (!logFile.FileExists())
+        return false;
+
+    return DeleteFile(logFile.C_str()) ? true : false;
+}
+
+
+/**
+ *  \brief
+ */
+bool DeltaLog::Open(const CPath& dbPath)
+{
+    Close();
+
+    CPath logFile(dbPath);
+    logFile += cFileName;
+
+    size_t size;
+    const char* buf = GrepEngine::MapFile(logFile, size, false);
+    if (buf == NULL)
+        return false;
+
+    const Header* header = reinterpret_cast<const Header*>(buf);
+
+    if (size < sizeof(Header) || memcmp(header->_magic, cMagic, sizeof(cMagic)) || header->_version != cVersion)
+    {
+        UnmapViewOfFile(buf);
+        return false;
+    }
+
+    _buf    = buf;
+    _size   = size;
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+void DeltaLog::Close()
+{
+    if (_buf)
+        UnmapViewOfFile(_buf);
+
+    _buf    = NULL;
+    _size   = 0;
+}
+
+
+/**
+ *  \brief
+ */
+bool DeltaLog::Next(size_t& pos, const char*& record, unsigned& len) const
+{
+    if (pos < sizeof(Header))
+        pos = sizeof(Header);
+
+    if (_buf == NULL || pos + sizeof(unsigned) > _size)
+        return false;
+
+    memcpy(&len, _buf + pos, sizeof(unsigned));
+    pos += sizeof(unsigned);
+
+    if (len > _size - pos)
+        return false;
+
+    record = _buf + pos;
+    pos += len;
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+bool DeltaLog::writeHeader(FILE* fp)
+{
+    Header header;
+    memcpy(header._magic, cMagic, sizeof(cMagic));
+    header._version = cVersion;
+
+    return (fwrite(&header, sizeof(header), 1, fp) == 1);
+}
+
+} // namespace GTags
@@ -0,0 +1,85 @@
+/**
+ *  \file
+ *  \brief  Append-only log of the database delta - the tags of the saved files not yet in the database
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include "Common.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  DeltaLog
+ *  \brief  File in the database folder the delta records are appended to.
+ *          The log is memory-mapped and replayed when the database is
+ *          opened - later records for a file replace the earlier ones. A
+ *          record cut by a crash ends the log.
+ */
+class DeltaLog
+{
+public:
+    static const TCHAR cFileName[];
+
+    static bool Append(const CPath& dbPath, const std::vector<char>& record);
+    static bool Rewrite(const CPath& dbPath, const std::vector<std::vector<char>>& records);
+    static bool Delete(const CPath& dbPath);
+
+    DeltaLog() : _buf(NULL), _size(0) {}
+    ~DeltaLog() { Close(); }
+
+    bool Open(const CPath& dbPath);
+    void Close();
+
+    // pos is 0 for the first record - returns false at the end of the log
+    bool Next(size_t& pos, const char*& record, unsigned& len) const;
+
+private:
+    static const unsigned   cVersion;
+    static const char       cMagic[4];
+
+    /**
+     *  \struct  Header
+     *  \brief  Each record follows as its length and data
+     */
+    struct Header
+    {
+        char        _magic[4];
+        unsigned    _version;
+    };
+
+    static bool writeHeader(FILE* fp);
+
+    DeltaLog(const DeltaLog&);
+    const DeltaLog& operator=(const DeltaLog&);
+
+    const char* _buf;
+    size_t      _size;
+};
+
+} // namespace GTags
@@ -65,9 +65,7 @@ void DocLocation::Push()
         _locList.erase(_locList.begin());
 
     Location loc;
-    INpp& npp = INpp::Get();
-    npp.GetFilePath(loc._filePath);
-    loc._posInFile = npp.GetPos();
+    getLocation(loc);
 
     if (_locList.empty() || !(loc == _locList.back()))
         _locList.push_back(loc);
@@ -85,9 +83,12 @@ void DocLocation::Back()
     {
         Location& loc = _locList.at(_backLocIdx--);
 
-        if (loc._filePath.FileExists())
+        CPath filePath;
+        GTags::PathTable::Get().GetPath(loc._file, filePath);
+
+        if (filePath.FileExists())
         {
-            swapView(loc);
+            swapView(loc, filePath);
             break;
         }
     }
@@ -103,9 +104,12 @@ void DocLocation::Forward()
     {
         Location& loc = _locList.at(++_backLocIdx);
 
-        if (loc._filePath.FileExists())
+        CPath filePath;
+        GTags::PathTable::Get().GetPath(loc._file, filePath);
+
+        if (filePath.FileExists())
         {
-            swapView(loc);
+            swapView(loc, filePath);
             break;
         }
     }
@@ -115,15 +119,28 @@ void DocLocation::Forward()
 /**
  *  \brief
  */
-void DocLocation::swapView(Location& loc)
+void DocLocation::getLocation(Location& loc)
 {
-    Location newLoc;
     INpp& npp = INpp::Get();
 
-    npp.GetFilePath(newLoc._filePath);
-    newLoc._posInFile = npp.GetPos();
+    CPath filePath;
+    npp.GetFilePath(filePath);
+
+    loc._file = GTags::PathTable::Get().Intern(filePath);
+    loc._posInFile = npp.GetPos();
+}
+
+
+/**
+ *  \brief
+ */
+void DocLocation::swapView(Location& loc, const CPath& filePath)
+{
+    Location newLoc;
+    getLocation(newLoc);
 
-    npp.OpenFile(loc._filePath.C_str());
+    INpp& npp = INpp::Get();
+    npp.OpenFile(filePath.C_str());
     npp.SetView(loc._posInFile);
 
     loc = newLoc;
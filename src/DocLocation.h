@@ -28,6 +28,7 @@
 #include <tchar.h>
 #include <vector>
 #include "Common.h"
+#include "PathTable.h"
 
 
 /**
@@ -56,19 +57,12 @@ private:
      */
     struct Location
     {
-        CPath   _filePath;
-        long    _posInFile;
-
-        inline const Location& operator=(const Location& loc)
-        {
-            _posInFile = loc._posInFile;
-            _filePath = loc._filePath;
-            return loc;
-        }
+        GTags::PathId   _file;
+        long            _posInFile;
 
         inline bool operator==(const Location& loc) const
         {
-            return ((_posInFile == loc._posInFile) && (_filePath == loc._filePath));
+            return ((_posInFile == loc._posInFile) && (_file == loc._file));
         }
     };
 
@@ -78,7 +72,9 @@ private:
     DocLocation(const DocLocation&);
     ~DocLocation() {}
 
-    void swapView(Location& loc);
+    static void getLocation(Location& loc);
+
+    void swapView(Location& loc, const CPath& filePath);
 
     unsigned                _maxDepth;
     int                     _backLocIdx;
@@ -32,15 +32,24 @@
 #include "DbManager.h"
 #include "Cmd.h"
 #include "CmdEngine.h"
+#include "CmdTrace.h"
 #include "DocLocation.h"
 #include "SearchWin.h"
 #include "ActivityWin.h"
 #include "AutoCompleteWin.h"
 #include "ResultWin.h"
+#include "TabParser.h"
 #include "SettingsWin.h"
 #include "AboutWin.h"
 #include "GTags.h"
 #include "LineParser.h"
+#include "SymbolResolver.h"
+#include "OverlayIndex.h"
+#include "ResultCache.h"
+#include "QueryCache.h"
+#include "DbWarmup.h"
+#include "Startup.h"
+#include "TabStore.h"
 
 
 namespace
@@ -60,16 +69,51 @@ const TCHAR cSearchSrc[]        = _T("Search in Source Files");
 const TCHAR cSearchOther[]      = _T("Search in Other Files");
 const TCHAR cVersion[]          = _T("About");
 
+const TCHAR cTimingsFileName[]  = PLUGIN_NAME _T("Timings.txt");
+const TCHAR cTraceFileName[]    = PLUGIN_NAME _T("Trace.json");
+
+const UINT  cOverlayDelay       = 500; // ms of no edits before the buffer is re-tagged
+const UINT  cPrefetchDelay      = 300; // ms the caret rests on a word before its definition is prefetched
+const UINT  cDeltaCheckPeriod   = 30000;    // ms between the checks for old database deltas
+const UINT  cDeltaMaxAge        = 120000;   // ms a saved file may stay in the database delta
+const UINT  cWarmupPeriod       = 200;      // ms between the startup warm-up steps on the UI thread
+const UINT  cWarmupStepBudget   = 10;       // ms a warm-up step may take
+const UINT  cHighlightDelay     = 200;      // ms of no scrolling or edits before the visible definitions are marked
+
+const int       cHighlightIndicator = INDIC_CONTAINER + 4;  // Not used by Notepad++
+const COLORREF  cHighlightColor     = RGB(0, 128, 192);
+
 
 std::unique_ptr<CPath>  ChangedFile;
 bool                    DeInitCOM = false;
 
+UINT_PTR                OverlayTimer = 0;
+LRESULT                 OverlayBufferId = 0;
+UINT_PTR                PrefetchTimer = 0;
+UINT_PTR                DeltaTimer = 0;
+UINT_PTR                WarmupTimer = 0;
+UINT_PTR                HighlightTimer = 0;
+
 
 /**
- *  \brief
+ *  \brief  Loaded on ready - the databases configs default to the settings
  */
-bool checkForGTagsBinaries(CPath& dllPath)
+bool loadSettings()
 {
+    if (!GTagsSettings.Load())
+        GTagsSettings.Save();
+
+    return true;
+}
+
+
+/**
+ *  \brief  Deferred init
+ */
+bool checkForGTagsBinaries()
+{
+    CPath dllPath(DllPath);
+
     dllPath.StripFilename();
     dllPath += cPluginName;
     dllPath += _T("\\global.exe");
@@ -90,10 +134,34 @@ bool checkForGTagsBinaries(CPath& dllPath)
         msg += dllPath;
         msg += _T("\"\n");
         msg += cPluginName;
-        msg += _T(" plugin will not be loaded!");
+        msg += _T(" plugin will not be operational!");
+
+        MessageBox(INpp::Get().GetHandle(), msg.C_str(), cPluginName, MB_OK | MB_ICONERROR);
+
+        return false;
+    }
 
-        MessageBox(NULL, msg.C_str(), cPluginName, MB_OK | MB_ICONERROR);
+    return true;
+}
+
+
+/**
+ *  \brief  Deferred init - the results window receives the command completions
+ */
+bool registerResultWin()
+{
+    INpp& npp = INpp::Get();
+    char font[32];
 
+    npp.GetFontName(STYLE_DEFAULT, font);
+    UIFontName = font;
+    UIFontSize = (unsigned)npp.GetFontSize(STYLE_DEFAULT);
+
+    MainWndH = ResultWin::Register();
+    if (MainWndH == NULL)
+    {
+        MessageBox(npp.GetHandle(), _T("Results Window init failed, plugin will not be operational"), cPluginName,
+                MB_OK | MB_ICONERROR);
         return false;
     }
 
@@ -101,6 +169,48 @@ bool checkForGTagsBinaries(CPath& dllPath)
 }
 
 
+/**
+ *  \brief  Deferred init - the folder browse dialog needs COM
+ */
+bool initCOM()
+{
+    const HRESULT coInitRes = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+    DeInitCOM = (coInitRes == S_OK || coInitRes == S_FALSE) ? true : false;
+
+    return true;
+}
+
+
+/**
+ *  \brief  The settings are loaded on ready - before that on first use
+ */
+inline bool settingsReady()
+{
+    return Startup::Get().Init(Startup::SETTINGS, loadSettings);
+}
+
+
+/**
+ *  \brief  Inits what running the commands needs on first use
+ */
+bool cmdEngineReady()
+{
+    Startup& startup = Startup::Get();
+
+    return (settingsReady() && startup.Init(Startup::BINARIES, checkForGTagsBinaries) &&
+            startup.Init(Startup::RESULT_WIN, registerResultWin));
+}
+
+
+/**
+ *  \brief  Inits what the menu commands need on first use
+ */
+bool menuCmdReady()
+{
+    return (cmdEngineReady() && Startup::Get().Init(Startup::COM, initCOM));
+}
+
+
 enum WordSelection_t
 {
     DONT_SELECT,
@@ -360,6 +470,11 @@ void findCB(const CmdPtr_t& cmd)
  */
 void dbWriteCB(const CmdPtr_t& cmd)
 {
+    // The files saved before the database was created are in it
+    if (cmd->Id() == CREATE_DATABASE)
+        OverlayIndex::Get().DropDelta(cmd->Db()->GetPath(), cmd->Db()->GetPathId(),
+                (cmd->Status() == OK) ? cmd->Timing().Get(CmdTiming::QUEUED) : 0);
+
     if (cmd->Status() != OK)
         DbManager::Get().UnregisterDb(cmd->Db());
     else
@@ -385,7 +500,7 @@ void aboutCB(const CmdPtr_t& cmd)
     if (cmd->Status() != OK)
     {
         const CTextA txt("\nVERSION READ FAILED\n\n");
-        cmd->AppendToResult(txt.Vector());
+        cmd->AppendToResult(txt);
     }
 
 	const CText msg = cmd->Result();
@@ -402,11 +517,11 @@ void halfAboutCB(const CmdPtr_t& cmd)
     if (cmd->Status() != OK)
     {
         const CTextA txt("VERSION READ FAILED\n");
-        cmd->SetResult(txt.Vector());
+        cmd->SetResult(txt);
     }
 
     const CTextA txt("\nCurrent Ctags parser version:\n\n");
-    cmd->AppendToResult(txt.Vector());
+    cmd->AppendToResult(txt);
 
     cmd->Id(CTAGS_VERSION);
     CmdEngine::Run(cmd, aboutCB);
@@ -418,6 +533,9 @@ void halfAboutCB(const CmdPtr_t& cmd)
  */
 void AutoComplete()
 {
+    if (!menuCmdReady())
+        return;
+
     CText tag = getSelection(NULL, true, PARTIAL_SELECT, false);
     if (tag.IsEmpty())
         return;
@@ -437,6 +555,9 @@ void AutoComplete()
  */
 void AutoCompleteFile()
 {
+    if (!menuCmdReady())
+        return;
+
     CText tag = getSelection(NULL, true, PARTIAL_SELECT, false);
     if (tag.IsEmpty())
         return;
@@ -459,6 +580,9 @@ void AutoCompleteFile()
  */
 void FindFile()
 {
+    if (!menuCmdReady())
+        return;
+
     SearchWin::Close();
 
     DbHandle db;
@@ -472,7 +596,7 @@ void FindFile()
     if (!db)
         return;
 
-    ParserPtr_t parser(new ResultWin::TabParser);
+    ParserPtr_t parser(new TabParser);
     CmdPtr_t cmd(new Cmd(FIND_FILE, cFindFile, db, parser, NULL, GTagsSettings._ic));
 
     CText tag = getSelection(rwHSci, false, DONT_SELECT);
@@ -485,7 +609,7 @@ void FindFile()
     }
     else
     {
-        cmd->Tag(tag);
+        cmd->Tag(std::move(tag));
         CmdEngine::Run(cmd, showResultCB);
     }
 }
@@ -496,6 +620,9 @@ void FindFile()
  */
 void FindDefinition()
 {
+    if (!menuCmdReady())
+        return;
+
     SearchWin::Close();
 
     DbHandle db;
@@ -509,7 +636,7 @@ void FindDefinition()
     if (!db)
         return;
 
-    ParserPtr_t parser(new ResultWin::TabParser);
+    ParserPtr_t parser(new TabParser);
     CmdPtr_t cmd(new Cmd(FIND_DEFINITION, cFindDefinition, db, parser, NULL, GTagsSettings._ic));
 
     CText tag = getSelection(rwHSci);
@@ -519,7 +646,7 @@ void FindDefinition()
     }
     else
     {
-        cmd->Tag(tag);
+        cmd->Tag(std::move(tag));
         CmdEngine::Run(cmd, findCB);
     }
 }
@@ -530,6 +657,9 @@ void FindDefinition()
  */
 void FindReference()
 {
+    if (!menuCmdReady())
+        return;
+
     SearchWin::Close();
 
     DbHandle db;
@@ -543,7 +673,7 @@ void FindReference()
     if (!db)
         return;
 
-    if (db->GetConfig()._parserIdx == DbConfig::CTAGS_PARSER)
+    if (db->GetConfig()->_parserIdx == DbConfig::CTAGS_PARSER)
     {
         MessageBox(INpp::Get().GetHandle(), _T("Ctags parser doesn't support reference search"), cPluginName,
                 MB_OK | MB_ICONINFORMATION);
@@ -553,7 +683,7 @@ void FindReference()
         return;
     }
 
-    ParserPtr_t parser(new ResultWin::TabParser);
+    ParserPtr_t parser(new TabParser);
     CmdPtr_t cmd(new Cmd(FIND_REFERENCE, cFindReference, db, parser, NULL, GTagsSettings._ic));
 
     CText tag = getSelection(rwHSci);
@@ -563,7 +693,7 @@ void FindReference()
     }
     else
     {
-        cmd->Tag(tag);
+        cmd->Tag(std::move(tag));
         CmdEngine::Run(cmd, findCB);
     }
 }
@@ -574,6 +704,9 @@ void FindReference()
  */
 void SearchSrc()
 {
+    if (!menuCmdReady())
+        return;
+
     SearchWin::Close();
 
     DbHandle db;
@@ -587,7 +720,7 @@ void SearchSrc()
     if (!db)
         return;
 
-    ParserPtr_t parser(new ResultWin::TabParser);
+    ParserPtr_t parser(new TabParser);
     CmdPtr_t cmd(new Cmd(GREP, cSearchSrc, db, parser, NULL, GTagsSettings._ic));
 
     CText tag = getSelection(rwHSci);
@@ -597,7 +730,7 @@ void SearchSrc()
     }
     else
     {
-        cmd->Tag(tag);
+        cmd->Tag(std::move(tag));
         CmdEngine::Run(cmd, showResultCB);
     }
 }
@@ -608,6 +741,9 @@ void SearchSrc()
  */
 void SearchOther()
 {
+    if (!menuCmdReady())
+        return;
+
     SearchWin::Close();
 
     DbHandle db;
@@ -621,7 +757,7 @@ void SearchOther()
     if (!db)
         return;
 
-    ParserPtr_t parser(new ResultWin::TabParser);
+    ParserPtr_t parser(new TabParser);
     CmdPtr_t cmd(new Cmd(GREP_TEXT, cSearchOther, db, parser, NULL, GTagsSettings._ic));
 
     CText tag = getSelection(rwHSci);
@@ -631,7 +767,7 @@ void SearchOther()
     }
     else
     {
-        cmd->Tag(tag);
+        cmd->Tag(std::move(tag));
         CmdEngine::Run(cmd, showResultCB);
     }
 }
@@ -642,6 +778,9 @@ void SearchOther()
  */
 void IgnoreCase()
 {
+    if (!settingsReady())
+        return;
+
     GTagsSettings._ic = !GTagsSettings._ic;
 
     INpp::Get().SetPluginMenuFlag(Menu[8]._cmdID, GTagsSettings._ic);
@@ -673,6 +812,9 @@ void GoForward()
  */
 void CreateDatabase()
 {
+    if (!menuCmdReady())
+        return;
+
     SearchWin::Close();
 
     CPath currentFile;
@@ -722,6 +864,9 @@ void CreateDatabase()
  */
 void DeleteDatabase()
 {
+    if (!menuCmdReady())
+        return;
+
     SearchWin::Close();
 
     DbHandle db = getDatabase(true);
@@ -751,6 +896,9 @@ void DeleteDatabase()
  */
 void ToggleResultWinFocus()
 {
+    if (!menuCmdReady())
+        return;
+
     ResultWin::Show();
 }
 
@@ -760,6 +908,9 @@ void ToggleResultWinFocus()
  */
 void SettingsCfg()
 {
+    if (!menuCmdReady())
+        return;
+
     SearchWin::Close();
 
     CPath currentFile;
@@ -786,22 +937,234 @@ void SettingsCfg()
 }
 
 
+/**
+ *  \brief
+ */
+void TimingStats()
+{
+    INpp& npp = INpp::Get();
+
+    CPath timingsFile;
+    npp.GetPluginsConfDir(timingsFile);
+    timingsFile += cTimingsFileName;
+
+    if (!CmdTrace::Get().Dump(timingsFile) || !Prefetcher::Get().AppendStats(timingsFile) ||
+            !TabStore::Get().AppendStats(timingsFile) || !Startup::Get().AppendStats(timingsFile))
+    {
+        CText msg(_T("Failed writing command timings to\n\""));
+        msg += timingsFile;
+        msg += _T("\"");
+        MessageBox(npp.GetHandle(), msg.C_str(), cPluginName, MB_OK | MB_ICONERROR);
+        return;
+    }
+
+    npp.OpenFile(timingsFile.C_str());
+}
+
+
+/**
+ *  \brief
+ */
+void ExportTrace()
+{
+    INpp& npp = INpp::Get();
+
+    CPath traceFile;
+    npp.GetPluginsConfDir(traceFile);
+    traceFile += cTraceFileName;
+
+    CText msg;
+
+    if (CmdTrace::Get().ExportChromeTrace(traceFile))
+    {
+        msg = _T("Command timings exported in Chrome trace format to\n\"");
+        msg += traceFile;
+        msg += _T("\"");
+        MessageBox(npp.GetHandle(), msg.C_str(), cPluginName, MB_OK | MB_ICONINFORMATION);
+    }
+    else
+    {
+        msg = _T("Failed writing command timings to\n\"");
+        msg += traceFile;
+        msg += _T("\"");
+        MessageBox(npp.GetHandle(), msg.C_str(), cPluginName, MB_OK | MB_ICONERROR);
+    }
+}
+
+
 /**
  *  \brief
  */
 void About()
 {
+    if (!menuCmdReady())
+        return;
+
     CmdPtr_t cmd(new Cmd(VERSION, cVersion));
     CmdEngine::Run(cmd, halfAboutCB);
 }
 
+
+/**
+ *  \brief  Re-tags the edited buffer once the user pauses typing
+ */
+void CALLBACK overlayTimerProc(HWND, UINT, UINT_PTR, DWORD)
+{
+    KillTimer(NULL, OverlayTimer);
+    OverlayTimer = 0;
+
+    INpp& npp = INpp::Get();
+
+    if (npp.GetCurrentBufferId() != OverlayBufferId)
+        return;
+
+    CPath file;
+    npp.GetFilePathFromBufID(OverlayBufferId, file);
+
+    // Saved buffer - the database update will replace the overlay
+    if (!npp.IsModified() && !OverlayIndex::Get().Contains(file))
+        return;
+
+    bool success;
+    DbHandle db = DbManager::Get().GetDb(file, false, &success);
+
+    // Not in a database - the plugin stays uninitialized
+    if (!db)
+        return;
+
+    // Database busy - retry later
+    if (!success)
+    {
+        OverlayTimer = SetTimer(NULL, 0, cOverlayDelay, overlayTimerProc);
+        return;
+    }
+
+    if (!cmdEngineReady())
+    {
+        DbManager::Get().PutDb(db);
+        return;
+    }
+
+    CTextA text;
+    npp.GetText(text);
+
+    OverlayIndex::Get().Update(db, file, text);
+}
+
+
+/**
+ *  \brief  Folds the old database deltas into the databases
+ */
+void CALLBACK deltaTimerProc(HWND, UINT, UINT_PTR, DWORD)
+{
+    // Deltas left from the last session wait for the first command
+    if (!Startup::Get().IsInit(Startup::RESULT_WIN))
+        return;
+
+    OverlayIndex::Get().Compact(cDeltaMaxAge);
+}
+
+
+/**
+ *  \brief  Opens the databases of the open documents a few at a time - the
+ *          step is skipped while a user command runs
+ */
+void CALLBACK warmupTimerProc(HWND, UINT, UINT_PTR, DWORD)
+{
+    if (CmdEngine::IsBusy())
+        return;
+
+    if (!settingsReady() || !DbWarmup::Get().Step(cWarmupStepBudget))
+    {
+        KillTimer(NULL, WarmupTimer);
+        WarmupTimer = 0;
+    }
+}
+
+
+/**
+ *  \brief  Prefetches the definition of the word the caret rests on
+ */
+void CALLBACK prefetchTimerProc(HWND, UINT, UINT_PTR, DWORD)
+{
+    KillTimer(NULL, PrefetchTimer);
+    PrefetchTimer = 0;
+
+    INpp& npp = INpp::Get();
+
+    if (npp.IsSelectionVertical())
+        return;
+
+    CTextA wordA;
+    npp.PeekWord(wordA);
+    if (wordA.IsEmpty())
+        return;
+
+    CPath currentFile;
+    npp.GetFilePath(currentFile);
+
+    bool success;
+    DbHandle db = DbManager::Get().GetDb(currentFile, false, &success);
+
+    if (!db && GTagsSettings._useDefDb && !GTagsSettings._defDbPath.IsEmpty())
+        db = DbManager::Get().GetDbAt(GTagsSettings._defDbPath, false, &success);
+
+    if (!db || !success)
+        return;
+
+    Prefetcher::Get().Prefetch(db, CText(wordA.C_str()), GTagsSettings._ic);
+}
+
+
+void CALLBACK highlightTimerProc(HWND, UINT, UINT_PTR, DWORD);
+
+
+/**
+ *  \brief  The database symbol table is loaded - mark the visible definitions with it
+ */
+void highlightReadyCB()
+{
+    if (!HighlightTimer)
+        HighlightTimer = SetTimer(NULL, 0, cHighlightDelay, highlightTimerProc);
+}
+
+
+/**
+ *  \brief  Marks the database definitions in the visible text - all its
+ *          identifiers are resolved in one batch against the symbol table
+ */
+void CALLBACK highlightTimerProc(HWND, UINT, UINT_PTR, DWORD)
+{
+    KillTimer(NULL, HighlightTimer);
+    HighlightTimer = 0;
+
+    if (!cmdEngineReady())
+        return;
+
+    std::vector<SymbolResolver::Symbol> symbols;
+    if (!SymbolResolver::Get().ResolveVisible(symbols, highlightReadyCB))
+        return;
+
+    INpp& npp = INpp::Get();
+
+    long startPos, endPos;
+    npp.GetVisibleRange(startPos, endPos);
+
+    npp.SetIndicatorStyle(cHighlightIndicator, INDIC_PLAIN, cHighlightColor);
+    npp.ClearIndicator(cHighlightIndicator, startPos, endPos);
+
+    for (const auto& symbol : symbols)
+        if (symbol._kind == SymbolTable::DEFINITION)
+            npp.FillIndicator(cHighlightIndicator, symbol._pos, symbol._len);
+}
+
 } // anonymous namespace
 
 
 namespace GTags
 {
 
-FuncItem Menu[21] = {
+FuncItem Menu[23] = {
     /* 0 */  FuncItem(cAutoCompl, AutoComplete),
     /* 1 */  FuncItem(cAutoComplFile, AutoCompleteFile),
     /* 2 */  FuncItem(cFindFile, FindFile),
@@ -821,8 +1184,10 @@ FuncItem Menu[21] = {
     /* 16 */ FuncItem(_T("Toggle Results Window Focus"), ToggleResultWinFocus),
     /* 17 */ FuncItem(),
     /* 18 */ FuncItem(_T("Settings..."), SettingsCfg),
-    /* 19 */ FuncItem(),
-    /* 20 */ FuncItem(_T("About..."), About)
+    /* 19 */ FuncItem(_T("Command Timings"), TimingStats),
+    /* 20 */ FuncItem(_T("Export Command Timings Trace"), ExportTrace),
+    /* 21 */ FuncItem(),
+    /* 22 */ FuncItem(_T("About..."), About)
 };
 
 HINSTANCE HMod = NULL;
@@ -841,17 +1206,17 @@ Settings GTagsSettings;
  */
 BOOL PluginLoad(HINSTANCE hMod)
 {
+    Startup::Get().Begin(Startup::LOAD);
+
     CPath moduleFileName(MAX_PATH);
     GetModuleFileName((HMODULE)hMod, moduleFileName.C_str(), MAX_PATH);
     moduleFileName.AutoFit();
 
     DllPath = moduleFileName;
-
-    if (!checkForGTagsBinaries(moduleFileName))
-        return FALSE;
-
     HMod = hMod;
 
+    Startup::Get().End(Startup::LOAD);
+
     return TRUE;
 }
 
@@ -861,31 +1226,9 @@ BOOL PluginLoad(HINSTANCE hMod)
  */
 void PluginInit()
 {
-    INpp& npp = INpp::Get();
-    char font[32];
-
-    npp.GetFontName(STYLE_DEFAULT, font);
-    UIFontName = font;
-    UIFontSize = (unsigned)npp.GetFontSize(STYLE_DEFAULT);
-
-    const HRESULT coInitRes = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
-    DeInitCOM = (coInitRes == S_OK || coInitRes == S_FALSE) ? true : false;
-
-    ActivityWin::Register();
-    SearchWin::Register();
-    AutoCompleteWin::Register();
-
-    MainWndH = ResultWin::Register();
-    if (MainWndH == NULL)
-    {
-        MessageBox(npp.GetHandle(), _T("Results Window init failed, plugin will not be operational"), cPluginName,
-                MB_OK | MB_ICONERROR);
-    }
-    else
-    {
-        if (!GTagsSettings.Load())
-            GTagsSettings.Save();
-    }
+    // The settings, the GTags binaries check, the windows and COM are initialized on first use
+    Startup::Get().Begin(Startup::INIT);
+    Startup::Get().End(Startup::INIT);
 }
 
 
@@ -894,9 +1237,25 @@ void PluginInit()
  */
 void PluginDeInit()
 {
+    if (DeltaTimer)
+    {
+        KillTimer(NULL, DeltaTimer);
+        DeltaTimer = 0;
+    }
+
+    if (WarmupTimer)
+    {
+        KillTimer(NULL, WarmupTimer);
+        WarmupTimer = 0;
+    }
+
+    DbWarmup::Get().Stop();
+
     if (GTagsSettings._dirty)
         GTagsSettings.Save();
 
+    QueryCache::Get().Compact();
+
     ActivityWin::Unregister();
     SearchWin::Unregister();
     AutoCompleteWin::Unregister();
@@ -917,7 +1276,24 @@ void PluginDeInit()
  */
 void OnNppReady()
 {
-    INpp::Get().SetPluginMenuFlag(Menu[8]._cmdID, GTagsSettings._ic);
+    Startup::Get().Begin(Startup::READY);
+
+    // The menu shows the saved Ignore Case option from the start
+    if (settingsReady())
+        INpp::Get().SetPluginMenuFlag(Menu[8]._cmdID, GTagsSettings._ic);
+
+    DeltaTimer = SetTimer(NULL, 0, cDeltaCheckPeriod, deltaTimerProc);
+
+    std::vector<CPath> files;
+    INpp::Get().GetOpenFiles(files);
+
+    if (!files.empty())
+    {
+        DbWarmup::Get().Start(files);
+        WarmupTimer = SetTimer(NULL, 0, cWarmupPeriod, warmupTimerProc);
+    }
+
+    Startup::Get().End(Startup::READY);
 }
 
 
@@ -944,8 +1320,14 @@ void OnFileChangeCancel()
  */
 void OnFileChange(const CPath& file)
 {
+    if (!settingsReady())
+        return;
+
     CPath path(file);
 
+    // Enclosing databases to update, innermost first
+    std::vector<DbHandle> dbs;
+
     while (path.DirUp())
     {
         bool success;
@@ -953,10 +1335,10 @@ void OnFileChange(const CPath& file)
         if (!db)
             break;
 
-        if (db->GetConfig()._autoUpdate)
+        if (db->GetConfig()->_autoUpdate)
         {
             if (success)
-                db->Update(file);
+                dbs.push_back(db);
             else
                 db->ScheduleUpdate(file);
         }
@@ -967,6 +1349,26 @@ void OnFileChange(const CPath& file)
 
         path = db->GetPath();
     }
+
+    if (dbs.empty())
+        return;
+
+    if (!cmdEngineReady())
+    {
+        for (const auto& db : dbs)
+            DbManager::Get().PutDb(db);
+        return;
+    }
+
+    // The saved file is tagged once into the databases delta - the databases are updated with it later
+    if (!OverlayIndex::Get().AddDelta(dbs, file))
+    {
+        for (const auto& db : dbs)
+        {
+            db->ScheduleUpdate(file);
+            DbManager::Get().PutDb(db);
+        }
+    }
 }
 
 
@@ -1001,4 +1403,61 @@ void OnFileDelete(const CPath& file)
     }
 }
 
+
+/**
+ *  \brief  Called on each text change in the current buffer
+ */
+void OnBufferModified()
+{
+    OverlayBufferId = INpp::Get().GetCurrentBufferId();
+
+    SymbolResolver::Get().BufferModified(OverlayBufferId);
+
+    if (OverlayTimer)
+        KillTimer(NULL, OverlayTimer);
+    OverlayTimer = SetTimer(NULL, 0, cOverlayDelay, overlayTimerProc);
+}
+
+
+/**
+ *  \brief  Called when the caret or the selection changes
+ */
+void OnCaretMove()
+{
+    Prefetcher::Get().Cancel();
+
+    // Prefetch does not bring the plugin init forward
+    if (!Startup::Get().IsInit(Startup::RESULT_WIN) || !GTagsSettings._prefetch)
+        return;
+
+    if (PrefetchTimer)
+        KillTimer(NULL, PrefetchTimer);
+    PrefetchTimer = SetTimer(NULL, 0, cPrefetchDelay, prefetchTimerProc);
+}
+
+
+/**
+ *  \brief  Called when the visible text changes - scrolled or edited
+ */
+void OnViewChange()
+{
+    // Not before the settings are loaded on first use
+    if (!Startup::Get().IsInit(Startup::SETTINGS) || !GTagsSettings._highlight)
+        return;
+
+    if (HighlightTimer)
+        KillTimer(NULL, HighlightTimer);
+    HighlightTimer = SetTimer(NULL, 0, cHighlightDelay, highlightTimerProc);
+}
+
+
+/**
+ *  \brief
+ */
+void OnBufferClose(LRESULT bufferId, const CPath& file)
+{
+    SymbolResolver::Get().BufferClosed(bufferId);
+    OverlayIndex::Get().Remove(file);
+}
+
 } // namespace GTags
@@ -47,10 +47,11 @@ enum PluginWinMessages_t
 {
     WM_RUN_CMD_CALLBACK = WM_USER,
     WM_OPEN_ACTIVITY_WIN,
+    WM_UPDATE_ACTIVITY_WIN,
     WM_CLOSE_ACTIVITY_WIN
 };
 
-extern FuncItem     Menu[21];
+extern FuncItem     Menu[23];
 
 extern HINSTANCE    HMod;
 extern CPath        DllPath;
@@ -75,5 +76,9 @@ void OnFileChangeCancel();
 void OnFileChange(const CPath& file);
 void OnFileRename(const CPath& file);
 void OnFileDelete(const CPath& file);
+void OnBufferModified();
+void OnCaretMove();
+void OnViewChange();
+void OnBufferClose(LRESULT bufferId, const CPath& file);
 
 } // namespace GTags
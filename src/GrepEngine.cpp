@@ -0,0 +1,529 @@
+/**
+ *  \file
+ *  \brief  In-process project files search (global -g replacement)
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <process.h>
+#include <string.h>
+#include "GrepEngine.h"
+#include "GrepIndex.h"
+#include "CmdTrace.h"
+#include "TabParser.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace
+{
+
+/**
+ *  \brief
+ */
+inline char foldCase(char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch;
+}
+
+
+#ifdef USE_SSE2
+/**
+ *  \brief
+ */
+inline unsigned lowestBit(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return idx;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+// Larger files are not mapped - they would exhaust the 32-bit address space
+const size_t    GrepEngine::cMaxFileSize        = 256 * 1024 * 1024;
+
+// Files with NUL byte in the beginning are considered binary and skipped
+const unsigned  GrepEngine::cBinaryCheckSize    = 4096;
+
+
+/**
+ *  \brief  maxThreads 0 means one worker per processor
+ */
+GrepEngine::GrepEngine(const char* pattern, bool ignoreCase, bool regExp, unsigned maxThreads) :
+    _pattern(pattern), _ignoreCase(ignoreCase), _regExp(regExp), _maxThreads(maxThreads), _valid(true),
+    _job(NULL), _index(NULL), _cancel(0), _firstHitTime(0), _fileListPipe(NULL), _hThread(NULL)
+{
+    if (!_maxThreads)
+    {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        _maxThreads = si.dwNumberOfProcessors ? si.dwNumberOfProcessors : 1;
+    }
+
+    if (_regExp)
+    {
+        std::regex::flag_type flags = std::regex::extended | std::regex::optimize;
+        if (_ignoreCase)
+            flags |= std::regex::icase;
+
+        try
+        {
+            _re.reset(new std::regex(_pattern, flags));
+        }
+        catch (const std::regex_error&)
+        {
+            _valid = false;
+        }
+    }
+    else if (_ignoreCase)
+    {
+        for (auto& ch : _pattern)
+            ch = foldCase(ch);
+    }
+
+    if (_pattern.empty())
+        _valid = false;
+}
+
+
+/**
+ *  \brief
+ */
+GrepEngine::~GrepEngine()
+{
+    if (_hThread)
+    {
+        Cancel();
+        WaitForSingleObject(_hThread, INFINITE);
+        CloseHandle(_hThread);
+    }
+}
+
+
+/**
+ *  \brief  Maps the file read-only. Returns NULL for empty, too big and (if
+ *          textOnly) binary files. The view must be released with UnmapViewOfFile.
+ */
+const char* GrepEngine::MapFile(const CPath& path, size_t& size, bool textOnly)
+{
+    HANDLE hFile = CreateFile(path.C_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0 || fileSize.QuadPart > (LONGLONG)cMaxFileSize)
+    {
+        CloseHandle(hFile);
+        return NULL;
+    }
+
+    HANDLE hMap = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(hFile);
+    if (hMap == NULL)
+        return NULL;
+
+    const char* buf = static_cast<const char*>(MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(hMap);
+    if (buf == NULL)
+        return NULL;
+
+    size = (size_t)fileSize.QuadPart;
+
+    if (textOnly && memchr(buf, 0, (size < cBinaryCheckSize) ? size : cBinaryCheckSize))
+    {
+        UnmapViewOfFile(buf);
+        return NULL;
+    }
+
+    return buf;
+}
+
+
+/**
+ *  \brief  Searches the files in fileList (new-line separated, relative to
+ *          root) and fills output with the matching lines in the order of the
+ *          list. Returns the number of matching lines.
+ */
+unsigned GrepEngine::Search(const CPath& root, const char* fileList, OutputBuffer& output,
+        const DbConfig* filterCfg)
+{
+    output.Clear();
+
+    if (!_valid || !fileList)
+        return 0;
+
+    Job job;
+    job._root = root;
+    job._next = 0;
+    job._maxSize = output.MaxSize();
+    job._outSize = 0;
+    job._full = 0;
+
+    for (const char* pSrc = fileList;;)
+    {
+        while (*pSrc == '\n' || *pSrc == '\r')
+            ++pSrc;
+        if (*pSrc == 0)
+            break;
+
+        const char* pEol = pSrc;
+        while (*pEol != '\n' && *pEol != '\r' && *pEol != 0)
+            ++pEol;
+
+        if ((!filterCfg || !TabParser::FilterEntry(*filterCfg, pSrc, pEol - pSrc)) &&
+                (!_index || _index->IsCandidate(pSrc, pEol - pSrc)))
+        {
+            job._files.push_back(pSrc);
+            job._fileLens.push_back(pEol - pSrc);
+        }
+
+        pSrc = pEol;
+    }
+
+    job._results.resize(job._files.size());
+
+    _job = &job;
+
+    unsigned threadsNum = _maxThreads;
+    if (threadsNum > job._files.size())
+        threadsNum = job._files.size();
+
+    // The calling thread is one of the workers
+    std::vector<HANDLE> threads;
+    for (unsigned i = 1; i < threadsNum; ++i)
+    {
+        HANDLE hThread = (HANDLE)_beginthreadex(NULL, 0, workerFunc, this, 0, NULL);
+        if (hThread)
+            threads.push_back(hThread);
+    }
+
+    worker();
+
+    for (auto hThread : threads)
+    {
+        WaitForSingleObject(hThread, INFINITE);
+        CloseHandle(hThread);
+    }
+
+    _job = NULL;
+
+    // Results are freed as they are appended to keep the peak memory low
+    unsigned hits = 0;
+    for (auto& result : job._results)
+    {
+        const size_t len = output.Append(result.data(), result.size());
+
+        for (size_t i = 0; i < len; ++i)
+            if (result[i] == '\n')
+                ++hits;
+
+        if (len < result.size())
+            break;
+
+        std::vector<char>().swap(result);
+    }
+
+    output.Terminate();
+
+    return hits;
+}
+
+
+/**
+ *  \brief  Starts the search in the background once the file list is read
+ *          from the pipe. GetWaitHandle() is signaled when done.
+ */
+bool GrepEngine::Start(const CPath& root, ReadPipe& fileListPipe, const DbConfigPtr& filterCfg)
+{
+    if (_hThread)
+        return false;
+
+    _root           = root;
+    _fileListPipe   = &fileListPipe;
+    _filterCfg      = filterCfg;
+
+    _hThread = (HANDLE)_beginthreadex(NULL, 0, threadFunc, this, 0, NULL);
+
+    return (_hThread != NULL);
+}
+
+
+/**
+ *  \brief
+ */
+OutputBuffer& GrepEngine::GetOutput()
+{
+    if (_hThread)
+    {
+        WaitForSingleObject(_hThread, INFINITE);
+        CloseHandle(_hThread);
+        _hThread = NULL;
+    }
+
+    return _output;
+}
+
+
+/**
+ *  \brief
+ */
+unsigned __stdcall GrepEngine::threadFunc(void* data)
+{
+    return static_cast<GrepEngine*>(data)->thread();
+}
+
+
+/**
+ *  \brief
+ */
+unsigned __stdcall GrepEngine::workerFunc(void* data)
+{
+    static_cast<GrepEngine*>(data)->worker();
+
+    return 0;
+}
+
+
+/**
+ *  \brief
+ */
+unsigned GrepEngine::thread()
+{
+    OutputBuffer& fileList = _fileListPipe->GetOutput();
+
+    if (!_cancel && !fileList.Empty())
+        Search(_root, fileList.Data(), _output, _filterCfg.get());
+
+    return 0;
+}
+
+
+/**
+ *  \brief  Takes the next file from the job until all are searched
+ */
+void GrepEngine::worker()
+{
+    for (;;)
+    {
+        if (_cancel || _job->_full)
+            break;
+
+        const unsigned idx = (unsigned)InterlockedIncrement(&_job->_next) - 1;
+        if (idx >= _job->_files.size())
+            break;
+
+        searchFile(idx);
+    }
+}
+
+
+/**
+ *  \brief
+ */
+void GrepEngine::searchFile(unsigned idx)
+{
+    const char* file = _job->_files[idx];
+    const unsigned fileLen = _job->_fileLens[idx];
+
+    CPath path(_job->_root);
+    path.Append(file, fileLen);
+
+    size_t size;
+    const char* buf = MapFile(path, size);
+    if (buf == NULL)
+        return;
+
+    std::vector<char>& result = _job->_results[idx];
+    searchBuf(buf, size, file, fileLen, result);
+
+    UnmapViewOfFile(buf);
+
+    // Files still being searched complete so the output is a whole prefix of the results
+    if (_job->_maxSize && !result.empty() &&
+            (size_t)InterlockedExchangeAdd64(&_job->_outSize, result.size()) + result.size() > _job->_maxSize)
+        InterlockedExchange(&_job->_full, 1);
+}
+
+
+/**
+ *  \brief  Appends "file:line:text" for each matching line
+ */
+void GrepEngine::searchBuf(const char* buf, size_t size, const char* file, unsigned fileLen,
+        std::vector<char>& out)
+{
+    const char* const end = buf + size;
+    const char* pos = buf;
+
+    // Lines are counted lazily only up to the next match
+    const char* counted = buf;
+    const char* lineStart = buf;
+    unsigned line = 1;
+
+    while (pos < end)
+    {
+        const char* match = _regExp ? findRegExp(pos, end) : FindLiteral(pos, end, _pattern, _ignoreCase);
+        if (!match)
+            break;
+
+        for (const char* pEol; (pEol = static_cast<const char*>(memchr(counted, '\n', match - counted)));)
+        {
+            ++line;
+            counted = pEol + 1;
+            lineStart = counted;
+        }
+
+        const char* lineEnd = static_cast<const char*>(memchr(match, '\n', end - match));
+        if (!lineEnd)
+            lineEnd = end;
+
+        const char* textEnd = lineEnd;
+        if (textEnd > lineStart && *(textEnd - 1) == '\r')
+            --textEnd;
+
+        if (!_firstHitTime)
+            InterlockedCompareExchange64(&_firstHitTime, CmdTiming::Now(), 0);
+
+        char lineNum[16];
+        const int lineNumLen = _snprintf_s(lineNum, _countof(lineNum), _TRUNCATE, ":%u:", line);
+
+        out.insert(out.end(), file, file + fileLen);
+        out.insert(out.end(), lineNum, lineNum + lineNumLen);
+        out.insert(out.end(), lineStart, textEnd);
+        out.push_back('\n');
+
+        // A single file could exceed the output max size on its own
+        if (lineEnd == end || (_job->_maxSize && out.size() > _job->_maxSize))
+            break;
+
+        ++line;
+        pos = counted = lineStart = lineEnd + 1;
+    }
+}
+
+
+/**
+ *  \brief  Returns pointer to the first occurrence of the literal pattern or NULL.
+ *          The pattern must not be empty and in lower case if ignoreCase. SSE2
+ *          version compares 16 candidate positions at once on the first and last
+ *          pattern bytes and verifies only the positions where both match.
+ */
+const char* GrepEngine::FindLiteral(const char* begin, const char* end, const std::string& pattern,
+        bool ignoreCase)
+{
+    const size_t len = pattern.size();
+
+    if ((size_t)(end - begin) < len)
+        return NULL;
+
+    const char* p = begin;
+
+#ifdef USE_SSE2
+    const char first    = pattern[0];
+    const char last     = pattern[len - 1];
+
+    const __m128i firstLo   = _mm_set1_epi8(first);
+    const __m128i lastLo    = _mm_set1_epi8(last);
+    const __m128i firstUp   = _mm_set1_epi8((ignoreCase && first >= 'a' && first <= 'z') ? first - ('a' - 'A') : first);
+    const __m128i lastUp    = _mm_set1_epi8((ignoreCase && last >= 'a' && last <= 'z') ? last - ('a' - 'A') : last);
+
+    for (; p + len + 15 <= end; p += 16)
+    {
+        const __m128i blockFirst    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i blockLast     = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + len - 1));
+
+        const __m128i eqFirst   = _mm_or_si128(_mm_cmpeq_epi8(blockFirst, firstLo), _mm_cmpeq_epi8(blockFirst, firstUp));
+        const __m128i eqLast    = _mm_or_si128(_mm_cmpeq_epi8(blockLast, lastLo), _mm_cmpeq_epi8(blockLast, lastUp));
+
+        for (unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(eqFirst, eqLast)); mask; mask &= mask - 1)
+        {
+            const char* candidate = p + lowestBit(mask);
+            if (equalLiteral(candidate, pattern, ignoreCase))
+                return candidate;
+        }
+    }
+#endif
+
+    for (; p + len <= end; ++p)
+        if (equalLiteral(p, pattern, ignoreCase))
+            return p;
+
+    return NULL;
+}
+
+
+/**
+ *  \brief  Matches the regular expression line by line
+ */
+const char* GrepEngine::findRegExp(const char* begin, const char* end) const
+{
+    for (const char* lineStart = begin; lineStart < end;)
+    {
+        const char* lineEnd = static_cast<const char*>(memchr(lineStart, '\n', end - lineStart));
+        if (!lineEnd)
+            lineEnd = end;
+
+        const char* textEnd = lineEnd;
+        if (textEnd > lineStart && *(textEnd - 1) == '\r')
+            --textEnd;
+
+        if (std::regex_search(lineStart, textEnd, *_re))
+            return lineStart;
+
+        lineStart = lineEnd + 1;
+    }
+
+    return NULL;
+}
+
+
+/**
+ *  \brief
+ */
+bool GrepEngine::equalLiteral(const char* str, const std::string& pattern, bool ignoreCase)
+{
+    const size_t len = pattern.size();
+
+    if (!ignoreCase)
+        return !memcmp(str, pattern.data(), len);
+
+    for (size_t i = 0; i < len; ++i)
+        if (foldCase(str[i]) != pattern[i])
+            return false;
+
+    return true;
+}
+
+} // namespace GTags
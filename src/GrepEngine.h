@@ -0,0 +1,131 @@
+/**
+ *  \file
+ *  \brief  In-process project files search (global -g replacement)
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include <regex>
+#include <memory>
+#include "Common.h"
+#include "Config.h"
+#include "ReadPipe.h"
+#include "OutputBuffer.h"
+
+
+namespace GTags
+{
+
+class GrepIndex;
+
+
+/**
+ *  \class  GrepEngine
+ *  \brief  Searches the project files listed by global -P on all cores
+ *          instead of running global -g which scans them sequentially.
+ *          The files are memory-mapped, literal patterns are matched with
+ *          SSE2 where available and the output has the global --result=grep
+ *          format ("path:line:text") so TabParser can parse it as before.
+ */
+class GrepEngine
+{
+public:
+    GrepEngine(const char* pattern, bool ignoreCase, bool regExp, unsigned maxThreads = 0);
+    ~GrepEngine();
+
+    static const char* MapFile(const CPath& path, size_t& size, bool textOnly = true);
+    static const char* FindLiteral(const char* begin, const char* end, const std::string& pattern, bool ignoreCase);
+
+    inline bool IsValid() const { return _valid; }
+
+    // Files the index rules out are not searched - the index must outlive the search
+    inline void UseIndex(const GrepIndex* index) { _index = index; }
+
+    // The search stops once the output max size is exceeded
+    unsigned Search(const CPath& root, const char* fileList, OutputBuffer& output,
+            const DbConfig* filterCfg = NULL);
+
+    bool Start(const CPath& root, ReadPipe& fileListPipe, const DbConfigPtr& filterCfg = DbConfigPtr());
+    HANDLE GetWaitHandle() const { return _hThread; }
+    void Cancel() { InterlockedExchange(&_cancel, 1); }
+    inline void MaxOutput(size_t maxSize) { _output.MaxSize(maxSize); }
+    OutputBuffer& GetOutput();
+    LONGLONG GetFirstHitTime() const { return _firstHitTime; }
+
+private:
+    static const size_t     cMaxFileSize;
+    static const unsigned   cBinaryCheckSize;
+
+    /**
+     *  \struct  Job
+     *  \brief  The files of a single search shared by the worker threads
+     */
+    struct Job
+    {
+        CPath                           _root;
+        std::vector<const char*>        _files;
+        std::vector<unsigned>           _fileLens;
+        std::vector<std::vector<char>>  _results;
+        volatile LONG                   _next;
+        size_t                          _maxSize;
+        volatile LONGLONG               _outSize;
+        volatile LONG                   _full;      // Output max size exceeded
+    };
+
+    static unsigned __stdcall threadFunc(void* data);
+    static unsigned __stdcall workerFunc(void* data);
+
+    GrepEngine(const GrepEngine&);
+    const GrepEngine& operator=(const GrepEngine&);
+
+    unsigned thread();
+    void worker();
+    void searchFile(unsigned idx);
+    void searchBuf(const char* buf, size_t size, const char* file, unsigned fileLen, std::vector<char>& out);
+    const char* findRegExp(const char* begin, const char* end) const;
+
+    static bool equalLiteral(const char* str, const std::string& pattern, bool ignoreCase);
+
+    std::string                     _pattern;
+    const bool                      _ignoreCase;
+    const bool                      _regExp;
+    unsigned                        _maxThreads;
+    bool                            _valid;
+    std::unique_ptr<std::regex>     _re;
+
+    Job*                            _job;
+    DbConfigPtr                     _filterCfg;
+    const GrepIndex*                _index;
+    volatile LONG                   _cancel;
+    volatile LONGLONG               _firstHitTime;
+
+    CPath                           _root;
+    ReadPipe*                       _fileListPipe;
+    HANDLE                          _hThread;
+    OutputBuffer                    _output;
+};
+
+} // namespace GTags
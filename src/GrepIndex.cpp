@@ -0,0 +1,785 @@
+/**
+ *  \file
+ *  \brief  Trigram index narrowing the files searched by GrepEngine
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include "GrepEngine.h"
+#include "GrepIndex.h"
+
+
+namespace
+{
+
+// One bit per trigram - marks the trigrams already seen in the current file
+const unsigned cTrigramsBitmapSize = (1 << 24) / 8;
+
+
+/**
+ *  \struct  Posting
+ *  \brief  Compressed list of the files containing a trigram while building the index
+ */
+struct Posting
+{
+    Posting() : _last(0), _count(0) {}
+
+    unsigned                    _last;
+    unsigned                    _count;
+    std::vector<unsigned char>  _bytes;
+};
+
+
+/**
+ *  \brief
+ */
+inline unsigned char foldCase(unsigned char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch;
+}
+
+
+/**
+ *  \brief
+ */
+inline void appendVarint(std::vector<unsigned char>& out, unsigned val)
+{
+    while (val >= 0x80)
+    {
+        out.push_back((unsigned char)(val | 0x80));
+        val >>= 7;
+    }
+
+    out.push_back((unsigned char)val);
+}
+
+
+/**
+ *  \brief  File ids are stored as deltas from the previous id in the list
+ */
+void encodeIds(std::vector<unsigned char>& out, const std::vector<unsigned>& ids)
+{
+    unsigned prev = 0;
+
+    for (auto id : ids)
+    {
+        appendVarint(out, id - prev);
+        prev = id;
+    }
+}
+
+
+/**
+ *  \brief  Appends the distinct trigrams of str to trigrams. Trigrams spanning
+ *          lines are skipped as the search patterns are matched per line.
+ */
+void extractTrigrams(const char* str, size_t len, std::vector<unsigned char>& seen,
+        std::vector<unsigned>& trigrams)
+{
+    unsigned key = 0;
+    unsigned run = 0;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        const unsigned char ch = (unsigned char)str[i];
+
+        if (ch == '\n' || ch == '\r')
+        {
+            run = 0;
+            continue;
+        }
+
+        key = ((key << 8) | foldCase(ch)) & 0xFFFFFF;
+
+        if (run < 2)
+        {
+            ++run;
+            continue;
+        }
+
+        const unsigned char bit = (unsigned char)(1 << (key & 7));
+
+        if (!(seen[key >> 3] & bit))
+        {
+            seen[key >> 3] |= bit;
+            trigrams.push_back(key);
+        }
+    }
+}
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+const TCHAR     GrepIndex::cFileName[]  = _T("GTRIGRAMS");
+const unsigned  GrepIndex::cVersion     = 1;
+const char      GrepIndex::cMagic[4]    = { 'N', 'G', 'T', 'I' };
+
+
+/**
+ *  \brief  Indexes the files in fileList (new-line separated, relative to
+ *          dbPath) and replaces the database index file
+ */
+bool GrepIndex::Build(const CPath& dbPath, const char* fileList)
+{
+    if (!fileList)
+        return false;
+
+    Data data;
+    std::unordered_map<unsigned, Posting> postings;
+    std::vector<unsigned char> seen(cTrigramsBitmapSize, 0);
+    std::vector<unsigned> trigrams;
+
+    for (const char* pSrc = fileList;;)
+    {
+        while (*pSrc == '\n' || *pSrc == '\r')
+            ++pSrc;
+        if (*pSrc == 0)
+            break;
+
+        const char* pEol = pSrc;
+        while (*pEol != '\n' && *pEol != '\r' && *pEol != 0)
+            ++pEol;
+
+        const unsigned id = data._paths.size();
+
+        data._paths.push_back(std::string(pSrc, pEol - pSrc));
+        normalizePath(data._paths.back());
+
+        CPath file(dbPath);
+        file.Append(pSrc, pEol - pSrc);
+
+        fileTrigrams(file, seen, trigrams);
+
+        for (auto trigram : trigrams)
+        {
+            Posting& posting = postings[trigram];
+
+            appendVarint(posting._bytes, id - posting._last);
+            posting._last = id;
+            ++posting._count;
+        }
+
+        pSrc = pEol;
+    }
+
+    std::vector<unsigned> keys;
+    keys.reserve(postings.size());
+    for (const auto& posting : postings)
+        keys.push_back(posting.first);
+
+    std::sort(keys.begin(), keys.end());
+
+    data._dir.reserve(keys.size());
+
+    for (auto key : keys)
+    {
+        Posting& posting = postings[key];
+
+        const DirEntry entry = { key, (unsigned)data._postings.size(), posting._count };
+        data._dir.push_back(entry);
+        data._postings.insert(data._postings.end(), posting._bytes.begin(), posting._bytes.end());
+
+        std::vector<unsigned char>().swap(posting._bytes);
+    }
+
+    return save(dbPath, data);
+}
+
+
+/**
+ *  \brief  Re-indexes single database file. The posting lists are merged
+ *          with the file's new trigrams and the index file is rewritten.
+ */
+bool GrepIndex::Update(const CPath& dbPath, const CPath& file)
+{
+    if (!file.IsSubpathOf(dbPath))
+        return false;
+
+    GrepIndex index;
+    if (!index.Open(dbPath))
+        return false;
+
+    CTextA relPathA(file.C_str() + dbPath.Len());
+    std::string relPath(relPathA.C_str());
+    normalizePath(relPath);
+
+    Data data;
+    data._paths.reserve(index._filesNum + 1);
+    for (unsigned i = 0; i < index._filesNum; ++i)
+        data._paths.push_back(index.path(i));
+
+    int id = index.findPath(relPath.c_str(), relPath.size());
+    if (id < 0)
+    {
+        id = data._paths.size();
+        data._paths.push_back(relPath);
+    }
+
+    std::vector<unsigned char> seen(cTrigramsBitmapSize, 0);
+    std::vector<unsigned> trigrams;
+
+    fileTrigrams(file, seen, trigrams);
+    std::sort(trigrams.begin(), trigrams.end());
+
+    data._dir.reserve(index._trigramsNum + trigrams.size());
+    data._postings.reserve(index._size);
+
+    std::vector<unsigned> ids;
+    unsigned iOld = 0;
+    unsigned iNew = 0;
+
+    while (iOld < index._trigramsNum || iNew < trigrams.size())
+    {
+        unsigned key;
+        ids.clear();
+
+        if (iOld < index._trigramsNum && (iNew == trigrams.size() || index._dir[iOld]._trigram <= trigrams[iNew]))
+        {
+            key = index._dir[iOld]._trigram;
+            index.decode(index._dir[iOld++], ids);
+        }
+        else
+        {
+            key = trigrams[iNew];
+        }
+
+        const bool inFile = (iNew < trigrams.size() && trigrams[iNew] == key);
+        if (inFile)
+            ++iNew;
+
+        auto iId = std::lower_bound(ids.begin(), ids.end(), (unsigned)id);
+        const bool listed = (iId != ids.end() && *iId == (unsigned)id);
+
+        if (listed && !inFile)
+            ids.erase(iId);
+        else if (!listed && inFile)
+            ids.insert(iId, (unsigned)id);
+
+        if (ids.empty())
+            continue;
+
+        const DirEntry entry = { key, (unsigned)data._postings.size(), (unsigned)ids.size() };
+        data._dir.push_back(entry);
+        encodeIds(data._postings, ids);
+    }
+
+    // The file cannot be overwritten while mapped
+    index.Close();
+
+    return save(dbPath, data);
+}
+
+
+/**
+ *  \brief
+ */
+bool GrepIndex::Delete(const CPath& dbPath)
+{
+    CPath indexFile(dbPath);
+    indexFile += cFileName;
+
+    if (!indexFile.FileExists())
+        return false;
+
+    return DeleteFile(indexFile.C_str()) ? true : false;
+}
+
+
+/**
+ *  \brief
+ */
+GrepIndex::GrepIndex() :
+    _buf(NULL), _size(0), _header(NULL), _dir(NULL), _filesNum(0), _trigramsNum(0), _narrowed(false)
+{
+}
+
+
+/**
+ *  \brief  Maps the database index file and checks its consistency
+ */
+bool GrepIndex::Open(const CPath& dbPath)
+{
+    Close();
+
+    CPath indexFile(dbPath);
+    indexFile += cFileName;
+
+    size_t size;
+    const char* buf = GrepEngine::MapFile(indexFile, size, false);
+    if (buf == NULL)
+        return false;
+
+    const Header* header = reinterpret_cast<const Header*>(buf);
+
+    if (size < sizeof(Header) || memcmp(header->_magic, cMagic, sizeof(cMagic)) ||
+            header->_version != cVersion || header->_size != size ||
+            header->_pathsOffset + (size_t)header->_filesNum * sizeof(unsigned) > header->_orderOffset ||
+            header->_orderOffset + (size_t)header->_filesNum * sizeof(unsigned) > header->_dirOffset ||
+            header->_dirOffset + (size_t)header->_trigramsNum * sizeof(DirEntry) > header->_postingsOffset ||
+            header->_postingsOffset > size)
+    {
+        UnmapViewOfFile(buf);
+        return false;
+    }
+
+    _buf            = buf;
+    _size           = size;
+    _header         = header;
+    _dir            = reinterpret_cast<const DirEntry*>(buf + header->_dirOffset);
+    _filesNum       = header->_filesNum;
+    _trigramsNum    = header->_trigramsNum;
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+void GrepIndex::Close()
+{
+    if (_buf)
+        UnmapViewOfFile(_buf);
+
+    _buf            = NULL;
+    _size           = 0;
+    _header         = NULL;
+    _dir            = NULL;
+    _filesNum       = 0;
+    _trigramsNum    = 0;
+    _narrowed       = false;
+    _candidates.clear();
+}
+
+
+/**
+ *  \brief  Finds the files that may contain pattern. Returns false if the
+ *          pattern has no (required) literal of at least 3 characters - then
+ *          all files remain candidates.
+ */
+bool GrepIndex::Narrow(const char* pattern, bool regExp)
+{
+    _narrowed = false;
+    _candidates.clear();
+
+    if (!IsOpen() || !pattern)
+        return false;
+
+    const std::string literal = regExp ? requiredLiteral(pattern) : std::string(pattern);
+    if (literal.size() < 3)
+        return false;
+
+    std::vector<unsigned> trigrams;
+    for (size_t i = 0; i + 2 < literal.size(); ++i)
+        trigrams.push_back(((unsigned)foldCase(literal[i]) << 16) |
+                ((unsigned)foldCase(literal[i + 1]) << 8) | foldCase(literal[i + 2]));
+
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    std::vector<const DirEntry*> entries;
+    for (auto trigram : trigrams)
+    {
+        const DirEntry* entry = findTrigram(trigram);
+        if (entry == NULL)
+        {
+            entries.clear();
+            break;
+        }
+
+        entries.push_back(entry);
+    }
+
+    std::vector<unsigned> ids;
+
+    if (!entries.empty())
+    {
+        // Start from the shortest list to keep the intersections small
+        std::sort(entries.begin(), entries.end(),
+                [](const DirEntry* e1, const DirEntry* e2) { return e1->_count < e2->_count; });
+
+        decode(*entries[0], ids);
+
+        std::vector<unsigned> nextIds;
+        std::vector<unsigned> common;
+
+        for (unsigned i = 1; i < entries.size() && !ids.empty(); ++i)
+        {
+            nextIds.clear();
+            decode(*entries[i], nextIds);
+
+            common.clear();
+            std::set_intersection(ids.begin(), ids.end(), nextIds.begin(), nextIds.end(),
+                    std::back_inserter(common));
+            ids.swap(common);
+        }
+    }
+
+    _candidates.assign(_filesNum, 0);
+    for (auto id : ids)
+        if (id < _filesNum)
+            _candidates[id] = 1;
+
+    _narrowed = true;
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+unsigned GrepIndex::CandidatesCount() const
+{
+    if (!_narrowed)
+        return _filesNum;
+
+    return (unsigned)std::count(_candidates.begin(), _candidates.end(), 1);
+}
+
+
+/**
+ *  \brief  Files not in the index are always candidates
+ */
+bool GrepIndex::IsCandidate(const char* file, unsigned fileLen) const
+{
+    if (!_narrowed)
+        return true;
+
+    const int id = findPath(file, fileLen);
+
+    return (id < 0 || _candidates[id]);
+}
+
+
+/**
+ *  \brief
+ */
+bool GrepIndex::save(const CPath& dbPath, const Data& data)
+{
+    const unsigned filesNum = data._paths.size();
+
+    Header header;
+    memcpy(header._magic, cMagic, sizeof(cMagic));
+    header._version     = cVersion;
+    header._filesNum    = filesNum;
+    header._trigramsNum = data._dir.size();
+
+    std::vector<unsigned> pathOffsets(filesNum);
+
+    size_t pos = sizeof(Header);
+    header._pathsOffset = pos;
+    pos += filesNum * sizeof(unsigned);
+
+    for (unsigned i = 0; i < filesNum; ++i)
+    {
+        pathOffsets[i] = pos;
+        pos += data._paths[i].size() + 1;
+    }
+
+    const size_t padding = (sizeof(unsigned) - pos % sizeof(unsigned)) % sizeof(unsigned);
+    pos += padding;
+
+    header._orderOffset = pos;
+    pos += filesNum * sizeof(unsigned);
+
+    header._dirOffset = pos;
+    pos += data._dir.size() * sizeof(DirEntry);
+
+    header._postingsOffset = pos;
+    pos += data._postings.size();
+
+    // Offsets are 32-bit
+    if (pos > 0xFFFFFFFF)
+        return false;
+
+    header._size = pos;
+
+    std::vector<unsigned> order(filesNum);
+    for (unsigned i = 0; i < filesNum; ++i)
+        order[i] = i;
+
+    std::sort(order.begin(), order.end(),
+            [&data](unsigned id1, unsigned id2)
+            {
+                return comparePaths(data._paths[id1].c_str(), data._paths[id1].size(),
+                        data._paths[id2].c_str()) < 0;
+            });
+
+    CPath indexFile(dbPath);
+    indexFile += cFileName;
+
+    FILE* fp;
+    _tfopen_s(&fp, indexFile.C_str(), _T("wb"));
+    if (fp == NULL)
+        return false;
+
+    static const char cZeros[sizeof(unsigned)] = { 0 };
+
+    bool success = (fwrite(&header, sizeof(header), 1, fp) == 1);
+
+    if (success && filesNum)
+        success = (fwrite(pathOffsets.data(), sizeof(unsigned), filesNum, fp) == filesNum);
+
+    for (unsigned i = 0; success && i < filesNum; ++i)
+        success = (fwrite(data._paths[i].c_str(), data._paths[i].size() + 1, 1, fp) == 1);
+
+    if (success && padding)
+        success = (fwrite(cZeros, padding, 1, fp) == 1);
+
+    if (success && filesNum)
+        success = (fwrite(order.data(), sizeof(unsigned), filesNum, fp) == filesNum);
+
+    if (success && !data._dir.empty())
+        success = (fwrite(data._dir.data(), sizeof(DirEntry), data._dir.size(), fp) == data._dir.size());
+
+    if (success && !data._postings.empty())
+        success = (fwrite(data._postings.data(), data._postings.size(), 1, fp) == 1);
+
+    if (fclose(fp))
+        success = false;
+
+    if (!success)
+        DeleteFile(indexFile.C_str());
+
+    return success;
+}
+
+
+/**
+ *  \brief  Fills trigrams with the distinct trigrams of the file. Files that
+ *          GrepEngine skips (binary or too big) have no trigrams.
+ */
+void GrepIndex::fileTrigrams(const CPath& path, std::vector<unsigned char>& seen,
+        std::vector<unsigned>& trigrams)
+{
+    trigrams.clear();
+
+    size_t size;
+    const char* buf = GrepEngine::MapFile(path, size);
+    if (buf == NULL)
+        return;
+
+    extractTrigrams(buf, size, seen, trigrams);
+
+    UnmapViewOfFile(buf);
+
+    for (auto trigram : trigrams)
+        seen[trigram >> 3] = 0;
+}
+
+
+/**
+ *  \brief  Paths are stored relative to the database with '/' separators
+ */
+void GrepIndex::normalizePath(std::string& path)
+{
+    for (auto& ch : path)
+        if (ch == '\\')
+            ch = '/';
+
+    if (path.size() > 2 && path[0] == '.' && path[1] == '/')
+        path.erase(0, 2);
+}
+
+
+/**
+ *  \brief  Case-insensitive path compare treating '\\' as '/'.
+ *          path1 has length len1, path2 is NUL-terminated.
+ */
+int GrepIndex::comparePaths(const char* path1, unsigned len1, const char* path2)
+{
+    if (len1 > 2 && path1[0] == '.' && (path1[1] == '/' || path1[1] == '\\'))
+    {
+        path1 += 2;
+        len1 -= 2;
+    }
+
+    for (unsigned i = 0; i < len1; ++i)
+    {
+        unsigned char ch1 = foldCase((unsigned char)path1[i]);
+        unsigned char ch2 = foldCase((unsigned char)path2[i]);
+
+        if (ch1 == '\\')
+            ch1 = '/';
+        if (ch2 == '\\')
+            ch2 = '/';
+
+        if (ch1 != ch2 || ch2 == 0)
+            return (int)ch1 - (int)ch2;
+    }
+
+    return path2[len1] ? -1 : 0;
+}
+
+
+/**
+ *  \brief  Returns the longest literal that every match of the extended
+ *          regular expression must contain or empty string if there is no
+ *          such (alternations are not analyzed). Literals inside groups and
+ *          bracket expressions are not considered.
+ */
+std::string GrepIndex::requiredLiteral(const char* regExp)
+{
+    std::string longest;
+    std::string current;
+    int depth = 0;
+
+    for (const char* pCh = regExp; *pCh; ++pCh)
+    {
+        const char ch = *pCh;
+
+        if (ch == '*' || ch == '?' || ch == '{')
+        {
+            // The preceding literal character is optional
+            if (!current.empty())
+                current.erase(current.size() - 1);
+
+            if (ch == '{')
+                while (pCh[1] && *pCh != '}')
+                    ++pCh;
+        }
+        else if (depth == 0 && !strchr(".[]()+|^$\\", ch))
+        {
+            current += ch;
+            continue;
+        }
+
+        if (current.size() > longest.size())
+            longest = current;
+        current.clear();
+
+        if (ch == '|' && depth == 0)
+            return std::string();
+
+        if (ch == '(')
+        {
+            ++depth;
+        }
+        else if (ch == ')')
+        {
+            if (depth)
+                --depth;
+        }
+        else if (ch == '\\')
+        {
+            if (pCh[1])
+                ++pCh;
+        }
+        else if (ch == '[')
+        {
+            ++pCh;
+            if (*pCh == '^')
+                ++pCh;
+            if (*pCh == ']')
+                ++pCh;
+            while (*pCh && *pCh != ']')
+                ++pCh;
+            if (*pCh == 0)
+                break;
+        }
+    }
+
+    if (current.size() > longest.size())
+        longest = current;
+
+    return longest;
+}
+
+
+/**
+ *  \brief  Binary search in the path-sorted file ids. Returns the file id or -1.
+ */
+int GrepIndex::findPath(const char* file, unsigned fileLen) const
+{
+    const unsigned* order = reinterpret_cast<const unsigned*>(_buf + _header->_orderOffset);
+
+    unsigned lo = 0;
+    unsigned hi = _filesNum;
+
+    while (lo < hi)
+    {
+        const unsigned mid = lo + (hi - lo) / 2;
+        const int cmp = comparePaths(file, fileLen, path(order[mid]));
+
+        if (cmp == 0)
+            return (int)order[mid];
+
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return -1;
+}
+
+
+/**
+ *  \brief
+ */
+const GrepIndex::DirEntry* GrepIndex::findTrigram(unsigned trigram) const
+{
+    const DirEntry* end = _dir + _trigramsNum;
+    const DirEntry* entry = std::lower_bound(_dir, end, trigram,
+            [](const DirEntry& e, unsigned t) { return e._trigram < t; });
+
+    return (entry != end && entry->_trigram == trigram) ? entry : NULL;
+}
+
+
+/**
+ *  \brief  Decodes the delta + varint compressed posting list and appends the file ids
+ */
+void GrepIndex::decode(const DirEntry& entry, std::vector<unsigned>& ids) const
+{
+    const unsigned char* pos = reinterpret_cast<const unsigned char*>(_buf + _header->_postingsOffset) + entry._offset;
+    const unsigned char* end = reinterpret_cast<const unsigned char*>(_buf + _size);
+
+    ids.reserve(ids.size() + entry._count);
+
+    unsigned id = 0;
+
+    for (unsigned i = 0; i < entry._count && pos < end; ++i)
+    {
+        unsigned delta = 0;
+        for (unsigned shift = 0; pos < end; shift += 7)
+        {
+            const unsigned char byte = *pos++;
+            delta |= (unsigned)(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                break;
+        }
+
+        id += delta;
+        ids.push_back(id);
+    }
+}
+
+} // namespace GTags
@@ -0,0 +1,143 @@
+/**
+ *  \file
+ *  \brief  Trigram index narrowing the files searched by GrepEngine
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include <string>
+#include "Common.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  GrepIndex
+ *  \brief  Maps each (ASCII case-folded) trigram to the list of database files
+ *          containing it. The posting lists are delta + varint compressed and
+ *          the index file is memory-mapped when queried. A file containing a
+ *          literal must contain all of its trigrams so the intersection of
+ *          their posting lists gives the only files that need to be searched.
+ *          Files not in the index (added after it was built) are always searched.
+ */
+class GrepIndex
+{
+public:
+    static const TCHAR cFileName[];
+
+    static bool Build(const CPath& dbPath, const char* fileList);
+    static bool Update(const CPath& dbPath, const CPath& file);
+    static bool Delete(const CPath& dbPath);
+
+    GrepIndex();
+    ~GrepIndex() { Close(); }
+
+    bool Open(const CPath& dbPath);
+    void Close();
+
+    inline bool IsOpen() const { return (_buf != NULL); }
+    inline size_t Size() const { return _size; }
+    inline unsigned FilesCount() const { return _filesNum; }
+    inline unsigned TrigramsCount() const { return _trigramsNum; }
+
+    bool Narrow(const char* pattern, bool regExp);
+    unsigned CandidatesCount() const;
+    bool IsCandidate(const char* file, unsigned fileLen) const;
+
+private:
+    static const unsigned   cVersion;
+    static const char       cMagic[4];
+
+    /**
+     *  \struct  Header
+     *  \brief  Offsets are from the beginning of the file
+     */
+    struct Header
+    {
+        char        _magic[4];
+        unsigned    _version;
+        unsigned    _filesNum;
+        unsigned    _trigramsNum;
+        unsigned    _pathsOffset;       // unsigned[_filesNum] path offsets, NUL-terminated paths follow
+        unsigned    _orderOffset;       // unsigned[_filesNum] file ids sorted by path
+        unsigned    _dirOffset;         // DirEntry[_trigramsNum] sorted by trigram
+        unsigned    _postingsOffset;
+        unsigned    _size;
+    };
+
+    /**
+     *  \struct  DirEntry
+     *  \brief  _offset is from the beginning of the postings
+     */
+    struct DirEntry
+    {
+        unsigned    _trigram;
+        unsigned    _offset;
+        unsigned    _count;
+    };
+
+    /**
+     *  \struct  Data
+     *  \brief  Index contents being written
+     */
+    struct Data
+    {
+        std::vector<std::string>    _paths;
+        std::vector<DirEntry>       _dir;
+        std::vector<unsigned char>  _postings;
+    };
+
+    static bool save(const CPath& dbPath, const Data& data);
+    static void fileTrigrams(const CPath& path, std::vector<unsigned char>& seen, std::vector<unsigned>& trigrams);
+    static void normalizePath(std::string& path);
+    static int comparePaths(const char* path1, unsigned len1, const char* path2);
+    static std::string requiredLiteral(const char* regExp);
+
+    GrepIndex(const GrepIndex&);
+    const GrepIndex& operator=(const GrepIndex&);
+
+    inline const char* path(unsigned id) const
+    {
+        return _buf + reinterpret_cast<const unsigned*>(_buf + _header->_pathsOffset)[id];
+    }
+
+    int findPath(const char* file, unsigned fileLen) const;
+    const DirEntry* findTrigram(unsigned trigram) const;
+    void decode(const DirEntry& entry, std::vector<unsigned>& ids) const;
+
+    const char*         _buf;
+    size_t              _size;
+    const Header*       _header;
+    const DirEntry*     _dir;
+    unsigned            _filesNum;
+    unsigned            _trigramsNum;
+
+    bool                _narrowed;
+    std::vector<char>   _candidates;
+};
+
+} // namespace GTags
@@ -71,6 +71,25 @@ void INpp::GetWord(CTextA& word, bool partial, bool select) const
 }
 
 
+/**
+ *  \brief  Gets the whole word at the caret leaving the selection as is
+ */
+void INpp::PeekWord(CTextA& word) const
+{
+    long currPos    = SendMessage(_hSC, SCI_GETCURRENTPOS, 0, 0);
+    long wordStart  = SendMessage(_hSC, SCI_WORDSTARTPOSITION, currPos, true);
+    long wordEnd    = SendMessage(_hSC, SCI_WORDENDPOSITION, currPos, true);
+
+    if (wordEnd == wordStart)
+    {
+        word.Clear();
+        return;
+    }
+
+    GetTextRange(word, wordStart, wordEnd);
+}
+
+
 /**
  *  \brief
  */
@@ -169,6 +188,36 @@ bool INpp::SearchText(const char* text, bool ignoreCase, bool wholeWord, bool re
 }
 
 
+/**
+ *  \brief  Full paths of the documents open in both views
+ */
+void INpp::GetOpenFiles(std::vector<CPath>& files) const
+{
+    files.clear();
+
+    const int count = (int)SendMessage(_nppData._nppHandle, NPPM_GETNBOPENFILES, 0, ALL_OPEN_FILES);
+    if (count <= 0)
+        return;
+
+    std::vector<CPath> paths(count);
+    std::vector<TCHAR*> names(count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        paths[i].Resize(MAX_PATH);
+        names[i] = paths[i].C_str();
+    }
+
+    const int filled = (int)SendMessage(_nppData._nppHandle, NPPM_GETOPENFILENAMES, (WPARAM)names.data(), count);
+
+    for (int i = 0; i < filled && i < count; ++i)
+    {
+        paths[i].AutoFit();
+        files.push_back(paths[i]);
+    }
+}
+
+
 /**
  *  \brief
  */
@@ -164,6 +164,22 @@ public:
         filePath.AutoFit();
     }
 
+    void GetOpenFiles(std::vector<CPath>& files) const;
+
+    inline LRESULT GetCurrentBufferId() const
+    {
+        return SendMessage(_nppData._nppHandle, NPPM_GETCURRENTBUFFERID, 0, 0);
+    }
+
+    // The current document text is UTF-8 (or ASCII) as in the file - not converted on load
+    inline bool IsDocUtf8() const
+    {
+        // UniMode - uniUTF8 (with BOM), uniCookie (without BOM), uni7Bit
+        const LRESULT uniMode = SendMessage(_nppData._nppHandle, NPPM_GETBUFFERENCODING, GetCurrentBufferId(), 0);
+
+        return (uniMode == 1 || uniMode == 4 || uniMode == 5);
+    }
+
     inline void GetFileNamePart(CPath& fileName) const
     {
         fileName.Resize(MAX_PATH);
@@ -244,6 +260,33 @@ public:
         return SendMessage(_hSC, SCI_GETLINEENDPOSITION, line, 0);
     }
 
+    inline void GetVisibleRange(long& startPos, long& endPos) const
+    {
+        long line = SendMessage(_hSC, SCI_GETFIRSTVISIBLELINE, 0, 0);
+        startPos = PositionFromLine(SendMessage(_hSC, SCI_DOCLINEFROMVISIBLE, line, 0));
+
+        line += SendMessage(_hSC, SCI_LINESONSCREEN, 0, 0);
+        endPos = LineEndPosition(SendMessage(_hSC, SCI_DOCLINEFROMVISIBLE, line, 0));
+    }
+
+    inline void SetIndicatorStyle(int indicator, int style, COLORREF color) const
+    {
+        SendMessage(_hSC, SCI_INDICSETSTYLE, indicator, style);
+        SendMessage(_hSC, SCI_INDICSETFORE, indicator, color);
+    }
+
+    inline void ClearIndicator(int indicator, long startPos, long endPos) const
+    {
+        SendMessage(_hSC, SCI_SETINDICATORCURRENT, indicator, 0);
+        SendMessage(_hSC, SCI_INDICATORCLEARRANGE, startPos, endPos - startPos);
+    }
+
+    inline void FillIndicator(int indicator, long startPos, long len) const
+    {
+        SendMessage(_hSC, SCI_SETINDICATORCURRENT, indicator, 0);
+        SendMessage(_hSC, SCI_INDICATORFILLRANGE, startPos, len);
+    }
+
     inline int IsSelectionVertical() const
     {
         return SendMessage(_hSC, SCI_SELECTIONISRECTANGLE, 0, 0);
@@ -263,6 +306,25 @@ public:
         sel.AutoFit();
     }
 
+    inline bool IsModified() const
+    {
+        return (SendMessage(_hSC, SCI_GETMODIFY, 0, 0) != 0);
+    }
+
+    inline void GetText(CTextA& txt) const
+    {
+        GetTextRange(txt, 0, SendMessage(_hSC, SCI_GETLENGTH, 0, 0));
+    }
+
+    inline void GetTextRange(CTextA& txt, long startPos, long endPos) const
+    {
+        txt.Resize(endPos - startPos);
+
+        struct TextRange tr = { { startPos, endPos }, txt.C_str() };
+        SendMessage(_hSC, SCI_GETTEXTRANGE, 0, (LPARAM)&tr);
+        txt.AutoFit();
+    }
+
     inline void SetSelection(long startPos, long endPos) const
     {
         SendMessage(_hSC, SCI_SETSEL, startPos, endPos);
@@ -293,6 +355,7 @@ public:
 
     long GetWordSize(bool partial = false) const;
     void GetWord(CTextA& word, bool partial = false, bool select = false) const;
+    void PeekWord(CTextA& word) const;
     void ReplaceWord(const char* replText, bool partial = false) const;
     bool SearchText(const char* text, bool ignoreCase, bool wholeWord, bool regExp,
             long* startPos = NULL, long* endPos = NULL) const;
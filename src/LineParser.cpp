@@ -36,7 +36,7 @@ int LineParser::Parse(const CmdPtr_t& cmd)
 {
     int result = 0;
 
-    const bool filterReoccurring = cmd->Db()->GetConfig()._useLibDb;
+    const bool filterReoccurring = cmd->Db()->GetConfig()->_useLibDb;
 
     StrUniquenessChecker<TCHAR> strChecker;
 
@@ -47,6 +47,10 @@ int LineParser::Parse(const CmdPtr_t& cmd)
     for (TCHAR* pToken = _tcstok_s(_buf.C_str(), _T("\n\r"), &pTmp); pToken;
             pToken = _tcstok_s(NULL, _T("\n\r"), &pTmp))
     {
+        // Superseded auto-complete - the result will be dropped anyway
+        if (cmd->IsCancelled())
+            break;
+
         if (cmd->Id() == FIND_FILE || cmd->Id() == AUTOCOMPLETE_FILE)
             ++pToken;
 
@@ -0,0 +1,258 @@
+/**
+ *  \file
+ *  \brief  Fast LZ77 codec for the in-memory payloads
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <string.h>
+#include <stdint.h>
+#include "LzCodec.h"
+
+
+namespace
+{
+
+/**
+ *  \brief
+ */
+inline uint32_t read32(const char* p)
+{
+    uint32_t val;
+    memcpy(&val, p, sizeof(val));
+    return val;
+}
+
+
+/**
+ *  \brief  Lengths that do not fit the token nibble continue in 255 steps
+ */
+inline void putLen(char*& dst, size_t len)
+{
+    for (; len >= 255; len -= 255)
+        *dst++ = (char)255;
+
+    *dst++ = (char)len;
+}
+
+
+/**
+ *  \brief
+ */
+inline bool getLen(const unsigned char*& p, const unsigned char* end, size_t& len)
+{
+    unsigned char b;
+
+    do
+    {
+        if (p == end)
+            return false;
+
+        b = *p++;
+        len += b;
+    }
+    while (b == 255);
+
+    return true;
+}
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+const unsigned LzCodec::cHashBits   = 14;
+const unsigned LzCodec::cMinMatch   = 4;
+const unsigned LzCodec::cMaxOffset  = 0xFFFF;
+
+
+/**
+ *  \brief  Output is the source length (4 bytes) followed by sequences of
+ *          token (literals count : 4, match length - 4 : 4), literals,
+ *          match offset (2 bytes). The last sequence has only literals.
+ */
+void LzCodec::Compress(const char* src, size_t len, std::vector<char>& dst)
+{
+    // Worst case - all literals
+    dst.resize(sizeof(uint32_t) + 1 + len + len / 255 + 1);
+
+    const uint32_t srcLen = (uint32_t)len;
+    memcpy(dst.data(), &srcLen, sizeof(srcLen));
+
+    char* out = dst.data() + sizeof(srcLen);
+
+    std::vector<uint32_t> table(1 << cHashBits, 0); // Position + 1 of the last 4 bytes with that hash
+
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    for (;;)
+    {
+        size_t matchPos = 0;
+        size_t matchLen = 0;
+
+        // Skip faster through incompressible data
+        for (; pos + cMinMatch <= len; pos += 1 + ((pos - anchor) >> 6))
+        {
+            const uint32_t seq = read32(src + pos);
+            const uint32_t hash = (seq * 2654435761U) >> (32 - cHashBits);
+            const size_t candidate = table[hash];
+
+            table[hash] = (uint32_t)pos + 1;
+
+            if (candidate && pos - (candidate - 1) <= cMaxOffset && read32(src + candidate - 1) == seq)
+            {
+                matchPos = candidate - 1;
+                matchLen = cMinMatch;
+
+                while (pos + matchLen < len && src[matchPos + matchLen] == src[pos + matchLen])
+                    ++matchLen;
+
+                break;
+            }
+        }
+
+        if (matchLen == 0)
+            pos = len;
+
+        const size_t literals = pos - anchor;
+        const size_t extraLen = matchLen ? matchLen - cMinMatch : 0;
+
+        *out++ = (char)(((literals < 15 ? literals : 15) << 4) | (extraLen < 15 ? extraLen : 15));
+
+        if (literals >= 15)
+            putLen(out, literals - 15);
+
+        if (literals)
+        {
+            memcpy(out, src + anchor, literals);
+            out += literals;
+        }
+
+        if (matchLen == 0)
+            break;
+
+        const size_t offset = pos - matchPos;
+        *out++ = (char)(offset & 0xFF);
+        *out++ = (char)(offset >> 8);
+
+        if (extraLen >= 15)
+            putLen(out, extraLen - 15);
+
+        pos += matchLen;
+        anchor = pos;
+    }
+
+    dst.resize(out - dst.data());
+}
+
+
+/**
+ *  \brief  Returns false on corrupted input
+ */
+bool LzCodec::Decompress(const char* src, size_t len, std::vector<char>& dst)
+{
+    const size_t dstLen = DecompressedLen(src, len);
+
+    dst.clear();
+
+    if (len < sizeof(uint32_t))
+        return false;
+
+    dst.resize(dstLen);
+
+    const unsigned char* p = (const unsigned char*)src + sizeof(uint32_t);
+    const unsigned char* end = (const unsigned char*)src + len;
+    size_t out = 0;
+
+    while (p < end)
+    {
+        const unsigned token = *p++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !getLen(p, end, literals))
+            return false;
+
+        if ((size_t)(end - p) < literals || dstLen - out < literals)
+            return false;
+
+        if (literals)
+        {
+            memcpy(dst.data() + out, p, literals);
+            p += literals;
+            out += literals;
+        }
+
+        if (p == end)
+            break;
+
+        if (end - p < 2)
+            return false;
+
+        const size_t offset = p[0] | (p[1] << 8);
+        p += 2;
+
+        size_t matchLen = token & 0xF;
+        if (matchLen == 15 && !getLen(p, end, matchLen))
+            return false;
+
+        matchLen += cMinMatch;
+
+        if (offset == 0 || offset > out || dstLen - out < matchLen)
+            return false;
+
+        char* pDst = dst.data() + out;
+        const char* pRef = pDst - offset;
+
+        // The match may overlap the output (repeated pattern) - then copy byte by byte
+        if (offset >= matchLen)
+        {
+            memcpy(pDst, pRef, matchLen);
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLen; ++i)
+                pDst[i] = pRef[i];
+        }
+
+        out += matchLen;
+    }
+
+    return (out == dstLen);
+}
+
+
+/**
+ *  \brief
+ */
+size_t LzCodec::DecompressedLen(const char* src, size_t len)
+{
+    if (len < sizeof(uint32_t))
+        return 0;
+
+    uint32_t dstLen;
+    memcpy(&dstLen, src, sizeof(dstLen));
+
+    return dstLen;
+}
+
+} // namespace GTags
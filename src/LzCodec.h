@@ -0,0 +1,61 @@
+/**
+ *  \file
+ *  \brief  Fast LZ77 codec for the in-memory payloads
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#pragma once
+
+
+#include <stddef.h>
+#include <vector>
+
+
+namespace GTags
+{
+
+/**
+ *  \class  LzCodec
+ *  \brief  Byte-oriented LZ77 compression in the spirit of LZ4 - greedy
+ *          matching through a hash of the next 4 bytes, no entropy coding.
+ *          Trades ratio for speed - the text of search results still
+ *          compresses several times.
+ */
+class LzCodec
+{
+public:
+    static void Compress(const char* src, size_t len, std::vector<char>& dst);
+    static bool Decompress(const char* src, size_t len, std::vector<char>& dst);
+
+    static size_t DecompressedLen(const char* src, size_t len);
+
+private:
+    static const unsigned   cHashBits;
+    static const unsigned   cMinMatch;
+    static const unsigned   cMaxOffset;
+
+    LzCodec();
+    LzCodec(const LzCodec&);
+    ~LzCodec();
+};
+
+} // namespace GTags
@@ -0,0 +1,281 @@
+/**
+ *  \file
+ *  \brief  Process output buffer spilling to a memory-mapped temporary file
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <string.h>
+#include <algorithm>
+#include "Common.h"
+#include "GTags.h"
+#include "OutputBuffer.h"
+
+
+namespace GTags
+{
+
+const size_t OutputBuffer::cSpillSize           = 16 * 1024 * 1024;
+const size_t OutputBuffer::cSpillGranularity    = 1024 * 1024;
+
+volatile LONG OutputBuffer::SpillId = 0;
+
+
+/**
+ *  \brief
+ */
+OutputBuffer::OutputBuffer(size_t maxSize) : _maxSize(maxSize), _truncated(false),
+    _hFile(INVALID_HANDLE_VALUE), _hMap(NULL), _data(NULL), _size(0), _capacity(0)
+{
+}
+
+
+/**
+ *  \brief  Returns space for up to len bytes after the data to be written
+ *          and then committed. len is reduced to what fits below the max
+ *          size. Returns NULL if nothing fits - the output is truncated.
+ */
+char* OutputBuffer::Reserve(size_t& len)
+{
+    if (_maxSize)
+    {
+        const size_t room = (_size < _maxSize) ? _maxSize - _size : 0;
+        if (len > room)
+            len = room;
+    }
+
+    if (!len || !grow(_size + len))
+    {
+        len = 0;
+        _truncated = true;
+        return NULL;
+    }
+
+    return _data + _size;
+}
+
+
+/**
+ *  \brief  Returns the number of bytes appended - less than len if truncated
+ */
+size_t OutputBuffer::Append(const char* data, size_t len)
+{
+    if (!len)
+        return 0;
+
+    size_t room = len;
+    char* dst = Reserve(room);
+    if (!dst)
+        return 0;
+
+    memcpy(dst, data, room);
+    _size += room;
+
+    if (room < len)
+        _truncated = true;
+
+    return room;
+}
+
+
+/**
+ *  \brief  Shrinks the data to size
+ */
+void OutputBuffer::Resize(size_t size)
+{
+    if (size < _size)
+        _size = size;
+}
+
+
+/**
+ *  \brief  Adds C-string termination to the data. The incomplete last line
+ *          of truncated output is dropped first so the parsers see whole lines.
+ */
+void OutputBuffer::Terminate()
+{
+    if (!_size)
+        return;
+
+    if (_truncated)
+    {
+        size_t size = _size;
+        while (size && _data[size - 1] != '\n')
+            --size;
+
+        if (size)
+            _size = size;
+    }
+
+    // The termination is not counted against the max size
+    if (grow(_size + 1))
+        ++_size;
+
+    _data[_size - 1] = 0;
+}
+
+
+/**
+ *  \brief  Frees the data and removes the spill file
+ */
+void OutputBuffer::Clear()
+{
+    if (_hMap)
+    {
+        UnmapViewOfFile(_data);
+        CloseHandle(_hMap);
+        _hMap = NULL;
+    }
+
+    if (_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(_hFile);
+        _hFile = INVALID_HANDLE_VALUE;
+    }
+
+    std::vector<char>().swap(_mem);
+
+    _data       = NULL;
+    _size       = 0;
+    _capacity   = 0;
+    _truncated  = false;
+}
+
+
+/**
+ *  \brief
+ */
+void OutputBuffer::Swap(OutputBuffer& other)
+{
+    std::swap(_maxSize, other._maxSize);
+    std::swap(_truncated, other._truncated);
+    _mem.swap(other._mem);
+    std::swap(_hFile, other._hFile);
+    std::swap(_hMap, other._hMap);
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+    std::swap(_capacity, other._capacity);
+}
+
+
+/**
+ *  \brief  Makes room for size bytes growing the capacity geometrically
+ */
+bool OutputBuffer::grow(size_t size)
+{
+    if (size <= _capacity)
+        return true;
+
+    size_t capacity = std::max(size, _capacity * 2);
+
+    // No need to grow past the max size and the termination
+    if (_maxSize && size <= _maxSize + 1 && capacity > _maxSize + 1)
+        capacity = _maxSize + 1;
+
+    if (!IsSpilled() && capacity <= cSpillSize)
+    {
+        _mem.resize(capacity);
+        _data = _mem.data();
+        _capacity = capacity;
+
+        return true;
+    }
+
+    capacity = (capacity + cSpillGranularity - 1) / cSpillGranularity * cSpillGranularity;
+
+    return IsSpilled() ? remap(capacity) : spill(capacity);
+}
+
+
+/**
+ *  \brief  Moves the data from memory to a new spill file. The file is
+ *          temporary (kept in the system cache if possible) and is deleted
+ *          on close, also if Notepad++ crashes.
+ */
+bool OutputBuffer::spill(size_t capacity)
+{
+    CPath spillFile(MAX_PATH);
+    GetTempPath(MAX_PATH, spillFile.C_str());
+    spillFile.AutoFit();
+
+    spillFile += cPluginName;
+    CreateDirectory(spillFile.C_str(), NULL);
+
+    TCHAR name[64];
+    _sntprintf_s(name, _countof(name), _TRUNCATE, _T("\\Output_%lu_%ld.bin"),
+            GetCurrentProcessId(), InterlockedIncrement(&SpillId));
+    spillFile += name;
+
+    _hFile = CreateFile(spillFile.C_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (_hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    if (!remap(capacity))
+    {
+        CloseHandle(_hFile);
+        _hFile = INVALID_HANDLE_VALUE;
+        return false;
+    }
+
+    if (_size)
+        memcpy(_data, _mem.data(), _size);
+    std::vector<char>().swap(_mem);
+
+    return true;
+}
+
+
+/**
+ *  \brief  Extends the spill file to capacity and maps it. The previous view
+ *          is released only when the new one is in place so the data stays
+ *          valid on failure.
+ */
+bool OutputBuffer::remap(size_t capacity)
+{
+    const ULONGLONG size = capacity;
+
+    HANDLE hMap = CreateFileMapping(_hFile, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, NULL);
+    if (!hMap)
+        return false;
+
+    char* view = static_cast<char*>(MapViewOfFile(hMap, FILE_MAP_WRITE, 0, 0, capacity));
+    if (!view)
+    {
+        CloseHandle(hMap);
+        return false;
+    }
+
+    if (_hMap)
+    {
+        UnmapViewOfFile(_data);
+        CloseHandle(_hMap);
+    }
+
+    _hMap       = hMap;
+    _data       = view;
+    _capacity   = capacity;
+
+    return true;
+}
+
+} // namespace GTags
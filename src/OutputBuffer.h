@@ -0,0 +1,96 @@
+/**
+ *  \file
+ *  \brief  Process output buffer spilling to a memory-mapped temporary file
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <vector>
+
+
+namespace GTags
+{
+
+/**
+ *  \class  OutputBuffer
+ *  \brief  Growing buffer for the output of the commands. The data is kept
+ *          in memory up to cSpillSize and then moved to a temporary file
+ *          mapped in memory so the parsers can read it directly. Output
+ *          beyond the max size (if set) is dropped and the buffer is marked
+ *          as truncated. Not thread-safe - the producer fills it and hands
+ *          it over once done.
+ */
+class OutputBuffer
+{
+public:
+    OutputBuffer(size_t maxSize = 0);
+    ~OutputBuffer() { Clear(); }
+
+    // 0 means no limit
+    inline void MaxSize(size_t maxSize) { _maxSize = maxSize; }
+    inline size_t MaxSize() const { return _maxSize; }
+
+    char* Reserve(size_t& len);
+    inline void Commit(size_t len) { _size += len; }
+    size_t Append(const char* data, size_t len);
+    void Resize(size_t size);
+    void Terminate();
+    void Clear();
+    void Swap(OutputBuffer& other);
+
+    // NULL if empty
+    inline char* Data() { return _size ? _data : NULL; }
+    inline const char* Data() const { return _size ? _data : NULL; }
+    inline size_t Size() const { return _size; }
+    inline bool Empty() const { return !_size; }
+
+    inline bool IsSpilled() const { return (_hFile != INVALID_HANDLE_VALUE); }
+    inline bool IsTruncated() const { return _truncated; }
+
+private:
+    static const size_t cSpillSize;
+    static const size_t cSpillGranularity;
+
+    static volatile LONG SpillId;
+
+    OutputBuffer(const OutputBuffer&);
+    const OutputBuffer& operator=(const OutputBuffer&);
+
+    bool grow(size_t size);
+    bool spill(size_t capacity);
+    bool remap(size_t capacity);
+
+    size_t              _maxSize;
+    bool                _truncated;
+
+    std::vector<char>   _mem;
+    HANDLE              _hFile;
+    HANDLE              _hMap;
+
+    char*               _data;
+    size_t              _size;
+    size_t              _capacity;
+};
+
+} // namespace GTags
@@ -0,0 +1,1381 @@
+/**
+ *  \file
+ *  \brief  In-memory tags of the modified (unsaved) buffers shadowing the database ones
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include <string.h>
+#include <regex>
+#include <algorithm>
+#include <unordered_set>
+#include "GTags.h"
+#include "Config.h"
+#include "CmdEngine.h"
+#include "CmdTrace.h"
+#include "GrepEngine.h"
+#include "DeltaLog.h"
+#include "OverlayIndex.h"
+
+
+namespace
+{
+
+const TCHAR cTagBuffer[]    = _T("Tag Unsaved Buffer");
+const TCHAR cTagSaved[]     = _T("Tag Saved File");
+
+
+/**
+ *  \brief
+ */
+inline char foldCase(char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch;
+}
+
+
+/**
+ *  \brief  Paths are compared case-insensitively and regardless of the separator
+ */
+inline char foldPathChar(char ch)
+{
+    return (ch == '\\') ? '/' : foldCase(ch);
+}
+
+
+/**
+ *  \class  TagMatcher
+ *  \brief  Matches the overlay tag names the way global matches the database ones
+ */
+class TagMatcher
+{
+public:
+    TagMatcher(const char* tag, bool ignoreCase, bool regExp, bool prefix);
+    ~TagMatcher() {}
+
+    bool Matches(const std::string& name) const;
+
+private:
+    TagMatcher(const TagMatcher&);
+    const TagMatcher& operator=(const TagMatcher&);
+
+    std::string                 _tag;
+    const bool                  _ignoreCase;
+    const bool                  _prefix;
+    bool                        _valid;
+    std::unique_ptr<std::regex> _regex;
+};
+
+
+/**
+ *  \brief
+ */
+TagMatcher::TagMatcher(const char* tag, bool ignoreCase, bool regExp, bool prefix) :
+    _tag(tag), _ignoreCase(ignoreCase), _prefix(prefix), _valid(true)
+{
+    if (!regExp)
+        return;
+
+    try
+    {
+        std::regex::flag_type flags = std::regex::extended | std::regex::nosubs;
+        if (ignoreCase)
+            flags |= std::regex::icase;
+
+        _regex.reset(new std::regex(tag, flags));
+    }
+    catch (const std::regex_error&)
+    {
+        _valid = false;
+    }
+}
+
+
+/**
+ *  \brief
+ */
+bool TagMatcher::Matches(const std::string& name) const
+{
+    if (!_valid)
+        return false;
+
+    if (_regex)
+        return std::regex_search(name, *_regex);
+
+    if (_prefix ? (name.size() < _tag.size()) : (name.size() != _tag.size()))
+        return false;
+
+    if (!_ignoreCase)
+        return !name.compare(0, _tag.size(), _tag);
+
+    for (size_t i = 0; i < _tag.size(); ++i)
+        if (foldCase(name[i]) != foldCase(_tag[i]))
+            return false;
+
+    return true;
+}
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+const unsigned  OverlayIndex::cMaxDeltaFiles    = 64;
+const size_t    OverlayIndex::cMaxDeltaSize     = 4 * 1024 * 1024;
+
+/**
+ *  \brief  Temp folder where the database tree is mirrored for tagging the buffers
+ */
+void OverlayIndex::MirrorRoot(const CPath& dbPath, CPath& root)
+{
+    root.Resize(MAX_PATH);
+    GetTempPath(MAX_PATH, root.C_str());
+    root.AutoFit();
+
+    root += cPluginName;
+    root += _T("\\");
+
+    // FNV-1a of the database path keeps the mirrors of different databases apart
+    unsigned hash = 2166136261U;
+    for (const TCHAR* pCh = dbPath.C_str(); *pCh; ++pCh)
+    {
+        hash ^= (unsigned)*pCh;
+        hash *= 16777619U;
+    }
+
+    TCHAR dir[16];
+    _sntprintf_s(dir, _countof(dir), _TRUNCATE, _T("%08X\\"), hash);
+    root += dir;
+}
+
+
+/**
+ *  \brief  Tags the buffer text in the background - called on the UI thread,
+ *          debounced on edits, with the file database locked for reading.
+ *          The lock is released when done.
+ */
+void OverlayIndex::Update(const DbHandle& db, const CPath& file, const CTextA& text)
+{
+    const LONGLONG time = CmdTiming::Now();
+    const PathId fileId = PathTable::Get().Intern(file);
+
+    for (auto iJob = _jobs.begin(); iJob != _jobs.end(); ++iJob)
+    {
+        if (iJob->_pathId == fileId && !iJob->_delta)
+        {
+            iJob->_pending  = true;
+            iJob->_text     = text;
+            iJob->_time     = time;
+
+            // Superseded - the newer text is tagged once the running job stops
+            iJob->_cmd->Cancel();
+
+            DbManager::Get().PutDb(db);
+
+            return;
+        }
+    }
+
+    start(db, file, text, time, false);
+}
+
+
+/**
+ *  \brief  Removes the file overlay unless it was taken after olderThan (0 - always)
+ */
+void OverlayIndex::Remove(const CPath& file, LONGLONG olderThan)
+{
+    const PathId fileId = PathTable::Get().Intern(file);
+
+    AUTOLOCK(_lock);
+
+    for (auto iTags = _overlays.begin(); iTags != _overlays.end(); ++iTags)
+    {
+        if ((*iTags)->_pathId == fileId)
+        {
+            if (!olderThan || (*iTags)->_time < olderThan)
+            {
+                _overlays.erase(iTags);
+                InterlockedIncrement(&_version);
+            }
+
+            break;
+        }
+    }
+}
+
+
+/**
+ *  \brief
+ */
+bool OverlayIndex::Contains(const CPath& file) const
+{
+    const PathId fileId = PathTable::Get().Intern(file);
+
+    AUTOLOCK(_lock);
+
+    for (const auto& tags : _overlays)
+        if (tags->_pathId == fileId)
+            return true;
+
+    return false;
+}
+
+
+/**
+ *  \brief  Tags the saved file into the delta of the databases it is in
+ *          (innermost first) - called on the UI thread with the databases
+ *          locked for writing, the locks are released when done. Enclosing
+ *          databases using the same parser share the tags of the innermost
+ *          one - the file is tagged once for all of them. Returns false if
+ *          the file cannot be read - the databases are still locked then and
+ *          should be updated the usual way.
+ */
+bool OverlayIndex::AddDelta(const std::vector<DbHandle>& dbs, const CPath& file)
+{
+    size_t size;
+    const char* buf = GrepEngine::MapFile(file, size, false);
+    if (buf == NULL)
+        return false;
+
+    const CTextA text(buf, (unsigned)size);
+    UnmapViewOfFile(buf);
+
+    const LONGLONG time = CmdTiming::Now();
+    const PathId fileId = PathTable::Get().Intern(file);
+
+    std::vector<bool> grouped(dbs.size(), false);
+
+    for (size_t i = 0; i < dbs.size(); ++i)
+    {
+        if (grouped[i])
+            continue;
+
+        const DbHandle& db = dbs[i];
+        const int parserIdx = db->GetConfig()->_parserIdx;
+
+        std::vector<DbHandle> sharedDbs;
+
+        for (size_t j = i + 1; j < dbs.size(); ++j)
+        {
+            if (!grouped[j] && dbs[j]->GetConfig()->_parserIdx == parserIdx)
+            {
+                grouped[j] = true;
+                sharedDbs.push_back(dbs[j]);
+            }
+        }
+
+        auto iJob = _jobs.begin();
+        for (; iJob != _jobs.end(); ++iJob)
+            if (iJob->_delta && iJob->_pathId == fileId && iJob->_dbPathId == db->GetPathId())
+                break;
+
+        if (iJob != _jobs.end())
+        {
+            iJob->_pending  = true;
+            iJob->_text     = text;
+            iJob->_time     = time;
+
+            DbManager::Get().PutDb(db);
+
+            for (const auto& sharedDb : sharedDbs)
+            {
+                bool known = false;
+                for (const auto& jobDb : iJob->_sharedDbs)
+                    known = known || (jobDb->GetPathId() == sharedDb->GetPathId());
+
+                // The job keeps the databases locked until it finishes
+                if (known)
+                    DbManager::Get().PutDb(sharedDb);
+                else
+                    iJob->_sharedDbs.push_back(sharedDb);
+            }
+        }
+        else if (!start(db, file, text, time, true, sharedDbs))
+        {
+            updateInstead(db->GetPath(), file);
+
+            for (const auto& sharedDb : sharedDbs)
+            {
+                DbManager::Get().PutDb(sharedDb);
+                updateInstead(sharedDb->GetPath(), file);
+            }
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ *  \brief  Replays the database delta log - called when the database is opened.
+ *          The loaded files are folded into the database on the next Compact().
+ */
+void OverlayIndex::LoadDelta(const CPath& dbPath, PathId dbPathId)
+{
+    DeltaLog log;
+    if (!log.Open(dbPath))
+        return;
+
+    std::vector<std::shared_ptr<FileTags>> files;
+    unsigned records = 0;
+
+    size_t pos = 0;
+    const char* record;
+    unsigned len;
+
+    while (log.Next(pos, record, len))
+    {
+        std::shared_ptr<FileTags> tags(new FileTags);
+        bool dropped;
+
+        if (!fromRecord(record, len, *tags, dropped))
+            break;
+
+        ++records;
+
+        auto iFile = files.begin();
+        for (; iFile != files.end(); ++iFile)
+            if ((*iFile)->_file == tags->_file)
+                break;
+
+        if (iFile != files.end())
+        {
+            if (dropped)
+                files.erase(iFile);
+            else
+                *iFile = tags;
+        }
+        else if (!dropped)
+        {
+            files.push_back(tags);
+        }
+    }
+
+    log.Close();
+
+    std::vector<std::vector<char>> liveRecords;
+
+    AUTOLOCK(_lock);
+
+    auto iDelta = findDelta(dbPathId);
+    if (iDelta != _deltas.end())
+        return;
+
+    Delta delta;
+    delta._dbPath       = dbPath;
+    delta._dbPathId     = dbPathId;
+    delta._size         = 0;
+    delta._oldest       = 0;
+    delta._compacting   = false;
+
+    for (auto& tags : files)
+    {
+        CText file(tags->_file.c_str());
+        for (TCHAR* pCh = file.C_str(); *pCh; ++pCh)
+            if (*pCh == _T('/'))
+                *pCh = _T('\\');
+
+        tags->_path     = dbPath;
+        tags->_path     += file;
+        tags->_dbPath   = dbPath;
+        tags->_pathId   = PathTable::Get().Intern(tags->_path);
+        tags->_dbPathId = dbPathId;
+        tags->_time     = 0;
+
+        delta._size += tagsSize(*tags);
+        delta._files.push_back(tags);
+
+        if (records > files.size())
+        {
+            liveRecords.push_back(std::vector<char>());
+            toRecord(*tags, liveRecords.back());
+        }
+    }
+
+    // Drop the replaced and folded records
+    if (records > files.size())
+        DeltaLog::Rewrite(dbPath, liveRecords);
+
+    if (!delta._files.empty())
+    {
+        _deltas.push_back(delta);
+        InterlockedIncrement(&_version);
+    }
+}
+
+
+/**
+ *  \brief  The file database update has completed - removes the file from
+ *          the delta unless saved again after olderThan. updatesDone is set
+ *          when there are no more scheduled updates for the database.
+ */
+void OverlayIndex::Folded(const CPath& file, PathId dbPathId, LONGLONG olderThan, bool updatesDone)
+{
+    const PathId fileId = PathTable::Get().Intern(file);
+
+    AUTOLOCK(_lock);
+
+    auto iDelta = findDelta(dbPathId);
+    if (iDelta == _deltas.end())
+        return;
+
+    if (updatesDone)
+        iDelta->_compacting = false;
+
+    for (auto iTags = iDelta->_files.begin(); iTags != iDelta->_files.end(); ++iTags)
+    {
+        if ((*iTags)->_pathId != fileId)
+            continue;
+
+        if ((*iTags)->_time >= olderThan)
+            return;
+
+        std::vector<char> record;
+        droppedRecord(**iTags, record);
+
+        iDelta->_size -= tagsSize(**iTags);
+        iDelta->_files.erase(iTags);
+
+        InterlockedIncrement(&_version);
+
+        if (iDelta->_files.empty())
+        {
+            DeltaLog::Delete(iDelta->_dbPath);
+            _deltas.erase(iDelta);
+            return;
+        }
+
+        DeltaLog::Append(iDelta->_dbPath, record);
+
+        iDelta->_oldest = iDelta->_files.front()->_time;
+        for (const auto& tags : iDelta->_files)
+            if (tags->_time < iDelta->_oldest)
+                iDelta->_oldest = tags->_time;
+
+        return;
+    }
+}
+
+
+/**
+ *  \brief  Drops the files added to the delta before olderThan (0 - all) -
+ *          the database was created anew
+ */
+void OverlayIndex::DropDelta(const CPath& dbPath, PathId dbPathId, LONGLONG olderThan)
+{
+    AUTOLOCK(_lock);
+
+    auto iDelta = findDelta(dbPathId);
+    if (iDelta == _deltas.end())
+    {
+        DeltaLog::Delete(dbPath);
+        return;
+    }
+
+    std::vector<std::vector<char>> records;
+
+    for (auto iTags = iDelta->_files.begin(); iTags != iDelta->_files.end();)
+    {
+        if (!olderThan || (*iTags)->_time < olderThan)
+        {
+            iDelta->_size -= tagsSize(**iTags);
+            iTags = iDelta->_files.erase(iTags);
+        }
+        else
+        {
+            records.push_back(std::vector<char>());
+            toRecord(**iTags, records.back());
+            ++iTags;
+        }
+    }
+
+    DeltaLog::Rewrite(dbPath, records);
+
+    if (iDelta->_files.empty())
+        _deltas.erase(iDelta);
+
+    InterlockedIncrement(&_version);
+}
+
+
+/**
+ *  \brief
+ */
+bool OverlayIndex::InDelta(const CPath& file) const
+{
+    const PathId fileId = PathTable::Get().Intern(file);
+
+    AUTOLOCK(_lock);
+
+    for (const auto& delta : _deltas)
+        for (const auto& tags : delta._files)
+            if (tags->_pathId == fileId)
+                return true;
+
+    return false;
+}
+
+
+/**
+ *  \brief  Called on the UI thread
+ */
+bool OverlayIndex::Compact(unsigned maxAgeMs)
+{
+    const LONGLONG now = CmdTiming::Now();
+
+    std::vector<Compaction> due;
+
+    {
+        AUTOLOCK(_lock);
+
+        if (_deltas.empty())
+            return false;
+
+        for (auto& delta : _deltas)
+        {
+            if (!delta._compacting && (!maxAgeMs || CmdTiming::ToMs(now - delta._oldest) >= maxAgeMs))
+            {
+                due.push_back(Compaction());
+                startCompaction(delta, due.back());
+            }
+        }
+    }
+
+    for (const auto& compaction : due)
+        compact(compaction);
+
+    return true;
+}
+
+
+/**
+ *  \brief  Replaces the command results for the files with overlays by the
+ *          overlay tags - called from the command thread before parsing
+ */
+void OverlayIndex::Merge(const CmdPtr_t& cmd) const
+{
+    if (!cmd->Db())
+        return;
+
+    std::vector<FileTagsPtr> overlays;
+
+    {
+        AUTOLOCK(_lock);
+
+        for (const auto& tags : _overlays)
+            if (tags->_dbPathId == cmd->Db()->GetPathId())
+                overlays.push_back(tags);
+
+        const size_t buffers = overlays.size();
+
+        // The saved files delta is under the buffer overlays
+        for (const auto& delta : _deltas)
+        {
+            if (delta._dbPathId != cmd->Db()->GetPathId())
+                continue;
+
+            for (const auto& tags : delta._files)
+            {
+                size_t i = 0;
+                while (i < buffers && overlays[i]->_pathId != tags->_pathId)
+                    ++i;
+
+                if (i == buffers)
+                    overlays.push_back(tags);
+            }
+        }
+    }
+
+    if (overlays.empty())
+        return;
+
+    if (cmd->Id() == AUTOCOMPLETE)
+        mergeNames(cmd, overlays);
+    else if (cmd->Id() == FIND_DEFINITION || cmd->Id() == FIND_REFERENCE)
+        mergeLines(cmd, overlays);
+}
+
+
+/**
+ *  \brief
+ */
+int OverlayIndex::Parser::Parse(const CmdPtr_t& cmd)
+{
+    const char* result = cmd->Result();
+    const unsigned len = cmd->ResultLen();
+    const unsigned definitionsEnd = (_definitionsLen < len) ? _definitionsLen : len;
+
+    _tags->_definitions.clear();
+    _tags->_references.clear();
+
+    parseLines(result, result + definitionsEnd, _tags->_definitions);
+    parseLines(result + definitionsEnd, result + len, _tags->_references);
+
+    auto less = [](const Tag& tag1, const Tag& tag2) { return tag1._name < tag2._name; };
+
+    std::stable_sort(_tags->_definitions.begin(), _tags->_definitions.end(), less);
+    std::stable_sort(_tags->_references.begin(), _tags->_references.end(), less);
+
+    return _tags->_definitions.size() + _tags->_references.size();
+}
+
+
+/**
+ *  \brief  ctags -x format: name, line number, file and the line text
+ *          separated by spaces
+ */
+void OverlayIndex::Parser::parseLines(const char* begin, const char* end, std::vector<Tag>& tags) const
+{
+    const std::string& file = _tags->_file;
+
+    for (const char* lineBegin = begin; lineBegin < end;)
+    {
+        const char* lineEnd = lineBegin;
+        while (lineEnd < end && *lineEnd != '\n')
+            ++lineEnd;
+
+        const char* next = lineEnd + 1;
+        if (lineEnd > lineBegin && *(lineEnd - 1) == '\r')
+            --lineEnd;
+
+        const char* pCh = lineBegin;
+        while (pCh < lineEnd && *pCh != ' ' && *pCh != '\t')
+            ++pCh;
+
+        Tag tag;
+        tag._name.assign(lineBegin, pCh);
+        tag._line = 0;
+
+        while (pCh < lineEnd && (*pCh == ' ' || *pCh == '\t'))
+            ++pCh;
+
+        const char* number = pCh;
+        for (; pCh < lineEnd && *pCh >= '0' && *pCh <= '9'; ++pCh)
+            tag._line = tag._line * 10 + (*pCh - '0');
+
+        if (!tag._name.empty() && pCh > number)
+        {
+            while (pCh < lineEnd && (*pCh == ' ' || *pCh == '\t'))
+                ++pCh;
+
+            // The file name may contain spaces so skip it as known
+            if ((unsigned)(lineEnd - pCh) >= file.size() && !file.compare(0, file.size(), pCh, file.size()))
+                pCh += file.size();
+            else
+                while (pCh < lineEnd && *pCh != ' ' && *pCh != '\t')
+                    ++pCh;
+
+            while (pCh < lineEnd && (*pCh == ' ' || *pCh == '\t'))
+                ++pCh;
+
+            tag._text.assign(pCh, lineEnd);
+            tags.push_back(tag);
+        }
+
+        lineBegin = next;
+    }
+}
+
+
+/**
+ *  \brief  The same command continues with the references in the file
+ */
+void OverlayIndex::definitionsCB(const CmdPtr_t& cmd)
+{
+    OverlayIndex& overlay = Get();
+    auto iJob = overlay.findJob(cmd);
+
+    if (cmd->Status() == OK && iJob != overlay._jobs.end())
+    {
+        cmd->Parser(ParserPtr_t(new Parser(iJob->_tags, cmd->Result() ? cmd->ResultLen() : 0)));
+        cmd->Id(OVERLAY_REFERENCES);
+
+        CmdEngine::Run(cmd, tagsCB);
+        return;
+    }
+
+    overlay.finish(cmd);
+}
+
+
+/**
+ *  \brief
+ */
+void OverlayIndex::tagsCB(const CmdPtr_t& cmd)
+{
+    Get().finish(cmd);
+}
+
+
+/**
+ *  \brief  Checks if the result line (path:line:text) is for the file
+ */
+bool OverlayIndex::pathMatches(const char* line, const std::string& file)
+{
+    if (line[0] == '.' && (line[1] == '/' || line[1] == '\\'))
+        line += 2;
+
+    for (size_t i = 0; i < file.size(); ++i)
+        if (foldPathChar(line[i]) != foldPathChar(file[i]))
+            return false;
+
+    return (line[file.size()] == ':');
+}
+
+
+/**
+ *  \brief
+ */
+std::list<OverlayIndex::Job>::iterator OverlayIndex::findJob(const CmdPtr_t& cmd)
+{
+    auto iJob = _jobs.begin();
+
+    for (; iJob != _jobs.end(); ++iJob)
+        if (iJob->_cmd == cmd)
+            break;
+
+    return iJob;
+}
+
+
+/**
+ *  \brief  Writes the text to the database mirror and runs global on it.
+ *          The database stays locked until the tagging is done.
+ */
+bool OverlayIndex::start(const DbHandle& db, const CPath& file, const CTextA& text, LONGLONG time, bool delta,
+        const std::vector<DbHandle>& sharedDbs)
+{
+    const CPath& dbPath = db->GetPath();
+
+    CPath mirror;
+    MirrorRoot(dbPath, mirror);
+    mirror += file.C_str() + dbPath.Len();
+
+    {
+        CPath dir(mirror);
+
+        for (TCHAR* pCh = dir.C_str() + 1; *pCh; ++pCh)
+        {
+            if (*pCh == _T('\\') || *pCh == _T('/'))
+            {
+                const TCHAR sep = *pCh;
+                *pCh = 0;
+                CreateDirectory(dir.C_str(), NULL);
+                *pCh = sep;
+            }
+        }
+    }
+
+    FILE* fp;
+    _tfopen_s(&fp, mirror.C_str(), _T("wb"));
+    if (fp == NULL)
+    {
+        DbManager::Get().PutDb(db);
+        return false;
+    }
+
+    fwrite(text.C_str(), 1, text.Len(), fp);
+    fclose(fp);
+
+    Job job;
+    job._delta      = delta;
+    job._sharedDbs  = sharedDbs;
+    job._path       = file;
+    job._dbPath     = dbPath;
+    job._pathId     = PathTable::Get().Intern(file);
+    job._dbPathId   = db->GetPathId();
+    job._pending    = false;
+    job._time       = time;
+
+    job._tags.reset(new FileTags);
+    job._tags->_path        = file;
+    job._tags->_dbPath      = dbPath;
+    job._tags->_pathId      = job._pathId;
+    job._tags->_dbPathId    = job._dbPathId;
+    job._tags->_file        = relativeFile(file, dbPath);
+    job._tags->_time        = time;
+
+    job._file = job._tags->_file.c_str();
+
+    CmdPtr_t cmd(new Cmd(OVERLAY_DEFINITIONS, delta ? cTagSaved : cTagBuffer, db, NULL, job._file.C_str()));
+
+    job._cmd = cmd;
+    _jobs.push_back(job);
+
+    // Ctags parser doesn't support references
+    if (db->GetConfig()->_parserIdx == DbConfig::CTAGS_PARSER)
+    {
+        cmd->Parser(ParserPtr_t(new Parser(job._tags, (unsigned)-1)));
+        CmdEngine::Run(cmd, tagsCB);
+    }
+    else
+    {
+        CmdEngine::Run(cmd, definitionsCB);
+    }
+
+    return true;
+}
+
+
+/**
+ *  \brief  Publishes the overlay and starts tagging the newest text if the
+ *          buffer was changed meanwhile
+ */
+void OverlayIndex::finish(const CmdPtr_t& cmd)
+{
+    auto iJob = findJob(cmd);
+
+    DbManager::Get().PutDb(cmd->Db());
+
+    if (iJob == _jobs.end())
+        return;
+
+    for (const auto& sharedDb : iJob->_sharedDbs)
+        DbManager::Get().PutDb(sharedDb);
+
+    CPath mirror;
+    MirrorRoot(iJob->_dbPath, mirror);
+    mirror += iJob->_path.C_str() + iJob->_dbPath.Len();
+    DeleteFile(mirror.C_str());
+
+    if (iJob->_delta)
+    {
+        if (cmd->Status() == OK || cmd->Status() == PARSE_EMPTY)
+        {
+            publishDelta(iJob->_tags);
+
+            // The tags text doesn't depend on the database - only the file path does
+            for (const auto& sharedDb : iJob->_sharedDbs)
+            {
+                std::shared_ptr<FileTags> tags(new FileTags(*iJob->_tags));
+                tags->_dbPath   = sharedDb->GetPath();
+                tags->_dbPathId = sharedDb->GetPathId();
+                tags->_file     = relativeFile(tags->_path, tags->_dbPath);
+
+                publishDelta(tags);
+            }
+        }
+        else
+        {
+            updateInstead(iJob->_dbPath, iJob->_path);
+
+            for (const auto& sharedDb : iJob->_sharedDbs)
+                updateInstead(sharedDb->GetPath(), iJob->_path);
+        }
+    }
+    else if (cmd->Status() == OK || cmd->Status() == PARSE_EMPTY)
+    {
+        AUTOLOCK(_lock);
+
+        auto iTags = _overlays.begin();
+        for (; iTags != _overlays.end(); ++iTags)
+            if ((*iTags)->_pathId == iJob->_pathId)
+                break;
+
+        if (iTags != _overlays.end())
+            *iTags = iJob->_tags;
+        else
+            _overlays.push_back(iJob->_tags);
+
+        InterlockedIncrement(&_version);
+    }
+
+    const Job job = *iJob;
+    _jobs.erase(iJob);
+
+    if (!job._pending)
+        return;
+
+    if (!job._delta)
+    {
+        bool success;
+        DbHandle db = DbManager::Get().GetDb(job._path, false, &success);
+
+        if (db && success)
+            start(db, job._path, job._text, job._time, false);
+
+        return;
+    }
+
+    std::vector<DbHandle> dbs;
+
+    for (size_t i = 0; i <= job._sharedDbs.size(); ++i)
+    {
+        const CPath& dbPath = i ? job._sharedDbs[i - 1]->GetPath() : job._dbPath;
+
+        bool success;
+        DbHandle db = DbManager::Get().GetDbAt(dbPath, false, &success);
+
+        if (db && success)
+            dbs.push_back(db);
+        else if (db)
+            db->ScheduleUpdate(job._path);
+    }
+
+    if (dbs.empty())
+        return;
+
+    const std::vector<DbHandle> sharedDbs(dbs.begin() + 1, dbs.end());
+
+    if (!start(dbs[0], job._path, job._text, job._time, true, sharedDbs))
+    {
+        updateInstead(dbs[0]->GetPath(), job._path);
+
+        for (const auto& sharedDb : sharedDbs)
+        {
+            DbManager::Get().PutDb(sharedDb);
+            updateInstead(sharedDb->GetPath(), job._path);
+        }
+    }
+}
+
+
+/**
+ *  \brief  Replaces the saved file tags in the database delta and logs them.
+ *          The buffer overlay taken before the save is dropped.
+ */
+void OverlayIndex::publishDelta(const FileTagsPtr& tags)
+{
+    std::vector<char> record;
+    toRecord(*tags, record);
+
+    const size_t size = tagsSize(*tags);
+    Compaction full;
+
+    {
+        AUTOLOCK(_lock);
+
+        auto iDelta = findDelta(tags->_dbPathId);
+        if (iDelta == _deltas.end())
+        {
+            Delta delta;
+            delta._dbPath       = tags->_dbPath;
+            delta._dbPathId     = tags->_dbPathId;
+            delta._size         = 0;
+            delta._oldest       = tags->_time;
+            delta._compacting   = false;
+
+            iDelta = _deltas.insert(_deltas.end(), delta);
+        }
+
+        auto iTags = iDelta->_files.begin();
+        for (; iTags != iDelta->_files.end(); ++iTags)
+            if ((*iTags)->_pathId == tags->_pathId)
+                break;
+
+        if (iTags != iDelta->_files.end())
+        {
+            iDelta->_size -= tagsSize(**iTags);
+            *iTags = tags;
+        }
+        else
+        {
+            iDelta->_files.push_back(tags);
+        }
+
+        iDelta->_size += size;
+        if (tags->_time < iDelta->_oldest)
+            iDelta->_oldest = tags->_time;
+
+        for (auto iOverlay = _overlays.begin(); iOverlay != _overlays.end(); ++iOverlay)
+        {
+            if ((*iOverlay)->_pathId == tags->_pathId)
+            {
+                if ((*iOverlay)->_time < tags->_time)
+                    _overlays.erase(iOverlay);
+                break;
+            }
+        }
+
+        DeltaLog::Append(iDelta->_dbPath, record);
+        InterlockedIncrement(&_version);
+
+        if (!iDelta->_compacting &&
+                (iDelta->_files.size() > cMaxDeltaFiles || iDelta->_size > cMaxDeltaSize))
+            startCompaction(*iDelta, full);
+    }
+
+    if (!full._files.empty())
+        compact(full);
+}
+
+
+/**
+ *  \brief  Updates the database with the file the usual way when it cannot
+ *          go to the delta
+ */
+void OverlayIndex::updateInstead(const CPath& dbPath, const CPath& file)
+{
+    bool success;
+    DbHandle db = DbManager::Get().GetDbAt(dbPath, true, &success);
+
+    if (db && success)
+        db->Update(file);
+    else if (db)
+        db->ScheduleUpdate(file);
+}
+
+
+/**
+ *  \brief  Marks the delta as being folded and copies out what compact()
+ *          needs - call with _lock held, the delta may be gone after it is
+ *          released
+ */
+void OverlayIndex::startCompaction(Delta& delta, Compaction& compaction)
+{
+    delta._compacting = true;
+
+    compaction._dbPath      = delta._dbPath;
+    compaction._dbPathId    = delta._dbPathId;
+
+    for (const auto& tags : delta._files)
+        compaction._files.push_back(tags->_path);
+}
+
+
+/**
+ *  \brief  Schedules the database update of each delta file - the updates
+ *          run one after another once the database is not in use. The files
+ *          are removed from the delta as their updates complete.
+ */
+void OverlayIndex::compact(const Compaction& compaction)
+{
+    bool success;
+    DbHandle db = DbManager::Get().GetDbAt(compaction._dbPath, false, &success);
+
+    // The database is gone
+    if (!db)
+    {
+        DropDelta(compaction._dbPath, compaction._dbPathId);
+        return;
+    }
+
+    for (const auto& file : compaction._files)
+        db->ScheduleUpdate(file);
+
+    if (success)
+        DbManager::Get().PutDb(db);
+}
+
+
+/**
+ *  \brief  Call with _lock held
+ */
+std::list<OverlayIndex::Delta>::iterator OverlayIndex::findDelta(PathId dbPathId)
+{
+    auto iDelta = _deltas.begin();
+
+    for (; iDelta != _deltas.end(); ++iDelta)
+        if (iDelta->_dbPathId == dbPathId)
+            break;
+
+    return iDelta;
+}
+
+
+/**
+ *  \brief
+ */
+size_t OverlayIndex::tagsSize(const FileTags& tags)
+{
+    size_t size = tags._file.size();
+
+    for (const auto& tag : tags._definitions)
+        size += tag._name.size() + tag._text.size() + sizeof(unsigned) + 2;
+
+    for (const auto& tag : tags._references)
+        size += tag._name.size() + tag._text.size() + sizeof(unsigned) + 2;
+
+    return size;
+}
+
+
+/**
+ *  \brief  Record is 'T', the NUL-terminated file, the definitions and the
+ *          references count and the tags - line, name and text each
+ */
+void OverlayIndex::toRecord(const FileTags& tags, std::vector<char>& record)
+{
+    record.clear();
+    record.reserve(tagsSize(tags) + 2 + 2 * sizeof(unsigned));
+
+    auto appendUnsigned = [&record](unsigned val)
+    {
+        const char* pVal = reinterpret_cast<const char*>(&val);
+        record.insert(record.end(), pVal, pVal + sizeof(val));
+    };
+
+    auto appendString = [&record](const std::string& str)
+    {
+        record.insert(record.end(), str.begin(), str.end());
+        record.push_back(0);
+    };
+
+    record.push_back('T');
+    appendString(tags._file);
+    appendUnsigned((unsigned)tags._definitions.size());
+    appendUnsigned((unsigned)tags._references.size());
+
+    for (const auto& tag : tags._definitions)
+    {
+        appendUnsigned(tag._line);
+        appendString(tag._name);
+        appendString(tag._text);
+    }
+
+    for (const auto& tag : tags._references)
+    {
+        appendUnsigned(tag._line);
+        appendString(tag._name);
+        appendString(tag._text);
+    }
+}
+
+
+/**
+ *  \brief  The file path relative to the database root the way global outputs it
+ */
+std::string OverlayIndex::relativeFile(const CPath& file, const CPath& dbPath)
+{
+    std::string relative(CTextA(file.C_str() + dbPath.Len()).C_str());
+
+    for (auto& ch : relative)
+        if (ch == '\\')
+            ch = '/';
+
+    return relative;
+}
+
+
+/**
+ *  \brief  Record is 'D' and the NUL-terminated file - it was folded into the database
+ */
+void OverlayIndex::droppedRecord(const FileTags& tags, std::vector<char>& record)
+{
+    record.clear();
+    record.push_back('D');
+    record.insert(record.end(), tags._file.begin(), tags._file.end());
+    record.push_back(0);
+}
+
+
+/**
+ *  \brief  Returns false if the record is malformed
+ */
+bool OverlayIndex::fromRecord(const char* record, unsigned len, FileTags& tags, bool& dropped)
+{
+    const char* const end = record + len;
+
+    auto readUnsigned = [&record, end](unsigned& val) -> bool
+    {
+        if ((size_t)(end - record) < sizeof(val))
+            return false;
+
+        memcpy(&val, record, sizeof(val));
+        record += sizeof(val);
+        return true;
+    };
+
+    auto readString = [&record, end](std::string& str) -> bool
+    {
+        const char* strEnd = static_cast<const char*>(memchr(record, 0, end - record));
+        if (strEnd == NULL)
+            return false;
+
+        str.assign(record, strEnd);
+        record = strEnd + 1;
+        return true;
+    };
+
+    if (len < 2 || (*record != 'T' && *record != 'D'))
+        return false;
+
+    dropped = (*record++ == 'D');
+
+    if (!readString(tags._file))
+        return false;
+
+    if (dropped)
+        return true;
+
+    unsigned definitions, references;
+    if (!readUnsigned(definitions) || !readUnsigned(references))
+        return false;
+
+    // Each tag takes at least 6 bytes
+    if ((size_t)definitions + references > (size_t)(end - record) / 6)
+        return false;
+
+    tags._definitions.resize(definitions);
+    tags._references.resize(references);
+
+    for (auto& tag : tags._definitions)
+        if (!readUnsigned(tag._line) || !readString(tag._name) || !readString(tag._text))
+            return false;
+
+    for (auto& tag : tags._references)
+        if (!readUnsigned(tag._line) || !readString(tag._name) || !readString(tag._text))
+            return false;
+
+    return true;
+}
+
+
+/**
+ *  \brief  Result lines are path:line:text
+ */
+void OverlayIndex::mergeLines(const CmdPtr_t& cmd, const std::vector<FileTagsPtr>& overlays) const
+{
+    const CTextA tag(cmd->Tag().C_str());
+    const TagMatcher matcher(tag.C_str(), cmd->IgnoreCase(), cmd->RegExp(), false);
+    const bool definitions = (cmd->Id() == FIND_DEFINITION);
+
+    std::vector<char> merged;
+
+    if (cmd->Result())
+    {
+        const char* result = cmd->Result();
+        merged.reserve(cmd->ResultLen() + 1);
+
+        for (const char* lineBegin = result; *lineBegin;)
+        {
+            const char* lineEnd = strchr(lineBegin, '\n');
+            lineEnd = lineEnd ? lineEnd + 1 : lineBegin + strlen(lineBegin);
+
+            bool shadowed = false;
+            for (const auto& tags : overlays)
+            {
+                if (pathMatches(lineBegin, tags->_file))
+                {
+                    shadowed = true;
+                    break;
+                }
+            }
+
+            if (!shadowed)
+                merged.insert(merged.end(), lineBegin, lineEnd);
+
+            lineBegin = lineEnd;
+        }
+    }
+
+    for (const auto& tags : overlays)
+    {
+        const std::vector<Tag>& list = definitions ? tags->_definitions : tags->_references;
+
+        for (const auto& entry : list)
+        {
+            if (!matcher.Matches(entry._name))
+                continue;
+
+            char line[16];
+            _snprintf_s(line, _countof(line), _TRUNCATE, ":%u:", entry._line);
+
+            merged.insert(merged.end(), tags->_file.begin(), tags->_file.end());
+            merged.insert(merged.end(), line, line + strlen(line));
+            merged.insert(merged.end(), entry._text.begin(), entry._text.end());
+            merged.push_back('\n');
+        }
+    }
+
+    if (merged.empty())
+    {
+        cmd->ClearResult();
+    }
+    else
+    {
+        merged.push_back(0);
+        cmd->SetResult(merged);
+    }
+}
+
+
+/**
+ *  \brief  Result lines are the names starting with the tag. Names only
+ *          defined in the saved version of the file are not removed as
+ *          they may be defined in other files too.
+ */
+void OverlayIndex::mergeNames(const CmdPtr_t& cmd, const std::vector<FileTagsPtr>& overlays) const
+{
+    const CTextA tag(cmd->Tag().C_str());
+    const TagMatcher matcher(tag.C_str(), cmd->IgnoreCase(), false, true);
+
+    std::unordered_set<std::string> names;
+
+    for (const auto& tags : overlays)
+    {
+        auto iTag = tags->_definitions.begin();
+
+        if (!cmd->IgnoreCase())
+            iTag = std::lower_bound(tags->_definitions.begin(), tags->_definitions.end(), tag.C_str(),
+                    [](const Tag& entry, const char* name) { return entry._name < name; });
+
+        for (; iTag != tags->_definitions.end(); ++iTag)
+        {
+            if (matcher.Matches(iTag->_name))
+                names.insert(iTag->_name);
+            else if (!cmd->IgnoreCase())
+                break;
+        }
+    }
+
+    if (names.empty())
+        return;
+
+    std::vector<char> merged;
+
+    if (cmd->Result())
+    {
+        const char* result = cmd->Result();
+        merged.assign(result, result + cmd->ResultLen());
+
+        if (!merged.empty() && merged.back() != '\n')
+            merged.push_back('\n');
+
+        for (const char* lineBegin = result; *lineBegin;)
+        {
+            const char* lineEnd = lineBegin;
+            while (*lineEnd && *lineEnd != '\n' && *lineEnd != '\r')
+                ++lineEnd;
+
+            names.erase(std::string(lineBegin, lineEnd));
+
+            while (*lineEnd == '\n' || *lineEnd == '\r')
+                ++lineEnd;
+            lineBegin = lineEnd;
+        }
+    }
+
+    for (const auto& name : names)
+    {
+        merged.insert(merged.end(), name.begin(), name.end());
+        merged.push_back('\n');
+    }
+
+    merged.push_back(0);
+    cmd->SetResult(merged);
+}
+
+} // namespace GTags
@@ -0,0 +1,228 @@
+/**
+ *  \file
+ *  \brief  In-memory tags of the modified (unsaved) buffers shadowing the database ones
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include <string>
+#include <list>
+#include <memory>
+#include "Common.h"
+#include "AutoLock.h"
+#include "CmdDefines.h"
+#include "Cmd.h"
+#include "DbManager.h"
+#include "PathTable.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  OverlayIndex
+ *  \brief  Holds the tags of the buffers edited since the database was last
+ *          updated. The buffer text is written to a mirror of the database
+ *          tree in the temp folder and tagged there by global -f with the
+ *          database parser. The overlay replaces the database results for
+ *          that file in FIND_DEFINITION, FIND_REFERENCE and AUTOCOMPLETE
+ *          until the database update for the saved file completes.
+ *
+ *          Saved files are tagged the same way into the database delta
+ *          instead of updating the database right away. The delta is kept
+ *          in a DeltaLog and merged under the buffer overlays. It is folded
+ *          into the database by background single-file updates once it
+ *          grows too big or too old - each file stays in the delta until
+ *          its update completes so the results are the same meanwhile.
+ *          A file in nested databases using the same parser is tagged once
+ *          and its tags go to the delta of each of them.
+ */
+class OverlayIndex
+{
+public:
+    static OverlayIndex& Get()
+    {
+        static OverlayIndex Instance;
+        return Instance;
+    }
+
+    static void MirrorRoot(const CPath& dbPath, CPath& root);
+
+    void Update(const DbHandle& db, const CPath& file, const CTextA& text);
+    void Remove(const CPath& file, LONGLONG olderThan = 0);
+    bool Contains(const CPath& file) const;
+
+    bool AddDelta(const std::vector<DbHandle>& dbs, const CPath& file);
+    void LoadDelta(const CPath& dbPath, PathId dbPathId);
+    void Folded(const CPath& file, PathId dbPathId, LONGLONG olderThan, bool updatesDone);
+    void DropDelta(const CPath& dbPath, PathId dbPathId, LONGLONG olderThan = 0);
+    bool InDelta(const CPath& file) const;
+
+    // Folds the deltas older than maxAgeMs (0 - all) into their databases. Returns false if there are none left.
+    bool Compact(unsigned maxAgeMs = 0);
+
+    // Changes each time an overlay is added, replaced or removed
+    inline unsigned Version() const { return (unsigned)_version; }
+
+    void Merge(const CmdPtr_t& cmd) const;
+
+private:
+    static const unsigned   cMaxDeltaFiles;
+    static const size_t     cMaxDeltaSize;
+
+    /**
+     *  \struct  Tag
+     *  \brief
+     */
+    struct Tag
+    {
+        std::string _name;
+        unsigned    _line;
+        std::string _text;
+    };
+
+    /**
+     *  \struct  FileTags
+     *  \brief  Tags are sorted by name
+     */
+    struct FileTags
+    {
+        CPath               _path;
+        CPath               _dbPath;
+        PathId              _pathId;
+        PathId              _dbPathId;
+        std::string         _file;      // Relative to the database root as output by global
+        LONGLONG            _time;      // When the buffer text was taken
+        std::vector<Tag>    _definitions;
+        std::vector<Tag>    _references;
+    };
+
+    typedef std::shared_ptr<const FileTags> FileTagsPtr;
+
+    /**
+     *  \class  Parser
+     *  \brief  Parses global -f (ctags -x format) output - the first
+     *          _definitionsLen bytes are the definitions, the rest references
+     */
+    class Parser : public ResultParser
+    {
+    public:
+        Parser(const std::shared_ptr<FileTags>& tags, unsigned definitionsLen) :
+            _tags(tags), _definitionsLen(definitionsLen) {}
+        virtual ~Parser() {}
+
+        virtual int Parse(const CmdPtr_t&);
+
+    private:
+        void parseLines(const char* begin, const char* end, std::vector<Tag>& tags) const;
+
+        std::shared_ptr<FileTags>   _tags;
+        const unsigned              _definitionsLen;
+    };
+
+    /**
+     *  \struct  Delta
+     *  \brief  Tags of the saved files of a database not folded into it yet
+     */
+    struct Delta
+    {
+        CPath                       _dbPath;
+        PathId                      _dbPathId;
+        std::vector<FileTagsPtr>    _files;
+        size_t                      _size;          // Bytes of the tags text
+        LONGLONG                    _oldest;        // When the oldest file was added
+        bool                        _compacting;    // The files are being folded into the database
+    };
+
+    /**
+     *  \struct  Compaction
+     *  \brief  Delta files to fold into the database - copied out under _lock
+     */
+    struct Compaction
+    {
+        CPath                       _dbPath;
+        PathId                      _dbPathId;
+        std::vector<CPath>          _files;
+    };
+
+    /**
+     *  \struct  Job
+     *  \brief  Tagging in progress - the newest text is kept to be tagged next
+     */
+    struct Job
+    {
+        CmdPtr_t                    _cmd;
+        bool                        _delta;
+        std::vector<DbHandle>       _sharedDbs;     // Enclosing databases getting the same delta tags
+        CPath                       _path;
+        CPath                       _dbPath;
+        PathId                      _pathId;
+        PathId                      _dbPathId;
+        CText                       _file;
+        std::shared_ptr<FileTags>   _tags;
+
+        bool                        _pending;
+        CTextA                      _text;
+        LONGLONG                    _time;
+    };
+
+    static void definitionsCB(const CmdPtr_t& cmd);
+    static void tagsCB(const CmdPtr_t& cmd);
+
+    static bool pathMatches(const char* line, const std::string& file);
+
+    static size_t tagsSize(const FileTags& tags);
+    static void startCompaction(Delta& delta, Compaction& compaction);
+    static void toRecord(const FileTags& tags, std::vector<char>& record);
+    static std::string relativeFile(const CPath& file, const CPath& dbPath);
+    static void droppedRecord(const FileTags& tags, std::vector<char>& record);
+    static bool fromRecord(const char* record, unsigned len, FileTags& tags, bool& dropped);
+
+    OverlayIndex() : _version(0) {}
+    OverlayIndex(const OverlayIndex&);
+    ~OverlayIndex() {}
+
+    std::list<Job>::iterator findJob(const CmdPtr_t& cmd);
+    bool start(const DbHandle& db, const CPath& file, const CTextA& text, LONGLONG time, bool delta,
+            const std::vector<DbHandle>& sharedDbs = std::vector<DbHandle>());
+    void finish(const CmdPtr_t& cmd);
+    void publishDelta(const FileTagsPtr& tags);
+    void updateInstead(const CPath& dbPath, const CPath& file);
+    void compact(const Compaction& compaction);
+    std::list<Delta>::iterator findDelta(PathId dbPathId);
+
+    void mergeLines(const CmdPtr_t& cmd, const std::vector<FileTagsPtr>& overlays) const;
+    void mergeNames(const CmdPtr_t& cmd, const std::vector<FileTagsPtr>& overlays) const;
+
+    std::list<Job>              _jobs;
+
+    mutable Mutex               _lock;
+    std::vector<FileTagsPtr>    _overlays;
+    std::list<Delta>            _deltas;
+    volatile LONG               _version;
+};
+
+} // namespace GTags
@@ -0,0 +1,278 @@
+/**
+ *  \file
+ *  \brief  Table of the interned (stored once) normalized paths
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <string.h>
+#include "Common.h"
+#include "PathTable.h"
+
+
+namespace GTags
+{
+
+const PathId PathTable::cRoot           = 0;
+const PathId PathTable::cInvalidId      = (PathId)-1;
+
+const unsigned PathTable::cChunkBits    = 12;
+const unsigned PathTable::cChunkSize    = 1 << PathTable::cChunkBits;
+const unsigned PathTable::cMaxChunks    = 1024;
+const unsigned PathTable::cNamePoolSize = 64 * 1024;
+
+
+/**
+ *  \brief  FNV-1a of the case-folded name continuing the parent path hash
+ */
+unsigned PathTable::hashName(unsigned hash, const TCHAR* name, unsigned len)
+{
+    hash = (hash ^ _T('\\')) * 16777619;
+
+    for (unsigned i = 0; i < len; ++i)
+        hash = (hash ^ (unsigned)fold(name[i])) * 16777619;
+
+    return hash;
+}
+
+
+/**
+ *  \brief
+ */
+bool PathTable::namesMatch(const TCHAR* name1, const TCHAR* name2, unsigned len)
+{
+    for (unsigned i = 0; i < len; ++i)
+        if (name1[i] != name2[i] && fold(name1[i]) != fold(name2[i]))
+            return false;
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+PathTable::PathTable() : _count(1), _nameBlock(NULL), _nameBlockFree(0)
+{
+    _chunks.reserve(cMaxChunks);
+    _chunks.push_back(new Node[cChunkSize]);
+
+    Node& root = _chunks[0][cRoot];
+
+    root._parent    = cRoot;
+    root._depth     = 0;
+    root._hash      = 2166136261U;
+    root._name      = _T("");
+    root._nameLen   = 0;
+}
+
+
+/**
+ *  \brief
+ */
+PathTable::~PathTable()
+{
+    for (auto chunk : _chunks)
+        delete [] chunk;
+
+    for (auto names : _namePool)
+        delete [] names;
+}
+
+
+/**
+ *  \brief  Leading separators (UNC or root-relative path) are kept as the
+ *          first component
+ */
+PathId PathTable::Intern(const TCHAR* path, unsigned len)
+{
+    AUTOLOCK(_lock);
+
+    PathId id = cRoot;
+    unsigned pos = 0;
+
+    while (pos < len && isSeparator(path[pos]))
+        ++pos;
+
+    if (pos)
+    {
+        static const TCHAR cLeadingSeparators[] = _T("\\\\");
+
+        id = child(id, cLeadingSeparators, pos > 1 ? 2 : 1);
+    }
+
+    while (pos < len && id != cInvalidId)
+    {
+        const unsigned start = pos;
+
+        while (pos < len && !isSeparator(path[pos]))
+            ++pos;
+
+        const unsigned nameLen = pos - start;
+
+        if (nameLen == 2 && path[start] == _T('.') && path[start + 1] == _T('.'))
+        {
+            if (id != cRoot)
+                id = node(id)._parent;
+        }
+        else if (nameLen && !(nameLen == 1 && path[start] == _T('.')))
+        {
+            id = child(id, path + start, nameLen);
+        }
+
+        while (pos < len && isSeparator(path[pos]))
+            ++pos;
+    }
+
+    return id;
+}
+
+
+/**
+ *  \brief  Result lines of global are narrow
+ */
+PathId PathTable::Intern(const char* path, unsigned len)
+{
+    CPath widePath;
+    widePath.Append(path, len);
+
+    return Intern(widePath.C_str(), widePath.Len());
+}
+
+
+/**
+ *  \brief
+ */
+bool PathTable::IsParentOf(PathId parent, PathId id) const
+{
+    if (parent == cInvalidId || id == cInvalidId)
+        return false;
+
+    const unsigned depth = node(parent)._depth;
+
+    while (node(id)._depth > depth)
+        id = node(id)._parent;
+
+    return (id == parent);
+}
+
+
+/**
+ *  \brief  Gives the path with '\' separators and no trailing one
+ */
+void PathTable::GetPath(PathId id, CPath& path) const
+{
+    if (id == cRoot || id == cInvalidId)
+    {
+        path.Clear();
+        return;
+    }
+
+    const Node& n = node(id);
+
+    GetPath(n._parent, path);
+
+    const unsigned len = path.Len();
+    if (len && !isSeparator(path.C_str()[len - 1]))
+        path += _T('\\');
+
+    path.Append(n._name, n._nameLen);
+}
+
+
+/**
+ *  \brief  Finds or adds the named child of parent
+ */
+PathId PathTable::child(PathId parent, const TCHAR* name, unsigned len)
+{
+    const Node& p = node(parent);
+    const unsigned hash = hashName(p._hash, name, len);
+
+    auto range = _index.equal_range(hash);
+    for (auto iEntry = range.first; iEntry != range.second; ++iEntry)
+    {
+        const Node& n = node(iEntry->second);
+
+        if (n._parent == parent && n._nameLen == len && namesMatch(n._name, name, len))
+            return iEntry->second;
+    }
+
+    const PathId id = (PathId)_count;
+
+    if ((id >> cChunkBits) >= _chunks.size())
+    {
+        if (_chunks.size() == cMaxChunks)
+            return cInvalidId;
+
+        _chunks.push_back(new Node[cChunkSize]);
+    }
+
+    Node& n = _chunks[id >> cChunkBits][id & (cChunkSize - 1)];
+
+    n._parent   = parent;
+    n._depth    = p._depth + 1;
+    n._hash     = hash;
+    n._name     = storeName(name, len);
+    n._nameLen  = len;
+
+    _index.insert(std::make_pair(hash, id));
+
+    // Publish the node after it is written
+    InterlockedIncrement(&_count);
+
+    return id;
+}
+
+
+/**
+ *  \brief  Names are never freed - they are kept in large blocks
+ */
+const TCHAR* PathTable::storeName(const TCHAR* name, unsigned len)
+{
+    TCHAR* names;
+
+    if (len > cNamePoolSize / 4)
+    {
+        names = new TCHAR[len];
+        _namePool.push_back(names);
+    }
+    else
+    {
+        if (_nameBlock == NULL || _nameBlockFree < len)
+        {
+            _nameBlock = new TCHAR[cNamePoolSize];
+            _nameBlockFree = cNamePoolSize;
+            _namePool.push_back(_nameBlock);
+        }
+
+        names = _nameBlock + cNamePoolSize - _nameBlockFree;
+        _nameBlockFree -= len;
+    }
+
+    memcpy(names, name, len * sizeof(TCHAR));
+
+    return names;
+}
+
+} // namespace GTags
@@ -0,0 +1,130 @@
+/**
+ *  \file
+ *  \brief  Table of the interned (stored once) normalized paths
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include <unordered_map>
+#include "Common.h"
+#include "AutoLock.h"
+
+
+namespace GTags
+{
+
+typedef unsigned PathId;
+
+
+/**
+ *  \class  PathTable
+ *  \brief  Stores each path once as a chain of its components and hands out
+ *          compact IDs for it. Paths are normalized on interning - '/' and '\'
+ *          are the same, letter case is ignored, '.' and '..' are resolved and
+ *          the trailing separator is dropped - so equal paths get equal IDs
+ *          and parent / subpath checks walk the parent chain comparing
+ *          integers. The root (empty path) is the parent of all relative and
+ *          absolute paths. Interning locks the table, the rest does not -
+ *          the nodes never move once added.
+ */
+class PathTable
+{
+public:
+    static const PathId cRoot;
+    static const PathId cInvalidId;    // Returned when the table is full
+
+    static PathTable& Get()
+    {
+        static PathTable Instance;
+        return Instance;
+    }
+
+    PathId Intern(const TCHAR* path, unsigned len);
+    PathId Intern(const char* path, unsigned len);
+    inline PathId Intern(const CPath& path) { return Intern(path.C_str(), path.Len()); }
+
+    inline PathId Parent(PathId id) const { return node(id)._parent; }
+    inline unsigned Depth(PathId id) const { return node(id)._depth; }
+    inline unsigned Hash(PathId id) const { return node(id)._hash; }
+
+    // True also if parent and id are the same path
+    bool IsParentOf(PathId parent, PathId id) const;
+    inline bool IsSubpathOf(PathId id, PathId parent) const { return IsParentOf(parent, id); }
+
+    void GetPath(PathId id, CPath& path) const;
+
+    inline unsigned Count() const { return (unsigned)_count; }
+
+private:
+    static const unsigned cChunkBits;
+    static const unsigned cChunkSize;
+    static const unsigned cMaxChunks;
+    static const unsigned cNamePoolSize;
+
+    /**
+     *  \struct  Node
+     *  \brief  One path component - _hash is of the whole case-folded path
+     */
+    struct Node
+    {
+        PathId          _parent;
+        unsigned        _depth;
+        unsigned        _hash;
+        const TCHAR*    _name;      // Letter case as first interned
+        unsigned        _nameLen;
+    };
+
+    static inline bool isSeparator(TCHAR ch) { return (ch == _T('\\') || ch == _T('/')); }
+    static inline TCHAR fold(TCHAR ch)
+    {
+        if (ch < 0x80)
+            return (ch >= _T('A') && ch <= _T('Z')) ? ch + (_T('a') - _T('A')) : ch;
+        return (TCHAR)_totlower(ch);
+    }
+    static unsigned hashName(unsigned hash, const TCHAR* name, unsigned len);
+    static bool namesMatch(const TCHAR* name1, const TCHAR* name2, unsigned len);
+
+    PathTable();
+    PathTable(const PathTable&);
+    ~PathTable();
+
+    inline const Node& node(PathId id) const { return _chunks[id >> cChunkBits][id & (cChunkSize - 1)]; }
+
+    PathId child(PathId parent, const TCHAR* name, unsigned len);
+    const TCHAR* storeName(const TCHAR* name, unsigned len);
+
+    Mutex                                       _lock;
+    std::vector<Node*>                          _chunks;    // Reserved upfront so it is never reallocated
+    volatile LONG                               _count;
+    std::unordered_multimap<unsigned, PathId>   _index;     // By hash
+    std::vector<TCHAR*>                         _namePool;
+    TCHAR*                                      _nameBlock;
+    unsigned                                    _nameBlockFree;
+};
+
+} // namespace GTags
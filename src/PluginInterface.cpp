@@ -113,6 +113,26 @@ extern "C" __declspec(dllexport) void beNotified(SCNotification* notifyCode)
         }
         break;
 
+        case NPPN_FILEBEFORECLOSE:
+        {
+            CPath file;
+            INpp::Get().GetFilePathFromBufID(notifyCode->nmhdr.idFrom, file);
+            GTags::OnBufferClose(notifyCode->nmhdr.idFrom, file);
+        }
+        break;
+
+        case SCN_UPDATEUI:
+            if (notifyCode->updated & SC_UPDATE_SELECTION)
+                GTags::OnCaretMove();
+            if (notifyCode->updated & (SC_UPDATE_CONTENT | SC_UPDATE_V_SCROLL))
+                GTags::OnViewChange();
+        break;
+
+        case SCN_MODIFIED:
+            if (notifyCode->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
+                GTags::OnBufferModified();
+        break;
+
         case NPPN_WORDSTYLESUPDATED:
         {
             INpp& npp = INpp::Get();
@@ -0,0 +1,537 @@
+/**
+ *  \file
+ *  \brief  Per-database query results cache kept on disk across sessions
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "Config.h"
+#include "Cmd.h"
+#include "DbManager.h"
+#include "GrepEngine.h"
+#include "QueryCache.h"
+
+
+namespace
+{
+
+/**
+ *  \brief  Changes when the file is written
+ */
+ULONGLONG fileStamp(const CPath& file)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if (!GetFileAttributesEx(file.C_str(), GetFileExInfoStandard, &data))
+        return 0;
+
+    const ULONGLONG time = ((ULONGLONG)data.ftLastWriteTime.dwHighDateTime << 32) |
+            data.ftLastWriteTime.dwLowDateTime;
+    const ULONGLONG size = ((ULONGLONG)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+
+    return time ^ (size * 0x9E3779B97F4A7C15ULL);
+}
+
+
+/**
+ *  \brief
+ */
+bool writeRecord(FILE* fp, const std::string& key, const char* result, unsigned len)
+{
+    const unsigned keyLen = (unsigned)key.size();
+    const unsigned recordLen = sizeof(keyLen) + keyLen + len;
+
+    if (fwrite(&recordLen, sizeof(recordLen), 1, fp) != 1 || fwrite(&keyLen, sizeof(keyLen), 1, fp) != 1)
+        return false;
+
+    if (keyLen && fwrite(key.data(), keyLen, 1, fp) != 1)
+        return false;
+
+    return (!len || fwrite(result, len, 1, fp) == 1);
+}
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+const TCHAR     QueryCache::cFileName[]     = _T("GCACHE");
+const unsigned  QueryCache::cVersion        = 1;
+const char      QueryCache::cMagic[4]       = { 'N', 'G', 'Q', 'C' };
+const unsigned  QueryCache::cMaxEntries     = 256;
+const size_t    QueryCache::cMaxSize        = 16 * 1024 * 1024;
+
+
+/**
+ *  \brief  Fills the command result if it is cached - called from the
+ *          command thread. The overlays are not merged in yet.
+ */
+bool QueryCache::Lookup(const CmdPtr_t& cmd)
+{
+    if (!IsCached(cmd->Id()))
+        return false;
+
+    const ULONGLONG gen = generation(cmd->Db()->GetPath(), *cmd->Db()->GetConfig());
+    const std::string entryKey = key(cmd);
+
+    AUTOLOCK(_lock);
+
+    ++_stats._lookups;
+
+    DbCache& cache = getCache(cmd->Db()->GetPath(), cmd->Db()->GetPathId(), gen);
+
+    auto iEntry = cache._entries.find(entryKey);
+    if (iEntry == cache._entries.end())
+        return false;
+
+    ++_stats._hits;
+
+    Entry& entry = iEntry->second;
+    entry._lastUse = ++_useCount;
+    cache._dirty = true;
+
+    if (entry._len == 0)
+        cmd->ClearResult();
+    else if (entry._result)
+        cmd->SetResult(std::vector<char>(entry._result, entry._result + entry._len));
+    else
+        cmd->SetResult(entry._stored);
+
+    return true;
+}
+
+
+/**
+ *  \brief  Keeps the command result before the overlays are merged in - called from the command thread
+ */
+void QueryCache::Store(const CmdPtr_t& cmd)
+{
+    if (!IsCached(cmd->Id()))
+        return;
+
+    const unsigned len = cmd->Result() ? cmd->ResultLen() + 1 : 0;
+
+    if (len > cMaxSize / 4)
+        return;
+
+    const ULONGLONG gen = generation(cmd->Db()->GetPath(), *cmd->Db()->GetConfig());
+    const std::string entryKey = key(cmd);
+
+    AUTOLOCK(_lock);
+
+    DbCache& cache = getCache(cmd->Db()->GetPath(), cmd->Db()->GetPathId(), gen);
+
+    auto iEntry = cache._entries.find(entryKey);
+    if (iEntry != cache._entries.end())
+    {
+        cache._size -= iEntry->second._len;
+        cache._entries.erase(iEntry);
+    }
+
+    Entry& entry = cache._entries[entryKey];
+    entry._result   = NULL;
+    entry._len      = len;
+    entry._lastUse  = ++_useCount;
+
+    if (len)
+        entry._stored.assign(cmd->Result(), cmd->Result() + len);
+
+    cache._size += len;
+    cache._dirty = true;
+
+    ++_stats._stored;
+
+    // The file is rewritten on exit anyway - stop growing it meanwhile
+    if (cache._fileSize < 2 * cMaxSize)
+        append(cache, entryKey, entry);
+
+    evict(cache);
+}
+
+
+/**
+ *  \brief  Loads the database cache file ahead of the first search - called
+ *          from the warm-up thread
+ */
+void QueryCache::Preload(const CPath& dbPath, PathId dbPathId, const DbConfig& cfg)
+{
+    const ULONGLONG gen = generation(dbPath, cfg);
+
+    AUTOLOCK(_lock);
+
+    getCache(dbPath, dbPathId, gen);
+}
+
+
+/**
+ *  \brief  Called before the database files are deleted
+ */
+void QueryCache::Drop(const CPath& dbPath)
+{
+    const PathId dbPathId = PathTable::Get().Intern(dbPath);
+
+    AUTOLOCK(_lock);
+
+    for (auto iCache = _caches.begin(); iCache != _caches.end(); ++iCache)
+    {
+        if (iCache->_dbPathId == dbPathId)
+        {
+            unload(*iCache, true);
+            _caches.erase(iCache);
+            return;
+        }
+    }
+
+    CPath cacheFile(dbPath);
+    cacheFile += cFileName;
+
+    if (cacheFile.FileExists())
+        DeleteFile(cacheFile.C_str());
+}
+
+
+/**
+ *  \brief  Rewrites the changed cache files with their entries only - least
+ *          recently used first so the order is kept when loaded again.
+ *          Called on exit.
+ */
+void QueryCache::Compact()
+{
+    AUTOLOCK(_lock);
+
+    for (auto& cache : _caches)
+    {
+        if (!cache._dirty)
+        {
+            unload(cache, false);
+            continue;
+        }
+
+        std::vector<std::pair<const std::string, Entry>*> entries;
+        entries.reserve(cache._entries.size());
+
+        for (auto& entry : cache._entries)
+            entries.push_back(&entry);
+
+        std::sort(entries.begin(), entries.end(),
+            [](const std::pair<const std::string, Entry>* entry1, const std::pair<const std::string, Entry>* entry2)
+            { return entry1->second._lastUse < entry2->second._lastUse; });
+
+        CPath cacheFile(cache._dbPath);
+        cacheFile += cFileName;
+
+        // The mapped results are written from a temp file as the mapped file cannot be truncated
+        CPath tmpFile(cacheFile);
+        tmpFile += _T(".tmp");
+
+        bool success = !entries.empty();
+
+        if (success)
+        {
+            FILE* fp;
+            _tfopen_s(&fp, tmpFile.C_str(), _T("wb"));
+
+            success = (fp != NULL);
+
+            if (success)
+            {
+                Header header;
+                memcpy(header._magic, cMagic, sizeof(cMagic));
+                header._version     = cVersion;
+                header._generation  = cache._generation;
+
+                success = (fwrite(&header, sizeof(header), 1, fp) == 1);
+
+                for (const auto entry : entries)
+                {
+                    if (!success)
+                        break;
+
+                    const Entry& e = entry->second;
+                    success = writeRecord(fp, entry->first, e._result ? e._result : e._stored.data(), e._len);
+                }
+
+                fclose(fp);
+            }
+        }
+
+        unload(cache, true);
+
+        if (success)
+            MoveFile(tmpFile.C_str(), cacheFile.C_str());
+        else if (tmpFile.FileExists())
+            DeleteFile(tmpFile.C_str());
+    }
+
+    _caches.clear();
+}
+
+
+/**
+ *  \brief
+ */
+void QueryCache::GetStats(Stats& stats) const
+{
+    AUTOLOCK(_lock);
+
+    stats = _stats;
+}
+
+
+/**
+ *  \brief  The database GTAGS stamp combined with the library ones
+ */
+ULONGLONG QueryCache::generation(const CPath& dbPath, const DbConfig& cfg)
+{
+    CPath tags(dbPath);
+    tags += _T("GTAGS");
+
+    ULONGLONG gen = fileStamp(tags);
+
+    if (cfg._useLibDb)
+    {
+        for (const auto& libDbPath : cfg._libDbPaths)
+        {
+            tags = libDbPath;
+            tags.AsFolder();
+            tags += _T("GTAGS");
+
+            gen = (gen * 1099511628211ULL) ^ fileStamp(tags);
+        }
+    }
+
+    return gen;
+}
+
+
+/**
+ *  \brief  Command ID, search flags and the tag
+ */
+std::string QueryCache::key(const CmdPtr_t& cmd)
+{
+    std::string entryKey;
+
+    entryKey += (char)cmd->Id();
+    entryKey += (char)((cmd->IgnoreCase() ? 1 : 0) | (cmd->RegExp() ? 2 : 0) | (cmd->SkipLibs() ? 4 : 0));
+    entryKey += CTextA(cmd->Tag().C_str()).C_str();
+
+    return entryKey;
+}
+
+
+/**
+ *  \brief  Loads the database cache on first use and drops it if the tags
+ *          have changed since - call with _lock held
+ */
+QueryCache::DbCache& QueryCache::getCache(const CPath& dbPath, PathId dbPathId, ULONGLONG gen)
+{
+    for (auto& cache : _caches)
+    {
+        if (cache._dbPathId == dbPathId)
+        {
+            if (cache._generation != gen)
+            {
+                ++_stats._invalidated;
+
+                unload(cache, true);
+                cache._generation = gen;
+            }
+
+            return cache;
+        }
+    }
+
+    _caches.push_back(DbCache());
+
+    DbCache& cache = _caches.back();
+    cache._dbPath       = dbPath;
+    cache._dbPathId     = dbPathId;
+    cache._generation   = gen;
+    cache._buf          = NULL;
+    cache._fileSize     = 0;
+    cache._size         = 0;
+    cache._dirty        = false;
+
+    load(cache);
+
+    return cache;
+}
+
+
+/**
+ *  \brief  Maps the cache file - later records for the same key replace the
+ *          earlier ones. The file is deleted if it is for other tags.
+ */
+void QueryCache::load(DbCache& cache)
+{
+    CPath cacheFile(cache._dbPath);
+    cacheFile += cFileName;
+
+    size_t size;
+    const char* buf = GrepEngine::MapFile(cacheFile, size, false);
+    if (buf == NULL)
+        return;
+
+    const Header* header = reinterpret_cast<const Header*>(buf);
+
+    if (size < sizeof(Header) || memcmp(header->_magic, cMagic, sizeof(cMagic)) ||
+            header->_version != cVersion || header->_generation != cache._generation)
+    {
+        UnmapViewOfFile(buf);
+        DeleteFile(cacheFile.C_str());
+
+        if (size >= sizeof(Header))
+            ++_stats._invalidated;
+
+        return;
+    }
+
+    cache._buf      = buf;
+    cache._fileSize = size;
+
+    for (size_t pos = sizeof(Header); pos + 2 * sizeof(unsigned) <= size;)
+    {
+        unsigned recordLen, keyLen;
+        memcpy(&recordLen, buf + pos, sizeof(unsigned));
+        memcpy(&keyLen, buf + pos + sizeof(unsigned), sizeof(unsigned));
+        pos += sizeof(unsigned);
+
+        // A record cut by a crash ends the file
+        if (recordLen > size - pos || keyLen > recordLen - sizeof(unsigned))
+        {
+            cache._fileSize = pos - sizeof(unsigned);
+            break;
+        }
+
+        const std::string entryKey(buf + pos + sizeof(unsigned), keyLen);
+
+        auto iEntry = cache._entries.find(entryKey);
+        if (iEntry != cache._entries.end())
+            cache._size -= iEntry->second._len;
+
+        Entry& entry = cache._entries[entryKey];
+        entry._len      = recordLen - sizeof(unsigned) - keyLen;
+        entry._result   = entry._len ? buf + pos + sizeof(unsigned) + keyLen : NULL;
+        entry._lastUse  = ++_useCount;
+        entry._stored.clear();
+
+        cache._size += entry._len;
+
+        pos += recordLen;
+    }
+
+    _stats._loaded += (unsigned)cache._entries.size();
+
+    evict(cache);
+}
+
+
+/**
+ *  \brief
+ */
+void QueryCache::unload(DbCache& cache, bool deleteFile)
+{
+    cache._entries.clear();
+    cache._size = 0;
+    cache._dirty = false;
+
+    if (cache._buf)
+        UnmapViewOfFile(cache._buf);
+
+    cache._buf      = NULL;
+
+    if (deleteFile && cache._fileSize)
+    {
+        CPath cacheFile(cache._dbPath);
+        cacheFile += cFileName;
+        DeleteFile(cacheFile.C_str());
+    }
+
+    cache._fileSize = 0;
+}
+
+
+/**
+ *  \brief  The file is created if there is none
+ */
+bool QueryCache::append(DbCache& cache, const std::string& entryKey, const Entry& entry)
+{
+    CPath cacheFile(cache._dbPath);
+    cacheFile += cFileName;
+
+    FILE* fp;
+    _tfopen_s(&fp, cacheFile.C_str(), _T("ab"));
+    if (fp == NULL)
+        return false;
+
+    bool success = true;
+
+    if (cache._fileSize == 0)
+    {
+        Header header;
+        memcpy(header._magic, cMagic, sizeof(cMagic));
+        header._version     = cVersion;
+        header._generation  = cache._generation;
+
+        success = (fwrite(&header, sizeof(header), 1, fp) == 1);
+        if (success)
+            cache._fileSize = sizeof(header);
+    }
+
+    if (success)
+        success = writeRecord(fp, entryKey, entry._stored.data(), entry._len);
+
+    fclose(fp);
+
+    if (success)
+        cache._fileSize += 2 * sizeof(unsigned) + entryKey.size() + entry._len;
+
+    return success;
+}
+
+
+/**
+ *  \brief  Drops the least recently used entries over the limits
+ */
+void QueryCache::evict(DbCache& cache)
+{
+    while (cache._entries.size() > cMaxEntries || cache._size > cMaxSize)
+    {
+        auto iOldest = cache._entries.begin();
+
+        for (auto iEntry = cache._entries.begin(); iEntry != cache._entries.end(); ++iEntry)
+            if (iEntry->second._lastUse < iOldest->second._lastUse)
+                iOldest = iEntry;
+
+        cache._size -= iOldest->second._len;
+        cache._entries.erase(iOldest);
+        cache._dirty = true;
+    }
+}
+
+} // namespace GTags
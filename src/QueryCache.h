@@ -0,0 +1,158 @@
+/**
+ *  \file
+ *  \brief  Per-database query results cache kept on disk across sessions
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include "Common.h"
+#include "AutoLock.h"
+#include "CmdDefines.h"
+#include "PathTable.h"
+
+
+namespace GTags
+{
+
+class DbConfig;
+
+
+/**
+ *  \class  QueryCache
+ *  \brief  Keeps the raw global output of FIND_DEFINITION and AUTOCOMPLETE
+ *          in a file in the database folder so the searches done in an
+ *          earlier session are answered at once. The results are stored
+ *          before the unsaved buffers and the delta are merged in - that is
+ *          done on each hit. The file is memory-mapped on the database's
+ *          first search, new results are appended to it and it is rewritten
+ *          with the most recently used ones on exit. It is dropped when the
+ *          database (or a library database) GTAGS file changes.
+ */
+class QueryCache
+{
+public:
+    static const TCHAR cFileName[];
+
+    /**
+     *  \struct  Stats
+     *  \brief
+     */
+    struct Stats
+    {
+        unsigned    _lookups;
+        unsigned    _hits;
+        unsigned    _stored;
+        unsigned    _loaded;        // Entries read from the cache files
+        unsigned    _invalidated;   // Caches dropped because the tags changed
+    };
+
+    static QueryCache& Get()
+    {
+        static QueryCache Instance;
+        return Instance;
+    }
+
+    static bool IsCached(CmdId_t id) { return (id == FIND_DEFINITION || id == AUTOCOMPLETE); }
+
+    bool Lookup(const CmdPtr_t& cmd);
+    void Store(const CmdPtr_t& cmd);
+    void Preload(const CPath& dbPath, PathId dbPathId, const DbConfig& cfg);
+    void Drop(const CPath& dbPath);
+    void Compact();
+
+    void GetStats(Stats& stats) const;
+
+private:
+    static const unsigned   cVersion;
+    static const char       cMagic[4];
+    static const unsigned   cMaxEntries;
+    static const size_t     cMaxSize;
+
+    /**
+     *  \struct  Header
+     *  \brief  Each record follows as its length, the key length, the key
+     *          and the result
+     */
+    struct Header
+    {
+        char        _magic[4];
+        unsigned    _version;
+        ULONGLONG   _generation;
+    };
+
+    /**
+     *  \struct  Entry
+     *  \brief  The result is either in the mapped file or stored
+     */
+    struct Entry
+    {
+        const char*         _result;
+        unsigned            _len;
+        std::vector<char>   _stored;
+        unsigned            _lastUse;
+    };
+
+    /**
+     *  \struct  DbCache
+     *  \brief
+     */
+    struct DbCache
+    {
+        CPath                                   _dbPath;
+        PathId                                  _dbPathId;
+        ULONGLONG                               _generation;
+        const char*                             _buf;
+        size_t                                  _fileSize;
+        size_t                                  _size;      // Bytes of the results
+        bool                                    _dirty;     // To be rewritten on exit
+        std::unordered_map<std::string, Entry>  _entries;
+    };
+
+    static ULONGLONG generation(const CPath& dbPath, const DbConfig& cfg);
+    static std::string key(const CmdPtr_t& cmd);
+
+    QueryCache() : _useCount(0) { memset(&_stats, 0, sizeof(_stats)); }
+    QueryCache(const QueryCache&);
+    ~QueryCache() {}
+
+    DbCache& getCache(const CPath& dbPath, PathId dbPathId, ULONGLONG gen);
+    void load(DbCache& cache);
+    void unload(DbCache& cache, bool deleteFile);
+    bool append(DbCache& cache, const std::string& entryKey, const Entry& entry);
+    void evict(DbCache& cache);
+
+    mutable Mutex       _lock;
+    std::list<DbCache>  _caches;
+    unsigned            _useCount;
+    Stats               _stats;
+};
+
+} // namespace GTags
@@ -24,6 +24,7 @@
 
 #include "ReadPipe.h"
 #include <process.h>
+#include <string.h>
 
 
 const unsigned ReadPipe::cChunkSize = 4096;
@@ -32,7 +33,8 @@ const unsigned ReadPipe::cChunkSize = 4096;
 /**
  *  \brief
  */
-ReadPipe::ReadPipe() : _hIn(NULL), _hOut(NULL), _hThread(NULL)
+ReadPipe::ReadPipe(PipeLineFilter* filter, size_t maxOutput) : _filter(filter), _hIn(NULL), _hOut(NULL),
+    _hThread(NULL), _hProcess(NULL), _output(maxOutput), _firstByteTime(0)
 {
     SECURITY_ATTRIBUTES attr    = {0};
     attr.nLength                = sizeof(attr);
@@ -60,19 +62,28 @@ ReadPipe::~ReadPipe()
         if (_hOut)
             CloseHandle(_hOut);
     }
+
+    if (_hProcess)
+        CloseHandle(_hProcess);
 }
 
 
 /**
- *  \brief
+ *  \brief  hProcess is the child writing to the pipe - it is terminated if
+ *          the output reaches the max size
  */
-bool ReadPipe::Open()
+bool ReadPipe::Open(HANDLE hProcess)
 {
     if (!_ready || !_hOut)
         return false;
     if (_hThread)
         return true;
 
+    // Own handle as the caller may close its one before the output is read
+    if (hProcess && _output.MaxSize())
+        DuplicateHandle(GetCurrentProcess(), hProcess, GetCurrentProcess(), &_hProcess,
+                0, FALSE, DUPLICATE_SAME_ACCESS);
+
     CloseHandle(_hIn);
     _hIn = NULL;
     _hThread = (HANDLE)_beginthreadex(NULL, 0, threadFunc, this, 0, NULL);
@@ -97,7 +108,8 @@ DWORD ReadPipe::Wait(DWORD time_ms)
     DWORD r = WaitForSingleObject(_hThread, time_ms);
     if (r != WAIT_TIMEOUT)
     {
-        CloseHandle(_hOut);
+        if (_hOut)
+            CloseHandle(_hOut);
         _hOut = NULL;
         CloseHandle(_hThread);
         _hThread = NULL;
@@ -110,7 +122,7 @@ DWORD ReadPipe::Wait(DWORD time_ms)
 /**
  *  \brief
  */
-std::vector<char>& ReadPipe::GetOutput()
+GTags::OutputBuffer& ReadPipe::GetOutput()
 {
     if (_hThread)
         Wait(INFINITE);
@@ -134,27 +146,102 @@ unsigned __stdcall ReadPipe::threadFunc(void* data)
 unsigned ReadPipe::thread()
 {
     DWORD bytesRead = 0;
-    unsigned totalBytesRead = 0;
-    unsigned chunkRemainingSize = 0;
+    size_t lineStart = 0;
 
     for (;;)
     {
-        if (!chunkRemainingSize)
+        size_t len = cChunkSize;
+        char* buf = _output.Reserve(len);
+        if (!buf)
         {
-            _output.resize(totalBytesRead + cChunkSize);
-            chunkRemainingSize = cChunkSize;
+            stop();
+            break;
         }
 
-        if (!ReadFile(_hOut, _output.data() + totalBytesRead, chunkRemainingSize, &bytesRead, NULL))
+        if (!ReadFile(_hOut, buf, (DWORD)len, &bytesRead, NULL))
             break;
 
-        chunkRemainingSize -= bytesRead;
-        totalBytesRead += bytesRead;
+        if (!_firstByteTime && bytesRead)
+        {
+            LARGE_INTEGER t;
+            QueryPerformanceCounter(&t);
+            _firstByteTime = t.QuadPart;
+        }
+
+        _output.Commit(bytesRead);
+
+        if (_filter)
+            _output.Resize(_output.Size() - filterLines(lineStart, _output.Size()));
     }
 
-    _output.resize(totalBytesRead);
-    if (totalBytesRead)
-        _output.push_back(0);
+    // Last line without new-line at the end
+    if (_filter && lineStart < _output.Size())
+    {
+        size_t len = _output.Size() - lineStart;
+        if (_output.Data()[lineStart + len - 1] == '\r')
+            --len;
+
+        if (_filter->FilterLine(_output.Data() + lineStart, (unsigned)len))
+            _output.Resize(lineStart);
+    }
+
+    _output.Terminate();
 
     return 0;
 }
+
+
+/**
+ *  \brief  Passes complete lines in [lineStart, dataEnd) to the filter and
+ *          compacts the output buffer removing the dropped ones.
+ *          lineStart is moved to the beginning of the incomplete last line.
+ *          Returns the number of bytes removed from the buffer.
+ */
+size_t ReadPipe::filterLines(size_t& lineStart, size_t dataEnd)
+{
+    char* data = _output.Data();
+    size_t readPos = lineStart;
+    size_t writePos = lineStart;
+
+    for (size_t i = lineStart; i < dataEnd; ++i)
+    {
+        if (data[i] != '\n')
+            continue;
+
+        const size_t lineSize = i + 1 - readPos;
+        unsigned len = (unsigned)lineSize - 1;
+        if (len && data[readPos + len - 1] == '\r')
+            --len;
+
+        if (!_filter->FilterLine(data + readPos, len))
+        {
+            if (writePos != readPos)
+                memmove(data + writePos, data + readPos, lineSize);
+            writePos += lineSize;
+        }
+
+        readPos = i + 1;
+    }
+
+    if (writePos != readPos && readPos < dataEnd)
+        memmove(data + writePos, data + readPos, dataEnd - readPos);
+
+    lineStart = writePos;
+
+    return readPos - writePos;
+}
+
+
+/**
+ *  \brief  Output reached the max size - the child is terminated the same
+ *          way as on user cancel and the pipe is closed so a child that
+ *          cannot be terminated fails on write instead of blocking
+ */
+void ReadPipe::stop()
+{
+    if (_hProcess)
+        TerminateProcess(_hProcess, 1);
+
+    CloseHandle(_hOut);
+    _hOut = NULL;
+}
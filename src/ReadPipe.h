@@ -26,23 +26,41 @@
 
 
 #include <windows.h>
-#include <vector>
+#include "OutputBuffer.h"
+
+
+/**
+ *  \class  PipeLineFilter
+ *  \brief  Interface for processing piped output line by line while the
+ *          process is still running
+ */
+class PipeLineFilter
+{
+public:
+    virtual ~PipeLineFilter() {}
+
+    // Called from the pipe reading thread; return true to drop the line from the pipe output
+    virtual bool FilterLine(const char* line, unsigned len) = 0;
+};
 
 
 /**
  *  \class  ReadPipe
- *  \brief
+ *  \brief  Collects the output of a child process. If maxOutput is set and
+ *          the output reaches it the child is terminated and the output is
+ *          marked as truncated.
  */
 class ReadPipe
 {
 public:
-    ReadPipe();
+    ReadPipe(PipeLineFilter* filter = NULL, size_t maxOutput = 0);
     ~ReadPipe();
 
     HANDLE GetInputHandle() { return _hIn; }
-    bool Open();
+    bool Open(HANDLE hProcess = NULL);
     DWORD Wait(DWORD time_ms);
-    std::vector<char>& GetOutput();
+    GTags::OutputBuffer& GetOutput();
+    LONGLONG GetFirstByteTime() const { return _firstByteTime; }
 
 private:
     static const unsigned cChunkSize;
@@ -53,10 +71,15 @@ private:
     const ReadPipe& operator=(const ReadPipe&);
 
     unsigned thread();
+    size_t filterLines(size_t& lineStart, size_t dataEnd);
+    void stop();
 
+    PipeLineFilter*     _filter;
     BOOL                _ready;
     HANDLE              _hIn;
     HANDLE              _hOut;
     HANDLE              _hThread;
-    std::vector<char>   _output;
+    HANDLE              _hProcess;
+    GTags::OutputBuffer _output;
+    volatile LONGLONG   _firstByteTime;
 };
@@ -0,0 +1,307 @@
+/**
+ *  \file
+ *  \brief  In-memory cache of definition search results and idle-time prefetch into it
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include "Cmd.h"
+#include "CmdEngine.h"
+#include "DbManager.h"
+#include "OverlayIndex.h"
+#include "ResultCache.h"
+#include "QueryCache.h"
+
+
+namespace
+{
+
+const TCHAR cPrefetch[] = _T("Prefetch Definition");
+
+
+/**
+ *  \brief
+ */
+inline double percent(unsigned part, unsigned total)
+{
+    return total ? 100.0 * part / total : 0.0;
+}
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+const unsigned ResultCache::cMaxEntries = 64;
+const size_t   ResultCache::cMaxSize    = 16 * 1024 * 1024;
+
+
+/**
+ *  \brief  Fills the command result if it is cached - called from the command thread
+ */
+bool ResultCache::Lookup(const CmdPtr_t& cmd)
+{
+    AUTOLOCK(_lock);
+
+    ++_stats._lookups;
+
+    auto iEntry = find(cmd);
+    if (iEntry == _entries.end())
+        return false;
+
+    ++_stats._hits;
+
+    if (iEntry->_prefetched && !iEntry->_used)
+        ++_stats._prefetchHits;
+
+    iEntry->_used = true;
+
+    if (iEntry->_result.empty())
+        cmd->ClearResult();
+    else
+        cmd->SetResult(iEntry->_result);
+
+    _entries.splice(_entries.begin(), _entries, iEntry);
+
+    return true;
+}
+
+
+/**
+ *  \brief  Checks for a valid entry without counting it as a lookup
+ */
+bool ResultCache::Contains(const CmdPtr_t& cmd)
+{
+    AUTOLOCK(_lock);
+
+    return (find(cmd) != _entries.end());
+}
+
+
+/**
+ *  \brief  Keeps the command result (before parsing) - called from the command thread
+ */
+void ResultCache::Store(const CmdPtr_t& cmd)
+{
+    const size_t len = cmd->Result() ? cmd->ResultLen() + 1 : 0;
+
+    if (len > cMaxSize / 4)
+        return;
+
+    AUTOLOCK(_lock);
+
+    auto iEntry = find(cmd);
+    if (iEntry != _entries.end())
+        erase(iEntry);
+
+    Entry entry;
+    entry._dbPathId         = cmd->Db()->GetPathId();
+    entry._tag              = cmd->Tag();
+    entry._ignoreCase       = cmd->IgnoreCase();
+    entry._regExp           = cmd->RegExp();
+    entry._skipLibs         = cmd->SkipLibs();
+    entry._tagsVersion      = cmd->Db()->TagsVersion();
+    entry._overlayVersion   = OverlayIndex::Get().Version();
+    entry._prefetched       = cmd->Background();
+    entry._used             = false;
+
+    _entries.push_front(entry);
+
+    if (len)
+        _entries.front()._result.assign(cmd->Result(), cmd->Result() + len);
+
+    _size += len;
+
+    if (entry._prefetched)
+        ++_stats._prefetchStored;
+
+    while (_entries.size() > cMaxEntries || _size > cMaxSize)
+        erase(--_entries.end());
+}
+
+
+/**
+ *  \brief
+ */
+void ResultCache::Clear()
+{
+    AUTOLOCK(_lock);
+
+    while (!_entries.empty())
+        erase(_entries.begin());
+}
+
+
+/**
+ *  \brief
+ */
+void ResultCache::GetStats(Stats& stats) const
+{
+    AUTOLOCK(_lock);
+
+    stats = _stats;
+}
+
+
+/**
+ *  \brief  Finds the entry for the command dropping it if outdated
+ */
+std::list<ResultCache::Entry>::iterator ResultCache::find(const CmdPtr_t& cmd)
+{
+    const PathId dbPathId = cmd->Db()->GetPathId();
+
+    for (auto iEntry = _entries.begin(); iEntry != _entries.end(); ++iEntry)
+    {
+        if (iEntry->_dbPathId == dbPathId && iEntry->_tag == cmd->Tag() && iEntry->_ignoreCase == cmd->IgnoreCase() &&
+                iEntry->_regExp == cmd->RegExp() && iEntry->_skipLibs == cmd->SkipLibs())
+        {
+            if (iEntry->_tagsVersion == cmd->Db()->TagsVersion() &&
+                    iEntry->_overlayVersion == OverlayIndex::Get().Version())
+                return iEntry;
+
+            erase(iEntry);
+            break;
+        }
+    }
+
+    return _entries.end();
+}
+
+
+/**
+ *  \brief
+ */
+void ResultCache::erase(std::list<Entry>::iterator iEntry)
+{
+    if (iEntry->_prefetched && !iEntry->_used)
+        ++_stats._prefetchUnused;
+
+    _size -= iEntry->_result.size();
+    _entries.erase(iEntry);
+}
+
+
+/**
+ *  \brief  Takes over the database read lock. Called on the UI thread when
+ *          the caret has rested on the tag for a while.
+ */
+void Prefetcher::Prefetch(const DbHandle& db, const CText& tag, bool ignoreCase)
+{
+    CmdPtr_t cmd(new Cmd(FIND_DEFINITION, cPrefetch, db, NULL, tag.C_str(), ignoreCase));
+    cmd->Background(true);
+
+    if (_cmd)
+    {
+        if (_cmd->Db() == db && _cmd->Tag() == tag && _cmd->IgnoreCase() == ignoreCase && !_cmd->IsCancelled())
+        {
+            DbManager::Get().PutDb(db);
+            return;
+        }
+
+        Cancel();
+    }
+
+    if (CmdEngine::IsBusy() || ResultCache::Get().Contains(cmd))
+    {
+        ++_stats._skipped;
+        DbManager::Get().PutDb(db);
+        return;
+    }
+
+    ++_stats._started;
+
+    if (!CmdEngine::Run(cmd, prefetchCB))
+        return;
+
+    _cmd = cmd;
+}
+
+
+/**
+ *  \brief  The engine reports the cancelled command through the callback
+ */
+void Prefetcher::Cancel()
+{
+    if (_cmd)
+        _cmd->Cancel();
+}
+
+
+/**
+ *  \brief  Appends the prefetch and cache counters to the command timings file
+ */
+bool Prefetcher::AppendStats(const CPath& file) const
+{
+    ResultCache::Stats cache;
+    ResultCache::Get().GetStats(cache);
+
+    QueryCache::Stats stored;
+    QueryCache::Get().GetStats(stored);
+
+    FILE* fp;
+    _tfopen_s(&fp, file.C_str(), _T("at"));
+    if (fp == NULL)
+        return false;
+
+    const unsigned wasted = _stats._cancelled + _stats._failed + cache._prefetchUnused;
+
+    _ftprintf_s(fp, _T("\n# Definition cache and prefetch\n"));
+    _ftprintf_s(fp, _T("# Lookups %u, hits %u (%.1f%%), prefetch hits %u (%.1f%% of lookups)\n"),
+            cache._lookups, cache._hits, percent(cache._hits, cache._lookups),
+            cache._prefetchHits, percent(cache._prefetchHits, cache._lookups));
+    _ftprintf_s(fp, _T("# Prefetches started %u, completed %u, cancelled %u, failed %u, skipped %u\n"),
+            _stats._started, _stats._completed, _stats._cancelled, _stats._failed, _stats._skipped);
+    _ftprintf_s(fp, _T("# Prefetched entries dropped unused %u, wasted prefetches %u (%.1f%% of started)\n"),
+            cache._prefetchUnused, wasted, percent(wasted, _stats._started));
+    _ftprintf_s(fp, _T("# Persistent cache lookups %u, hits %u (%.1f%%), stored %u, loaded %u, invalidated %u\n"),
+            stored._lookups, stored._hits, percent(stored._hits, stored._lookups),
+            stored._stored, stored._loaded, stored._invalidated);
+
+    fclose(fp);
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+void Prefetcher::prefetchCB(const CmdPtr_t& cmd)
+{
+    Prefetcher& prefetcher = Get();
+
+    DbManager::Get().PutDb(cmd->Db());
+
+    if (prefetcher._cmd == cmd)
+        prefetcher._cmd.reset();
+
+    if (cmd->Status() == OK)
+        ++prefetcher._stats._completed;
+    else if (cmd->Status() == CANCELLED)
+        ++prefetcher._stats._cancelled;
+    else
+        ++prefetcher._stats._failed;
+}
+
+} // namespace GTags
@@ -0,0 +1,161 @@
+/**
+ *  \file
+ *  \brief  In-memory cache of definition search results and idle-time prefetch into it
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include <list>
+#include "Common.h"
+#include "AutoLock.h"
+#include "CmdDefines.h"
+#include "PathTable.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  ResultCache
+ *  \brief  Keeps the raw (unparsed) output of the last FIND_DEFINITION
+ *          commands. An entry is valid while the database tags and the
+ *          unsaved buffer overlays are the same as when it was stored.
+ *          Library databases are not tracked - their results may be stale
+ *          until the main database or the overlays change.
+ */
+class ResultCache
+{
+public:
+    /**
+     *  \struct  Stats
+     *  \brief
+     */
+    struct Stats
+    {
+        unsigned    _lookups;
+        unsigned    _hits;
+        unsigned    _prefetchHits;      // Hits on entries stored by the prefetcher
+        unsigned    _prefetchStored;
+        unsigned    _prefetchUnused;    // Prefetched entries dropped without being hit
+    };
+
+    static ResultCache& Get()
+    {
+        static ResultCache Instance;
+        return Instance;
+    }
+
+    bool Lookup(const CmdPtr_t& cmd);
+    bool Contains(const CmdPtr_t& cmd);
+    void Store(const CmdPtr_t& cmd);
+    void Clear();
+
+    void GetStats(Stats& stats) const;
+
+private:
+    static const unsigned cMaxEntries;
+    static const size_t   cMaxSize;
+
+    /**
+     *  \struct  Entry
+     *  \brief
+     */
+    struct Entry
+    {
+        PathId              _dbPathId;
+        CText               _tag;
+        bool                _ignoreCase;
+        bool                _regExp;
+        bool                _skipLibs;
+        unsigned            _tagsVersion;
+        unsigned            _overlayVersion;
+        std::vector<char>   _result;
+        bool                _prefetched;
+        bool                _used;
+    };
+
+    ResultCache() : _size(0) { memset(&_stats, 0, sizeof(_stats)); }
+    ResultCache(const ResultCache&);
+    ~ResultCache() {}
+
+    std::list<Entry>::iterator find(const CmdPtr_t& cmd);
+    void erase(std::list<Entry>::iterator iEntry);
+
+    mutable Mutex       _lock;
+    std::list<Entry>    _entries;   // Most recently used first
+    size_t              _size;
+    Stats               _stats;
+};
+
+
+/**
+ *  \class  Prefetcher
+ *  \brief  Looks up the definition of the identifier the caret rests on
+ *          into the ResultCache before the user asks for it. The prefetch
+ *          runs as a background command - it is cancelled when the caret
+ *          moves or an interactive command starts.
+ */
+class Prefetcher
+{
+public:
+    /**
+     *  \struct  Stats
+     *  \brief
+     */
+    struct Stats
+    {
+        unsigned    _started;
+        unsigned    _completed;
+        unsigned    _cancelled;
+        unsigned    _failed;
+        unsigned    _skipped;   // Already cached or interactive command running
+    };
+
+    static Prefetcher& Get()
+    {
+        static Prefetcher Instance;
+        return Instance;
+    }
+
+    void Prefetch(const DbHandle& db, const CText& tag, bool ignoreCase);
+    void Cancel();
+    inline bool IsRunning() const { return (bool)_cmd; }
+
+    void GetStats(Stats& stats) const { stats = _stats; }
+    bool AppendStats(const CPath& file) const;
+
+private:
+    static void prefetchCB(const CmdPtr_t& cmd);
+
+    Prefetcher() { memset(&_stats, 0, sizeof(_stats)); }
+    Prefetcher(const Prefetcher&);
+    ~Prefetcher() {}
+
+    CmdPtr_t    _cmd;
+    Stats       _stats;
+};
+
+} // namespace GTags
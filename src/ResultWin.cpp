@@ -31,14 +31,17 @@
 #include "DocLocation.h"
 #include "ActivityWin.h"
 #include "Cmd.h"
+#include "CmdEngine.h"
 #include <windowsx.h>
 #include <richedit.h>
 #include <commctrl.h>
 #include <vector>
+#include <algorithm>
 #include "Common.h"
 #include "GTags.h"
 #include "dockingResource.h"
-#include "StrUniquenessChecker.h"
+#include "TabParser.h"
+#include "TabStore.h"
 
 
 // Scintilla user defined styles IDs
@@ -68,230 +71,155 @@ const TCHAR ResultWin::cSearchClassName[]   = _T("ResultSearchWin");
 const int ResultWin::cSearchBkgndColor      = COLOR_INFOBK;
 const unsigned ResultWin::cSearchFontSize   = 10;
 const int ResultWin::cSearchWidth           = 420;
+const unsigned ResultWin::cPageResults      = 4096;
 
 
 ResultWin* ResultWin::RW = NULL;
 
 
 /**
- *  \brief
+ *  \brief  Loads the result lines of the first files up to a page - all of
+ *          them if there are not too many
  */
-int ResultWin::TabParser::Parse(const CmdPtr_t& cmd)
+ResultWin::Tab::Tab(const CmdPtr_t& cmd) :
+    _cmdId(cmd->Id()), _regExp(cmd->RegExp()), _ignoreCase(cmd->IgnoreCase()),
+    _projectPath(cmd->Db()->GetPath().C_str()), _search(cmd->Tag().C_str()), _currentLine(1), _firstVisibleLine(0),
+    _parser(cmd->Parser()), _unloadedFiles(0)
 {
-    // Add the search header - cmd name + search word + project path
-    _buf = cmd->Name();
-    _buf += " \"";
-    _buf += cmd->Tag().C_str();
-    _buf += "\"";
+    const TabParser* parser = Parser();
+    const unsigned filesCount = parser->FilesCount();
 
-    if (cmd->RegExp() || cmd->IgnoreCase())
-    {
-        _buf += " (";
+    _files.resize(filesCount);
 
-        if (cmd->RegExp())
-        {
-            _buf += "regexp";
+    unsigned pageResults = 0;
+    int lineNum = 1;
 
-            if (cmd->IgnoreCase())
-                _buf += ", ";
-        }
+    for (unsigned i = 0; i < filesCount; ++i)
+    {
+        const unsigned resultsCount = parser->ResultsCount(i);
 
-        if (cmd->IgnoreCase())
-            _buf += "ignore case";
+        _files[i]._line     = lineNum++;
+        _files[i]._expanded = false;
+        _files[i]._loaded   = (_unloadedFiles == 0 && pageResults + resultsCount <= cPageResults);
 
-        _buf += ")";
+        if (_files[i]._loaded)
+        {
+            pageResults += resultsCount;
+            lineNum += resultsCount;
+        }
+        else
+        {
+            ++_unloadedFiles;
+        }
     }
-
-    _buf += " in \"";
-    _buf += cmd->Db()->GetPath().C_str();
-    _buf += "\"";
-
-    // parsing command result
-    if (cmd->Id() == FIND_FILE)
-        return parseFindFile(cmd);
-    else
-        return parseCmd(cmd);
 }
 
 
 /**
  *  \brief
  */
-bool ResultWin::TabParser::filterEntry(const DbConfig& cfg, const char* pEntry, unsigned len)
+ResultWin::Tab::~Tab()
 {
-    if (cfg._usePathFilter)
-    {
-        CPath currentEntry;
-        currentEntry.Append(pEntry, len);
-
-        for (const auto& filter : cfg._pathFilters)
-        {
-            if (filter.IsParentOf(currentEntry))
-                return true;
-        }
-    }
-
-    return false;
+    TabStore::Get().Drop(Parser());
 }
 
 
 /**
- *  \brief
+ *  \brief  Formats the tab document - the header, the file lines and the loaded result lines
  */
-int ResultWin::TabParser::parseFindFile(const CmdPtr_t& cmd)
+void ResultWin::Tab::GetText(CTextA& text) const
 {
-    int result = 0;
+    const TabParser* parser = Parser();
 
-    const char* pSrc = cmd->Result();
-    const char* pEol;
+    text = parser->GetText();
 
-    const DbConfig& cfg = cmd->Db()->GetConfig();
-
-    for (;;)
+    for (unsigned i = 0; i < _files.size(); ++i)
     {
-        while (*pSrc == '\n' || *pSrc == '\r' || *pSrc == ' ' || *pSrc == '\t')
-            ++pSrc;
-        if (*pSrc == 0) break;
-
-        pEol = pSrc;
-        while (*pEol != '\n' && *pEol != '\r' && *pEol != 0)
-            ++pEol;
-
-        if (!filterEntry(cfg, pSrc, pEol - pSrc))
-        {
-            _buf += "\n\t";
-            _buf.Append(pSrc, pEol - pSrc);
-
-            ++result;
-        }
+        parser->AppendFile(text, i);
 
-        pSrc = pEol;
+        if (_files[i]._loaded)
+            parser->AppendResults(text, i);
     }
-
-    return result;
 }
 
 
 /**
- *  \brief
+ *  \brief  Returns the file the tab document line belongs to (-1 for the header)
  */
-int ResultWin::TabParser::parseCmd(const CmdPtr_t& cmd)
+int ResultWin::Tab::FileFromLine(int lineNum) const
 {
-    int result = 0;
-
-    bool filterReoccurring = false;
-
-    const DbConfig& cfg = cmd->Db()->GetConfig();
-    if (cmd->Id() == FIND_DEFINITION && cfg._useLibDb)
-    {
-        for (const auto& libPath : cfg._libDbPaths)
-        {
-            if (libPath.IsParentOf(cmd->Db()->GetPath()))
-            {
-                filterReoccurring = true;
-                break;
-            }
-        }
-    }
-
-    StrUniquenessChecker<char> strChecker;
+    auto iFile = std::upper_bound(_files.begin(), _files.end(), lineNum,
+            [](int line, const File& file) { return line < file._line; });
 
-    char*       pSrc = cmd->Result();
-    char*       pIdx;
-
-    const char* pLine;
-    const char* pPreviousFile = NULL;
-    unsigned    previousFileLen = 0;
-    bool        previousFileFiltered = false;
-
-    unsigned    previousBufLen;
-
-    for (;;)
-    {
-        while (*pSrc == '\n' || *pSrc == '\r')
-            ++pSrc;
-        if (*pSrc == 0) break;
-
-        previousBufLen = _buf.Len();
-        pLine = pSrc;
-
-        pIdx = pSrc;
-        while (*pIdx != ':')
-            ++pIdx;
-
-        // Path is absolute (starts with drive letter)
-        if ((pIdx - pSrc == 1) && ((*(pIdx + 1) == '\\') || (*(pIdx + 1) == '/')))
-            while (*++pIdx != ':');
-
-        // add new file name to the UI buffer only if it is different
-        // than the previous one
-        if ((pPreviousFile == NULL) || ((unsigned)(pIdx - pSrc) != previousFileLen) ||
-            strncmp(pSrc, pPreviousFile, previousFileLen))
-        {
-            pPreviousFile = pSrc;
-            previousFileLen = pIdx - pSrc;
+    return (int)(iFile - _files.begin()) - 1;
+}
 
-            if (filterEntry(cfg, pPreviousFile, previousFileLen))
-            {
-                previousFileFiltered = true;
-            }
-            else
-            {
-                _buf += "\n\t";
-                _buf.Append(pPreviousFile, previousFileLen);
 
-                previousFileFiltered = false;
-            }
-        }
+/**
+ *  \brief  The result lines are inserted after the file line - the next file lines move down
+ */
+void ResultWin::Tab::SetLoaded(int file)
+{
+    if (_files[file]._loaded)
+        return;
 
-        if (previousFileFiltered)
-        {
-            while (*pSrc != '\n' && *pSrc != '\r')
-                ++pSrc;
-            continue;
-        }
+    _files[file]._loaded = true;
+    --_unloadedFiles;
 
-        pSrc = ++pIdx;
-        while (*pSrc != ':')
-            ++pSrc;
+    const int resultsCount = Parser()->ResultsCount(file);
 
-        _buf += "\n\t\tline ";
-        _buf.Append(pIdx, pSrc - pIdx);
-        _buf += ":\t";
+    for (unsigned i = file + 1; i < _files.size(); ++i)
+        _files[i]._line += resultsCount;
+}
 
-        pIdx = ++pSrc;
-        while (*pIdx == ' ' || *pIdx == '\t')
-            ++pIdx;
 
-        pSrc = pIdx + 1;
-        while (*pSrc != '\n' && *pSrc != '\r')
-            ++pSrc;
+/**
+ *  \brief
+ */
+void ResultWin::Tab::SetAllLoaded()
+{
+    const TabParser* parser = Parser();
+    int lineNum = 1;
 
-        if (pSrc == pIdx + 1)
-            return -1;
+    for (unsigned i = 0; i < _files.size(); ++i)
+    {
+        _files[i]._line     = lineNum;
+        _files[i]._loaded   = true;
 
-        _buf.Append(pIdx, pSrc - pIdx);
+        lineNum += 1 + parser->ResultsCount(i);
+    }
 
-        *pSrc++ = 0;
+    _unloadedFiles = 0;
+}
 
-        if (filterReoccurring && !strChecker.IsUnique(pLine))
-            _buf.Resize(previousBufLen);
-        else
-            ++result;
-    }
 
-    return result;
+/**
+ *  \brief  Leaves only the header line - the results are lost
+ */
+void ResultWin::Tab::Clear()
+{
+    _files.clear();
+    _unloadedFiles = 0;
+    _currentLine = 0;
+    _firstVisibleLine = 0;
 }
 
 
 /**
- *  \brief
+ *  \brief  Returns the hits on the given tab document line (NULL if none)
  */
-ResultWin::Tab::Tab(const CmdPtr_t& cmd) :
-    _cmdId(cmd->Id()), _regExp(cmd->RegExp()), _ignoreCase(cmd->IgnoreCase()),
-    _projectPath(cmd->Db()->GetPath().C_str()), _search(cmd->Tag().C_str()), _currentLine(1), _firstVisibleLine(0),
-    _parser(cmd->Parser())
+const TabParser::Hit* ResultWin::Tab::GetHits(int lineNum, unsigned& hitsCount, unsigned& previewCol) const
 {
+    const int file = FileFromLine(lineNum);
+
+    if (file < 0 || !_files[file]._loaded || lineNum == _files[file]._line)
+    {
+        hitsCount   = 0;
+        previewCol  = 0;
+        return NULL;
+    }
+
+    return Parser()->GetHits(file, lineNum - _files[file]._line - 1, hitsCount, previewCol);
 }
 
 
@@ -300,7 +228,9 @@ ResultWin::Tab::Tab(const CmdPtr_t& cmd) :
  */
 inline void ResultWin::Tab::SetFolded(int lineNum)
 {
-    _expandedLines.erase(lineNum);
+    const int file = FileFromLine(lineNum);
+    if (file >= 0)
+        _files[file]._expanded = false;
 }
 
 
@@ -309,7 +239,8 @@ inline void ResultWin::Tab::SetFolded(int lineNum)
  */
 inline void ResultWin::Tab::SetAllFolded()
 {
-    _expandedLines.clear();
+    for (auto& file : _files)
+        file._expanded = false;
 }
 
 
@@ -318,7 +249,9 @@ inline void ResultWin::Tab::SetAllFolded()
  */
 inline void ResultWin::Tab::ClearFolded(int lineNum)
 {
-    _expandedLines.insert(lineNum);
+    const int file = FileFromLine(lineNum);
+    if (file >= 0)
+        _files[file]._expanded = true;
 }
 
 
@@ -327,7 +260,9 @@ inline void ResultWin::Tab::ClearFolded(int lineNum)
  */
 inline bool ResultWin::Tab::IsFolded(int lineNum)
 {
-    return (_expandedLines.find(lineNum) == _expandedLines.end());
+    const int file = FileFromLine(lineNum);
+
+    return (file < 0 || !_files[file]._expanded);
 }
 
 
@@ -491,6 +426,8 @@ void ResultWin::show(const CmdPtr_t& cmd)
     loadTab(tab);
 
     showWindow();
+
+    cmd->Timing().Mark(CmdTiming::RENDERED);
 }
 
 
@@ -868,21 +805,41 @@ ResultWin::Tab* ResultWin::getTab(int i)
  */
 void ResultWin::loadTab(ResultWin::Tab* tab)
 {
-    // store current view if there is one
+    TabStore& store = TabStore::Get();
+    store.SetBudget((size_t)GTagsSettings._tabsMemory * 1024 * 1024);
+
+    // store current view if there is one and pack the tab results
     if (_activeTab)
     {
         _activeTab->_currentLine = sendSci(SCI_LINEFROMPOSITION, sendSci(SCI_GETCURRENTPOS));
         _activeTab->_firstVisibleLine = sendSci(SCI_GETFIRSTVISIBLELINE);
+
+        if (_activeTab != tab)
+            store.Pack(_activeTab->Parser());
     }
 
     _activeTab = NULL;
+    _findTab = NULL;
 
     sendSci(SCI_SETREADONLY, 0);
     sendSci(SCI_CLEARALL);
 
+    if (!store.Restore(tab->Parser()))
+    {
+        tab->Clear();
+
+        MessageBox(INpp::Get().GetHandle(),
+                _T("Failed restoring the results of this tab.")
+                _T("\nPlease redo the search."),
+                cPluginName, MB_OK | MB_ICONEXCLAMATION);
+    }
+
     _activeTab = tab;
 
-    sendSci(SCI_SETTEXT, 0, reinterpret_cast<LPARAM>(tab->_parser->GetText().C_str()));
+    CTextA text;
+    tab->GetText(text);
+
+    sendSci(SCI_SETTEXT, 0, reinterpret_cast<LPARAM>(text.C_str()));
     sendSci(SCI_SETREADONLY, 1);
 
     sendSci(SCI_SETFIRSTVISIBLELINE, tab->_firstVisibleLine);
@@ -890,6 +847,68 @@ void ResultWin::loadTab(ResultWin::Tab* tab)
 }
 
 
+/**
+ *  \brief  Inserts the result lines of the file in the active tab document
+ */
+void ResultWin::insertResults(int file)
+{
+    const TabParser* parser = _activeTab->Parser();
+    const int lineNum = _activeTab->FileLine(file);
+    const int resultsCount = parser->ResultsCount(file);
+
+    if (resultsCount == 0)
+        return;
+
+    CTextA text;
+    parser->AppendResults(text, file);
+
+    sendSci(SCI_SETREADONLY, 0);
+    sendSci(SCI_INSERTTEXT, sendSci(SCI_GETLINEENDPOSITION, lineNum), reinterpret_cast<LPARAM>(text.C_str()));
+    sendSci(SCI_SETREADONLY, 1);
+
+    // The inserted lines are styled later - set the fold levels now so they are hidden in a folded file
+    sendSci(SCI_SETFOLDLEVEL, lineNum, FILE_HEADER_LVL | SC_FOLDLEVELHEADERFLAG);
+
+    for (int i = 1; i <= resultsCount; ++i)
+        sendSci(SCI_SETFOLDLEVEL, lineNum + i, RESULT_LVL);
+
+    if (_activeTab->IsFolded(lineNum))
+        sendSci(SCI_FOLDLINE, lineNum, SC_FOLDACTION_CONTRACT);
+}
+
+
+/**
+ *  \brief  Loads the file result lines in the active tab document if not already loaded
+ */
+void ResultWin::loadFile(int file)
+{
+    if (file < 0 || _activeTab->IsLoaded(file))
+        return;
+
+    insertResults(file);
+    _activeTab->SetLoaded(file);
+}
+
+
+/**
+ *  \brief  Loads the result lines of all files in the active tab document
+ */
+void ResultWin::loadAllFiles()
+{
+    if (_activeTab->IsAllLoaded())
+        return;
+
+    // Last file first so the lines of the files before it stay the same
+    for (int file = _activeTab->Parser()->FilesCount() - 1; file >= 0; --file)
+    {
+        if (!_activeTab->IsLoaded(file))
+            insertResults(file);
+    }
+
+    _activeTab->SetAllLoaded();
+}
+
+
 /**
  *  \brief
  */
@@ -909,11 +928,33 @@ bool ResultWin::openItem(int lineNum, unsigned matchNum)
     int line = 0;
     int i;
 
+    CTextA hitTxt;
+    unsigned hitCol = 0;
+
     if (_activeTab->_cmdId != FIND_FILE)
     {
-        for (i = 7; i <= lineLen && lineTxt[i] != ':'; ++i);
+        unsigned hitsCount;
+        unsigned previewCol;
+        const TabParser::Hit* hits = _activeTab->GetHits(lineNum, hitsCount, previewCol);
+
+        if (matchNum && matchNum <= hitsCount)
+        {
+            // "\t\tline: Num" - 'N' is at position 8, the preview follows the next '\t'
+            for (i = 8; i < lineLen && lineTxt[i] != '\t'; ++i);
+
+            const TabParser::Hit& hit = hits[matchNum - 1];
+
+            // Hits outside the shown preview are looked up by text
+            if (hit._col >= previewCol && i + 1 + hit._col - previewCol + hit._len <= (unsigned)lineLen)
+            {
+                hitCol = hit._col;
+                hitTxt.Append(&lineTxt[i + 1 + hit._col - previewCol], hit._len);
+            }
+        }
+
+        for (i = TabParser::cResultPrefixLen; i <= lineLen && lineTxt[i] != ':'; ++i);
         lineTxt[i] = 0;
-        line = atoi(&lineTxt[7]) - 1;
+        line = atoi(&lineTxt[TabParser::cResultPrefixLen]) - 1;
 
         lineNum = sendSci(SCI_GETFOLDPARENT, lineNum);
         if (lineNum == -1)
@@ -954,17 +995,36 @@ bool ResultWin::openItem(int lineNum, unsigned matchNum)
     if (_activeTab->_cmdId == FIND_FILE)
         return true;
 
+    const long lineStart = npp.PositionFromLine(line);
     const long endPos = npp.LineEndPosition(line);
 
+    // The hit column is in the file bytes - they are the document ones only if Notepad++ has not converted them
+    // (UTF-16, ANSI with a set character set). Then just check that the text at the column is still the same.
+    if (lineStart >= 0 && !hitTxt.IsEmpty() && npp.IsDocUtf8())
+    {
+        const long hitStart = lineStart + hitCol;
+        const long hitEnd = hitStart + hitTxt.Len();
+
+        CTextA docTxt;
+        if (hitEnd <= endPos)
+            npp.GetTextRange(docTxt, hitStart, hitEnd);
+
+        if (docTxt == hitTxt)
+        {
+            npp.SetView(hitStart, hitEnd);
+            return true;
+        }
+    }
+
     const bool wholeWord = (_activeTab->_cmdId != GREP && _activeTab->_cmdId != GREP_TEXT);
 
-    // Highlight the corresponding match number if there are more than one
+    // Otherwise highlight the corresponding match number if there are more than one
     // matches on single result line
-    for (long findBegin = npp.PositionFromLine(line), findEnd = endPos;
+    for (long findBegin = lineStart, findEnd = endPos;
         matchNum; findBegin = findEnd, findEnd = endPos, --matchNum)
     {
-        if (!npp.SearchText(_activeTab->_search.C_str(), _activeTab->_ignoreCase, wholeWord, _activeTab->_regExp,
-                &findBegin, &findEnd))
+        if (lineStart < 0 || !npp.SearchText(_activeTab->_search.C_str(), _activeTab->_ignoreCase, wholeWord,
+                _activeTab->_regExp, &findBegin, &findEnd))
         {
             MessageBox(npp.GetHandle(),
                     _T("Look-up mismatch, present results are outdated.")
@@ -1011,6 +1071,8 @@ bool ResultWin::findString(const char* str, int* startPos, int* endPos, bool ign
  */
 void ResultWin::toggleFolding(int lineNum)
 {
+    loadFile(_activeTab->FileFromLine(lineNum));
+
     sendSci(SCI_GOTOLINE, lineNum);
     sendSci(SCI_TOGGLEFOLD, lineNum);
 
@@ -1026,6 +1088,14 @@ void ResultWin::toggleFolding(int lineNum)
  */
 void ResultWin::foldAll(int foldAction)
 {
+    if (!_activeTab->IsAllLoaded())
+    {
+        // Toggle expands all if the first file is folded
+        if (foldAction == SC_FOLDACTION_EXPAND ||
+                (foldAction == SC_FOLDACTION_TOGGLE && !sendSci(SCI_GETFOLDEXPANDED, _activeTab->FileLine(0))))
+            loadAllFiles();
+    }
+
     sendSci(SCI_FOLDALL, foldAction);
 
     const int linesCount = sendSci(SCI_GETLINECOUNT);
@@ -1132,29 +1202,38 @@ void ResultWin::onStyleNeeded(SCNotification* notify)
                 int previewPos = startPos + 8;
                 for (; (char)sendSci(SCI_GETCHARAT, previewPos) != '\t'; ++previewPos);
 
-                int findBegin = previewPos;
-                int findEnd = endPos;
+                unsigned hitsCount;
+                unsigned previewCol;
+                const TabParser::Hit* hits = _activeTab->GetHits(lineNum, hitsCount, previewCol);
 
-                const bool wholeWord = (_activeTab->_cmdId != GREP && _activeTab->_cmdId != GREP_TEXT);
-
-                if (findString(_activeTab->_search.C_str(), &findBegin, &findEnd,
-                    _activeTab->_ignoreCase, wholeWord, _activeTab->_regExp))
+                if (hits)
                 {
                     sendSci(SCI_SETSTYLING, previewPos - startPos, SCE_GTAGS_LINE_NUM);
 
-                    // Highlight all matches in a single result line
-                    do
+                    // The preview starts after the '\t', highlight all matches in a single result line
+                    const int previewStart = previewPos + 1;
+
+                    for (unsigned i = 0; i < hitsCount; ++i)
                     {
-                        if (findBegin - previewPos)
-                            sendSci(SCI_SETSTYLING, findBegin - previewPos, STYLE_DEFAULT);
+                        // Hits outside the shown preview are not highlighted
+                        if (hits[i]._col < previewCol)
+                            continue;
+
+                        const int hitBegin = previewStart + (int)(hits[i]._col - previewCol);
+                        if (hitBegin < previewPos || hitBegin >= endPos)
+                            continue;
 
-                        sendSci(SCI_SETSTYLING, findEnd - findBegin, SCE_GTAGS_WORD2SEARCH);
+                        int hitEnd = hitBegin + (int)hits[i]._len;
+                        if (hitEnd > endPos)
+                            hitEnd = endPos;
 
-                        findBegin = previewPos = findEnd;
-                        findEnd = endPos;
+                        if (hitBegin - previewPos)
+                            sendSci(SCI_SETSTYLING, hitBegin - previewPos, STYLE_DEFAULT);
+
+                        sendSci(SCI_SETSTYLING, hitEnd - hitBegin, SCE_GTAGS_WORD2SEARCH);
+
+                        previewPos = hitEnd;
                     }
-                    while (findString(_activeTab->_search.C_str(), &findBegin, &findEnd,
-                            _activeTab->_ignoreCase, wholeWord, _activeTab->_regExp));
 
                     if (endPos - previewPos)
                         sendSci(SCI_SETSTYLING, endPos - previewPos, STYLE_DEFAULT);
@@ -1197,21 +1276,22 @@ void ResultWin::onHotspotClick(SCNotification* notify)
 
     if (_activeTab->_cmdId != FIND_FILE)
     {
-        const int endLine = sendSci(SCI_GETLINEENDPOSITION, lineNum);
-
         // "\t\tline: Num" - 'N' is at position 8
-        int findBegin = sendSci(SCI_POSITIONFROMLINE, lineNum) + 8;
-        for (; (char)sendSci(SCI_GETCHARAT, findBegin) != '\t'; ++findBegin);
+        int previewPos = sendSci(SCI_POSITIONFROMLINE, lineNum) + 8;
+        for (; (char)sendSci(SCI_GETCHARAT, previewPos) != '\t'; ++previewPos);
 
-        const bool wholeWord = (_activeTab->_cmdId != GREP && _activeTab->_cmdId != GREP_TEXT);
+        unsigned hitsCount;
+        unsigned previewCol;
+        const TabParser::Hit* hits = _activeTab->GetHits(lineNum, hitsCount, previewCol);
 
         // Find which hotspot was clicked in case there are more than one
-        // matches on single result line
-        for (int findEnd = endLine; findString(_activeTab->_search.C_str(), &findBegin, &findEnd,
-                    _activeTab->_ignoreCase, wholeWord, _activeTab->_regExp);
-                findBegin = findEnd, findEnd = endLine, ++matchNum)
-            if (notify->position >= findBegin && notify->position <= findEnd)
+        // matches on single result line - the preview starts after the '\t'
+        for (; matchNum < hitsCount; ++matchNum)
+        {
+            const TabParser::Hit& hit = hits[matchNum - 1];
+            if (notify->position <= previewPos + 1 + (int)hit._col - (int)previewCol + (int)hit._len)
                 break;
+        }
     }
 
     openItem(lineNum, matchNum);
@@ -1515,6 +1595,7 @@ void ResultWin::onCloseTab()
 void ResultWin::closeAllTabs()
 {
     _activeTab = NULL;
+    _findTab = NULL;
 
     for (int i = TabCtrl_GetItemCount(_hTab); i; --i)
     {
@@ -1610,31 +1691,59 @@ void ResultWin::onSearch(bool reverseDir, bool keepFocus)
         return;
     }
 
+    if (_activeTab == NULL)
+        return;
+
     CTextA txt(_lastSearchTxt.C_str());
 
-    const int docEnd = sendSci(SCI_GETLENGTH);
+    // The matches in the whole tab are found once per search text and options
+    if (_findTab != _activeTab || !(_findTxt == txt) ||
+            _findRE != _lastRE || _findIC != _lastIC || _findWW != _lastWW)
+    {
+        _activeTab->Parser()->FindAll(txt.C_str(), _lastIC, _lastWW, _lastRE, _findMatches);
 
-    int startPos = sendSci(SCI_GETCURRENTPOS);
-    int endPos = docEnd;
+        _findTab    = _activeTab;
+        _findTxt    = txt;
+        _findRE     = _lastRE;
+        _findIC     = _lastIC;
+        _findWW     = _lastWW;
+    }
 
-    if (reverseDir)
+    if (_findMatches.empty())
     {
-        if (startPos)
-            startPos -= 1;
-        else
-            startPos = docEnd;
+        if (_hSearch)
+        {
+            SetWindowText(_hSearch, _T("Search in results - not found"));
+            Edit_SetSel(_hSearchTxt, 0, -1);
+        }
 
-        endPos = 0;
+        return;
     }
 
-    bool found = findString(txt.C_str(), &startPos, &endPos, _lastIC, _lastWW, _lastRE);
+    const TabParser::Match from = matchFromPos(reverseDir ?
+            sendSci(SCI_GETSELECTIONSTART) : sendSci(SCI_GETCURRENTPOS));
 
-    if (!found && ((!reverseDir && startPos) || (reverseDir && startPos != docEnd)))
+    auto iMatch = std::lower_bound(_findMatches.begin(), _findMatches.end(), from, matchIsBefore);
+    bool wrapped = false;
+
+    if (!reverseDir && iMatch == _findMatches.end())
+    {
+        iMatch = _findMatches.begin();
+        wrapped = true;
+    }
+    else if (reverseDir)
     {
-        startPos = reverseDir ? docEnd : 0;
+        if (iMatch == _findMatches.begin())
+        {
+            iMatch = _findMatches.end();
+            wrapped = true;
+        }
 
-        found = findString(txt.C_str(), &startPos, &endPos, _lastIC, _lastWW, _lastRE);
+        --iMatch;
+    }
 
+    if (wrapped)
+    {
         FLASHWINFO fi {0};
         fi.cbSize       = sizeof(fi);
         fi.hwnd         = INpp::Get().GetHandle();
@@ -1645,17 +1754,86 @@ void ResultWin::onSearch(bool reverseDir, bool keepFocus)
         FlashWindowEx(&fi);
     }
 
-    if (found)
+    if (!keepFocus)
+        SetFocus(_hSci);
+
+    showMatch(iMatch - _findMatches.begin());
+}
+
+
+/**
+ *  \brief  Orders the search matches as they are in the tab
+ */
+bool ResultWin::matchIsBefore(const TabParser::Match& lhs, const TabParser::Match& rhs)
+{
+    if (lhs._file != rhs._file)
+        return (lhs._file < rhs._file);
+
+    if (lhs._result != rhs._result)
+        return (lhs._result < rhs._result);
+
+    return (lhs._col < rhs._col);
+}
+
+
+/**
+ *  \brief  Converts the active tab document position to search match coordinates
+ */
+TabParser::Match ResultWin::matchFromPos(int pos)
+{
+    TabParser::Match match = { 0, -1, 0, 0 };
+
+    const int lineNum = sendSci(SCI_LINEFROMPOSITION, pos);
+    const int file = _activeTab->FileFromLine(lineNum);
+
+    if (file < 0)
+        return match;
+
+    const int fileLine = _activeTab->FileLine(file);
+    const int col = pos - sendSci(SCI_POSITIONFROMLINE, lineNum);
+
+    match._file = file;
+
+    if (lineNum != fileLine)
+        match._result = lineNum - fileLine - 1;
+
+    match._col = TabParser::SpanCol(match._result, col);
+
+    return match;
+}
+
+
+/**
+ *  \brief  Selects the search match - its file results are loaded and
+ *          unfolded if needed
+ */
+void ResultWin::showMatch(unsigned matchIdx)
+{
+    const TabParser::Match& match = _findMatches[matchIdx];
+
+    int lineNum = _activeTab->FileLine(match._file);
+
+    if (match._result >= 0)
     {
-        if (!keepFocus)
-            SetFocus(_hSci);
+        loadFile(match._file);
+
+        // Scintilla unfolds the file to show the match
+        _activeTab->ClearFolded(lineNum);
 
-        sendSci(SCI_SETSEL, startPos, endPos);
-        sendSci(SCI_ENSUREVISIBLEENFORCEPOLICY, sendSci(SCI_LINEFROMPOSITION, startPos));
+        lineNum += match._result + 1;
     }
-    else
+
+    const int startPos = sendSci(SCI_POSITIONFROMLINE, lineNum) + TabParser::LineCol(match._result, match._col);
+
+    sendSci(SCI_SETSEL, startPos, startPos + match._len);
+    sendSci(SCI_ENSUREVISIBLEENFORCEPOLICY, lineNum);
+
+    if (_hSearch)
     {
-        Edit_SetSel(_hSearchTxt, 0, -1);
+        TCHAR caption[64];
+        _sntprintf_s(caption, _countof(caption), _TRUNCATE, _T("Search in results - %u of %u"),
+                matchIdx + 1, (unsigned)_findMatches.size());
+        SetWindowText(_hSearch, caption);
     }
 }
 
@@ -1823,15 +2001,7 @@ LRESULT APIENTRY ResultWin::wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
         // Below are WM_USER messages for DLL threads synchronization
 
         case WM_RUN_CMD_CALLBACK:
-        {
-            CompletionCB    complCB = reinterpret_cast<CompletionCB>(wParam);
-            CmdPtr_t        cmd(*(reinterpret_cast<CmdPtr_t*>(lParam)));
-
-            ReplyMessage(0);
-
-            if (complCB && cmd)
-                complCB(cmd);
-        }
+            CmdEngine::RunCompletions();
         return 0;
 
         case WM_OPEN_ACTIVITY_WIN:
@@ -1844,6 +2014,16 @@ LRESULT APIENTRY ResultWin::wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
         }
         return 0;
 
+        case WM_UPDATE_ACTIVITY_WIN:
+        {
+            const ActivityWin::Progress* progress = reinterpret_cast<const ActivityWin::Progress*>(wParam);
+            HANDLE hCancel = reinterpret_cast<HANDLE>(lParam);
+
+            if (hCancel && progress)
+                ActivityWin::Update(hCancel, progress->_text, progress->_percent);
+        }
+        return 0;
+
         case WM_CLOSE_ACTIVITY_WIN:
         {
             HANDLE hCancel = reinterpret_cast<HANDLE>(lParam);
@@ -1854,6 +2034,8 @@ LRESULT APIENTRY ResultWin::wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
 
                 if (hActivityWin)
                     SendMessage(hActivityWin, WM_CLOSE, 0, 0);
+
+                CloseHandle(hCancel);
             }
         }
         return 0;
@@ -27,10 +27,11 @@
 
 #include <windows.h>
 #include <tchar.h>
-#include <unordered_set>
+#include <vector>
 #include "Scintilla.h"
 #include "Common.h"
 #include "Cmd.h"
+#include "TabParser.h"
 
 
 namespace GTags
@@ -43,26 +44,6 @@ namespace GTags
 class ResultWin
 {
 public:
-    /**
-     *  \class  TabParser
-     *  \brief
-     */
-    class TabParser : public ResultParser
-    {
-    public:
-        TabParser() {}
-        virtual ~TabParser() {}
-
-        virtual int Parse(const CmdPtr_t&);
-
-    private:
-        static bool filterEntry(const DbConfig& cfg, const char* pEntry, unsigned len);
-
-        int parseCmd(const CmdPtr_t&);
-        int parseFindFile(const CmdPtr_t&);
-    };
-
-
     static HWND Register();
     static void Unregister();
 
@@ -103,12 +84,15 @@ public:
 private:
     /**
      *  \struct  Tab
-     *  \brief
+     *  \brief  The tab document holds the header line and a line per file.
+     *          The result lines of a file are loaded from the parser model
+     *          the first time it is expanded - only the first page of files is
+     *          loaded upfront so huge result sets show instantly.
      */
     struct Tab
     {
         Tab(const CmdPtr_t& cmd);
-        ~Tab() {}
+        ~Tab();
         Tab& operator=(const Tab&) = delete;
 
         inline bool operator==(const Tab& tab) const
@@ -125,13 +109,43 @@ private:
         int             _firstVisibleLine;
         ParserPtr_t     _parser;
 
+        // Result tabs are always filled by TabParser
+        inline TabParser* Parser() const
+        {
+            return static_cast<TabParser*>(_parser.get());
+        }
+
+        void GetText(CTextA& text) const;
+
+        int FileFromLine(int lineNum) const;
+        inline int FileLine(int file) const { return _files[file]._line; }
+        inline bool IsLoaded(int file) const { return _files[file]._loaded; }
+        inline bool IsAllLoaded() const { return (_unloadedFiles == 0); }
+        void SetLoaded(int file);
+        void SetAllLoaded();
+        void Clear();
+
+        const TabParser::Hit* GetHits(int lineNum, unsigned& hitsCount, unsigned& previewCol) const;
+
         inline void SetFolded(int lineNum);
         inline void SetAllFolded();
         inline void ClearFolded(int lineNum);
         inline bool IsFolded(int lineNum);
 
     private:
-        std::unordered_set<int> _expandedLines;
+        /**
+         *  \struct  File
+         *  \brief  The file line in the tab document
+         */
+        struct File
+        {
+            int     _line;
+            bool    _loaded;
+            bool    _expanded;
+        };
+
+        std::vector<File>   _files;
+        unsigned            _unloadedFiles;
     };
 
 
@@ -144,6 +158,7 @@ private:
     static const int        cSearchBkgndColor;
     static const unsigned   cSearchFontSize;
     static const int        cSearchWidth;
+    static const unsigned   cPageResults;
 
     static LRESULT CALLBACK keyHookProc(int code, WPARAM wParam, LPARAM lParam);
     static LRESULT APIENTRY wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -151,7 +166,7 @@ private:
 
     ResultWin() : _hWnd(NULL), _hSci(NULL), _hKeyHook(NULL), _sciFunc(NULL), _sciPtr(0), _activeTab(NULL),
             _hSearch(NULL), _hSearchFont(NULL), _hBtnFont(NULL),
-            _lastRE(false), _lastIC(false), _lastWW(true) {}
+            _lastRE(false), _lastIC(false), _lastWW(true), _findTab(NULL) {}
     ResultWin(const ResultWin&);
     ~ResultWin();
 
@@ -182,6 +197,9 @@ private:
 
     Tab* getTab(int i = -1);
     void loadTab(Tab* tab);
+    void insertResults(int file);
+    void loadFile(int file);
+    void loadAllFiles();
     bool openItem(int lineNum, unsigned matchNum = 1);
 
     bool findString(const char* str, int* startPos, int* endPos, bool ignoreCase, bool wholeWord, bool regExp);
@@ -200,6 +218,10 @@ private:
     void onMove();
     void onSearch(bool reverseDir = false, bool keepFocus = false);
 
+    static bool matchIsBefore(const TabParser::Match& lhs, const TabParser::Match& rhs);
+    TabParser::Match matchFromPos(int pos);
+    void showMatch(unsigned matchIdx);
+
     static ResultWin* RW;
 
     HWND        _hWnd;
@@ -226,6 +248,14 @@ private:
     bool        _lastIC;
     bool        _lastWW;
     CText       _lastSearchTxt;
+
+    // Search in results matches of _findTab for _findTxt and options
+    const Tab*                      _findTab;
+    CTextA                          _findTxt;
+    bool                            _findRE;
+    bool                            _findIC;
+    bool                            _findWW;
+    std::vector<TabParser::Match>   _findMatches;
 };
 
 } // namespace GTags
@@ -48,13 +48,19 @@ const int SearchWin::cComplAfter    = 2;
 
 
 SearchWin* SearchWin::SW = NULL;
+bool       SearchWin::Registered = false;
 
 
 /**
- *  \brief
+ *  \brief  Called on the first Show
  */
 void SearchWin::Register()
 {
+    if (Registered)
+        return;
+
+    Registered = true;
+
     WNDCLASS wc         = {0};
     wc.style            = CS_HREDRAW | CS_VREDRAW;
     wc.lpfnWndProc      = wndProc;
@@ -78,6 +84,11 @@ void SearchWin::Register()
  */
 void SearchWin::Unregister()
 {
+    if (!Registered)
+        return;
+
+    Registered = false;
+
     UnregisterClass(cClassName, HMod);
 }
 
@@ -90,6 +101,8 @@ void SearchWin::Show(const CmdPtr_t& cmd, CompletionCB complCB, bool enRE, bool
     if (SW)
         SendMessage(SW->_hWnd, WM_CLOSE, 0, 0);
 
+    Register();
+
     HWND hOwner = INpp::Get().GetHandle();
 
     SW = new SearchWin(cmd, complCB);
@@ -124,6 +137,8 @@ SearchWin::~SearchWin()
     if (_hTxtFont)
         DeleteObject(_hTxtFont);
 
+    cancelCompletion();
+
     if (_cancelled)
     {
         _cmd->Status(CANCELLED);
@@ -237,7 +252,10 @@ HWND SearchWin::composeWindow(HWND hOwner, bool enRE, bool enIC)
 void SearchWin::startCompletion()
 {
     if (Button_GetCheck(_hRE) == BST_CHECKED)
+    {
+        cancelCompletion();
         return;
+    }
 
     CmdId_t cmplId;
     TCHAR tag[cComplAfter + 2];
@@ -263,21 +281,47 @@ void SearchWin::startCompletion()
         tag[cComplAfter] = 0;
 
         for (int i = 0; tag[i] != 0; ++i)
+        {
             if (tag[i] == _T(' ') || tag[i] == _T('\t'))
+            {
+                cancelCompletion();
                 return;
+            }
+        }
 
         complCB = halfComplete;
     }
 
-    CmdPtr_t cmpl(new Cmd(cmplId, _T("AutoComplete"), _cmd->Db(), parser,
-            tag, (Button_GetCheck(_hIC) == BST_CHECKED), false));
+    const bool ignoreCase = (Button_GetCheck(_hIC) == BST_CHECKED);
+
+    // The query in flight is for the same prefix - its result is filtered by the current text when ready
+    if (_completionCmd && _completionCmd->Tag() == tag && _completionCmd->IgnoreCase() == ignoreCase)
+        return;
+
+    // Superseded - don't wait for it, start the new query right away
+    cancelCompletion();
+
+    CmdPtr_t cmpl(new Cmd(cmplId, _T("AutoComplete"), _cmd->Db(), parser, tag, ignoreCase, false));
 
     if (_cmd->Id() != FIND_DEFINITION)
         cmpl->SkipLibs(true);
 
-    _completionStarted = true;
+    if (CmdEngine::Run(cmpl, complCB))
+        _completionCmd = cmpl;
+}
+
 
-    CmdEngine::Run(cmpl, complCB);
+/**
+ *  \brief  Drops the completion query in flight - its child process is
+ *          terminated and its result ignored
+ */
+void SearchWin::cancelCompletion()
+{
+    if (_completionCmd)
+    {
+        _completionCmd->Cancel();
+        _completionCmd.reset();
+    }
 }
 
 
@@ -286,12 +330,13 @@ void SearchWin::startCompletion()
  */
 void SearchWin::halfComplete(const CmdPtr_t& cmpl)
 {
-    if (SW == NULL)
+    // Superseded by a newer query
+    if (SW == NULL || SW->_completionCmd != cmpl)
         return;
 
     if (ComboBox_GetTextLength(SW->_hSearch) < cComplAfter)
     {
-        SW->_completionStarted = false;
+        SW->_completionCmd.reset();
         return;
     }
 
@@ -302,13 +347,12 @@ void SearchWin::halfComplete(const CmdPtr_t& cmpl)
         ParserPtr_t parser(new LineParser);
         cmpl->Parser(parser);
 
-        CmdEngine::Run(cmpl, endCompletion);
-    }
-    else
-    {
-        SW->_completionStarted = false;
-        SW->_completionDone = true;
+        if (CmdEngine::Run(cmpl, endCompletion))
+            return;
     }
+
+    SW->_completionCmd.reset();
+    SW->_completionDone = true;
 }
 
 
@@ -317,10 +361,11 @@ void SearchWin::halfComplete(const CmdPtr_t& cmpl)
  */
 void SearchWin::endCompletion(const CmdPtr_t& cmpl)
 {
-    if (SW == NULL)
+    // Superseded by a newer query
+    if (SW == NULL || SW->_completionCmd != cmpl)
         return;
 
-    SW->_completionStarted = false;
+    SW->_completionCmd.reset();
 
     if (ComboBox_GetTextLength(SW->_hSearch) < cComplAfter)
         return;
@@ -340,7 +385,7 @@ void SearchWin::endCompletion(const CmdPtr_t& cmpl)
  */
 void SearchWin::clearCompletion()
 {
-    if (_completionStarted)
+    if (_completionCmd)
         return;
 
     CText txt(ComboBox_GetTextLength(_hSearch));
@@ -372,13 +417,6 @@ void SearchWin::filterComplList()
 
     int pos = HIWORD(SendMessage(_hSearch, CB_GETEDITSEL, 0, 0));
 
-    int (*pCompare)(const TCHAR*, const TCHAR*, size_t);
-
-    if (Button_GetCheck(_hIC) == BST_CHECKED)
-        pCompare = &_tcsnicmp;
-    else
-        pCompare = &_tcsncmp;
-
     ComboBox_ResetContent(_hSearch);
     ComboBox_ShowDropdown(_hSearch, FALSE);
     ComboBox_SetText(_hSearch, filter.C_str());
@@ -386,17 +424,12 @@ void SearchWin::filterComplList()
 
     SendMessage(_hSearch, WM_SETREDRAW, FALSE, 0);
 
-    if (filter.Len() == cComplAfter)
-    {
-        for (const auto& complEntry : _completion->GetList())
-            ComboBox_AddString(_hSearch, complEntry);
-    }
-    else
-    {
-        for (const auto& complEntry : _completion->GetList())
-            if (!pCompare(complEntry, filter.C_str(), filter.Len()))
-                ComboBox_AddString(_hSearch, complEntry);
-    }
+    std::vector<TCHAR*> filtered;
+    _completion->FilterList(filter.C_str(), (filter.Len() == cComplAfter) ? 0 : filter.Len(),
+            Button_GetCheck(_hIC) == BST_CHECKED, filtered);
+
+    for (const auto& complEntry : filtered)
+        ComboBox_AddString(_hSearch, complEntry);
 
     if (ComboBox_GetCount(_hSearch))
     {
@@ -433,9 +466,6 @@ void SearchWin::saveSearchOptions()
  */
 void SearchWin::onEditChange()
 {
-    if (_completionStarted)
-        return;
-
     int len = ComboBox_GetTextLength(_hSearch);
 
     if (_completionDone)
@@ -452,6 +482,8 @@ void SearchWin::onEditChange()
 
     if (!_completionDone && len >= cComplAfter)
         startCompletion();
+    else if (len < cComplAfter)
+        cancelCompletion();
 }
 
 
@@ -469,7 +501,7 @@ void SearchWin::onOK()
         bool re = (Button_GetCheck(_hRE) == BST_CHECKED);
         bool ic = (Button_GetCheck(_hIC) == BST_CHECKED);
 
-        _cmd->Tag(tag);
+        _cmd->Tag(std::move(tag));
         _cmd->RegExp(re);
         _cmd->IgnoreCase(ic);
 
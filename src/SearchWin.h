@@ -61,13 +61,14 @@ private:
 
     SearchWin(const CmdPtr_t& cmd, CompletionCB complCB) :
         _cmd(cmd), _complCB(complCB), _hKeyHook(NULL), _cancelled(true), _keyPressed(0),
-        _completionStarted(false), _completionDone(false) {}
+        _completionDone(false) {}
     SearchWin(const SearchWin&);
     ~SearchWin();
     SearchWin& operator=(const SearchWin&) = delete;
 
     HWND composeWindow(HWND hOwner, bool enRE, bool enIC);
     void startCompletion();
+    void cancelCompletion();
     void clearCompletion();
     void filterComplList();
 
@@ -76,6 +77,7 @@ private:
     void onOK();
 
     static SearchWin* SW;
+    static bool       Registered;
 
     CmdPtr_t            _cmd;
     CompletionCB const  _complCB;
@@ -90,7 +92,7 @@ private:
     HHOOK       _hKeyHook;
     bool        _cancelled;
     int         _keyPressed;
-    bool        _completionStarted;
+    CmdPtr_t    _completionCmd;     // The newest completion query in flight - older ones are cancelled
     bool        _completionDone;
     ParserPtr_t _completion;
 };
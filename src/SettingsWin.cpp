@@ -55,7 +55,7 @@ SettingsWin* SettingsWin::SW = NULL;
 SettingsWin::Tab::Tab(const DbHandle db) : _db(db), _updateDb(false)
 {
     if (db)
-        _cfg = db->GetConfig();
+        _cfg = *db->GetConfig();
     else
         _cfg = GTagsSettings._genericDbCfg;
 }
@@ -243,7 +243,7 @@ HWND SettingsWin::composeWindow(HWND hOwner)
     DWORD styleEx   = WS_EX_OVERLAPPEDWINDOW | WS_EX_TOOLWINDOW;
     DWORD style     = WS_POPUP | WS_CAPTION | WS_SYSMENU | WS_CLIPCHILDREN;
 
-    RECT win = Tools::GetWinRect(hOwner, styleEx, style, 500, 13 * txtHeight + txtInfoHeight + 270);
+    RECT win = Tools::GetWinRect(hOwner, styleEx, style, 500, 14 * txtHeight + txtInfoHeight + 285);
     int width = win.right - win.left;
     int height = win.bottom - win.top;
 
@@ -355,6 +355,12 @@ HWND SettingsWin::composeWindow(HWND hOwner)
             xPos + (width / 2) + 30, yPos, (width / 2) - 50, txtHeight + 10,
             _hWnd, NULL, HMod, NULL);
 
+    yPos += (txtHeight + 15);
+    _hGrepIndex = CreateWindowEx(0, _T("BUTTON"), _T("Index files for text search"),
+            WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX,
+            xPos + (width / 2) + 30, yPos, (width / 2) - 50, txtHeight + 10,
+            _hWnd, NULL, HMod, NULL);
+
     yPos += (txtHeight + 30);
     _hEnLibDb = CreateWindowEx(0, _T("BUTTON"), _T("Enable library databases"),
             WS_CHILD | WS_VISIBLE | BS_AUTOCHECKBOX,
@@ -437,6 +443,7 @@ HWND SettingsWin::composeWindow(HWND hOwner)
         SendMessage(_hUpdDefDb, WM_SETFONT, (WPARAM)_hFontInfo, TRUE);
         SendMessage(_hTab, WM_SETFONT, (WPARAM)_hFontInfo, TRUE);
         SendMessage(_hAutoUpdDb, WM_SETFONT, (WPARAM)_hFontInfo, TRUE);
+        SendMessage(_hGrepIndex, WM_SETFONT, (WPARAM)_hFontInfo, TRUE);
         SendMessage(_hEnLibDb, WM_SETFONT, (WPARAM)_hFontInfo, TRUE);
         SendMessage(_hAddLibDb, WM_SETFONT, (WPARAM)_hFontInfo, TRUE);
         SendMessage(_hUpdLibDbs, WM_SETFONT, (WPARAM)_hFontInfo, TRUE);
@@ -676,6 +683,7 @@ void SettingsWin::fillTabData()
     }
 
     Button_SetCheck(_hAutoUpdDb, _activeTab->_cfg._autoUpdate ? BST_CHECKED : BST_UNCHECKED);
+    Button_SetCheck(_hGrepIndex, _activeTab->_cfg._useGrepIndex ? BST_CHECKED : BST_UNCHECKED);
     Button_SetCheck(_hEnLibDb, _activeTab->_cfg._useLibDb ? BST_CHECKED : BST_UNCHECKED);
     Button_SetCheck(_hEnPathFilter, _activeTab->_cfg._usePathFilter ? BST_CHECKED : BST_UNCHECKED);
 
@@ -709,6 +717,7 @@ void SettingsWin::readTabData()
     }
 
     _activeTab->_cfg._autoUpdate    = (Button_GetCheck(_hAutoUpdDb) == BST_CHECKED) ? true : false;
+    _activeTab->_cfg._useGrepIndex  = (Button_GetCheck(_hGrepIndex) == BST_CHECKED) ? true : false;
     _activeTab->_cfg._useLibDb      = (Button_GetCheck(_hEnLibDb) == BST_CHECKED) ? true : false;
     _activeTab->_cfg._usePathFilter = (Button_GetCheck(_hEnPathFilter) == BST_CHECKED) ? true : false;
 
@@ -736,7 +745,7 @@ bool SettingsWin::saveDbConfig(SettingsWin::Tab* tab)
         return false;
     }
 
-    if (tab->_db->GetConfig()._parserIdx != tab->_cfg._parserIdx)
+    if (tab->_db->GetConfig()->_parserIdx != tab->_cfg._parserIdx)
         tab->_updateDb = true;
 
     tab->_db->SetConfig(tab->_cfg);
@@ -781,7 +790,7 @@ bool SettingsWin::saveTab(SettingsWin::Tab* tab)
         CPath cfgFile(tab->_db->GetPath());
         cfgFile += cPluginCfgFileName;
 
-        if (cfgFile.FileExists() && tab->_db->GetConfig() == tab->_cfg)
+        if (cfgFile.FileExists() && *tab->_db->GetConfig() == tab->_cfg)
             return true;
 
         return saveDbConfig(tab);
@@ -1208,7 +1217,7 @@ LRESULT APIENTRY SettingsWin::wndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARA
                     return 0;
                 }
 
-                if ((HWND)lParam == SW->_hAutoUpdDb)
+                if ((HWND)lParam == SW->_hAutoUpdDb || (HWND)lParam == SW->_hGrepIndex)
                     EnableWindow(SW->_hSave, TRUE);
             }
             else if (HIWORD(wParam) == EN_CHANGE || HIWORD(wParam) == CBN_SELCHANGE)
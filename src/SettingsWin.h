@@ -120,6 +120,7 @@ private:
     HWND        _hParserInfo;
     HWND        _hParser;
     HWND        _hAutoUpdDb;
+    HWND        _hGrepIndex;
     HWND        _hEnLibDb;
     HWND        _hAddLibDb;
     HWND        _hUpdLibDbs;
@@ -0,0 +1,168 @@
+/**
+ *  \file
+ *  \brief  Plugin startup phases timing and on-first-use init of the subsystems
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include "CmdTrace.h"
+#include "Startup.h"
+
+
+namespace GTags
+{
+
+const double Startup::cBudgetMs = 5.0;
+
+const TCHAR* const Startup::cPhaseNames[] =
+{
+    _T("DLL load"),
+    _T("init"),
+    _T("ready"),
+    _T("Settings"),
+    _T("GTags binaries check"),
+    _T("Results window"),
+    _T("COM")
+};
+
+
+/**
+ *  \brief
+ */
+void Startup::Begin(Phase_t phase)
+{
+    _begin[phase]   = CmdTiming::Now();
+    _end[phase]     = 0;
+}
+
+
+/**
+ *  \brief
+ */
+void Startup::End(Phase_t phase)
+{
+    _end[phase] = CmdTiming::Now();
+    _ok[phase]  = true;
+}
+
+
+/**
+ *  \brief  Runs initFunc on the first call for subsystem only. Returns its
+ *          result - the same on each later call. A modal dialog shown by
+ *          initFunc runs the timer procs and the window messages - the calls
+ *          made from them while it is running return false.
+ */
+bool Startup::Init(Phase_t subsystem, bool (*initFunc)())
+{
+    if (_end[subsystem])
+        return _ok[subsystem];
+
+    if (_running[subsystem])
+        return false;
+
+    _running[subsystem] = true;
+
+    Begin(subsystem);
+    const bool ok = initFunc();
+    End(subsystem);
+
+    _ok[subsystem]      = ok;
+    _running[subsystem] = false;
+
+    return ok;
+}
+
+
+/**
+ *  \brief  -1 if the phase has not run (yet)
+ */
+double Startup::PhaseMs(Phase_t phase) const
+{
+    if (!_end[phase])
+        return -1.0;
+
+    return CmdTiming::ToMs(_end[phase] - _begin[phase]);
+}
+
+
+/**
+ *  \brief  The time the editor start waited for the plugin
+ */
+double Startup::StartupMs() const
+{
+    double ms = 0;
+
+    for (int phase = LOAD; phase < SETTINGS; ++phase)
+        if (_end[phase])
+            ms += CmdTiming::ToMs(_end[phase] - _begin[phase]);
+
+    return ms;
+}
+
+
+/**
+ *  \brief
+ */
+bool Startup::AppendStats(const CPath& file) const
+{
+    FILE* fp;
+    _tfopen_s(&fp, file.C_str(), _T("at"));
+    if (fp == NULL)
+        return false;
+
+    const double startupMs = StartupMs();
+
+    _ftprintf_s(fp, _T("\n# Startup\n"));
+    _ftprintf_s(fp, _T("# Editor start waited %.2f ms for the plugin (budget %.2f ms%s) - %s %.2f ms, %s %.2f ms, ")
+            _T("%s %.2f ms\n"), startupMs, cBudgetMs, startupMs <= cBudgetMs ? _T("") : _T(", EXCEEDED"),
+            cPhaseNames[LOAD], PhaseMs(LOAD), cPhaseNames[INIT], PhaseMs(INIT), cPhaseNames[READY], PhaseMs(READY));
+
+    const LONGLONG ready = _end[READY];
+
+    for (int phase = SETTINGS; phase < PHASES_NUM; ++phase)
+    {
+        if (!_end[phase])
+        {
+            _ftprintf_s(fp, _T("# %s: not used yet\n"), cPhaseNames[phase]);
+        }
+        else if (_begin[phase] < ready)
+        {
+            _ftprintf_s(fp, _T("# %s: init %.2f ms%s, on ready\n"), cPhaseNames[phase],
+                    CmdTiming::ToMs(_end[phase] - _begin[phase]), _ok[phase] ? _T("") : _T(" (failed)"));
+        }
+        else
+        {
+            _ftprintf_s(fp, _T("# %s: init %.2f ms%s, on first use %.0f ms after ready\n"), cPhaseNames[phase],
+                    CmdTiming::ToMs(_end[phase] - _begin[phase]), _ok[phase] ? _T("") : _T(" (failed)"),
+                    ready ? CmdTiming::ToMs(_begin[phase] - ready) : -1.0);
+        }
+    }
+
+    fclose(fp);
+
+    return true;
+}
+
+} // namespace GTags
@@ -0,0 +1,100 @@
+/**
+ *  \file
+ *  \brief  Plugin startup phases timing and on-first-use init of the subsystems
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include "Common.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  Startup
+ *  \brief  Times the plugin work on the editor start path (DLL load, setInfo
+ *          and NPPN_READY) and initializes the rest of the subsystems on
+ *          their first use instead - each init is run and timed once and its
+ *          result is remembered. Used on the UI thread only.
+ */
+class Startup
+{
+public:
+    enum Phase_t
+    {
+        LOAD = 0,
+        INIT,
+        READY,
+        SETTINGS,       // Subsystems from here on - the settings are loaded on ready, the rest on first use
+        BINARIES,
+        RESULT_WIN,
+        COM,
+        PHASES_NUM
+    };
+
+    // Plugin share of the editor start time - LOAD, INIT and READY
+    static const double cBudgetMs;
+
+    static Startup& Get()
+    {
+        static Startup Instance;
+        return Instance;
+    }
+
+    void Begin(Phase_t phase);
+    void End(Phase_t phase);
+
+    bool Init(Phase_t subsystem, bool (*initFunc)());
+    inline bool IsInit(Phase_t subsystem) const { return (_end[subsystem] && _ok[subsystem]); }
+
+    double PhaseMs(Phase_t phase) const;
+    double StartupMs() const;
+    inline bool WithinBudget() const { return (StartupMs() <= cBudgetMs); }
+
+    bool AppendStats(const CPath& file) const;
+
+private:
+    static const TCHAR* const cPhaseNames[];
+
+    Startup()
+    {
+        memset(_begin, 0, sizeof(_begin));
+        memset(_end, 0, sizeof(_end));
+        memset(_ok, 0, sizeof(_ok));
+        memset(_running, 0, sizeof(_running));
+    }
+    Startup(const Startup&);
+    ~Startup() {}
+
+    LONGLONG    _begin[PHASES_NUM];
+    LONGLONG    _end[PHASES_NUM];
+    bool        _ok[PHASES_NUM];
+    bool        _running[PHASES_NUM];
+};
+
+} // namespace GTags
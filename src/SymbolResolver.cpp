@@ -0,0 +1,472 @@
+/**
+ *  \file
+ *  \brief  Batch symbol resolution for the identifiers in the visible editor range
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <string.h>
+#include <algorithm>
+#include <numeric>
+#include "INpp.h"
+#include "Config.h"
+#include "GTags.h"
+#include "DbManager.h"
+#include "CmdEngine.h"
+#include "SymbolResolver.h"
+
+
+namespace
+{
+
+/**
+ *  \brief  Word characters as in the Scintilla whole word search
+ */
+inline bool isWordChar(char ch)
+{
+    return ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_' ||
+            (unsigned char)ch >= 0x80);
+}
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+/**
+ *  \brief  Builds the table from the command result - the first _definitionsLen
+ *          bytes are the defined names, the rest are the referenced only ones
+ */
+int SymbolTable::Parse(const CmdPtr_t& cmd)
+{
+    const unsigned len = cmd->ResultLen();
+
+    _names.assign(cmd->Result(), cmd->Result() + len);
+    _entries.clear();
+
+    const unsigned definitionsEnd = (_definitionsLen < len) ? _definitionsLen : len;
+
+    addNames(0, definitionsEnd, DEFINITION);
+    const size_t definitionsNum = _entries.size();
+    addNames(definitionsEnd, len, SYMBOL);
+
+    auto less = [this](const Entry& e1, const Entry& e2)
+    {
+        return compare(&_names[e1._offset], e1._len, &_names[e2._offset], e2._len) < 0;
+    };
+
+    // global lists the names sorted unless they come from several (library) databases
+    const auto middle = _entries.begin() + definitionsNum;
+
+    if (!std::is_sorted(_entries.begin(), middle, less))
+        std::sort(_entries.begin(), middle, less);
+    if (!std::is_sorted(middle, _entries.end(), less))
+        std::sort(middle, _entries.end(), less);
+
+    // Stable merge - for names listed twice the definition comes first and is kept
+    std::inplace_merge(_entries.begin(), middle, _entries.end(), less);
+
+    _entries.erase(std::unique(_entries.begin(), _entries.end(),
+            [&less](const Entry& e1, const Entry& e2) { return !less(e1, e2); }), _entries.end());
+
+    return _entries.size();
+}
+
+
+/**
+ *  \brief
+ */
+SymbolTable::Kind_t SymbolTable::Find(const char* name, unsigned len) const
+{
+    auto iEntry = std::lower_bound(_entries.begin(), _entries.end(), name,
+            [this, len](const Entry& entry, const char* name)
+            {
+                return compare(&_names[entry._offset], entry._len, name, len) < 0;
+            });
+
+    if (iEntry != _entries.end() && !compare(&_names[iEntry->_offset], iEntry->_len, name, len))
+        return iEntry->_kind;
+
+    return UNKNOWN;
+}
+
+
+/**
+ *  \brief  Resolves the names in sorted order so the table is searched in a
+ *          single forward pass - each search starts where the previous ended
+ */
+void SymbolTable::Resolve(const std::vector<std::string>& names, std::vector<Kind_t>& kinds) const
+{
+    kinds.assign(names.size(), UNKNOWN);
+
+    std::vector<unsigned> order(names.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+            [&names](unsigned i1, unsigned i2) { return names[i1] < names[i2]; });
+
+    auto iEntry = _entries.begin();
+
+    for (unsigned idx : order)
+    {
+        const char* name = names[idx].c_str();
+        const unsigned len = names[idx].size();
+
+        iEntry = std::lower_bound(iEntry, _entries.end(), name,
+                [this, len](const Entry& entry, const char* name)
+                {
+                    return compare(&_names[entry._offset], entry._len, name, len) < 0;
+                });
+
+        if (iEntry == _entries.end())
+            break;
+
+        if (!compare(&_names[iEntry->_offset], iEntry->_len, name, len))
+            kinds[idx] = iEntry->_kind;
+    }
+}
+
+
+/**
+ *  \brief  Byte order as the names are sorted by global
+ */
+int SymbolTable::compare(const char* name1, unsigned len1, const char* name2, unsigned len2)
+{
+    const int r = memcmp(name1, name2, (len1 < len2) ? len1 : len2);
+    if (r)
+        return r;
+
+    return (len1 < len2) ? -1 : (len1 > len2) ? 1 : 0;
+}
+
+
+/**
+ *  \brief  Adds the names (one per line) found in _names[offset, end)
+ */
+void SymbolTable::addNames(unsigned offset, unsigned end, Kind_t kind)
+{
+    while (offset < end)
+    {
+        unsigned lineEnd = offset;
+        while (lineEnd < end && _names[lineEnd] != '\n')
+            ++lineEnd;
+
+        unsigned len = lineEnd - offset;
+        if (len && _names[offset + len - 1] == '\r')
+            --len;
+
+        if (len)
+        {
+            Entry entry = { offset, len, kind };
+            _entries.push_back(entry);
+        }
+
+        offset = lineEnd + 1;
+    }
+}
+
+
+/**
+ *  \brief  Resolves the batch of names for the file's database. Returns false
+ *          if the database symbol table is not loaded yet - in that case it is
+ *          being loaded and readyCB will be called once that's done.
+ *          The tables are reloaded in the background when the database changes
+ *          and the old one is used meanwhile.
+ */
+bool SymbolResolver::Resolve(const CPath& file, LRESULT bufferId, const std::vector<std::string>& names,
+        std::vector<SymbolTable::Kind_t>& kinds, ReadyCB readyCB)
+{
+    bool success;
+    DbHandle db = DbManager::Get().GetDb(file, false, &success);
+
+    if (!db && GTagsSettings._useDefDb && !GTagsSettings._defDbPath.IsEmpty())
+        db = DbManager::Get().GetDbAt(GTagsSettings._defDbPath, false, &success);
+
+    if (!db)
+        return false;
+
+    DbTable& dbt = dbTable(db->GetPath());
+
+    if (success)
+    {
+        // The database stays locked for reading until the table is loaded
+        if (!dbt._loading && (!dbt._table || dbt._tagsVersion != db->TagsVersion()))
+        {
+            dbt._loading = true;
+
+            CmdPtr_t cmd(new Cmd(LIST_DEFINITIONS, _T("List Definitions"), db));
+            CmdEngine::Run(cmd, definitionsCB);
+        }
+        else
+        {
+            DbManager::Get().PutDb(db);
+        }
+    }
+
+    if (!dbt._table)
+    {
+        dbt._readyCB = readyCB;
+        return false;
+    }
+
+    BufferCache& cache = _buffers[bufferId];
+
+    if (cache._cachedVersion != cache._version || cache._table != dbt._table)
+    {
+        cache._kinds.clear();
+        cache._cachedVersion = cache._version;
+        cache._table = dbt._table;
+    }
+
+    kinds.resize(names.size());
+    _stats._lookups += names.size();
+
+    std::vector<std::string> uncached;
+    std::vector<unsigned> uncachedIdx;
+
+    for (unsigned i = 0; i < names.size(); ++i)
+    {
+        auto iCached = cache._kinds.find(names[i]);
+
+        if (iCached != cache._kinds.end())
+        {
+            kinds[i] = iCached->second;
+            ++_stats._cacheHits;
+        }
+        else
+        {
+            uncached.push_back(names[i]);
+            uncachedIdx.push_back(i);
+        }
+    }
+
+    if (!uncached.empty())
+    {
+        std::vector<SymbolTable::Kind_t> uncachedKinds;
+        dbt._table->Resolve(uncached, uncachedKinds);
+
+        for (unsigned i = 0; i < uncached.size(); ++i)
+        {
+            kinds[uncachedIdx[i]] = uncachedKinds[i];
+            cache._kinds[uncached[i]] = uncachedKinds[i];
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ *  \brief  Resolves all identifiers in the visible range of the current editor
+ */
+bool SymbolResolver::ResolveVisible(std::vector<Symbol>& symbols, ReadyCB readyCB)
+{
+    INpp& npp = INpp::Get();
+    npp.ReadSciHandle();
+
+    CPath file;
+    npp.GetFilePath(file);
+
+    long startPos, endPos;
+    npp.GetVisibleRange(startPos, endPos);
+
+    CTextA text;
+    npp.GetTextRange(text, startPos, endPos);
+
+    symbols.clear();
+
+    std::vector<std::string> names;
+    std::vector<unsigned> nameIdx;
+    std::unordered_map<std::string, unsigned> uniqueNames;
+
+    const char* str = text.C_str();
+    const unsigned len = text.Len();
+
+    for (unsigned i = 0; i < len;)
+    {
+        if (!isWordChar(str[i]))
+        {
+            ++i;
+            continue;
+        }
+
+        const unsigned wordStart = i;
+        while (i < len && isWordChar(str[i]))
+            ++i;
+
+        // Skip numbers
+        if (str[wordStart] >= '0' && str[wordStart] <= '9')
+            continue;
+
+        auto iName = uniqueNames.insert(std::make_pair(std::string(str + wordStart, i - wordStart),
+                (unsigned)names.size()));
+        if (iName.second)
+            names.push_back(iName.first->first);
+
+        Symbol symbol = { startPos + (long)wordStart, i - wordStart, SymbolTable::UNKNOWN };
+        symbols.push_back(symbol);
+        nameIdx.push_back(iName.first->second);
+    }
+
+    std::vector<SymbolTable::Kind_t> kinds;
+
+    if (!Resolve(file, npp.GetCurrentBufferId(), names, kinds, readyCB))
+    {
+        symbols.clear();
+        return false;
+    }
+
+    for (unsigned i = 0; i < symbols.size(); ++i)
+        symbols[i]._kind = kinds[nameIdx[i]];
+
+    return true;
+}
+
+
+/**
+ *  \brief  Invalidates the cached results - called on each buffer text change
+ */
+void SymbolResolver::BufferModified(LRESULT bufferId)
+{
+    auto iCache = _buffers.find(bufferId);
+
+    if (iCache != _buffers.end())
+        ++iCache->second._version;
+}
+
+
+/**
+ *  \brief
+ */
+void SymbolResolver::BufferClosed(LRESULT bufferId)
+{
+    _buffers.erase(bufferId);
+}
+
+
+/**
+ *  \brief  The same command continues with listing the referenced only symbols
+ */
+void SymbolResolver::definitionsCB(const CmdPtr_t& cmd)
+{
+    if (cmd->Status() == CANCELLED)
+    {
+        Get().loadCancelled(cmd);
+        return;
+    }
+
+    if (cmd->Status() == OK)
+    {
+        cmd->Parser(ParserPtr_t(new SymbolTable(cmd->Result() ? cmd->ResultLen() : 0)));
+        cmd->Id(LIST_SYMBOLS);
+        cmd->Name(_T("List Symbols"));
+
+        CmdEngine::Run(cmd, symbolsCB);
+        return;
+    }
+
+    const unsigned tagsVersion = cmd->Db()->TagsVersion();
+    DbManager::Get().PutDb(cmd->Db());
+
+    Get().tableLoaded(cmd->Db()->GetPath(), tagsVersion, NULL);
+}
+
+
+/**
+ *  \brief
+ */
+void SymbolResolver::symbolsCB(const CmdPtr_t& cmd)
+{
+    if (cmd->Status() == CANCELLED)
+    {
+        Get().loadCancelled(cmd);
+        return;
+    }
+
+    std::shared_ptr<const SymbolTable> table;
+
+    if (cmd->Status() == OK || cmd->Status() == PARSE_EMPTY)
+        table = std::static_pointer_cast<const SymbolTable>(cmd->Parser());
+
+    const unsigned tagsVersion = cmd->Db()->TagsVersion();
+    DbManager::Get().PutDb(cmd->Db());
+
+    Get().tableLoaded(cmd->Db()->GetPath(), tagsVersion, table);
+}
+
+
+/**
+ *  \brief
+ */
+SymbolResolver::DbTable& SymbolResolver::dbTable(const CPath& dbPath)
+{
+    for (auto iTable = _tables.begin(); iTable != _tables.end(); ++iTable)
+        if (iTable->_dbPath == dbPath)
+            return *iTable;
+
+    _tables.push_back(DbTable(dbPath));
+
+    return _tables.back();
+}
+
+
+/**
+ *  \brief  On failure an empty table is set so the load is not retried until
+ *          the database changes - all names are resolved as UNKNOWN meanwhile
+ */
+void SymbolResolver::tableLoaded(const CPath& dbPath, unsigned tagsVersion,
+        const std::shared_ptr<const SymbolTable>& table)
+{
+    DbTable& dbt = dbTable(dbPath);
+
+    dbt._loading = false;
+    dbt._tagsVersion = tagsVersion;
+
+    if (table)
+    {
+        dbt._table = table;
+        ++_stats._tableLoads;
+    }
+    else if (!dbt._table)
+        dbt._table.reset(new SymbolTable);
+
+    if (dbt._readyCB)
+    {
+        ReadyCB readyCB = dbt._readyCB;
+        dbt._readyCB = NULL;
+        readyCB();
+    }
+}
+
+
+/**
+ *  \brief  The table is not marked as loaded - the next Resolve loads it
+ *          again and readyCB is called then
+ */
+void SymbolResolver::loadCancelled(const CmdPtr_t& cmd)
+{
+    DbManager::Get().PutDb(cmd->Db());
+
+    dbTable(cmd->Db()->GetPath())._loading = false;
+}
+
+} // namespace GTags
@@ -0,0 +1,186 @@
+/**
+ *  \file
+ *  \brief  Batch symbol resolution for the identifiers in the visible editor range
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include <string>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include "Common.h"
+#include "CmdDefines.h"
+#include "Cmd.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  SymbolTable
+ *  \brief  Sorted table of all tag names in the database built from the output
+ *          of LIST_DEFINITIONS followed by LIST_SYMBOLS. A batch of identifiers
+ *          is resolved in a single pass over the table.
+ */
+class SymbolTable : public ResultParser
+{
+public:
+    enum Kind_t
+    {
+        UNKNOWN = 0,
+        SYMBOL,         // Referenced only - no definition in the database
+        DEFINITION
+    };
+
+    SymbolTable(unsigned definitionsLen = 0) : _definitionsLen(definitionsLen) {}
+    virtual ~SymbolTable() {}
+
+    virtual int Parse(const CmdPtr_t&);
+
+    inline unsigned Size() const { return _entries.size(); }
+
+    Kind_t Find(const char* name, unsigned len) const;
+    void Resolve(const std::vector<std::string>& names, std::vector<Kind_t>& kinds) const;
+
+private:
+    /**
+     *  \struct  Entry
+     *  \brief
+     */
+    struct Entry
+    {
+        unsigned    _offset;
+        unsigned    _len;
+        Kind_t      _kind;
+    };
+
+    static int compare(const char* name1, unsigned len1, const char* name2, unsigned len2);
+
+    void addNames(unsigned offset, unsigned end, Kind_t kind);
+
+    unsigned            _definitionsLen;
+    std::vector<char>   _names;
+    std::vector<Entry>  _entries;
+};
+
+
+/**
+ *  \class  SymbolResolver
+ *  \brief  Keeps a SymbolTable per database, reloaded in the background when
+ *          the database tags change, and caches the resolved identifiers per
+ *          editor buffer until the buffer is modified
+ */
+class SymbolResolver
+{
+public:
+    typedef void (*ReadyCB)();
+
+    /**
+     *  \struct  Symbol
+     *  \brief  Identifier occurrence in the visible range
+     */
+    struct Symbol
+    {
+        long                _pos;
+        unsigned            _len;
+        SymbolTable::Kind_t _kind;
+    };
+
+    /**
+     *  \struct  Stats
+     *  \brief
+     */
+    struct Stats
+    {
+        unsigned    _lookups;       // Names resolved
+        unsigned    _cacheHits;     // Names resolved from the buffer cache
+        unsigned    _tableLoads;
+    };
+
+    static SymbolResolver& Get()
+    {
+        static SymbolResolver Instance;
+        return Instance;
+    }
+
+    bool Resolve(const CPath& file, LRESULT bufferId, const std::vector<std::string>& names,
+            std::vector<SymbolTable::Kind_t>& kinds, ReadyCB readyCB = NULL);
+    bool ResolveVisible(std::vector<Symbol>& symbols, ReadyCB readyCB = NULL);
+
+    void BufferModified(LRESULT bufferId);
+    void BufferClosed(LRESULT bufferId);
+
+    void GetStats(Stats& stats) const { stats = _stats; }
+
+private:
+    /**
+     *  \struct  DbTable
+     *  \brief
+     */
+    struct DbTable
+    {
+        DbTable(const CPath& dbPath) : _dbPath(dbPath), _tagsVersion(0), _loading(false), _readyCB(NULL) {}
+
+        CPath                                   _dbPath;
+        unsigned                                _tagsVersion;
+        std::shared_ptr<const SymbolTable>      _table;
+        bool                                    _loading;
+        ReadyCB                                 _readyCB;
+    };
+
+    /**
+     *  \struct  BufferCache
+     *  \brief  Resolved identifiers valid while the buffer version and the table match
+     */
+    struct BufferCache
+    {
+        BufferCache() : _version(0), _cachedVersion(0) {}
+
+        unsigned                                                _version;
+        unsigned                                                _cachedVersion;
+        std::shared_ptr<const SymbolTable>                      _table;
+        std::unordered_map<std::string, SymbolTable::Kind_t>    _kinds;
+    };
+
+    static void definitionsCB(const CmdPtr_t& cmd);
+    static void symbolsCB(const CmdPtr_t& cmd);
+
+    SymbolResolver() { memset(&_stats, 0, sizeof(_stats)); }
+    SymbolResolver(const SymbolResolver&);
+    ~SymbolResolver() {}
+
+    DbTable& dbTable(const CPath& dbPath);
+    void tableLoaded(const CPath& dbPath, unsigned tagsVersion, const std::shared_ptr<const SymbolTable>& table);
+    void loadCancelled(const CmdPtr_t& cmd);
+
+    std::list<DbTable>                  _tables;
+    std::map<LRESULT, BufferCache>      _buffers;
+    Stats                               _stats;
+};
+
+} // namespace GTags
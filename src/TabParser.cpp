@@ -0,0 +1,754 @@
+/**
+ *  \file
+ *  \brief  Result window tab content parser
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <string.h>
+#include <regex>
+#include <memory>
+#include "TabParser.h"
+#include "LzCodec.h"
+#include "GrepEngine.h"
+#include "PathTable.h"
+#include "StrUniquenessChecker.h"
+
+
+namespace
+{
+
+/**
+ *  \brief
+ */
+inline char foldCase(char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? ch + ('a' - 'A') : ch;
+}
+
+
+/**
+ *  \brief  Word characters as in the Scintilla whole word search
+ */
+inline bool isWordChar(char ch)
+{
+    return ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_' ||
+            (unsigned char)ch >= 0x80);
+}
+
+
+/**
+ *  \brief  Checks the match edges as the Scintilla whole word search
+ */
+bool isWholeWord(const char* lineBegin, const char* lineEnd, const char* matchBegin, const char* matchEnd)
+{
+    if (matchBegin > lineBegin && isWordChar(*(matchBegin - 1)) && isWordChar(*matchBegin))
+        return false;
+
+    if (matchEnd < lineEnd && isWordChar(*matchEnd) && isWordChar(*(matchEnd - 1)))
+        return false;
+
+    return true;
+}
+
+
+/**
+ *  \class  HitFinder
+ *  \brief  Finds the search matches in the result preview lines the way the
+ *          results window highlights them
+ */
+class HitFinder
+{
+public:
+    HitFinder(const char* pattern, bool ignoreCase, bool wholeWord, bool regExp);
+    ~HitFinder() {}
+
+    bool Find(const char* lineBegin, const char* lineEnd, const char*& matchBegin, const char*& matchEnd) const;
+
+private:
+    HitFinder(const HitFinder&);
+    const HitFinder& operator=(const HitFinder&);
+
+    bool findLiteral(const char* begin, const char* end, const char*& matchBegin) const;
+
+    std::string                     _pattern;
+    const bool                      _ignoreCase;
+    const bool                      _wholeWord;
+    std::unique_ptr<std::regex>     _re;
+};
+
+
+/**
+ *  \brief
+ */
+HitFinder::HitFinder(const char* pattern, bool ignoreCase, bool wholeWord, bool regExp) :
+    _pattern(pattern), _ignoreCase(ignoreCase), _wholeWord(wholeWord)
+{
+    if (regExp)
+    {
+        std::regex::flag_type flags = std::regex::extended;
+        if (_ignoreCase)
+            flags |= std::regex::icase;
+
+        try
+        {
+            _re.reset(new std::regex(_pattern, flags));
+        }
+        catch (const std::regex_error&)
+        {
+            _pattern.clear();
+        }
+    }
+    else if (_ignoreCase)
+    {
+        for (auto& ch : _pattern)
+            ch = foldCase(ch);
+    }
+}
+
+
+/**
+ *  \brief  Finds the first match in [matchBegin, lineEnd). matchBegin must be
+ *          within the line - the line beginning is needed for the word and
+ *          line start checks.
+ */
+bool HitFinder::Find(const char* lineBegin, const char* lineEnd, const char*& matchBegin,
+        const char*& matchEnd) const
+{
+    if (_pattern.empty())
+        return false;
+
+    for (const char* pos = matchBegin; pos < lineEnd; ++pos)
+    {
+        if (_re)
+        {
+            std::cmatch match;
+            const std::regex_constants::match_flag_type flags = (pos > lineBegin) ?
+                    std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+
+            if (!std::regex_search(pos, lineEnd, match, *_re, flags))
+                return false;
+
+            // Empty matches are not highlighted
+            if (match.length(0) == 0)
+            {
+                pos = match[0].first;
+                continue;
+            }
+
+            matchBegin  = match[0].first;
+            matchEnd    = match[0].second;
+        }
+        else
+        {
+            if (!findLiteral(pos, lineEnd, matchBegin))
+                return false;
+
+            matchEnd = matchBegin + _pattern.size();
+        }
+
+        if (!_wholeWord || isWholeWord(lineBegin, lineEnd, matchBegin, matchEnd))
+            return true;
+
+        pos = matchBegin;
+    }
+
+    return false;
+}
+
+
+/**
+ *  \brief
+ */
+bool HitFinder::findLiteral(const char* begin, const char* end, const char*& matchBegin) const
+{
+    const size_t len = _pattern.size();
+
+    for (const char* p = begin; p + len <= end; ++p)
+    {
+        size_t i = 0;
+
+        if (_ignoreCase)
+        {
+            while (i < len && foldCase(p[i]) == _pattern[i])
+                ++i;
+        }
+        else
+        {
+            while (i < len && p[i] == _pattern[i])
+                ++i;
+        }
+
+        if (i == len)
+        {
+            matchBegin = p;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+const char      TabParser::cFilePrefix[]    = "\t";
+const char      TabParser::cResultPrefix[]  = "\t\tline ";
+const unsigned  TabParser::cFilePrefixLen   = _countof(TabParser::cFilePrefix) - 1;
+const unsigned  TabParser::cResultPrefixLen = _countof(TabParser::cResultPrefix) - 1;
+
+
+/**
+ *  \brief
+ */
+int TabParser::Parse(const CmdPtr_t& cmd)
+{
+    _data.clear();
+    _files.clear();
+    _results.clear();
+    _hits.clear();
+    _foldedData.clear();
+
+    // Add the search header - cmd name + search word + project path
+    _buf = cmd->Name();
+    _buf += " \"";
+    _buf += cmd->Tag().C_str();
+    _buf += "\"";
+
+    if (cmd->RegExp() || cmd->IgnoreCase())
+    {
+        _buf += " (";
+
+        if (cmd->RegExp())
+        {
+            _buf += "regexp";
+
+            if (cmd->IgnoreCase())
+                _buf += ", ";
+        }
+
+        if (cmd->IgnoreCase())
+            _buf += "ignore case";
+
+        _buf += ")";
+    }
+
+    _buf += " in \"";
+    _buf += cmd->Db()->GetPath().C_str();
+    _buf += "\"";
+
+    if (cmd->IsTruncated())
+        _buf += " - output truncated, only the first results are shown";
+
+    // parsing command result
+    const int result = (cmd->Id() == FIND_FILE) ? parseFindFile(cmd) : parseCmd(cmd);
+
+    _data.shrink_to_fit();
+    _files.shrink_to_fit();
+    _results.shrink_to_fit();
+    _hits.shrink_to_fit();
+
+    return result;
+}
+
+
+/**
+ *  \brief
+ */
+unsigned TabParser::ResultsCount(unsigned file) const
+{
+    const unsigned end = (file + 1 < _files.size()) ? _files[file + 1]._firstResult : _results.size();
+
+    return end - _files[file]._firstResult;
+}
+
+
+/**
+ *  \brief  Appends the file line as shown in the results window tab
+ */
+void TabParser::AppendFile(CTextA& buf, unsigned file) const
+{
+    buf += "\n";
+    buf += cFilePrefix;
+    buf.Append(_data.data() + _files[file]._path, _files[file]._pathLen);
+}
+
+
+/**
+ *  \brief  Appends the result lines of the file as shown in the results window tab
+ */
+void TabParser::AppendResults(CTextA& buf, unsigned file) const
+{
+    const unsigned first = _files[file]._firstResult;
+    const unsigned end = first + ResultsCount(file);
+
+    for (unsigned i = first; i < end; ++i)
+    {
+        buf += "\n";
+        buf += cResultPrefix;
+        buf.Append(_data.data() + _results[i]._text, _results[i]._textLen);
+    }
+}
+
+
+/**
+ *  \brief  Returns the hits on the given result line of the file (NULL if none)
+ */
+const TabParser::Hit* TabParser::GetHits(unsigned file, unsigned result, unsigned& hitsCount,
+        unsigned& previewCol) const
+{
+    hitsCount   = 0;
+    previewCol  = 0;
+
+    if (file >= _files.size() || result >= ResultsCount(file))
+        return NULL;
+
+    const unsigned i = _files[file]._firstResult + result;
+    const unsigned end = (i + 1 < _results.size()) ? _results[i + 1]._firstHit : _hits.size();
+
+    if (end == _results[i]._firstHit)
+        return NULL;
+
+    hitsCount   = end - _results[i]._firstHit;
+    previewCol  = _results[i]._previewCol;
+
+    return &_hits[_results[i]._firstHit];
+}
+
+
+/**
+ *  \brief  Finds all matches in the file paths and the result texts in the tab
+ *          order. Literal patterns are searched span by span in the
+ *          (case folded) model buffer.
+ */
+void TabParser::FindAll(const char* pattern, bool ignoreCase, bool wholeWord, bool regExp,
+        std::vector<Match>& matches) const
+{
+    matches.clear();
+
+    if (*pattern == 0 || _files.empty())
+        return;
+
+    unsigned file = 0;
+    int result = -1;
+    unsigned spanBegin, spanEnd;
+
+    if (regExp)
+    {
+        HitFinder hitFinder(pattern, ignoreCase, wholeWord, true);
+
+        do
+        {
+            getSpan(file, result, spanBegin, spanEnd);
+
+            const char* begin = _data.data() + spanBegin;
+            const char* end = _data.data() + spanEnd;
+
+            for (const char* matchBegin = begin, *matchEnd;
+                    hitFinder.Find(begin, end, matchBegin, matchEnd); matchBegin = matchEnd)
+            {
+                const Match match = { file, result, (unsigned)(matchBegin - begin), (unsigned)(matchEnd - matchBegin) };
+                matches.push_back(match);
+            }
+        }
+        while (nextSpan(file, result));
+
+        return;
+    }
+
+    std::string search(pattern);
+    const char* data = _data.data();
+
+    if (ignoreCase)
+    {
+        for (auto& ch : search)
+            ch = foldCase(ch);
+
+        if (_foldedData.size() != _data.size())
+        {
+            _foldedData.resize(_data.size());
+
+            for (size_t i = 0; i < _data.size(); ++i)
+                _foldedData[i] = foldCase(_data[i]);
+        }
+
+        data = _foldedData.data();
+    }
+
+    const unsigned len = search.size();
+
+    // Each span is searched on its own so matches never run into the next one
+    do
+    {
+        getSpan(file, result, spanBegin, spanEnd);
+
+        const char* begin = data + spanBegin;
+        const char* end = data + spanEnd;
+
+        for (const char* pos = begin; (pos = GrepEngine::FindLiteral(pos, end, search, false)) != NULL;)
+        {
+            if (wholeWord && !isWholeWord(begin, end, pos, pos + len))
+            {
+                ++pos;
+                continue;
+            }
+
+            const Match match = { file, result, (unsigned)(pos - begin), len };
+            matches.push_back(match);
+
+            pos += len;
+        }
+    }
+    while (nextSpan(file, result));
+}
+
+
+/**
+ *  \brief  Memory held by the parsed model
+ */
+size_t TabParser::Size() const
+{
+    return _data.capacity() + _files.capacity() * sizeof(File) + _results.capacity() * sizeof(Result) +
+            _hits.capacity() * sizeof(Hit) + _foldedData.capacity();
+}
+
+
+/**
+ *  \brief  Compresses the parsed model into packed and frees it. The header
+ *          (GetText()) is kept.
+ */
+void TabParser::Pack(std::vector<char>& packed)
+{
+    const Counts counts = { (unsigned)_data.size(), (unsigned)_files.size(), (unsigned)_results.size(),
+            (unsigned)_hits.size() };
+
+    std::vector<char> raw;
+    raw.reserve(sizeof(counts) + _files.size() * sizeof(File) + _results.size() * sizeof(Result) +
+            _hits.size() * sizeof(Hit) + _data.size());
+
+    raw.insert(raw.end(), (const char*)&counts, (const char*)(&counts + 1));
+    raw.insert(raw.end(), (const char*)_files.data(), (const char*)(_files.data() + _files.size()));
+    raw.insert(raw.end(), (const char*)_results.data(), (const char*)(_results.data() + _results.size()));
+    raw.insert(raw.end(), (const char*)_hits.data(), (const char*)(_hits.data() + _hits.size()));
+    raw.insert(raw.end(), _data.begin(), _data.end());
+
+    LzCodec::Compress(raw.data(), raw.size(), packed);
+
+    std::vector<char>().swap(_data);
+    std::vector<File>().swap(_files);
+    std::vector<Result>().swap(_results);
+    std::vector<Hit>().swap(_hits);
+    std::vector<char>().swap(_foldedData);
+}
+
+
+/**
+ *  \brief  Restores the model compressed by Pack()
+ */
+bool TabParser::Unpack(const char* packed, size_t len)
+{
+    std::vector<char> raw;
+
+    if (!LzCodec::Decompress(packed, len, raw) || raw.size() < sizeof(Counts))
+        return false;
+
+    Counts counts;
+    memcpy(&counts, raw.data(), sizeof(counts));
+
+    if (raw.size() != sizeof(counts) + counts._files * sizeof(File) + counts._results * sizeof(Result) +
+            counts._hits * sizeof(Hit) + counts._data)
+        return false;
+
+    const char* pSrc = raw.data() + sizeof(counts);
+
+    const File* files = reinterpret_cast<const File*>(pSrc);
+    _files.assign(files, files + counts._files);
+    pSrc += counts._files * sizeof(File);
+
+    const Result* results = reinterpret_cast<const Result*>(pSrc);
+    _results.assign(results, results + counts._results);
+    pSrc += counts._results * sizeof(Result);
+
+    const Hit* hits = reinterpret_cast<const Hit*>(pSrc);
+    _hits.assign(hits, hits + counts._hits);
+    pSrc += counts._hits * sizeof(Hit);
+
+    _data.assign(pSrc, pSrc + counts._data);
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+bool TabParser::FilterEntry(const DbConfig& cfg, const char* pEntry, unsigned len)
+{
+    if (cfg._usePathFilter && !cfg._filterIds.empty())
+        return cfg.IsFiltered(PathTable::Get().Intern(pEntry, len));
+
+    return false;
+}
+
+
+/**
+ *  \brief
+ */
+void TabParser::addFile(const char* path, unsigned len)
+{
+    const File file = { (unsigned)_data.size(), len, (unsigned)_results.size() };
+    _files.push_back(file);
+
+    appendData(path, len);
+}
+
+
+/**
+ *  \brief
+ */
+inline void TabParser::appendData(const char* data, unsigned len)
+{
+    _data.insert(_data.end(), data, data + len);
+}
+
+
+/**
+ *  \brief  Moves to the next text span in the tab order - the file path is
+ *          followed by the file results. Returns false after the last one.
+ */
+bool TabParser::nextSpan(unsigned& file, int& result) const
+{
+    if ((unsigned)(result + 1) < ResultsCount(file))
+    {
+        ++result;
+        return true;
+    }
+
+    if (file + 1 >= _files.size())
+        return false;
+
+    ++file;
+    result = -1;
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+void TabParser::getSpan(unsigned file, int result, unsigned& begin, unsigned& end) const
+{
+    if (result < 0)
+    {
+        begin   = _files[file]._path;
+        end     = begin + _files[file]._pathLen;
+    }
+    else
+    {
+        const Result& res = _results[_files[file]._firstResult + result];
+
+        begin   = res._text;
+        end     = begin + res._textLen;
+    }
+}
+
+
+/**
+ *  \brief
+ */
+int TabParser::parseFindFile(const CmdPtr_t& cmd)
+{
+    int result = 0;
+
+    const char* pSrc = cmd->Result();
+    const char* pEol;
+
+    const DbConfigPtr cfg = cmd->Db()->GetConfig();
+
+    for (;;)
+    {
+        while (*pSrc == '\n' || *pSrc == '\r' || *pSrc == ' ' || *pSrc == '\t')
+            ++pSrc;
+        if (*pSrc == 0) break;
+
+        pEol = pSrc;
+        while (*pEol != '\n' && *pEol != '\r' && *pEol != 0)
+            ++pEol;
+
+        if (!FilterEntry(*cfg, pSrc, pEol - pSrc))
+        {
+            addFile(pSrc, pEol - pSrc);
+
+            ++result;
+        }
+
+        pSrc = pEol;
+    }
+
+    return result;
+}
+
+
+/**
+ *  \brief
+ */
+int TabParser::parseCmd(const CmdPtr_t& cmd)
+{
+    int result = 0;
+
+    bool filterReoccurring = false;
+
+    const DbConfigPtr cfg = cmd->Db()->GetConfig();
+    if (cmd->Id() == FIND_DEFINITION && cfg->_useLibDb)
+        filterReoccurring = cfg->_isLibDb;
+
+    StrUniquenessChecker<char> strChecker;
+
+    CTextA search(cmd->Tag().C_str());
+    HitFinder hitFinder(search.C_str(), cmd->IgnoreCase(), cmd->Id() != GREP && cmd->Id() != GREP_TEXT,
+            cmd->RegExp());
+
+    char*       pSrc = cmd->Result();
+    char*       pIdx;
+
+    const char* pLine;
+    const char* pPreviousFile = NULL;
+    unsigned    previousFileLen = 0;
+    bool        previousFileFiltered = false;
+
+    unsigned    previousDataLen;
+    unsigned    previousFilesNum;
+    unsigned    previousResultsNum;
+    unsigned    previousHitsNum;
+
+    for (;;)
+    {
+        while (*pSrc == '\n' || *pSrc == '\r')
+            ++pSrc;
+        if (*pSrc == 0) break;
+
+        previousDataLen     = _data.size();
+        previousFilesNum    = _files.size();
+        previousResultsNum  = _results.size();
+        previousHitsNum     = _hits.size();
+        pLine = pSrc;
+
+        pIdx = pSrc;
+        while (*pIdx != ':')
+            ++pIdx;
+
+        // Path is absolute (starts with drive letter)
+        if ((pIdx - pSrc == 1) && ((*(pIdx + 1) == '\\') || (*(pIdx + 1) == '/')))
+            while (*++pIdx != ':');
+
+        // add new file only if it is different than the previous one
+        if ((pPreviousFile == NULL) || ((unsigned)(pIdx - pSrc) != previousFileLen) ||
+            strncmp(pSrc, pPreviousFile, previousFileLen))
+        {
+            pPreviousFile = pSrc;
+            previousFileLen = pIdx - pSrc;
+
+            if (FilterEntry(*cfg, pPreviousFile, previousFileLen))
+            {
+                previousFileFiltered = true;
+            }
+            else
+            {
+                addFile(pPreviousFile, previousFileLen);
+
+                previousFileFiltered = false;
+            }
+        }
+
+        if (previousFileFiltered)
+        {
+            while (*pSrc != '\n' && *pSrc != '\r')
+                ++pSrc;
+            continue;
+        }
+
+        pSrc = ++pIdx;
+        while (*pSrc != ':')
+            ++pSrc;
+
+        Result res;
+        res._text = _data.size();
+
+        appendData(pIdx, pSrc - pIdx);
+        appendData(":\t", 2);
+
+        const char* pText = ++pSrc;
+
+        pIdx = pSrc;
+        while (*pIdx == ' ' || *pIdx == '\t')
+            ++pIdx;
+
+        pSrc = pIdx + 1;
+        while (*pSrc != '\n' && *pSrc != '\r')
+            ++pSrc;
+
+        if (pSrc == pIdx + 1)
+            return -1;
+
+        appendData(pIdx, pSrc - pIdx);
+
+        res._textLen    = _data.size() - res._text;
+        res._firstHit   = _hits.size();
+        res._previewCol = pIdx - pText;
+
+        for (const char* matchBegin = pIdx, *matchEnd;
+                hitFinder.Find(pIdx, pSrc, matchBegin, matchEnd); matchBegin = matchEnd)
+        {
+            const Hit hit = { (unsigned)(matchBegin - pText), (unsigned)(matchEnd - matchBegin) };
+            _hits.push_back(hit);
+        }
+
+        _results.push_back(res);
+
+        *pSrc++ = 0;
+
+        if (filterReoccurring && !strChecker.IsUnique(pLine))
+        {
+            // The file is added again with its next unique result
+            if (_files.size() != previousFilesNum)
+                pPreviousFile = NULL;
+
+            _data.resize(previousDataLen);
+            _files.resize(previousFilesNum);
+            _results.resize(previousResultsNum);
+            _hits.resize(previousHitsNum);
+        }
+        else
+        {
+            ++result;
+        }
+    }
+
+    return result;
+}
+
+} // namespace GTags
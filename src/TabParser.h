@@ -0,0 +1,170 @@
+/**
+ *  \file
+ *  \brief  Result window tab content parser
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include "Common.h"
+#include "Config.h"
+#include "Cmd.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  TabParser
+ *  \brief  Parses the command result into a compact model for the results
+ *          window tab - each file path and result preview is stored once and
+ *          the tab text is formatted per file only when the results window
+ *          loads it. GetText() returns the search header line. The search
+ *          matches in each result line are located while parsing so the
+ *          results window can highlight them and jump to them directly.
+ */
+class TabParser : public ResultParser
+{
+public:
+    /**
+     *  \struct  Hit
+     *  \brief  Search match in the source line - byte column and length
+     */
+    struct Hit
+    {
+        unsigned    _col;
+        unsigned    _len;
+    };
+
+    /**
+     *  \struct  Match
+     *  \brief  Search match in the tab text - _col is relative to the file
+     *          path if _result is -1, to the result text ("Num:\tpreview")
+     *          otherwise
+     */
+    struct Match
+    {
+        unsigned    _file;
+        int         _result;
+        unsigned    _col;
+        unsigned    _len;
+    };
+
+    // The file path and the result text prefixes in the results window tab lines
+    static const char       cFilePrefix[];
+    static const char       cResultPrefix[];
+    static const unsigned   cFilePrefixLen;
+    static const unsigned   cResultPrefixLen;
+
+    TabParser() {}
+    virtual ~TabParser() {}
+
+    virtual int Parse(const CmdPtr_t&);
+
+    inline unsigned FilesCount() const { return _files.size(); }
+    unsigned ResultsCount(unsigned file) const;
+
+    void AppendFile(CTextA& buf, unsigned file) const;
+    void AppendResults(CTextA& buf, unsigned file) const;
+
+    const Hit* GetHits(unsigned file, unsigned result, unsigned& hitsCount, unsigned& previewCol) const;
+
+    void FindAll(const char* pattern, bool ignoreCase, bool wholeWord, bool regExp,
+            std::vector<Match>& matches) const;
+
+    size_t Size() const;
+    void Pack(std::vector<char>& packed);
+    bool Unpack(const char* packed, size_t len);
+
+    static bool FilterEntry(const DbConfig& cfg, const char* pEntry, unsigned len);
+
+    // Convert between the Match _col and the column in the tab line
+    static inline unsigned LineCol(int result, unsigned col)
+    {
+        return col + ((result < 0) ? cFilePrefixLen : cResultPrefixLen);
+    }
+
+    static inline unsigned SpanCol(int result, unsigned lineCol)
+    {
+        const unsigned prefixLen = (result < 0) ? cFilePrefixLen : cResultPrefixLen;
+        return (lineCol > prefixLen) ? lineCol - prefixLen : 0;
+    }
+
+private:
+    /**
+     *  \struct  Counts
+     *  \brief  Header of the packed model
+     */
+    struct Counts
+    {
+        unsigned    _data;
+        unsigned    _files;
+        unsigned    _results;
+        unsigned    _hits;
+    };
+
+    /**
+     *  \struct  File
+     *  \brief  File path in _data and the index of its first result
+     */
+    struct File
+    {
+        unsigned    _path;
+        unsigned    _pathLen;
+        unsigned    _firstResult;
+    };
+
+    /**
+     *  \struct  Result
+     *  \brief  Result line text in _data ("Num:\tpreview") and the index of
+     *          its first hit. _previewCol is the source line column of the
+     *          first preview character (leading white-space is not shown).
+     */
+    struct Result
+    {
+        unsigned    _text;
+        unsigned    _textLen;
+        unsigned    _firstHit;
+        unsigned    _previewCol;
+    };
+
+    int parseCmd(const CmdPtr_t&);
+    int parseFindFile(const CmdPtr_t&);
+
+    void addFile(const char* path, unsigned len);
+    void appendData(const char* data, unsigned len);
+
+    bool nextSpan(unsigned& file, int& result) const;
+    void getSpan(unsigned file, int result, unsigned& begin, unsigned& end) const;
+
+    std::vector<char>       _data;
+    std::vector<File>       _files;
+    std::vector<Result>     _results;
+    std::vector<Hit>        _hits;
+
+    mutable std::vector<char>   _foldedData;    // Lower case _data for ignore case search - made on first use
+};
+
+} // namespace GTags
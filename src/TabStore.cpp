@@ -0,0 +1,285 @@
+/**
+ *  \file
+ *  \brief  Compressed storage of the inactive results window tabs
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include "GTags.h"
+#include "GrepEngine.h"
+#include "TabStore.h"
+
+
+namespace
+{
+
+/**
+ *  \brief
+ */
+inline double megabytes(size_t size)
+{
+    return size / (1024.0 * 1024.0);
+}
+
+} // anonymous namespace
+
+
+namespace GTags
+{
+
+const size_t TabStore::cMinSize = 64 * 1024;
+
+
+/**
+ *  \brief
+ */
+TabStore::~TabStore()
+{
+    while (!_entries.empty())
+        erase(_entries.begin());
+}
+
+
+/**
+ *  \brief  Sets the memory limit for the packed tabs - spills the excess
+ */
+void TabStore::SetBudget(size_t budget)
+{
+    _budget = budget;
+
+    fitBudget();
+}
+
+
+/**
+ *  \brief  Compresses the tab results - called when the tab is deactivated.
+ *          Small results are not worth it and are kept as they are.
+ */
+void TabStore::Pack(TabParser* parser)
+{
+    const size_t size = parser->Size();
+
+    if (size < cMinSize || find(parser) != _entries.end())
+        return;
+
+    _entries.push_front(Entry());
+
+    Entry& entry = _entries.front();
+    entry._parser   = parser;
+    entry._rawSize  = size;
+
+    parser->Pack(entry._packed);
+
+    entry._packed.shrink_to_fit();
+    entry._packedSize = entry._packed.size();
+
+    _memSize += entry._packedSize;
+
+    ++_stats._packed;
+
+    fitBudget();
+}
+
+
+/**
+ *  \brief  Decompresses the tab results if they are packed - called when the
+ *          tab is activated. Returns false if the results are lost.
+ */
+bool TabStore::Restore(TabParser* parser)
+{
+    auto iEntry = find(parser);
+    if (iEntry == _entries.end())
+        return true;
+
+    bool restored = false;
+
+    if (iEntry->_spillFile.IsEmpty())
+    {
+        restored = parser->Unpack(iEntry->_packed.data(), iEntry->_packed.size());
+    }
+    else
+    {
+        size_t size;
+        const char* buf = GrepEngine::MapFile(iEntry->_spillFile, size, false);
+
+        if (buf)
+        {
+            restored = parser->Unpack(buf, size);
+            UnmapViewOfFile(buf);
+        }
+    }
+
+    if (restored)
+        ++_stats._restored;
+    else
+        ++_stats._failed;
+
+    erase(iEntry);
+
+    return restored;
+}
+
+
+/**
+ *  \brief  Forgets the tab results - called when the tab is closed
+ */
+void TabStore::Drop(const TabParser* parser)
+{
+    auto iEntry = find(parser);
+    if (iEntry != _entries.end())
+        erase(iEntry);
+}
+
+
+/**
+ *  \brief
+ */
+void TabStore::GetStats(Stats& stats) const
+{
+    stats = _stats;
+
+    stats._rawSize      = 0;
+    stats._packedSize   = 0;
+    stats._memSize      = _memSize;
+
+    for (const auto& entry : _entries)
+    {
+        stats._rawSize      += entry._rawSize;
+        stats._packedSize   += entry._packedSize;
+    }
+}
+
+
+/**
+ *  \brief  Appends the inactive tabs counters to the command timings file
+ */
+bool TabStore::AppendStats(const CPath& file) const
+{
+    Stats stats;
+    GetStats(stats);
+
+    FILE* fp;
+    _tfopen_s(&fp, file.C_str(), _T("at"));
+    if (fp == NULL)
+        return false;
+
+    _ftprintf_s(fp, _T("\n# Inactive results window tabs\n"));
+    _ftprintf_s(fp, _T("# Packed %u, restored %u, spilled to disk %u, failed %u\n"),
+            stats._packed, stats._restored, stats._spilled, stats._failed);
+    _ftprintf_s(fp, _T("# Now %u tabs: %.2f MB packed to %.2f MB, %.2f MB in memory (budget %.2f MB)\n"),
+            (unsigned)_entries.size(), megabytes(stats._rawSize), megabytes(stats._packedSize),
+            megabytes(stats._memSize), megabytes(_budget));
+
+    fclose(fp);
+
+    return true;
+}
+
+
+/**
+ *  \brief
+ */
+std::list<TabStore::Entry>::iterator TabStore::find(const TabParser* parser)
+{
+    for (auto iEntry = _entries.begin(); iEntry != _entries.end(); ++iEntry)
+        if (iEntry->_parser == parser)
+            return iEntry;
+
+    return _entries.end();
+}
+
+
+/**
+ *  \brief
+ */
+void TabStore::erase(std::list<Entry>::iterator iEntry)
+{
+    if (iEntry->_spillFile.IsEmpty())
+        _memSize -= iEntry->_packedSize;
+    else
+        DeleteFile(iEntry->_spillFile.C_str());
+
+    _entries.erase(iEntry);
+}
+
+
+/**
+ *  \brief  Spills the least recently packed tabs until the rest fit in the budget
+ */
+void TabStore::fitBudget()
+{
+    for (auto iEntry = _entries.rbegin(); _memSize > _budget && iEntry != _entries.rend(); ++iEntry)
+    {
+        if (iEntry->_spillFile.IsEmpty() && !spill(*iEntry))
+            break;
+    }
+}
+
+
+/**
+ *  \brief
+ */
+bool TabStore::spill(Entry& entry)
+{
+    CPath spillFile(MAX_PATH);
+    GetTempPath(MAX_PATH, spillFile.C_str());
+    spillFile.AutoFit();
+
+    spillFile += cPluginName;
+    CreateDirectory(spillFile.C_str(), NULL);
+
+    // Process ID keeps the files of several Notepad++ instances apart
+    TCHAR name[64];
+    _sntprintf_s(name, _countof(name), _TRUNCATE, _T("\\Tab_%lu_%u.bin"), GetCurrentProcessId(), ++_spillId);
+    spillFile += name;
+
+    FILE* fp;
+    _tfopen_s(&fp, spillFile.C_str(), _T("wb"));
+    if (fp == NULL)
+    {
+        ++_stats._failed;
+        return false;
+    }
+
+    const bool written = (fwrite(entry._packed.data(), 1, entry._packed.size(), fp) == entry._packed.size());
+    fclose(fp);
+
+    if (!written)
+    {
+        DeleteFile(spillFile.C_str());
+        ++_stats._failed;
+        return false;
+    }
+
+    entry._spillFile = spillFile;
+    std::vector<char>().swap(entry._packed);
+
+    _memSize -= entry._packedSize;
+
+    ++_stats._spilled;
+
+    return true;
+}
+
+} // namespace GTags
@@ -0,0 +1,112 @@
+/**
+ *  \file
+ *  \brief  Compressed storage of the inactive results window tabs
+ *
+ *  \author  Pavel Nedev <pg.nedev@gmail.com>
+ *
+ *  \section COPYRIGHT
+ *  Copyright(C) 2019 Pavel Nedev
+ *
+ *  \section LICENSE
+ *  This program is free software; you can redistribute it and/or modify it
+ *  under the terms of the GNU General Public License version 2 as published
+ *  by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#pragma once
+
+
+#include <windows.h>
+#include <tchar.h>
+#include <vector>
+#include <list>
+#include "Common.h"
+#include "TabParser.h"
+
+
+namespace GTags
+{
+
+/**
+ *  \class  TabStore
+ *  \brief  Keeps the parsed results of the inactive results window tabs
+ *          compressed. When the compressed tabs exceed the memory budget the
+ *          least recently used ones are spilled to temp files which are mapped
+ *          back when the tab is activated. Used on the UI thread only.
+ */
+class TabStore
+{
+public:
+    /**
+     *  \struct  Stats
+     *  \brief
+     */
+    struct Stats
+    {
+        unsigned    _packed;
+        unsigned    _restored;
+        unsigned    _spilled;
+        unsigned    _failed;        // Spill or restore errors
+        size_t      _rawSize;       // Of the tabs packed at the moment
+        size_t      _packedSize;
+        size_t      _memSize;       // Packed size not spilled
+    };
+
+    static TabStore& Get()
+    {
+        static TabStore Instance;
+        return Instance;
+    }
+
+    void SetBudget(size_t budget);
+
+    void Pack(TabParser* parser);
+    bool Restore(TabParser* parser);
+    void Drop(const TabParser* parser);
+
+    void GetStats(Stats& stats) const;
+    bool AppendStats(const CPath& file) const;
+
+private:
+    static const size_t cMinSize;
+
+    /**
+     *  \struct  Entry
+     *  \brief  _packed is empty if the tab is spilled to _spillFile
+     */
+    struct Entry
+    {
+        const TabParser*    _parser;
+        size_t              _rawSize;
+        size_t              _packedSize;
+        std::vector<char>   _packed;
+        CPath               _spillFile;
+    };
+
+    TabStore() : _budget((size_t)-1), _memSize(0), _spillId(0) { memset(&_stats, 0, sizeof(_stats)); }
+    TabStore(const TabStore&);
+    ~TabStore();
+
+    std::list<Entry>::iterator find(const TabParser* parser);
+    void erase(std::list<Entry>::iterator iEntry);
+    void fitBudget();
+    bool spill(Entry& entry);
+
+    std::list<Entry>    _entries;   // Most recently packed first
+    size_t              _budget;
+    size_t              _memSize;
+    unsigned            _spillId;
+    Stats               _stats;
+};
+
+} // namespace GTags